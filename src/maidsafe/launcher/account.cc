@@ -32,6 +32,7 @@
 #include "maidsafe/common/serialisation/types/asio_and_boost_asio.h"
 
 #include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/app_field_traits.h"
 
 namespace maidsafe {
 
@@ -51,8 +52,14 @@ ImmutableData EncryptAccount(const authentication::UserCredentials& user_credent
   output_archive(account.passport->Encrypt(user_credentials), serialised_timestamp, account.ip,
                  account.port, unique_user_id, root_parent_id, account.config_file_aes_key_and_iv,
                  account.apps.size());
-  for (const auto& app : account.apps)
-    output_archive(app.name, app.permitted_dirs, app.icon);
+  // The apps are written from the traits, so a change to which fields are kInAccount changes the
+  // serialised Account.  That must be handled deliberately (e.g. by versioning), then this updated.
+  static_assert(kAccountAppFields == (kAppName | kAppPermittedDirs | kAppIcon),
+                "Changing the Account fields changes the serialised Account.");
+  for (const auto& app : account.apps) {
+    ForEachAccountField(
+        [&](auto field) { output_archive(AppFieldTraits<decltype(field)>::Get(app)); });
+  }
 
   NonEmptyString serialised_account{
       std::string(binary_output_stream.vector().begin(), binary_output_stream.vector().end())};
@@ -101,7 +108,8 @@ Account::Account(const ImmutableData& encrypted_account,
                 optional_root_parent_id, config_file_aes_key_and_iv, app_count);
   for (std::size_t i{0}; i < app_count; ++i) {
     AppDetails app_details;
-    input_archive(app_details.name, app_details.permitted_dirs, app_details.icon);
+    ForEachAccountField(
+        [&](auto field) { input_archive(AppFieldTraits<decltype(field)>::Get(app_details)); });
     apps.insert(apps.end(), std::move(app_details));
   }
 
@@ -18,6 +18,7 @@
 
 #include "maidsafe/launcher/account_handler.h"
 
+#include <exception>
 #include <string>
 #include <utility>
 
@@ -42,14 +43,25 @@ Identity GetAccountLocation(const authentication::UserCredentials::Keyword& keyw
                                                pin.Hash<crypto::SHA512>().string())};
 }
 
-AccountHandler::AccountHandler() : account_(), account_versions_(20, 1), user_credentials_() {}
+AccountHandler::AccountHandler()
+    : account_(),
+      account_versions_(20, 1),
+      user_credentials_(),
+      retry_policy_(),
+      hedge_policy_(),
+      network_stats_(std::make_shared<NetworkOperationStats>()),
+      read_latencies_(std::make_shared<LatencyTracker>()) {}
 
 AccountHandler::AccountHandler(Account&& account,
                                authentication::UserCredentials&& user_credentials,
                                NetworkClient& network_client)
     : account_(maidsafe::make_unique<Account>(std::move(account))),
       account_versions_(20, 1),
-      user_credentials_(std::move(user_credentials)) {
+      user_credentials_(std::move(user_credentials)),
+      retry_policy_(),
+      hedge_policy_(),
+      network_stats_(std::make_shared<NetworkOperationStats>()),
+      read_latencies_(std::make_shared<LatencyTracker>()) {
   // throw if private_client & account are not coherent
   // TODO(Prakash) Validate credentials
   Identity account_location{GetAccountLocation(*user_credentials_.keyword, *user_credentials_.pin)};
@@ -78,11 +90,13 @@ void AccountHandler::Login(authentication::UserCredentials&& user_credentials,
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
 
   Identity account_location{GetAccountLocation(*user_credentials.keyword, *user_credentials.pin)};
+  auto get([&](const Data::NameAndTypeId& name) {
+    return RetryWithBackoff(retry_policy_, *network_stats_,
+                            [&] { return HedgedGet(account_getter, name); });
+  });
   try {
     MutableData account_versions_wrapper(
-        Parse<MutableData>(account_getter.data_getter()
-                               .Get(Data::NameAndTypeId(account_location, DataTypeId(1)))
-                               .string()));
+        Parse<MutableData>(get(Data::NameAndTypeId(account_location, DataTypeId(1))).string()));
     account_versions_.ApplySerialised(
         StructuredDataVersions::serialised_type(account_versions_wrapper.Value()));
     auto versions(account_versions_.Get());
@@ -91,9 +105,7 @@ void AccountHandler::Login(authentication::UserCredentials&& user_credentials,
     // case where the latest one fails.  Or just throw, but add 'int version_number' to this
     // function's signature where 0 == most recent, 1 == second newest, etc.
     ImmutableData encrypted_account(
-        Parse<ImmutableData>(account_getter.data_getter()
-                                 .Get(Data::NameAndTypeId(versions.at(0).id, DataTypeId(0)))
-                                 .string()));
+        Parse<ImmutableData>(get(Data::NameAndTypeId(versions.at(0).id, DataTypeId(0))).string()));
     account_ = maidsafe::make_unique<Account>(encrypted_account, user_credentials);
     user_credentials_ = std::move(user_credentials);
   } catch (const std::exception& e) {
@@ -108,8 +120,10 @@ void AccountHandler::Save(NetworkClient& network_client) {
 
   ImmutableData encrypted_account(EncryptAccount(user_credentials_, *account_));
   try {
-    network_client.Store(encrypted_account.NameAndType(),
-                         NonEmptyString(Serialise(encrypted_account)));
+    RetryWithBackoff(retry_policy_, *network_stats_, [&] {
+      network_client.Store(encrypted_account.NameAndType(),
+                           NonEmptyString(Serialise(encrypted_account)));
+    });
     // Get current tip-of-tree and create new version
     auto versions(account_versions_.Get());
     assert(versions.size() == 1U);
@@ -120,8 +134,10 @@ void AccountHandler::Save(NetworkClient& network_client) {
     Identity account_location{
         GetAccountLocation(*user_credentials_.keyword, *user_credentials_.pin)};
     MutableData account_versions_wrapper(account_location, account_versions_.Serialise());
-    network_client.Store(account_versions_wrapper.NameAndType(),
-                         NonEmptyString(Serialise(account_versions_wrapper)));
+    RetryWithBackoff(retry_policy_, *network_stats_, [&] {
+      network_client.Store(account_versions_wrapper.NameAndType(),
+                           NonEmptyString(Serialise(account_versions_wrapper)));
+    });
 
     strong_guarantee.Release();
   } catch (const std::exception& e) {
@@ -131,6 +147,27 @@ void AccountHandler::Save(NetworkClient& network_client) {
   }
 }
 
+void AccountHandler::SetRetryPolicy(const RetryPolicy& retry_policy) {
+  retry_policy_ = retry_policy;
+}
+
+void AccountHandler::SetHedgePolicy(const HedgePolicy& hedge_policy) {
+  hedge_policy_ = hedge_policy;
+}
+
+NetworkMetrics AccountHandler::GetNetworkMetrics() const {
+  return NetworkMetrics{*network_stats_};
+}
+
+NonEmptyString AccountHandler::HedgedGet(AccountGetter& account_getter,
+                                         const Data::NameAndTypeId& name) {
+  // The requests run on the AccountGetter's asio threads, which are joined before its DataGetter is
+  // destroyed, so a losing request may safely outlive this call.
+  DataGetter& data_getter(account_getter.data_getter());
+  return HedgedRead(account_getter.asio_service_.service(), hedge_policy_, read_latencies_,
+                    network_stats_, [&data_getter, name] { return data_getter.Get(name); });
+}
+
 }  // namespace launcher
 
 }  // namespace maidsafe
@@ -24,9 +24,11 @@
 #include "maidsafe/common/config.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/authentication/user_credentials.h"
+#include "maidsafe/common/data_types/data.h"
 #include "maidsafe/common/data_types/structured_data_versions.h"
 
 #include "maidsafe/launcher/account.h"
+#include "maidsafe/launcher/retry_policy.h"
 #include "maidsafe/launcher/types.h"
 
 namespace maidsafe {
@@ -55,19 +57,36 @@ class AccountHandler {
 
   // Retrieves and decrypts account info when logging in to an existing account.  'account_getter'
   // should already be joined to the network.  Throws on error, including already having logged in.
-  // Provides strong exception guarantee.
+  // Provides strong exception guarantee.  Each read is hedged according to the current
+  // HedgePolicy and retried on transient errors according to the current RetryPolicy.
   void Login(authentication::UserCredentials&& user_credentials, AccountGetter& account_getter);
 
   // Saves account on the network using 'network_client', which should already be joined to the
-  // network.  Throws on error, with strong exception guarantee.
+  // network.  Throws on error, with strong exception guarantee.  Each store is retried on transient
+  // errors according to the current RetryPolicy.
   void Save(NetworkClient& network_client);
 
+  void SetRetryPolicy(const RetryPolicy& retry_policy);
+  void SetHedgePolicy(const HedgePolicy& hedge_policy);
+
+  // Returns the counts of attempts, retries and hedged requests made by 'Login' and 'Save'.
+  NetworkMetrics GetNetworkMetrics() const;
+
   // Give full access to the account
   std::unique_ptr<Account> account_;
 
  private:
+  // Issues a Get via 'account_getter', and if that hasn't completed within the hedge delay, issues
+  // a duplicate.  Returns the first successful reply, or throws the first error if all fail.
+  NonEmptyString HedgedGet(AccountGetter& account_getter, const Data::NameAndTypeId& name);
+
   StructuredDataVersions account_versions_;
   authentication::UserCredentials user_credentials_;
+  RetryPolicy retry_policy_;
+  HedgePolicy hedge_policy_;
+  // These are shared with any hedged request which is still outstanding when its sibling completes.
+  std::shared_ptr<NetworkOperationStats> network_stats_;
+  std::shared_ptr<LatencyTracker> read_latencies_;
 };
 
 }  // namespace launcher
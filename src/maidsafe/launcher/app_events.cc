@@ -0,0 +1,111 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_events.h"
+
+#include <map>
+#include <utility>
+
+#include "maidsafe/launcher/app_query.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+// Maps each app's name to its details and whether it's local.
+using AppLocations = std::map<AppName, std::pair<const AppDetails*, bool>>;
+
+AppLocations Locate(const PersistentSet<AppDetails>& local_apps,
+                    const PersistentSet<AppDetails>& non_local_apps) {
+  AppLocations locations;
+  for (const auto& app : local_apps)
+    locations.emplace(app.name, std::make_pair(&app, true));
+  for (const auto& app : non_local_apps)
+    locations.emplace(app.name, std::make_pair(&app, false));
+  return locations;
+}
+
+}  // unnamed namespace
+
+AppEvent::AppEvent(Type type_in, AppName app_name_in, bool locally_available_in)
+    : type(type_in),
+      app_name(std::move(app_name_in)),
+      old_name(),
+      fields(0),
+      locally_available(locally_available_in) {}
+
+AppEventBatch::AppEventBatch() : sequence_number(0), events() {}
+
+void AppendAppSetDiff(const PersistentSet<AppDetails>& old_local_apps,
+                      const PersistentSet<AppDetails>& old_non_local_apps,
+                      const PersistentSet<AppDetails>& new_local_apps,
+                      const PersistentSet<AppDetails>& new_non_local_apps,
+                      std::vector<AppEvent>& events) {
+  const AppLocations old_locations(Locate(old_local_apps, old_non_local_apps));
+  const AppLocations new_locations(Locate(new_local_apps, new_non_local_apps));
+  auto old_itr(old_locations.begin());
+  auto new_itr(new_locations.begin());
+  while (old_itr != old_locations.end() || new_itr != new_locations.end()) {
+    if (new_itr == new_locations.end() ||
+        (old_itr != old_locations.end() && old_itr->first < new_itr->first)) {
+      events.emplace_back(AppEvent::Type::kRemoved, old_itr->first, old_itr->second.second);
+      ++old_itr;
+    } else if (old_itr == old_locations.end() || new_itr->first < old_itr->first) {
+      events.emplace_back(AppEvent::Type::kAdded, new_itr->first, new_itr->second.second);
+      events.back().fields = kAllAppFields;
+      ++new_itr;
+    } else {
+      const bool was_local(old_itr->second.second), is_local(new_itr->second.second);
+      if (was_local != is_local) {
+        events.emplace_back(
+            is_local ? AppEvent::Type::kMovedToLocal : AppEvent::Type::kMovedToNonLocal,
+            new_itr->first, is_local);
+      }
+      std::uint32_t fields(ChangedFields(*old_itr->second.first, *new_itr->second.first));
+      if (fields != 0) {
+        events.emplace_back(AppEvent::Type::kFieldUpdated, new_itr->first, is_local);
+        events.back().fields = fields;
+      }
+      ++old_itr;
+      ++new_itr;
+    }
+  }
+}
+
+std::uint32_t ChangedFields(const AppDetails& lhs, const AppDetails& rhs) {
+  std::uint32_t fields(0);
+  if (lhs.name != rhs.name)
+    fields |= kAppName;
+  if (lhs.path != rhs.path)
+    fields |= kAppPath;
+  if (lhs.args != rhs.args)
+    fields |= kAppArgs;
+  if (lhs.permitted_dirs < rhs.permitted_dirs || rhs.permitted_dirs < lhs.permitted_dirs)
+    fields |= kAppPermittedDirs;
+  if (lhs.icon != rhs.icon)
+    fields |= kAppIcon;
+  if (lhs.auto_start != rhs.auto_start)
+    fields |= kAppAutoStart;
+  return fields;
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,83 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_APP_EVENTS_H_
+#define MAIDSAFE_LAUNCHER_APP_EVENTS_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/persistent_set.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// A single change to the set of local or non-local apps.
+struct AppEvent {
+  enum class Type {
+    kAdded,
+    kRemoved,
+    kRenamed,          // 'old_name' holds the previous name
+    kFieldUpdated,     // 'fields' holds the AppField mask of the changed fields
+    kMovedToLocal,     // e.g. a non-local app was linked
+    kMovedToNonLocal,  // only occurs when a previous state is restored
+  };
+
+  AppEvent(Type type_in, AppName app_name_in, bool locally_available_in);
+
+  Type type;
+  AppName app_name;
+  AppName old_name;
+  std::uint32_t fields;
+  // Whether the app is in (or, for kRemoved, was removed from) the set of local apps.
+  bool locally_available;
+};
+
+// All of the events resulting from a single transaction (e.g. a single Launcher::Update... call, or
+// a Launcher::Batch being committed).  Sequence numbers increase by one for each batch, and match
+// the 'sequence_number' of the AppHandler::State published by the same transaction.
+struct AppEventBatch {
+  AppEventBatch();
+
+  std::uint64_t sequence_number;
+  std::vector<AppEvent> events;
+};
+
+using AppEventHandler = std::function<void(const AppEventBatch&)>;
+using AppEventSubscriptionId = std::uint64_t;
+
+// Appends to 'events' the changes required to get from the 'old_...' sets to the 'new_...' ones.
+// Since apps are identified by name, a rename appears as a removal and an addition.
+void AppendAppSetDiff(const PersistentSet<AppDetails>& old_local_apps,
+                      const PersistentSet<AppDetails>& old_non_local_apps,
+                      const PersistentSet<AppDetails>& new_local_apps,
+                      const PersistentSet<AppDetails>& new_non_local_apps,
+                      std::vector<AppEvent>& events);
+
+// Returns the AppField mask of the fields which differ between 'lhs' and 'rhs'.
+std::uint32_t ChangedFields(const AppDetails& lhs, const AppDetails& rhs);
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_APP_EVENTS_H_
@@ -0,0 +1,227 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_APP_FIELD_TRAITS_H_
+#define MAIDSAFE_LAUNCHER_APP_FIELD_TRAITS_H_
+
+#include <cstdint>
+#include <set>
+#include <type_traits>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/directory_info.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/app_query.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Tags naming the fields of AppDetails, for use with AppFieldTraits.
+namespace field {
+
+struct Name {};
+struct Path {};
+struct Args {};
+struct PermittedDirs {};
+struct Icon {};
+struct AutoStart {};
+
+}  // namespace field
+
+// Describes at compile time where each field of AppDetails is held, and how it's updated:
+//
+//   kField      the field's AppField flag
+//   kInAccount  whether the field is serialised by EncryptAccount, so that changing it requires
+//               the Account to be saved (and allows it to be rolled back)
+//   kInConfig   whether the field is written to the config file for local apps
+//   kIsSortKey  whether apps are ordered by the field, so that changing it moves the app
+//   Value       the field's type
+//   UpdateType  the type of the value taken by an update of the field
+//   Get         returns a reference to the field
+//   Update      applies an update to the field
+//   Inverse     returns the update which reverses applying an update to 'app'
+//
+// The config file layout and the Account write each app's fields via ForEachConfigField and
+// ForEachAccountField below, so what they write can't drift out of sync with these.  They also
+// static_assert the fields they expect, so that a change here which would alter a persisted format
+// fails to compile until that format is deliberately updated.
+template <typename Field>
+struct AppFieldTraits;
+
+template <>
+struct AppFieldTraits<field::Name> {
+  using Value = AppName;
+  using UpdateType = AppName;
+  static const std::uint32_t kField = kAppName;
+  static const bool kInAccount = true, kInConfig = true, kIsSortKey = true;
+  static Value& Get(AppDetails& app) { return app.name; }
+  static const Value& Get(const AppDetails& app) { return app.name; }
+  static void Update(AppDetails& app, const UpdateType& new_name) { app.name = new_name; }
+  static UpdateType Inverse(const AppDetails& app, const UpdateType&) { return app.name; }
+};
+
+template <>
+struct AppFieldTraits<field::Path> {
+  using Value = boost::filesystem::path;
+  using UpdateType = boost::filesystem::path;
+  static const std::uint32_t kField = kAppPath;
+  static const bool kInAccount = false, kInConfig = true, kIsSortKey = false;
+  static Value& Get(AppDetails& app) { return app.path; }
+  static const Value& Get(const AppDetails& app) { return app.path; }
+  static void Update(AppDetails& app, const UpdateType& new_path) { app.path = new_path; }
+  static UpdateType Inverse(const AppDetails& app, const UpdateType&) { return app.path; }
+};
+
+template <>
+struct AppFieldTraits<field::Args> {
+  using Value = AppArgs;
+  using UpdateType = AppArgs;
+  static const std::uint32_t kField = kAppArgs;
+  static const bool kInAccount = false, kInConfig = true, kIsSortKey = false;
+  static Value& Get(AppDetails& app) { return app.args; }
+  static const Value& Get(const AppDetails& app) { return app.args; }
+  static void Update(AppDetails& app, const UpdateType& new_args) { app.args = new_args; }
+  static UpdateType Inverse(const AppDetails& app, const UpdateType&) { return app.args; }
+};
+
+// An update of the permitted dirs replaces any existing entry for the given directory, or removes
+// it if the new access rights are kNone.
+template <>
+struct AppFieldTraits<field::PermittedDirs> {
+  using Value = std::set<DirectoryInfo>;
+  using UpdateType = DirectoryInfo;
+  static const std::uint32_t kField = kAppPermittedDirs;
+  static const bool kInAccount = true, kInConfig = false, kIsSortKey = false;
+  static Value& Get(AppDetails& app) { return app.permitted_dirs; }
+  static const Value& Get(const AppDetails& app) { return app.permitted_dirs; }
+  static void Update(AppDetails& app, const UpdateType& new_dir) {
+    app.permitted_dirs.erase(new_dir);
+    if (new_dir.access_rights != DirectoryInfo::AccessRights::kNone)
+      app.permitted_dirs.insert(new_dir);
+  }
+  static UpdateType Inverse(const AppDetails& app, const UpdateType& new_dir) {
+    auto itr(app.permitted_dirs.find(new_dir));
+    if (itr != app.permitted_dirs.end())
+      return *itr;
+    UpdateType removal(new_dir);
+    removal.access_rights = DirectoryInfo::AccessRights::kNone;
+    return removal;
+  }
+};
+
+template <>
+struct AppFieldTraits<field::Icon> {
+  using Value = SerialisedData;
+  using UpdateType = SerialisedData;
+  static const std::uint32_t kField = kAppIcon;
+  static const bool kInAccount = true, kInConfig = false, kIsSortKey = false;
+  static Value& Get(AppDetails& app) { return app.icon; }
+  static const Value& Get(const AppDetails& app) { return app.icon; }
+  static void Update(AppDetails& app, const UpdateType& new_icon) { app.icon = new_icon; }
+  static UpdateType Inverse(const AppDetails& app, const UpdateType&) { return app.icon; }
+};
+
+template <>
+struct AppFieldTraits<field::AutoStart> {
+  using Value = bool;
+  using UpdateType = bool;
+  static const std::uint32_t kField = kAppAutoStart;
+  static const bool kInAccount = false, kInConfig = true, kIsSortKey = false;
+  static Value& Get(AppDetails& app) { return app.auto_start; }
+  static const Value& Get(const AppDetails& app) { return app.auto_start; }
+  static void Update(AppDetails& app, const UpdateType& new_auto_start_value) {
+    app.auto_start = new_auto_start_value;
+  }
+  static UpdateType Inverse(const AppDetails& app, const UpdateType&) { return app.auto_start; }
+};
+
+// Calls 'visitor' with a default-constructed tag for each field, in declaration order.
+template <typename Visitor>
+void ForEachAppField(Visitor&& visitor) {
+  visitor(field::Name());
+  visitor(field::Path());
+  visitor(field::Args());
+  visitor(field::PermittedDirs());
+  visitor(field::Icon());
+  visitor(field::AutoStart());
+}
+
+template <typename Field, typename Visitor>
+void VisitFieldIf(std::true_type, Visitor& visitor) {
+  visitor(Field());
+}
+
+template <typename Field, typename Visitor>
+void VisitFieldIf(std::false_type, Visitor& /*visitor*/) {}
+
+// As ForEachAppField, but only for the fields held in the config file, or in the Account.  Other
+// fields aren't visited at all, so 'visitor' needn't handle their values.
+template <typename Visitor>
+void ForEachConfigField(Visitor&& visitor) {
+  ForEachAppField([&](auto field) {
+    using Field = decltype(field);
+    VisitFieldIf<Field>(std::integral_constant<bool, AppFieldTraits<Field>::kInConfig>(), visitor);
+  });
+}
+
+template <typename Visitor>
+void ForEachAccountField(Visitor&& visitor) {
+  ForEachAppField([&](auto field) {
+    using Field = decltype(field);
+    VisitFieldIf<Field>(std::integral_constant<bool, AppFieldTraits<Field>::kInAccount>(), visitor);
+  });
+}
+
+template <typename... Fields>
+struct AppFieldMasks;
+
+template <>
+struct AppFieldMasks<> {
+  static const std::uint32_t kAll = 0, kAccount = 0, kConfig = 0;
+};
+
+template <typename Field, typename... Fields>
+struct AppFieldMasks<Field, Fields...> {
+  using Traits = AppFieldTraits<Field>;
+  static const std::uint32_t kAll = Traits::kField | AppFieldMasks<Fields...>::kAll;
+  static const std::uint32_t kAccount =
+      (Traits::kInAccount ? Traits::kField : 0U) | AppFieldMasks<Fields...>::kAccount;
+  static const std::uint32_t kConfig =
+      (Traits::kInConfig ? Traits::kField : 0U) | AppFieldMasks<Fields...>::kConfig;
+};
+
+using AllAppFieldMasks = AppFieldMasks<field::Name, field::Path, field::Args, field::PermittedDirs,
+                                       field::Icon, field::AutoStart>;
+
+static_assert(AllAppFieldMasks::kAll == kAllAppFields, "Every field must have AppFieldTraits.");
+static_assert((AllAppFieldMasks::kAccount | AllAppFieldMasks::kConfig) == kAllAppFields,
+              "Every field must be held in the Account or the config file.");
+
+// The fields held in the Account, and in the config file.
+const std::uint32_t kAccountAppFields = AllAppFieldMasks::kAccount;
+const std::uint32_t kConfigAppFields = AllAppFieldMasks::kConfig;
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_APP_FIELD_TRAITS_H_
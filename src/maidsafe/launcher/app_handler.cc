@@ -20,21 +20,21 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <exception>
 #include <iterator>
 #include <string>
 
 #include "boost/filesystem/operations.hpp"
-#include "cereal/types/string.hpp"
-#include "cereal/types/set.hpp"
 
-#include "maidsafe/common/convert.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/utils.h"
-#include "maidsafe/common/serialisation/types/boost_filesystem.h"
 
 #include "maidsafe/launcher/account.h"
 #include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/app_events.h"
 
 namespace fs = boost::filesystem;
 
@@ -44,44 +44,199 @@ namespace launcher {
 
 namespace {
 
-void UpdateAppDetails(AppDetails& app, const AppName* const new_name,
-                      const boost::filesystem::path* const new_path, const AppArgs* const new_args,
-                      const DirectoryInfo* const new_dir, const SerialisedData* const new_icon,
-                      const bool* const new_auto_start_value) {
-  // Check exactly one of the six pointers is non-null.
-  assert(int(!!new_name) + int(!!new_path) + int(!!new_args) + int(!!new_dir) + int(!!new_icon) +
-             int(!!new_auto_start_value) ==
-         1);
-
-  if (new_name) {
-    app.name = *new_name;
-  } else if (new_path) {
-    app.path = *new_path;
-  } else if (new_args) {
-    app.args = *new_args;
-  } else if (new_dir) {
-    app.permitted_dirs.erase(*new_dir);
-    if (new_dir->access_rights != DirectoryInfo::AccessRights::kNone)
-      app.permitted_dirs.insert(*new_dir);
-  } else if (new_icon) {
-    app.icon = *new_icon;
-  } else {
-    app.auto_start = *new_auto_start_value;
+// Returns an app holding only the fields which are written to the config file, so that recording a
+// change doesn't copy the app's permitted dirs and icon.
+AppDetails ConfigOnlyFields(const AppDetails& app) {
+  AppDetails config_only;
+  ForEachConfigField([&](auto field) {
+    using Traits = AppFieldTraits<decltype(field)>;
+    Traits::Get(config_only) = Traits::Get(app);
+  });
+  return config_only;
+}
+
+// Logs and throws an error reported by one of the non-throwing functions, all of which report
+// CommonErrors.
+[[noreturn]] void ThrowError(const std::error_code& ec, const std::string& message) {
+  assert(ec.category() == make_error_code(CommonErrors::unknown).category());
+  LOG(kError) << message << ": " << ec.message();
+  BOOST_THROW_EXCEPTION(MakeError(static_cast<CommonErrors>(ec.value())));
+}
+
+AppDetails KeyFor(const AppName& app_name) {
+  AppDetails key;
+  key.name = app_name;
+  return key;
+}
+
+// The Account's set orders apps by name only, so its elements' other fields can be modified in
+// place.  The name must not be modified via the returned reference.
+AppDetails& MutableApp(std::set<AppDetails>::iterator itr) { return const_cast<AppDetails&>(*itr); }
+
+// Moves the app at 'itr' to 'new_name', which mustn't be held in 'apps', without copying its
+// fields.  Only the insertion of the new node can throw, in which case 'apps' is unchanged.
+void RenameAccountApp(std::set<AppDetails>& apps, std::set<AppDetails>::iterator itr,
+                      const AppName& new_name) {
+  auto renamed(apps.insert(KeyFor(new_name)).first);
+  AppDetails& target(MutableApp(renamed));
+  AppName name(std::move(target.name));
+  target = std::move(MutableApp(itr));
+  target.name = std::move(name);
+  apps.erase(itr);
+}
+
+// The Operation type which updates each field, and the member of Operation holding the new value.
+template <typename Field>
+struct FieldOperation;
+
+template <>
+struct FieldOperation<field::Name> {
+  static const AppHandler::Operation::Type kType = AppHandler::Operation::Type::kUpdateName;
+  static AppName& Value(AppHandler::Operation& operation) { return operation.new_values.name; }
+};
+
+template <>
+struct FieldOperation<field::Path> {
+  static const AppHandler::Operation::Type kType = AppHandler::Operation::Type::kUpdatePath;
+  static fs::path& Value(AppHandler::Operation& operation) { return operation.new_values.path; }
+};
+
+template <>
+struct FieldOperation<field::Args> {
+  static const AppHandler::Operation::Type kType = AppHandler::Operation::Type::kUpdateArgs;
+  static AppArgs& Value(AppHandler::Operation& operation) { return operation.new_values.args; }
+};
+
+template <>
+struct FieldOperation<field::PermittedDirs> {
+  static const AppHandler::Operation::Type kType =
+      AppHandler::Operation::Type::kUpdatePermittedDirs;
+  static DirectoryInfo& Value(AppHandler::Operation& operation) { return operation.new_dir; }
+};
+
+template <>
+struct FieldOperation<field::Icon> {
+  static const AppHandler::Operation::Type kType = AppHandler::Operation::Type::kUpdateIcon;
+  static SerialisedData& Value(AppHandler::Operation& operation) {
+    return operation.new_values.icon;
+  }
+};
+
+template <>
+struct FieldOperation<field::AutoStart> {
+  static const AppHandler::Operation::Type kType = AppHandler::Operation::Type::kUpdateAutoStart;
+  static bool& Value(AppHandler::Operation& operation) { return operation.new_values.auto_start; }
+};
+
+AppView Project(const AppDetails& app, std::uint32_t fields, bool locally_available) {
+  AppView view;
+  if (fields & kAppName)
+    view.name = &app.name;
+  if (fields & kAppPath)
+    view.path = &app.path;
+  if (fields & kAppArgs)
+    view.args = &app.args;
+  if (fields & kAppPermittedDirs)
+    view.permitted_dirs = &app.permitted_dirs;
+  if (fields & kAppIcon)
+    view.icon = &app.icon;
+  if (fields & kAppAutoStart)
+    view.auto_start = &app.auto_start;
+  view.locally_available = locally_available;
+  return view;
+}
+
+// Visits the apps in 'apps' which match 'query', skipping the first 'to_skip' matches and stopping
+// once 'remaining' apps have been visited.  Both counts are decremented as matches are consumed.
+void VisitMatches(const AppHandler::AppSet& apps, bool locally_available, const AppQuery& query,
+                  const AppVisitor& visitor, std::size_t& to_skip, std::size_t& remaining) {
+  // All names with the given prefix are contiguous, starting at the prefix itself.
+  AppDetails prefix;
+  prefix.name = query.name_prefix;
+  for (auto itr(apps.lower_bound(prefix)); itr != apps.end() && remaining != 0; ++itr) {
+    if (itr->name.compare(0, query.name_prefix.size(), query.name_prefix) != 0)
+      break;
+    if ((query.auto_start_only && !itr->auto_start) || (query.predicate && !query.predicate(*itr)))
+      continue;
+    if (to_skip != 0) {
+      --to_skip;
+      continue;
+    }
+    visitor(Project(*itr, query.fields, locally_available));
+    --remaining;
   }
 }
 
 }  // unnamed namespace
 
+const std::size_t AppHandler::kEventHistorySize = 256;
+const std::uint64_t AppHandler::kLatestSequenceNumber;
+
+AppHandler::Operation::Operation(Type type_in, AppName app_name_in)
+    : type(type_in), app_name(std::move(app_name_in)), new_values(), new_dir() {}
+
+bool AppHandler::Operation::ModifiesAccount() const {
+  switch (type) {
+    case Type::kAdd:
+    case Type::kRemoveFromNetwork:
+    case Type::kUndoAdd:
+    case Type::kRestoreToNetwork:
+      return true;
+    case Type::kUpdateName:
+      return AppFieldTraits<field::Name>::kInAccount;
+    case Type::kUpdatePath:
+      return AppFieldTraits<field::Path>::kInAccount;
+    case Type::kUpdateArgs:
+      return AppFieldTraits<field::Args>::kInAccount;
+    case Type::kUpdatePermittedDirs:
+      return AppFieldTraits<field::PermittedDirs>::kInAccount;
+    case Type::kUpdateIcon:
+      return AppFieldTraits<field::Icon>::kInAccount;
+    case Type::kUpdateAutoStart:
+      return AppFieldTraits<field::AutoStart>::kInAccount;
+    default:  // links, local removals and their inverses only touch the local app sets
+      return false;
+  }
+}
+
+AppHandler::State::State() : local_apps(), non_local_apps(), indexes(), sequence_number(0) {}
+
+AppHandler::Subscriber::Subscriber(AppEventHandler handler_in, std::uint64_t skip_through_in)
+    : handler(std::move(handler_in)), skip_through(skip_through_in) {}
+
 AppHandler::AppHandler()
     : account_(nullptr),
       account_mutex_(nullptr),
-      config_file_path_(),
+      config_writer_(),
       local_apps_(),
       non_local_apps_(),
-      mutex_() {}
+      indexes_(),
+      config_file_exists_(false),
+      search_index_(),
+      search_mutex_(),
+      pending_events_(),
+      sequence_number_(0),
+      pending_inverses_(),
+      account_undo_(),
+      state_(std::make_shared<const State>()),
+      mutex_(),
+      event_history_(),
+      delivered_sequence_number_(0),
+      events_mutex_(),
+      record_file_(),
+      deferred_load_(),
+      subscribers_(),
+      next_subscription_id_(0),
+      delivery_mutex_() {}
+
+AppHandler::~AppHandler() {
+  if (deferred_load_.valid())
+    deferred_load_.wait();
+}
 
 void AppHandler::Initialise(fs::path config_file_path, Account* account,
-                            std::mutex* account_mutex) {
+                            std::mutex* account_mutex, ConfigStore::FsyncPolicy fsync_policy,
+                            ConfigCodec codec, ConfigStore::Format format) {
   // Check 'Initialise' hasn't already been called.
   assert(!account_ && !account_mutex_);
 
@@ -92,144 +247,240 @@ void AppHandler::Initialise(fs::path config_file_path, Account* account,
   std::lock_guard<std::mutex> lock(mutex_, std::adopt_lock);
   account_ = account;
   account_mutex_ = account_mutex;
-  config_file_path_ = std::move(config_file_path);
-
-  // Initialise the non-local apps from the account and the local ones from the config file
-  non_local_apps_ = account_->apps;
-  if (!fs::exists(config_file_path_.parent_path()))
-    fs::create_directories(config_file_path_.parent_path());
+  auto config_store(maidsafe::make_unique<ConfigStore>(
+      std::move(config_file_path), account_->config_file_aes_key_and_iv, format));
+  config_store->SetFsyncPolicy(fsync_policy);
+  config_store->SetCodec(std::move(codec));
+
+  // Initialise the non-local apps from the account and the local ones from the config file (or
+  // just its index, in which case the rest is loaded in the background)
+  non_local_apps_ = AppSet(account_->apps.begin(), account_->apps.end());
+  if (!fs::exists(config_store->config_file_path().parent_path()))
+    fs::create_directories(config_store->config_file_path().parent_path());
   else
-    ReadConfigFile();
-
-  // Iterate through each set of apps.  For any app which appears as local *and* non-local, its info
-  // is merged to the copy in the local set and it is removed from the non-local set.  Any app which
-  // appears as local only is removed.
-  auto local_itr(local_apps_.begin());
-  auto non_local_itr(non_local_apps_.begin());
-  while (local_itr != local_apps_.end() && non_local_itr != non_local_apps_.end()) {
-    if (*local_itr < *non_local_itr) {  // local only
-      local_itr = local_apps_.erase(local_itr);
-    } else if (*non_local_itr < *local_itr) {  // non-local only
-      ++non_local_itr;
-    } else {  // both local and non-local
-      AppDetails local(*local_itr);
-      local.permitted_dirs = non_local_itr->permitted_dirs;
-      local_itr = local_apps_.erase(local_itr);
-      local_apps_.insert(std::move(local));
-      non_local_itr = non_local_apps_.erase(non_local_itr);
+    local_apps_ = config_store->LoadIndex();
+  config_file_exists_ = config_store->Exists();
+  record_file_ = config_store->record_file();
+  config_writer_ = maidsafe::make_unique<ConfigWriter>(std::move(config_store));
+
+  // Iterate through the apps read from the config file.  For any app which appears as local *and*
+  // non-local, its info is merged to the copy in the local set and it is removed from the non-local
+  // set.  Any app which appears as local only is removed.
+  AppSet config_file_apps;
+  swap(config_file_apps, local_apps_);
+  for (const auto& config_file_app : config_file_apps) {
+    auto non_local_itr(non_local_apps_.find(config_file_app));
+    if (non_local_itr == non_local_apps_.end())  // local only
+      continue;
+    AppDetails local(config_file_app);
+    local.permitted_dirs = non_local_itr->permitted_dirs;
+    non_local_apps_.erase(local);
+    local_apps_.insert(std::move(local));
+  }
+  indexes_.Rebuild(local_apps_, non_local_apps_);
+
+  {
+    std::lock_guard<std::mutex> search_lock{search_mutex_};
+    search_index_.Clear();
+    for (const auto& app : local_apps_)
+      search_index_.Insert(app.name, true);
+    for (const auto& app : non_local_apps_)
+      search_index_.Insert(app.name, false);
+  }
+  PublishState();
+  if (record_file_ && !local_apps_.empty())
+    deferred_load_ = std::async(std::launch::async, [this] { CompleteLoad(); }).share();
+  else
+    record_file_.reset();
+}
+
+void AppHandler::CompleteLoad() {
+  // The record file is threadsafe, and no change is made to the local apps until this finishes, so
+  // the records can be read without holding the lock.
+  const AppSet loaded_apps(record_file_->LoadRecords());
+  std::lock_guard<std::mutex> lock{mutex_};
+  std::vector<AppDetails> local_apps;
+  local_apps.reserve(local_apps_.size());
+  for (const auto& app : local_apps_) {
+    local_apps.push_back(app);
+    auto loaded_itr(loaded_apps.find(app));
+    assert(loaded_itr != loaded_apps.end());
+    if (loaded_itr != loaded_apps.end()) {
+      local_apps.back().path = loaded_itr->path;
+      local_apps.back().args = loaded_itr->args;
     }
   }
+  local_apps_ = AppSet::FromSorted(std::move(local_apps));
+  indexes_.Rebuild(local_apps_, non_local_apps_);
+  PublishState();
+}
+
+void AppHandler::AwaitLoad() const {
+  if (deferred_load_.valid())
+    deferred_load_.get();
 }
 
 AppHandler::Snapshot AppHandler::GetSnapshot() const {
+  AwaitLoad();
   Snapshot snapshot;
   std::lock_guard<std::mutex> lock{mutex_};
   snapshot.local_apps = local_apps_;
   snapshot.non_local_apps = non_local_apps_;
-  try {
-    // Set up copy of config file.  Path is held in a shared_ptr with a custom deleter which also
-    // tries to remove the copied file as well as deleting the path pointer.
-    snapshot.config_file.reset(
-        new fs::path(config_file_path_.parent_path() / RandomAlphaNumericString(10)),
-        [](fs::path* delete_path) {
-          if (!delete_path->empty() && fs::exists(*delete_path)) {
-            boost::system::error_code ec;
-            if (!fs::remove(*delete_path, ec))
-              LOG(kWarning) << "Failed to remove " << *delete_path;
-            if (ec)
-              LOG(kWarning) << "Error removing " << *delete_path << "  " << ec.message();
-          }
-          delete delete_path;
-        });
-    if (fs::exists(config_file_path_))
-      fs::copy_file(config_file_path_, *snapshot.config_file);
-  } catch (const std::exception& e) {
-    LOG(kError) << "Failed to copy config file from " << config_file_path_ << " to "
-                << *snapshot.config_file << ": " << e.what();
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
-  }
+  snapshot.indexes = indexes_;
+  snapshot.config_file_exists = config_file_exists_;
   return snapshot;
 }
 
 void AppHandler::ApplySnapshot(Snapshot snapshot) {
-  auto locks(AcquireLocks());
-
-  // Reset account
-  account_->apps.clear();
-  std::set_union(snapshot.local_apps.begin(), snapshot.local_apps.end(),
-                 snapshot.non_local_apps.begin(), snapshot.non_local_apps.end(),
-                 std::inserter(account_->apps, account_->apps.end()));
-
-  // Reset app sets
-  local_apps_ = std::move(snapshot.local_apps);
-  non_local_apps_ = std::move(snapshot.non_local_apps);
-
-  // Replace config file
-  try {
-    if (fs::exists(*snapshot.config_file))
-      fs::rename(*snapshot.config_file, config_file_path_);
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    pending_events_.clear();
+    AppendAppSetDiff(local_apps_, non_local_apps_, snapshot.local_apps, snapshot.non_local_apps,
+                     pending_events_);
+
+    // Reset account
+    account_->apps.clear();
+    std::set_union(snapshot.local_apps.begin(), snapshot.local_apps.end(),
+                   snapshot.non_local_apps.begin(), snapshot.non_local_apps.end(),
+                   std::inserter(account_->apps, account_->apps.end()));
+
+    // Reset app sets
+    local_apps_ = std::move(snapshot.local_apps);
+    non_local_apps_ = std::move(snapshot.non_local_apps);
+    indexes_ = std::move(snapshot.indexes);
+
+    // Rebuild config file from the snapshot
+    config_file_exists_ = snapshot.config_file_exists;
+    if (config_file_exists_)
+      config_writer_->Rewrite(local_apps_);
     else
-      fs::remove(config_file_path_);
-  } catch (const std::exception& e) {
-    LOG(kError) << "Failed to move config file from " << *snapshot.config_file << " to "
-                << config_file_path_ << ": " << e.what();
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+      config_writer_->Remove();
+    PublishState();
   }
+  DeliverEvents();
+}
+
+AppHandler::StatePtr AppHandler::GetState() const {
+  AwaitLoad();
+  return std::atomic_load(&state_);
+}
+
+PersistentSet<AppName> AppHandler::GetAutoStartApps() const {
+  return std::atomic_load(&state_)->indexes.auto_start_apps();
 }
 
 std::set<AppDetails> AppHandler::GetApps(bool locally_available) const {
-  std::lock_guard<std::mutex> lock{mutex_};
-  return locally_available ? local_apps_ : non_local_apps_;
+  StatePtr state(GetState());
+  const AppSet& apps(locally_available ? state->local_apps : state->non_local_apps);
+  return std::set<AppDetails>(apps.begin(), apps.end());
+}
+
+std::size_t AppHandler::Query(const AppQuery& query, const AppVisitor& visitor) const {
+  StatePtr state(GetState());
+  std::size_t to_skip(query.offset), remaining(query.limit);
+  if (query.availability != AppQuery::Availability::kNonLocal)
+    VisitMatches(state->local_apps, true, query, visitor, to_skip, remaining);
+  if (query.availability != AppQuery::Availability::kLocal)
+    VisitMatches(state->non_local_apps, false, query, visitor, to_skip, remaining);
+  return query.limit - remaining;
+}
+
+std::vector<AppSearchResult> AppHandler::Search(const std::string& query,
+                                                std::size_t max_results) const {
+  std::lock_guard<std::mutex> search_lock{search_mutex_};
+  return search_index_.Search(query, max_results);
 }
 
-AppDetails AppHandler::AddOrLinkApp(AppName app_name, fs::path app_path, AppArgs app_args,
-                                    const SerialisedData* const app_icon, bool auto_start) {
+std::shared_ptr<const AppDetails> AppHandler::AddOrLinkApp(AppName app_name, fs::path app_path,
+                                                           AppArgs app_args,
+                                                           const SerialisedData* const app_icon,
+                                                           bool auto_start, UndoLog* undo_log) {
+  const AppName name(app_name);
+  std::error_code ec;
+  auto added_app(AddOrLinkApp(std::move(app_name), std::move(app_path), std::move(app_args),
+                              app_icon, auto_start, ec, undo_log));
+  if (ec)
+    ThrowError(ec, (app_icon ? "Failed to add app \"" : "Failed to link app \"") + name + '"');
+  return added_app;
+}
+
+std::shared_ptr<const AppDetails> AppHandler::AddOrLinkApp(AppName app_name, fs::path app_path,
+                                                           AppArgs app_args,
+                                                           const SerialisedData* const app_icon,
+                                                           bool auto_start, std::error_code& ec,
+                                                           UndoLog* undo_log) {
   AppDetails app;
-  app.name = app_name;
-  app.path = app_path;
-  app.args = app_args;
+  app.name = std::move(app_name);
+  app.path = std::move(app_path);
+  app.args = std::move(app_args);
   app.auto_start = auto_start;
 
-  auto locks(AcquireLocks());
+  std::shared_ptr<const AppDetails> added_app;
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    ec = Transact(
+        [&](ConfigChanges& config_changes) {
+          std::error_code result;
+          added_app = AddOrLink(std::move(app), app_icon, config_changes, result);
+          return result;
+        },
+        undo_log);
+  }
+  DeliverEvents();
+  return added_app;
+}
+
+std::shared_ptr<const AppDetails> AppHandler::AddOrLink(AppDetails app,
+                                                        const SerialisedData* const app_icon,
+                                                        ConfigChanges& config_changes,
+                                                        std::error_code& ec) {
   auto account_itr(account_->apps.find(app));
 
   // We're linking the app if 'app_icon' is null, otherwise we're adding the app.
   if (app_icon) {
     app.icon = *app_icon;
-    Add(app, account_itr);
+    ec = Add(app, account_itr);
   } else {
-    Link(app, account_itr);
+    ec = Link(app, account_itr);
   }
+  if (ec)
+    return nullptr;
+
+  config_changes.emplace_back([config_only = ConfigOnlyFields(app)](ConfigStore& config_store) {
+    config_store.RecordPut(config_only);
+  });
 
-  WriteConfigFile();
-  return app;
+  // The local set shares its element with the caller rather than holding a further copy.
+  auto added_app(std::make_shared<const AppDetails>(std::move(app)));
+  local_apps_.insert(added_app);
+  return added_app;
 }
 
-void AppHandler::Add(AppDetails& app, std::set<AppDetails>::iterator account_itr) {
+std::error_code AppHandler::Add(AppDetails& app, std::set<AppDetails>::iterator account_itr) {
   // Adding requires app to not exist in the account
-  if (account_itr != account_->apps.end()) {
-    LOG(kError) << "App \"" << app.name << "\" already exists in Account - can't add.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
-  }
+  if (account_itr != account_->apps.end())
+    return make_error_code(CommonErrors::unable_to_handle_request);
   assert(local_apps_.count(app) == 0 && non_local_apps_.count(app) == 0);
 
   app.permitted_dirs.emplace(std::string("/") + app.name, account_->root_parent_id, MakeIdentity(),
                              DirectoryInfo::AccessRights::kReadWrite);
 
-  // Add to account and local set
+  // Add to account.  The caller adds 'app' to the local set.
+  pending_inverses_.emplace_back(Operation::Type::kUndoAdd, app.name);
+  account_undo_.emplace_back(
+      [this, app_name = app.name] { account_->apps.erase(KeyFor(app_name)); });
   account_->apps.insert(app);
-  local_apps_.insert(app);
+  indexes_.Insert(app, true);
+  AddEvent(AppEvent::Type::kAdded, app.name, true).fields = kAllAppFields;
+  return std::error_code();
 }
 
-void AppHandler::Link(AppDetails& app, std::set<AppDetails>::iterator account_itr) {
+std::error_code AppHandler::Link(AppDetails& app, std::set<AppDetails>::iterator account_itr) {
   // Linking requires app to exist in non-local set and not exist in local set
-  auto non_local_itr(non_local_apps_.find(app));
-  if (local_apps_.count(app) != 0 || non_local_itr != non_local_apps_.end()) {
-    LOG(kError)
-        << "App \"" << app.name
-        << "\" already exists in local set, or doesn't exist in non-local set - can't link.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
-  }
+  if (local_apps_.count(app) != 0 || non_local_apps_.count(app) == 0)
+    return make_error_code(CommonErrors::unable_to_handle_request);
 
   // If app is in non-local set, it must also be in Account.
   assert(account_itr != account_->apps.end());
@@ -237,78 +488,456 @@ void AppHandler::Link(AppDetails& app, std::set<AppDetails>::iterator account_it
   app.permitted_dirs = account_itr->permitted_dirs;
   app.icon = account_itr->icon;
 
-  // Add to local and remove from non-local
-  local_apps_.insert(app);
-  non_local_apps_.erase(non_local_itr);
+  // Remove from non-local.  The caller adds 'app' to the local set.
+  pending_inverses_.emplace_back(Operation::Type::kUndoLink, app.name);
+  indexes_.Erase(*non_local_apps_.find(app), false);
+  indexes_.Insert(app, true);
+  non_local_apps_.erase(app);
+  AddEvent(AppEvent::Type::kMovedToLocal, app.name, true);
+  return std::error_code();
 }
 
 void AppHandler::UpdateName(const AppName& app_name, const AppName& new_name) {
-  Update(app_name, &new_name, nullptr, nullptr, nullptr, nullptr, nullptr);
+  Update<field::Name>(app_name, new_name);
 }
 
 void AppHandler::UpdatePath(const AppName& app_name, const fs::path& new_path) {
-  Update(app_name, nullptr, &new_path, nullptr, nullptr, nullptr, nullptr);
+  Update<field::Path>(app_name, new_path);
 }
 
 void AppHandler::UpdateArgs(const AppName& app_name, const AppArgs& new_args) {
-  Update(app_name, nullptr, nullptr, &new_args, nullptr, nullptr, nullptr);
+  Update<field::Args>(app_name, new_args);
 }
 
 void AppHandler::UpdatePermittedDirs(const AppName& app_name, const DirectoryInfo& new_dir) {
-  Update(app_name, nullptr, nullptr, nullptr, &new_dir, nullptr, nullptr);
+  Update<field::PermittedDirs>(app_name, new_dir);
 }
 
 void AppHandler::UpdateIcon(const AppName& app_name, const SerialisedData& new_icon) {
-  Update(app_name, nullptr, nullptr, nullptr, nullptr, &new_icon, nullptr);
+  Update<field::Icon>(app_name, new_icon);
 }
 
 void AppHandler::UpdateAutoStart(const AppName& app_name, bool new_auto_start_value) {
-  Update(app_name, nullptr, nullptr, nullptr, nullptr, nullptr, &new_auto_start_value);
+  Update<field::AutoStart>(app_name, new_auto_start_value);
+}
+
+void AppHandler::RemoveLocally(const AppName& app_name, UndoLog* undo_log) {
+  std::error_code ec;
+  RemoveLocally(app_name, ec, undo_log);
+  if (ec)
+    ThrowError(ec, "Failed to remove app \"" + app_name + "\" locally");
 }
 
-void AppHandler::RemoveLocally(const AppName& app_name) {
+void AppHandler::RemoveLocally(const AppName& app_name, std::error_code& ec, UndoLog* undo_log) {
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    ec = Transact(
+        [&](ConfigChanges& config_changes) { return RemoveLocal(app_name, config_changes); },
+        undo_log);
+  }
+  DeliverEvents();
+}
+
+std::error_code AppHandler::RemoveLocal(const AppName& app_name, ConfigChanges& config_changes) {
   AppDetails app;
   app.name = app_name;
-  std::lock_guard<std::mutex> lock{mutex_};
-  if (local_apps_.erase(app) != 1U) {
-    LOG(kError) << "App \"" << app_name << "\" doesn't exist in AppHandler's local apps set.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  auto itr(local_apps_.find(app));
+  if (itr == local_apps_.end())
+    return make_error_code(CommonErrors::no_such_element);
+  pending_inverses_.emplace_back(Operation::Type::kRestoreLocally, app_name);
+  pending_inverses_.back().new_values = *itr;
+  indexes_.Erase(*itr, true);
+  local_apps_.erase(app);
+  config_changes.emplace_back(
+      [app_name](ConfigStore& config_store) { config_store.RecordErase(app_name); });
+  AddEvent(AppEvent::Type::kRemoved, app_name, true);
+  return std::error_code();
+}
+
+void AppHandler::RemoveFromNetwork(const AppName& app_name, UndoLog* undo_log) {
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    Transact(
+        [&](ConfigChanges&) {
+          RemoveNonLocal(app_name);
+          return std::error_code();
+        },
+        undo_log);
   }
-  WriteConfigFile();
+  DeliverEvents();
 }
 
-void AppHandler::RemoveFromNetwork(const AppName& app_name) {
+void AppHandler::RemoveNonLocal(const AppName& app_name) {
   AppDetails app;
   app.name = app_name;
-  auto locks(AcquireLocks());
 
-  // Handle non-local set
-  if (non_local_apps_.erase(app) != 1U) {
+  auto itr(non_local_apps_.find(app));
+  if (itr == non_local_apps_.end()) {
     LOG(kError) << "App \"" << app_name << "\" doesn't exist in AppHandler's non-local apps set.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   }
-
-  // Handle Account
-  if (account_->apps.erase(app) != 1U) {
+  auto account_itr(account_->apps.find(app));
+  if (account_itr == account_->apps.end()) {
     LOG(kError) << "App \"" << app_name << "\" doesn't exist in Account.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   }
+  pending_inverses_.emplace_back(Operation::Type::kRestoreToNetwork, app_name);
+  pending_inverses_.back().new_values = *itr;
+  indexes_.Erase(*itr, false);
+  non_local_apps_.erase(app);
+  EraseFromAccount(account_itr);
+  AddEvent(AppEvent::Type::kRemoved, app_name, false);
+}
 
-  WriteConfigFile();
+void AppHandler::UndoAdd(const AppName& app_name, ConfigChanges& config_changes) {
+  AppDetails app;
+  app.name = app_name;
+  auto itr(local_apps_.find(app));
+  auto account_itr(account_->apps.find(app));
+  if (itr == local_apps_.end() || account_itr == account_->apps.end()) {
+    LOG(kError) << "App \"" << app_name << "\" isn't a local app in Account - can't undo add.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  indexes_.Erase(*itr, true);
+  local_apps_.erase(app);
+  EraseFromAccount(account_itr);
+  config_changes.emplace_back(
+      [app_name](ConfigStore& config_store) { config_store.RecordErase(app_name); });
+  AddEvent(AppEvent::Type::kRemoved, app_name, true);
 }
 
-std::pair<fs::path, AppArgs> AppHandler::GetPathAndArgs(AppName app_name) const {
+void AppHandler::UndoLink(const AppName& app_name, ConfigChanges& config_changes) {
   AppDetails app;
   app.name = app_name;
-  std::lock_guard<std::mutex> lock{mutex_};
-  auto itr = local_apps_.find(app);
-  if (itr == local_apps_.end()) {
-    LOG(kError) << "App \"" << app_name << "\" doesn't exist in AppHandler's local apps set.";
+  auto itr(local_apps_.find(app));
+  auto account_itr(account_->apps.find(app));
+  if (itr == local_apps_.end() || account_itr == account_->apps.end()) {
+    LOG(kError) << "App \"" << app_name << "\" isn't a local app in Account - can't undo link.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
   }
+  // A non-local app is held as it is in the Account.
+  AppDetails non_local_app(*account_itr);
+  indexes_.Erase(*itr, true);
+  indexes_.Insert(non_local_app, false);
+  local_apps_.erase(app);
+  non_local_apps_.insert(std::move(non_local_app));
+  config_changes.emplace_back(
+      [app_name](ConfigStore& config_store) { config_store.RecordErase(app_name); });
+  AddEvent(AppEvent::Type::kMovedToNonLocal, app_name, false);
+}
+
+void AppHandler::RestoreLocal(const AppDetails& app, ConfigChanges& config_changes) {
+  // The Account keeps apps which have been removed locally.
+  if (local_apps_.count(app) != 0 || non_local_apps_.count(app) != 0 ||
+      account_->apps.count(app) == 0) {
+    LOG(kError) << "App \"" << app.name << "\" can't be restored to the local set.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  indexes_.Insert(app, true);
+  local_apps_.insert(app);
+  config_changes.emplace_back([config_only = ConfigOnlyFields(app)](ConfigStore& config_store) {
+    config_store.RecordPut(config_only);
+  });
+  AddEvent(AppEvent::Type::kAdded, app.name, true).fields = kAllAppFields;
+}
+
+void AppHandler::RestoreNonLocal(const AppDetails& app) {
+  if (local_apps_.count(app) != 0 || non_local_apps_.count(app) != 0 ||
+      account_->apps.count(app) != 0) {
+    LOG(kError) << "App \"" << app.name << "\" can't be restored to the non-local set.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  account_undo_.emplace_back(
+      [this, app_name = app.name] { account_->apps.erase(KeyFor(app_name)); });
+  account_->apps.insert(app);
+  indexes_.Insert(app, false);
+  non_local_apps_.insert(app);
+  AddEvent(AppEvent::Type::kAdded, app.name, false).fields = kAllAppFields;
+}
+
+void AppHandler::EraseFromAccount(std::set<AppDetails>::iterator account_itr) {
+  // The erased app is moved rather than copied into its undo.
+  auto erased_app(std::make_shared<AppDetails>());
+  account_undo_.emplace_back([this, erased_app] { account_->apps.insert(std::move(*erased_app)); });
+  *erased_app = std::move(MutableApp(account_itr));
+  account_->apps.erase(account_itr);
+}
+
+void AppHandler::ApplyBatch(const std::vector<Operation>& operations, UndoLog* undo_log) {
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    ApplyOperations(operations, undo_log);
+  }
+  DeliverEvents();
+}
+
+void AppHandler::RevokeAccess(const fs::path& directory, UndoLog* undo_log) {
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    std::vector<Operation> operations;
+    for (auto& grant : indexes_.permissions().GrantsUnder(directory)) {
+      operations.emplace_back(Operation::Type::kUpdatePermittedDirs, grant.first);
+      operations.back().new_dir = std::move(grant.second);
+      operations.back().new_dir.access_rights = DirectoryInfo::AccessRights::kNone;
+    }
+    ApplyOperations(operations, undo_log);
+  }
+  DeliverEvents();
+}
+
+template <typename ApplyChanges>
+std::error_code AppHandler::Transact(ApplyChanges apply, UndoLog* undo_log) {
+  pending_events_.clear();
+  pending_inverses_.clear();
+  account_undo_.clear();
+
+  // Keep the current state so it can be restored if anything fails.  Copying the app sets and
+  // indexes is O(1), and only the Account's elements which are changed are restored.
+  AppSet original_local_apps(local_apps_), original_non_local_apps(non_local_apps_);
+  AppIndexes original_indexes(indexes_);
+  on_scope_exit strong_guarantee{[&] {
+    swap(local_apps_, original_local_apps);
+    swap(non_local_apps_, original_non_local_apps);
+    std::swap(indexes_, original_indexes);
+    UndoAccountChanges();
+    pending_events_.clear();
+    pending_inverses_.clear();
+  }};
+
+  ConfigChanges config_changes;
+  const std::error_code ec(apply(config_changes));
+  if (ec)
+    return ec;
+  // Reserve the space for the inverses now, so that appending them can't fail once the changes
+  // have been published.
+  if (undo_log) {
+    const std::size_t size(undo_log->size() + pending_inverses_.size());
+    if (size > undo_log->capacity())
+      undo_log->reserve(std::max(size, 2 * undo_log->capacity()));
+  }
+  WriteConfigChanges(std::move(config_changes));
+  PublishState();
+  strong_guarantee.Release();
+
+  account_undo_.clear();
+  if (undo_log) {
+    std::move(pending_inverses_.begin(), pending_inverses_.end(),
+              std::back_inserter(*undo_log));
+  }
+  pending_inverses_.clear();
+  return ec;
+}
+
+void AppHandler::ApplyOperations(const std::vector<Operation>& operations, UndoLog* undo_log) {
+  auto failed(operations.end());
+  const std::error_code ec(Transact(
+      [&](ConfigChanges& config_changes) {
+        for (auto itr(operations.begin()); itr != operations.end(); ++itr) {
+          if (auto result = Apply(*itr, config_changes)) {
+            failed = itr;
+            return result;
+          }
+        }
+        return std::error_code();
+      },
+      undo_log));
+  if (ec)
+    ThrowError(ec, "Failed to apply operation on app \"" + failed->app_name + '"');
+}
+
+void AppHandler::UndoAccountChanges() {
+  try {
+    while (!account_undo_.empty()) {
+      account_undo_.back()();
+      account_undo_.pop_back();
+    }
+  } catch (const std::exception& e) {
+    LOG(kError) << "Failed to restore Account: " << boost::diagnostic_information(e);
+  }
+  account_undo_.clear();
+}
+
+std::error_code AppHandler::Apply(const Operation& operation, ConfigChanges& config_changes) {
+  const AppDetails& new_values(operation.new_values);
+  switch (operation.type) {
+    case Operation::Type::kAdd:
+    case Operation::Type::kLink: {
+      AppDetails app;
+      app.name = operation.app_name;
+      app.path = new_values.path;
+      app.args = new_values.args;
+      app.auto_start = new_values.auto_start;
+      const bool adding(operation.type == Operation::Type::kAdd);
+      std::error_code ec;
+      AddOrLink(std::move(app), adding ? &new_values.icon : nullptr, config_changes, ec);
+      return ec;
+    }
+    case Operation::Type::kUpdateName:
+      return UpdateApp<field::Name>(operation.app_name, new_values.name, config_changes);
+    case Operation::Type::kUpdatePath:
+      return UpdateApp<field::Path>(operation.app_name, new_values.path, config_changes);
+    case Operation::Type::kUpdateArgs:
+      return UpdateApp<field::Args>(operation.app_name, new_values.args, config_changes);
+    case Operation::Type::kUpdatePermittedDirs:
+      return UpdateApp<field::PermittedDirs>(operation.app_name, operation.new_dir, config_changes);
+    case Operation::Type::kUpdateIcon:
+      return UpdateApp<field::Icon>(operation.app_name, new_values.icon, config_changes);
+    case Operation::Type::kUpdateAutoStart:
+      return UpdateApp<field::AutoStart>(operation.app_name, new_values.auto_start, config_changes);
+    case Operation::Type::kRemoveLocally:
+      return RemoveLocal(operation.app_name, config_changes);
+    case Operation::Type::kRemoveFromNetwork:
+      RemoveNonLocal(operation.app_name);
+      break;
+    case Operation::Type::kUndoAdd:
+      UndoAdd(operation.app_name, config_changes);
+      break;
+    case Operation::Type::kUndoLink:
+      UndoLink(operation.app_name, config_changes);
+      break;
+    case Operation::Type::kRestoreLocally:
+      RestoreLocal(new_values, config_changes);
+      break;
+    case Operation::Type::kRestoreToNetwork:
+      RestoreNonLocal(new_values);
+      break;
+    default:
+      LOG(kError) << "Invalid batch operation type.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  return std::error_code();
+}
+
+std::pair<fs::path, AppArgs> AppHandler::GetPathAndArgs(AppName app_name) const {
+  std::error_code ec;
+  auto path_and_args(GetPathAndArgs(app_name, ec));
+  if (ec)
+    ThrowError(ec, "Failed to get path and args of app \"" + app_name + '"');
+  return path_and_args;
+}
+
+std::pair<fs::path, AppArgs> AppHandler::GetPathAndArgs(AppName app_name,
+                                                        std::error_code& ec) const {
+  ec.clear();
+  AppDetails app;
+  app.name = app_name;
+  // While the local apps are being loaded, decrypt just this app's record rather than waiting.
+  const bool loading(deferred_load_.valid() &&
+                     deferred_load_.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+  StatePtr state(loading ? std::atomic_load(&state_) : GetState());
+  auto itr = state->local_apps.find(app);
+  if (itr == state->local_apps.end()) {
+    ec = make_error_code(CommonErrors::no_such_element);
+    return {};
+  }
+  if (loading)
+    return record_file_->ReadPathAndArgs(app_name);
   return std::make_pair(itr->path, itr->args);
 }
 
+AppEventSubscriptionId AppHandler::Subscribe(AppEventHandler handler,
+                                             std::uint64_t resume_after_sequence_number) {
+  std::lock_guard<std::mutex> delivery_lock{delivery_mutex_};
+  if (resume_after_sequence_number == kLatestSequenceNumber)
+    resume_after_sequence_number = GetState()->sequence_number;
+
+  // Collect the batches which other subscribers have already been given.  Later ones will be
+  // delivered by 'DeliverEvents' as usual.
+  std::vector<AppEventBatchPtr> replay;
+  {
+    std::lock_guard<std::mutex> events_lock{events_mutex_};
+    if (resume_after_sequence_number < delivered_sequence_number_) {
+      if (event_history_.empty() ||
+          event_history_.front()->sequence_number > resume_after_sequence_number + 1) {
+        LOG(kError) << "Event batch " << resume_after_sequence_number + 1
+                    << " is no longer held - can't resume subscription.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+      }
+      for (const auto& batch : event_history_) {
+        if (batch->sequence_number > delivered_sequence_number_)
+          break;
+        if (batch->sequence_number > resume_after_sequence_number)
+          replay.push_back(batch);
+      }
+    }
+  }
+
+  for (const auto& batch : replay)
+    handler(*batch);
+  subscribers_.emplace(++next_subscription_id_,
+                       Subscriber(std::move(handler), resume_after_sequence_number));
+  return next_subscription_id_;
+}
+
+void AppHandler::Unsubscribe(AppEventSubscriptionId subscription_id) {
+  std::lock_guard<std::mutex> delivery_lock{delivery_mutex_};
+  subscribers_.erase(subscription_id);
+}
+
+void AppHandler::FlushConfig() { config_writer_->Flush(); }
+
+void AppHandler::PublishState() {
+  auto state(std::make_shared<State>());
+  state->local_apps = local_apps_;
+  state->non_local_apps = non_local_apps_;
+  state->indexes = indexes_;
+  if (!pending_events_.empty()) {
+    {
+      std::lock_guard<std::mutex> search_lock{search_mutex_};
+      search_index_.Apply(pending_events_);
+    }
+    auto batch(std::make_shared<AppEventBatch>());
+    batch->sequence_number = ++sequence_number_;
+    batch->events.swap(pending_events_);
+    std::lock_guard<std::mutex> events_lock{events_mutex_};
+    event_history_.push_back(std::move(batch));
+    while (event_history_.size() > kEventHistorySize &&
+           event_history_.front()->sequence_number <= delivered_sequence_number_) {
+      event_history_.pop_front();
+    }
+  }
+  state->sequence_number = sequence_number_;
+  std::atomic_store(&state_, StatePtr(std::move(state)));
+}
+
+void AppHandler::DeliverEvents() {
+  std::lock_guard<std::mutex> delivery_lock{delivery_mutex_};
+  for (;;) {
+    AppEventBatchPtr batch;
+    {
+      std::lock_guard<std::mutex> events_lock{events_mutex_};
+      if (event_history_.empty() ||
+          event_history_.back()->sequence_number == delivered_sequence_number_) {
+        return;
+      }
+      // Sequence numbers are contiguous, so the next batch can be indexed directly.
+      batch = event_history_[static_cast<std::size_t>(
+          delivered_sequence_number_ + 1 - event_history_.front()->sequence_number)];
+    }
+    for (const auto& subscriber : subscribers_) {
+      if (batch->sequence_number <= subscriber.second.skip_through)
+        continue;
+      try {
+        subscriber.second.handler(*batch);
+      } catch (const std::exception& e) {
+        LOG(kError) << "App event handler threw: " << e.what();
+      }
+    }
+    std::lock_guard<std::mutex> events_lock{events_mutex_};
+    delivered_sequence_number_ = batch->sequence_number;
+  }
+}
+
+AppEvent& AppHandler::AddEvent(AppEvent::Type type, const AppName& app_name,
+                               bool locally_available) {
+  pending_events_.emplace_back(type, app_name, locally_available);
+  return pending_events_.back();
+}
+
 std::pair<AppHandler::LockGuardPtr, AppHandler::LockGuardPtr> AppHandler::AcquireLocks() const {
   std::lock(*account_mutex_, mutex_);
   return std::make_pair(
@@ -316,89 +945,143 @@ std::pair<AppHandler::LockGuardPtr, AppHandler::LockGuardPtr> AppHandler::Acquir
       maidsafe::make_unique<std::lock_guard<std::mutex>>(mutex_, std::adopt_lock));
 }
 
-void AppHandler::ReadConfigFile() {
-  if (!fs::exists(config_file_path_))
+void AppHandler::WriteConfigChanges(ConfigChanges config_changes) {
+  if (config_changes.empty())
     return;
-  assert(fs::is_regular_file(config_file_path_));
-
-  // Read from file.
-  crypto::CipherText encrypted_contents{NonEmptyString{ReadFile(config_file_path_).value()}};
-
-  // Decrypt and uncompress the contents.
-  auto serialised_contents(crypto::Uncompress(crypto::CompressedText(
-      crypto::SymmDecrypt(encrypted_contents, account_->config_file_aes_key_and_iv))));
-
-  // Parse the set of local apps.
-  std::stringstream str_stream{convert::ToString(serialised_contents.string())};
-  std::size_t app_count(ConvertFromStream<std::size_t>(str_stream));
-  for (std::size_t i{0}; i < app_count; ++i) {
-    AppDetails app_details;
-    ConvertFromStream(str_stream, app_details.name, app_details.path, app_details.args,
-                      app_details.auto_start);
-    local_apps_.insert(std::move(app_details));
+  if (config_file_exists_) {
+    config_writer_->Record(std::move(config_changes), local_apps_);
+  } else {
+    config_writer_->Rewrite(local_apps_);
+    config_file_exists_ = true;
   }
 }
 
-void AppHandler::WriteConfigFile() const {
-  // Serialise the set of local apps.  Omit their 'permitted_dirs' and 'icon' fields since they're
-  // held in the serialised Account.
-  std::string serialised_contents(ConvertToString(local_apps_.size()));
-  for (const auto& app : local_apps_)
-    serialised_contents += ConvertToString(app.name, app.path, app.args, app.auto_start);
-
-  // Compress and encrypt the serialised contents.
-  auto encrypted_contents(crypto::SymmEncrypt(
-      crypto::Compress(crypto::UncompressedText(convert::ToByteVector(serialised_contents)), 9)
-          .data,
-      account_->config_file_aes_key_and_iv));
+template <typename Field>
+void AppHandler::Update(const AppName& app_name,
+                        const typename AppFieldTraits<Field>::UpdateType& new_value,
+                        UndoLog* undo_log) {
+  std::error_code ec;
+  Update<Field>(app_name, new_value, ec, undo_log);
+  if (ec)
+    ThrowError(ec, "Failed to update app \"" + app_name + '"');
+}
 
-  // Write to file.
-  if (!WriteFile(config_file_path_, encrypted_contents->string())) {
-    LOG(kError) << "Failed to save config file at " << config_file_path_;
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+template <typename Field>
+void AppHandler::Update(const AppName& app_name,
+                        const typename AppFieldTraits<Field>::UpdateType& new_value,
+                        std::error_code& ec, UndoLog* undo_log) {
+  AwaitLoad();
+  {
+    auto locks(AcquireLocks());
+    ec = Transact(
+        [&](ConfigChanges& config_changes) {
+          return UpdateApp<Field>(app_name, new_value, config_changes);
+        },
+        undo_log);
   }
+  DeliverEvents();
 }
 
-void AppHandler::Update(const AppName& app_name, const AppName* const new_name,
-                        const boost::filesystem::path* const new_path,
-                        const AppArgs* const new_args, const DirectoryInfo* const new_dir,
-                        const SerialisedData* const new_icon,
-                        const bool* const new_auto_start_value) {
+template <typename Field>
+std::error_code AppHandler::UpdateApp(const AppName& app_name,
+                                      const typename AppFieldTraits<Field>::UpdateType& new_value,
+                                      ConfigChanges& config_changes) {
+  using Traits = AppFieldTraits<Field>;
   AppDetails current_app;
   current_app.name = app_name;
-  auto locks(AcquireLocks());
 
   // Handle local or non-local set
-  std::set<AppDetails>* app_set{nullptr};
+  AppSet* app_set{&local_apps_};
   auto itr(local_apps_.find(current_app));
   if (itr == local_apps_.end()) {
-    itr = non_local_apps_.find(current_app);
-    if (itr == non_local_apps_.end()) {
-      LOG(kError) << "App \"" << app_name << "\" doesn't exist in AppHandler sets.";
-      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-    }
     app_set = &non_local_apps_;
-  } else {
-    app_set = &local_apps_;
+    itr = non_local_apps_.find(current_app);
+    if (itr == non_local_apps_.end())
+      return make_error_code(CommonErrors::no_such_element);
   }
+  auto account_itr(account_->apps.find(current_app));
+  if (account_itr == account_->apps.end())
+    return make_error_code(CommonErrors::no_such_element);
+
+  // The sets' elements are shared with snapshots and published states, so the updated app is the
+  // one copy made.
   AppDetails updated_app{*itr};
-  UpdateAppDetails(updated_app, new_name, new_path, new_args, new_dir, new_icon,
-                   new_auto_start_value);
-  app_set->erase(itr);
-  app_set->insert(updated_app);
-
-  // Handle Account
-  itr = account_->apps.find(current_app);
-  if (itr == account_->apps.end()) {
-    LOG(kError) << "App \"" << app_name << "\" doesn't exist in Account.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  Traits::Update(updated_app, new_value);
+  const std::uint32_t changed_fields(ChangedFields(*itr, updated_app));
+  const bool locally_available(app_set == &local_apps_);
+  const bool moves(Traits::kIsSortKey && (changed_fields & Traits::kField) != 0);
+  if (moves && account_->apps.count(updated_app) != 0)
+    return make_error_code(CommonErrors::unable_to_handle_request);
+
+  Operation inverse(FieldOperation<Field>::kType, updated_app.name);
+  FieldOperation<Field>::Value(inverse) = Traits::Inverse(*itr, new_value);
+  pending_inverses_.push_back(std::move(inverse));
+  indexes_.Update(*itr, updated_app, locally_available);
+
+  // Only local apps' config-only fields are held in the config file.
+  if (Traits::kInConfig && locally_available) {
+    auto config_only(ConfigOnlyFields(updated_app));
+    if (Traits::kIsSortKey) {
+      config_changes.emplace_back(
+          [app_name, config_only = std::move(config_only)](ConfigStore& config_store) {
+            config_store.RecordRename(app_name, config_only);
+          });
+    } else {
+      config_changes.emplace_back([config_only = std::move(config_only)](
+          ConfigStore& config_store) { config_store.RecordPut(config_only); });
+    }
   }
-  account_->apps.erase(itr);
-  account_->apps.insert(std::move(updated_app));
 
-  WriteConfigFile();
+  if (changed_fields & kAppName) {
+    AddEvent(AppEvent::Type::kRenamed, updated_app.name, locally_available).old_name = app_name;
+  } else if (changed_fields != 0) {
+    AddEvent(AppEvent::Type::kFieldUpdated, app_name, locally_available).fields = changed_fields;
+  }
+
+  // Unless the sort key changes, the Account's element is updated in place and the set's element
+  // is replaced without rebalancing.  Otherwise the Account's element is moved to a new node rather
+  // than copied.  Either way, only the changed field is kept to undo the Account's change.
+  if (moves) {
+    account_undo_.emplace_back([this, old_name = app_name, new_name = updated_app.name] {
+      auto renamed(account_->apps.find(KeyFor(new_name)));
+      if (renamed != account_->apps.end())
+        RenameAccountApp(account_->apps, renamed, old_name);
+    });
+    RenameAccountApp(account_->apps, account_itr, updated_app.name);
+    app_set->erase(current_app);
+    app_set->insert(std::move(updated_app));
+  } else {
+    account_undo_.emplace_back([this, app_name, old_value = Traits::Get(*account_itr)] {
+      auto unchanged(account_->apps.find(KeyFor(app_name)));
+      if (unchanged != account_->apps.end())
+        Traits::Get(MutableApp(unchanged)) = old_value;
+    });
+    Traits::Update(MutableApp(account_itr), new_value);
+    app_set->insert_or_replace(std::move(updated_app));
+  }
+  return std::error_code();
 }
 
+template void AppHandler::Update<field::Name>(const AppName&, const AppName&, UndoLog*);
+template void AppHandler::Update<field::Name>(const AppName&, const AppName&, std::error_code&,
+                                              UndoLog*);
+template void AppHandler::Update<field::Path>(const AppName&, const fs::path&, UndoLog*);
+template void AppHandler::Update<field::Path>(const AppName&, const fs::path&, std::error_code&,
+                                              UndoLog*);
+template void AppHandler::Update<field::Args>(const AppName&, const AppArgs&, UndoLog*);
+template void AppHandler::Update<field::Args>(const AppName&, const AppArgs&, std::error_code&,
+                                              UndoLog*);
+template void AppHandler::Update<field::PermittedDirs>(const AppName&, const DirectoryInfo&,
+                                                      UndoLog*);
+template void AppHandler::Update<field::PermittedDirs>(const AppName&, const DirectoryInfo&,
+                                                      std::error_code&, UndoLog*);
+template void AppHandler::Update<field::Icon>(const AppName&, const SerialisedData&, UndoLog*);
+template void AppHandler::Update<field::Icon>(const AppName&, const SerialisedData&,
+                                              std::error_code&, UndoLog*);
+template void AppHandler::Update<field::AutoStart>(const AppName&, const bool&, UndoLog*);
+template void AppHandler::Update<field::AutoStart>(const AppName&, const bool&, std::error_code&,
+                                                   UndoLog*);
+
 }  // namespace launcher
 
 }  // namespace maidsafe
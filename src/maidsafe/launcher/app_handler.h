@@ -19,11 +19,20 @@
 #ifndef MAIDSAFE_LAUNCHER_APP_HANDLER_H_
 #define MAIDSAFE_LAUNCHER_APP_HANDLER_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
+#include <system_error>
 #include <utility>
+#include <vector>
 
 #include "boost/filesystem/path.hpp"
 
@@ -31,6 +40,17 @@
 #include "maidsafe/common/serialisation/serialisation.h"
 #include "maidsafe/directory_info.h"
 
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/app_events.h"
+#include "maidsafe/launcher/app_field_traits.h"
+#include "maidsafe/launcher/app_indexes.h"
+#include "maidsafe/launcher/app_query.h"
+#include "maidsafe/launcher/app_search_index.h"
+#include "maidsafe/launcher/config_codec.h"
+#include "maidsafe/launcher/config_record_file.h"
+#include "maidsafe/launcher/config_store.h"
+#include "maidsafe/launcher/config_writer.h"
+#include "maidsafe/launcher/persistent_set.h"
 #include "maidsafe/launcher/types.h"
 
 namespace maidsafe {
@@ -38,30 +58,119 @@ namespace maidsafe {
 namespace launcher {
 
 struct Account;
-struct AppDetails;
 
 namespace test {
 class AppHandlerTest;
 }  // namespace test
 
-// This class only offers the basic exception safety guarantee, but it allows a snapshot to be taken
-// so that the owning Launcher class can revert this to the snapshot state if required.  The
-// Snapshot struct provides a RAII copy of the config file.  When an instance of a Snaphot is
-// created, a copy of the config file is created and the path to this copy held in a shared_ptr
-// member of the Snapshot instance.  When the final copy of this Snapshot instance is destroyed, the
-// copied file is also removed from disk.
+// Each mutating function provides the strong exception-safety guarantee.  The app sets are held in
+// persistent trees, so on failure they (and the indexes) are restored from O(1) copies, and only
+// the Account's elements which were changed are restored individually.  Each mutating function can
+// also append to an UndoLog the operations which reverse its changes, so that the owning Launcher
+// can revert to an earlier point with work proportional to the changes made since.
+//
+// A Snapshot of the app sets can also be taken in O(1) without touching the disk.  When a Snapshot
+// is applied, the config file is rewritten from the snapshot's local apps (or removed if it didn't
+// exist when the snapshot was taken).
+//
+// Changes to local apps are persisted by appending a record to the config journal (see
+// ConfigStore) rather than rewriting the whole config file.  The writes are made asynchronously by
+// a ConfigWriter, so no disk I/O happens while the locks are held; 'FlushConfig' blocks until all
+// changes made so far are on disk.
+//
+// After every successful change, the app sets are published as an immutable State which readers
+// can obtain via 'GetState' without taking any lock or copying any apps.
+//
+// 'ApplyBatch' applies several operations under a single acquisition of the locks and writes the
+// config journal once.  If any of the operations fail, the in-memory state is left unchanged.
+//
+// Each successful change also produces an AppEventBatch describing it, which is delivered in order
+// to all subscribers once the locks have been released.  The most recent batches are kept so that
+// a subscriber can resume from the sequence number of any State it has already seen.  The same
+// events keep an AppSearchIndex over the names of all apps up to date.
+//
+// Secondary indexes (see AppIndexes), including a PermissionIndex over all apps' permitted
+// directories, are maintained alongside the app sets, and published and snapshotted with them.
+//
+// With ConfigStore::Format::kIndexedRecords, 'Initialise' reads only the config file's index, and
+// the local apps' paths and args are loaded in the background.  Until that finishes, only
+// 'GetAutoStartApps', 'GetPathAndArgs' (which then decrypts the single record needed), 'Search'
+// and the event subscription functions proceed without waiting for it.  All other functions wait,
+// and rethrow any error the background load hit.
 class AppHandler {
  public:
+  using AppSet = PersistentSet<AppDetails>;
+
   struct Snapshot {
+    Snapshot() : local_apps(), non_local_apps(), indexes(), config_file_exists(false) {}
+
     friend class AppHandler;
     friend class test::AppHandlerTest;
 
    private:
-    std::set<AppDetails> local_apps, non_local_apps;
-    std::shared_ptr<boost::filesystem::path> config_file;
+    AppSet local_apps, non_local_apps;
+    AppIndexes indexes;
+    bool config_file_exists;
+  };
+
+  // A single operation to be applied by 'ApplyBatch'.  Adds and links take the new app's path,
+  // args, icon and auto_start value from 'new_values'.  Updates take the new value from the
+  // corresponding field of 'new_values', or from 'new_dir' for 'kUpdatePermittedDirs'.
+  //
+  // The last four types are the inverses recorded in an UndoLog, and aren't themselves recorded:
+  //   kUndoAdd           removes a local app from the local set and the Account
+  //   kUndoLink          moves a local app back to the non-local set
+  //   kRestoreLocally    puts 'new_values' back in the local set (the Account still holds it)
+  //   kRestoreToNetwork  puts 'new_values' back in the non-local set and the Account
+  struct Operation {
+    enum class Type {
+      kAdd,
+      kLink,
+      kUpdateName,
+      kUpdatePath,
+      kUpdateArgs,
+      kUpdatePermittedDirs,
+      kUpdateIcon,
+      kUpdateAutoStart,
+      kRemoveLocally,
+      kRemoveFromNetwork,
+      kUndoAdd,
+      kUndoLink,
+      kRestoreLocally,
+      kRestoreToNetwork
+    };
+
+    Operation(Type type_in, AppName app_name_in);
+
+    // Whether applying this changes the Account, and so needs saved to the network.
+    bool ModifiesAccount() const;
+
+    Type type;
+    AppName app_name;
+    AppDetails new_values;
+    DirectoryInfo new_dir;
+  };
+
+  // Operations which, applied in reverse order, undo the changes which appended them.
+  using UndoLog = std::vector<Operation>;
+
+  // An immutable view of the app sets at a point in time.  'sequence_number' is that of the last
+  // AppEventBatch included in the view.
+  struct State {
+    State();
+
+    AppSet local_apps, non_local_apps;
+    AppIndexes indexes;
+    std::uint64_t sequence_number;
   };
+  using StatePtr = std::shared_ptr<const State>;
+
+  // The number of delivered event batches retained for subscribers resuming from an earlier point.
+  static const std::size_t kEventHistorySize;
+  static const std::uint64_t kLatestSequenceNumber = std::numeric_limits<std::uint64_t>::max();
 
   AppHandler();
+  ~AppHandler();
 
   AppHandler(const AppHandler&) = delete;
   AppHandler(AppHandler&&) = delete;
@@ -69,42 +178,185 @@ class AppHandler {
   AppHandler& operator=(AppHandler&&) = delete;
 
   void Initialise(boost::filesystem::path config_file_path, Account* account,
-                  std::mutex* account_mutex);
+                  std::mutex* account_mutex,
+                  ConfigStore::FsyncPolicy fsync_policy = ConfigStore::FsyncPolicy::kOnRewrite,
+                  ConfigCodec codec = ConfigCodec(),
+                  ConfigStore::Format format = ConfigStore::Format::kJournal);
 
   Snapshot GetSnapshot() const;
   void ApplySnapshot(Snapshot snapshot);
 
+  // Returns the most recently published state.  Lock-free and O(1) once the local apps are loaded.
+  StatePtr GetState() const;
+  // Returns the names of the local apps with auto_start set.  Doesn't wait for the local apps'
+  // paths and args to be loaded.
+  PersistentSet<AppName> GetAutoStartApps() const;
   std::set<AppDetails> GetApps(bool locally_available) const;
-  // Link if 'app_icon' is null, else Add.
-  AppDetails AddOrLinkApp(AppName app_name, boost::filesystem::path app_path, AppArgs app_args,
-                          const SerialisedData* const app_icon, bool auto_start);
+  // Visits the apps matching 'query' in the current state, projected onto the requested fields.
+  // Lock-free, and copies no fields.  Returns the number of apps visited.
+  std::size_t Query(const AppQuery& query, const AppVisitor& visitor) const;
+  // Returns the best 'max_results' local or non-local apps matching 'query'.  See AppSearchIndex.
+  std::vector<AppSearchResult> Search(const std::string& query, std::size_t max_results) const;
+  // The mutating functions below append the inverses of their changes to 'undo_log' if it is
+  // non-null.  Nothing is appended if they fail.
+  //
+  // The overloads taking a std::error_code report expected failures (no_such_element if the app
+  // doesn't exist, or unable_to_handle_request if it can't be added, linked or renamed as
+  // requested) via 'ec' without logging or throwing, and leave everything unchanged.  They can
+  // still throw on unexpected failures.  The other overloads log and throw on any failure.
+  //
+  // Link if 'app_icon' is null, else Add.  Returns the app as now held in the local set, or null on
+  // failure.
+  std::shared_ptr<const AppDetails> AddOrLinkApp(AppName app_name,
+                                                 boost::filesystem::path app_path,
+                                                 AppArgs app_args,
+                                                 const SerialisedData* const app_icon,
+                                                 bool auto_start, UndoLog* undo_log = nullptr);
+  std::shared_ptr<const AppDetails> AddOrLinkApp(AppName app_name,
+                                                 boost::filesystem::path app_path,
+                                                 AppArgs app_args,
+                                                 const SerialisedData* const app_icon,
+                                                 bool auto_start, std::error_code& ec,
+                                                 UndoLog* undo_log = nullptr);
   void UpdateName(const AppName& app_name, const AppName& new_name);
   void UpdatePath(const AppName& app_name, const boost::filesystem::path& new_path);
   void UpdateArgs(const AppName& app_name, const AppArgs& new_args);
   void UpdatePermittedDirs(const AppName& app_name, const DirectoryInfo& new_dir);
   void UpdateIcon(const AppName& app_name, const SerialisedData& new_icon);
   void UpdateAutoStart(const AppName& app_name, bool new_auto_start_value);
-  void RemoveLocally(const AppName& app_name);
-  void RemoveFromNetwork(const AppName& app_name);
+  // Generic form of the above, for any of the field tags in app_field_traits.h.
+  template <typename Field>
+  void Update(const AppName& app_name,
+              const typename AppFieldTraits<Field>::UpdateType& new_value,
+              UndoLog* undo_log = nullptr);
+  template <typename Field>
+  void Update(const AppName& app_name,
+              const typename AppFieldTraits<Field>::UpdateType& new_value, std::error_code& ec,
+              UndoLog* undo_log = nullptr);
+  void RemoveLocally(const AppName& app_name, UndoLog* undo_log = nullptr);
+  void RemoveLocally(const AppName& app_name, std::error_code& ec, UndoLog* undo_log = nullptr);
+  void RemoveFromNetwork(const AppName& app_name, UndoLog* undo_log = nullptr);
+  void ApplyBatch(const std::vector<Operation>& operations, UndoLog* undo_log = nullptr);
+  // Removes every app's grant of 'directory' and of any directory below it, as a single
+  // transaction.  Grants of directories above 'directory' are unaffected.  Uses the permission
+  // index, so only the affected apps are visited.
+  void RevokeAccess(const boost::filesystem::path& directory, UndoLog* undo_log = nullptr);
   std::pair<boost::filesystem::path, AppArgs> GetPathAndArgs(AppName app_name) const;
+  // Sets 'ec' to no_such_element, without logging or throwing, if the app isn't a local app.
+  std::pair<boost::filesystem::path, AppArgs> GetPathAndArgs(AppName app_name,
+                                                             std::error_code& ec) const;
+
+  // Subscribes 'handler' to all event batches with a sequence number greater than
+  // 'resume_after_sequence_number' (or to all future batches if this is kLatestSequenceNumber).
+  // Any such batches which have already been delivered to other subscribers are replayed to
+  // 'handler' before this returns.  Throws if those are no longer all held in the history, in which
+  // case the caller should fetch the current State and resume from its sequence number instead.
+  // Handlers are invoked without any of this class's locks held, but must not subscribe or
+  // unsubscribe; exceptions thrown by handlers are logged and otherwise ignored.
+  AppEventSubscriptionId Subscribe(
+      AppEventHandler handler, std::uint64_t resume_after_sequence_number = kLatestSequenceNumber);
+  // Blocks until any in-progress delivery has finished.
+  void Unsubscribe(AppEventSubscriptionId subscription_id);
+
+  // Blocks until all changes made so far have been written to the config file.  Throws if any of
+  // them couldn't be written.
+  void FlushConfig();
 
  private:
   using LockGuardPtr = std::unique_ptr<std::lock_guard<std::mutex>>;
+  using ConfigChanges = std::vector<ConfigWriter::ConfigChange>;
+  using AppEventBatchPtr = std::shared_ptr<const AppEventBatch>;
+
+  struct Subscriber {
+    Subscriber(AppEventHandler handler_in, std::uint64_t skip_through_in);
+
+    AppEventHandler handler;
+    // Batches up to and including this one have already been replayed, or were not requested.
+    std::uint64_t skip_through;
+  };
+
+  // Reads every record of the config file's index, fills in the local apps' paths and args, and
+  // publishes the result.  Run in the background by 'Initialise'.
+  void CompleteLoad();
+  // Blocks until 'CompleteLoad' has finished, if it was started.  Must be called with none of the
+  // locks held.
+  void AwaitLoad() const;
   std::pair<LockGuardPtr, LockGuardPtr> AcquireLocks() const;
-  void ReadConfigFile();
-  void WriteConfigFile() const;
-  void Add(AppDetails& app, std::set<AppDetails>::iterator account_itr);
-  void Link(AppDetails& app, std::set<AppDetails>::iterator account_itr);
-  void Update(const AppName& app_name, const AppName* const new_name,
-              const boost::filesystem::path* const new_path, const AppArgs* const new_args,
-              const DirectoryInfo* const new_dir, const SerialisedData* const new_icon,
-              const bool* const new_auto_start_value);
+  // Publishes the current app sets as the new State, along with any pending events as a new
+  // AppEventBatch.  Must be called with 'mutex_' held.
+  void PublishState();
+  // Delivers all published but undelivered event batches to the subscribers.  Must be called with
+  // none of the locks held.
+  void DeliverEvents();
+  // Queues 'config_changes' to be appended to the config journal in a single write.  If there is no
+  // config file yet, it is queued to be written in full instead.
+  void WriteConfigChanges(ConfigChanges config_changes);
+  // Calls 'apply(config_changes)' as a single transaction, then writes the config changes,
+  // publishes the new State and appends the transaction's inverses to 'undo_log' (if non-null).  If
+  // 'apply' returns an error or anything throws, all the changes are undone.  Returns the error
+  // returned by 'apply'.  Must be called with both locks held.
+  template <typename ApplyChanges>
+  std::error_code Transact(ApplyChanges apply, UndoLog* undo_log);
+  // Applies 'operations' in order as a single transaction.  Throws on failure.
+  void ApplyOperations(const std::vector<Operation>& operations, UndoLog* undo_log);
+  // Restores the Account's elements changed by the failed transaction.
+  void UndoAccountChanges();
+  // The following functions expect the relevant locks to already be held, and push any changes
+  // needing written to the config file onto 'config_changes' rather than writing them.  Each
+  // pushes its inverse onto 'pending_inverses_', and an undo of any change it makes to the Account
+  // onto 'account_undo_', before making it.  Those returning a std::error_code return expected
+  // failures, having changed nothing, rather than throwing.
+  std::error_code Apply(const Operation& operation, ConfigChanges& config_changes);
+  std::shared_ptr<const AppDetails> AddOrLink(AppDetails app, const SerialisedData* const app_icon,
+                                              ConfigChanges& config_changes, std::error_code& ec);
+  std::error_code Add(AppDetails& app, std::set<AppDetails>::iterator account_itr);
+  std::error_code Link(AppDetails& app, std::set<AppDetails>::iterator account_itr);
+  template <typename Field>
+  std::error_code UpdateApp(const AppName& app_name,
+                            const typename AppFieldTraits<Field>::UpdateType& new_value,
+                            ConfigChanges& config_changes);
+  std::error_code RemoveLocal(const AppName& app_name, ConfigChanges& config_changes);
+  void RemoveNonLocal(const AppName& app_name);
+  void UndoAdd(const AppName& app_name, ConfigChanges& config_changes);
+  void UndoLink(const AppName& app_name, ConfigChanges& config_changes);
+  void RestoreLocal(const AppDetails& app, ConfigChanges& config_changes);
+  void RestoreNonLocal(const AppDetails& app);
+  // Moves the app out of the Account, pushing an undo which moves it back.
+  void EraseFromAccount(std::set<AppDetails>::iterator account_itr);
+  AppEvent& AddEvent(AppEvent::Type type, const AppName& app_name, bool locally_available);
 
   Account* account_;
   mutable std::mutex* account_mutex_;
-  boost::filesystem::path config_file_path_;
-  std::set<AppDetails> local_apps_, non_local_apps_;
+  std::unique_ptr<ConfigWriter> config_writer_;
+  AppSet local_apps_, non_local_apps_;
+  // Must be updated with every change to 'local_apps_' or 'non_local_apps_'.
+  AppIndexes indexes_;
+  bool config_file_exists_;
+  // Updated in 'PublishState'.
+  AppSearchIndex search_index_;
+  mutable std::mutex search_mutex_;
+  // Events resulting from the current transaction, and the last published batch's sequence number.
+  std::vector<AppEvent> pending_events_;
+  std::uint64_t sequence_number_;
+  // The current transaction's inverses, and the undos of its changes to the Account.
+  UndoLog pending_inverses_;
+  std::vector<std::function<void()>> account_undo_;
+  // Only accessed via std::atomic_load and std::atomic_store.
+  StatePtr state_;
   mutable std::mutex mutex_;
+  // Published batches, including any not yet delivered, oldest first.  Guarded by 'events_mutex_'.
+  std::deque<AppEventBatchPtr> event_history_;
+  std::uint64_t delivered_sequence_number_;
+  std::mutex events_mutex_;
+  // Only set with ConfigStore::Format::kIndexedRecords, while the local apps' paths and args are
+  // being loaded.
+  std::shared_ptr<ConfigRecordFile> record_file_;
+  std::shared_future<void> deferred_load_;
+  // Guarded by 'delivery_mutex_', which is held while handlers are invoked so that batches are
+  // delivered in order.  Always locked before 'events_mutex_'.
+  std::map<AppEventSubscriptionId, Subscriber> subscribers_;
+  AppEventSubscriptionId next_subscription_id_;
+  std::mutex delivery_mutex_;
 };
 
 }  // namespace launcher
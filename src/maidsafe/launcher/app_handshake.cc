@@ -18,25 +18,49 @@
 
 #include "maidsafe/launcher/app_handshake.h"
 
+#include <utility>
+
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
-#include "maidsafe/common/utils.h"
 
 namespace maidsafe {
 
 namespace launcher {
 
-AppHandshake::AppHandshake(asio::io_service& io_service, std::set<DirectoryInfo> permitted_dirs)
-    : strand_(io_service),
-      listener_(tcp::Listener::MakeShared(
-          strand_, [this](tcp::ConnectionPtr connection) { OnConnection(connection); },
-          static_cast<tcp::Port>(RandomUint32()))),
+AppHandshake::AppHandshake(std::shared_ptr<LaunchListener> launch_listener,
+                           std::set<DirectoryInfo> permitted_dirs)
+    : launch_listener_(std::move(launch_listener)),
+      token_(launch_listener_->Register(
+          [this](tcp::ConnectionPtr connection) { OnConnection(connection); },
+          [this](tcp::Message message) { OnMessage(std::move(message)); },
+          [this] { OnConnectionClosed(); })),
       connection_(),
+      local_connection_(),
       permitted_dirs_(std::move(permitted_dirs)) {}
 
-AppHandshake::~AppHandshake() {}
+AppHandshake::AppHandshake(LocalConnectionPtr local_connection,
+                           std::set<DirectoryInfo> permitted_dirs)
+    : launch_listener_(),
+      token_(),
+      connection_(),
+      local_connection_(std::move(local_connection)),
+      permitted_dirs_(std::move(permitted_dirs)) {
+  local_connection_->Start([this](tcp::Message message) { OnMessage(std::move(message)); },
+                           [this] { OnConnectionClosed(); });
+}
+
+AppHandshake::~AppHandshake() {
+  if (launch_listener_)
+    launch_listener_->Unregister(token_);
+  if (local_connection_)
+    local_connection_->Close();
+}
+
+tcp::Port AppHandshake::ListeningPort() const {
+  return launch_listener_ ? launch_listener_->ListeningPort() : tcp::Port{0};
+}
 
-tcp::Port AppHandshake::ListeningPort() const { return listener_->ListeningPort(); }
+const LaunchToken& AppHandshake::Token() const { return token_; }
 
 // asymm::PublicKey AppHandshake::AppSessionPublicKey() {
 
@@ -45,8 +69,6 @@ tcp::Port AppHandshake::ListeningPort() const { return listener_->ListeningPort(
 void AppHandshake::OnConnection(tcp::ConnectionPtr connection) {
   connection_ = connection;
   // try {
-  //  connection_->Start([&](std::string message) { OnMessage(std::move(message)); },
-  //                     [&] { OnConnectionClosed(); });
   //  tcp_connection->Send(Serialise(std::move(public_key)));
   //  {
   //    std::unique_lock<std::mutex> lock{ reply_handler.mutex };
@@ -21,16 +21,16 @@
 
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <set>
 
-#include "asio/io_service.hpp"
-#include "asio/io_service_strand.hpp"
-
 #include "maidsafe/directory_info.h"
 #include "maidsafe/common/rsa.h"
 #include "maidsafe/common/tcp/connection.h"
-#include "maidsafe/common/tcp/listener.h"
+
+#include "maidsafe/launcher/launch_listener.h"
+#include "maidsafe/launcher/local_connection.h"
 
 namespace maidsafe {
 
@@ -38,9 +38,15 @@ namespace launcher {
 
 class AppHandshake {
  public:
-  AppHandshake(asio::io_service& io_service, std::set<DirectoryInfo> permitted_dirs);
+  // Registers with 'launch_listener' for a token which the app must present when it connects.
+  AppHandshake(std::shared_ptr<LaunchListener> launch_listener,
+               std::set<DirectoryInfo> permitted_dirs);
+  // Handshakes over the launcher's end of a socket pair, the other end of which the app inherits.
+  AppHandshake(LocalConnectionPtr local_connection, std::set<DirectoryInfo> permitted_dirs);
   ~AppHandshake();
+  // Both return a default value when handshaking over a socket pair.
   tcp::Port ListeningPort() const;
+  const LaunchToken& Token() const;
   asymm::PublicKey AppSessionPublicKey();
 
  private:
@@ -48,9 +54,10 @@ class AppHandshake {
   void OnConnectionClosed();
   void OnMessage(tcp::Message message);
 
-  asio::io_service::strand strand_;
-  tcp::ListenerPtr listener_;
+  std::shared_ptr<LaunchListener> launch_listener_;
+  LaunchToken token_;
   tcp::ConnectionPtr connection_;
+  LocalConnectionPtr local_connection_;
   std::mutex mutex_;
   std::condition_variable cond_var_;
   std::set<DirectoryInfo> permitted_dirs_;
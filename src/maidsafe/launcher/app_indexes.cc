@@ -0,0 +1,150 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_indexes.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "maidsafe/common/config.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+std::string CanonicalAppPath(const fs::path& path) {
+  fs::path normalised;
+  for (const auto& element : path) {
+    if (element == ".")
+      continue;
+    if (element == "..") {
+      if (normalised.has_relative_path() && normalised.filename() != "..")
+        normalised.remove_filename();
+      else if (!normalised.has_root_directory())
+        normalised /= element;
+      continue;
+    }
+    normalised /= element;
+  }
+  std::string canonical(normalised.generic_string());
+#ifdef MAIDSAFE_WIN32
+  std::transform(canonical.begin(), canonical.end(), canonical.begin(), [](char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+#endif
+  return canonical;
+}
+
+AppIndexes::AppIndexes()
+    : auto_start_apps_(), apps_by_path_(), apps_by_directory_(), permissions_() {}
+
+void AppIndexes::Insert(const AppDetails& app, bool locally_available) {
+  if (locally_available) {
+    if (app.auto_start)
+      auto_start_apps_.insert(app.name);
+    apps_by_path_.insert(std::make_pair(CanonicalAppPath(app.path), app.name));
+  }
+  for (const auto& dir : app.permitted_dirs) {
+    apps_by_directory_.insert(std::make_pair(dir.directory_id, app.name));
+    permissions_.Add(app.name, dir);
+  }
+}
+
+void AppIndexes::Erase(const AppDetails& app, bool locally_available) {
+  if (locally_available) {
+    auto_start_apps_.erase(app.name);
+    apps_by_path_.erase(std::make_pair(CanonicalAppPath(app.path), app.name));
+  }
+  for (const auto& dir : app.permitted_dirs) {
+    apps_by_directory_.erase(std::make_pair(dir.directory_id, app.name));
+    permissions_.Remove(app.name, dir);
+  }
+}
+
+void AppIndexes::Update(const AppDetails& old_app, const AppDetails& new_app,
+                        bool locally_available) {
+  if (old_app.name != new_app.name) {
+    Erase(old_app, locally_available);
+    Insert(new_app, locally_available);
+    return;
+  }
+
+  if (locally_available) {
+    if (old_app.auto_start != new_app.auto_start) {
+      if (new_app.auto_start)
+        auto_start_apps_.insert(new_app.name);
+      else
+        auto_start_apps_.erase(new_app.name);
+    }
+    if (old_app.path != new_app.path) {
+      apps_by_path_.erase(std::make_pair(CanonicalAppPath(old_app.path), old_app.name));
+      apps_by_path_.insert(std::make_pair(CanonicalAppPath(new_app.path), new_app.name));
+    }
+  }
+
+  // Equivalent DirectoryInfos can differ in their access rights, so those are compared too.
+  for (const auto& dir : old_app.permitted_dirs) {
+    if (new_app.permitted_dirs.count(dir) == 0) {
+      apps_by_directory_.erase(std::make_pair(dir.directory_id, old_app.name));
+      permissions_.Remove(old_app.name, dir);
+    }
+  }
+  for (const auto& dir : new_app.permitted_dirs) {
+    auto old_itr(old_app.permitted_dirs.find(dir));
+    if (old_itr == old_app.permitted_dirs.end()) {
+      apps_by_directory_.insert(std::make_pair(dir.directory_id, new_app.name));
+      permissions_.Add(new_app.name, dir);
+    } else if (old_itr->access_rights != dir.access_rights) {
+      permissions_.Add(new_app.name, dir);
+    }
+  }
+}
+
+void AppIndexes::Rebuild(const PersistentSet<AppDetails>& local_apps,
+                         const PersistentSet<AppDetails>& non_local_apps) {
+  *this = AppIndexes();
+  for (const auto& app : local_apps)
+    Insert(app, true);
+  for (const auto& app : non_local_apps)
+    Insert(app, false);
+}
+
+std::vector<AppName> AppIndexes::AppsWithPath(const fs::path& path) const {
+  std::vector<AppName> names;
+  const std::string canonical(CanonicalAppPath(path));
+  for (auto itr(apps_by_path_.lower_bound(std::make_pair(canonical, AppName())));
+       itr != apps_by_path_.end() && itr->first == canonical; ++itr) {
+    names.push_back(itr->second);
+  }
+  return names;
+}
+
+std::vector<AppName> AppIndexes::AppsWithDirectory(const Identity& directory_id) const {
+  std::vector<AppName> names;
+  for (auto itr(apps_by_directory_.lower_bound(std::make_pair(directory_id, AppName())));
+       itr != apps_by_directory_.end() && itr->first == directory_id; ++itr) {
+    names.push_back(itr->second);
+  }
+  return names;
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
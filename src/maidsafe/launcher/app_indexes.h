@@ -0,0 +1,79 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_APP_INDEXES_H_
+#define MAIDSAFE_LAUNCHER_APP_INDEXES_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/permission_index.h"
+#include "maidsafe/launcher/persistent_set.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Returns a lexically normalised form of 'path' for use as an index key: "." elements are removed,
+// ".." elements are resolved against their parent, separators are made uniform and, on Windows,
+// the path is lower-cased.  The filesystem is not consulted, so symlinks aren't resolved.
+std::string CanonicalAppPath(const boost::filesystem::path& path);
+
+// Secondary indexes over the local and non-local app sets.  Like the sets, the indexes are held in
+// persistent trees, so copying an AppIndexes is O(1) and it can be published and snapshotted along
+// with the sets.  Every insertion into, or removal from, either set must be mirrored here.
+class AppIndexes {
+ public:
+  AppIndexes();
+
+  void Insert(const AppDetails& app, bool locally_available);
+  void Erase(const AppDetails& app, bool locally_available);
+  // Equivalent to 'Erase(old_app, ...)' followed by 'Insert(new_app, ...)', but if the name is
+  // unchanged, only the entries for the fields which differ are touched.
+  void Update(const AppDetails& old_app, const AppDetails& new_app, bool locally_available);
+  void Rebuild(const PersistentSet<AppDetails>& local_apps,
+               const PersistentSet<AppDetails>& non_local_apps);
+
+  // Names of the local apps with 'auto_start' set.
+  const PersistentSet<AppName>& auto_start_apps() const { return auto_start_apps_; }
+  // Names of the local apps whose path has the same CanonicalAppPath as 'path'.
+  std::vector<AppName> AppsWithPath(const boost::filesystem::path& path) const;
+  // Names of the apps, local or non-local, with a permitted directory identified by 'directory_id'.
+  std::vector<AppName> AppsWithDirectory(const Identity& directory_id) const;
+  // The permitted directories of all apps, local or non-local, indexed by path.
+  const PermissionIndex& permissions() const { return permissions_; }
+
+ private:
+  PersistentSet<AppName> auto_start_apps_;
+  PersistentSet<std::pair<std::string, AppName>> apps_by_path_;
+  PersistentSet<std::pair<Identity, AppName>> apps_by_directory_;
+  PermissionIndex permissions_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_APP_INDEXES_H_
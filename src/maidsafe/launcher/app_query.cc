@@ -0,0 +1,47 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_query.h"
+
+#include <limits>
+
+namespace maidsafe {
+
+namespace launcher {
+
+AppView::AppView()
+    : name(nullptr),
+      path(nullptr),
+      args(nullptr),
+      permitted_dirs(nullptr),
+      icon(nullptr),
+      auto_start(nullptr),
+      locally_available(false) {}
+
+AppQuery::AppQuery()
+    : availability(Availability::kAll),
+      fields(kAllAppFields),
+      auto_start_only(false),
+      name_prefix(),
+      predicate(),
+      offset(0),
+      limit(std::numeric_limits<std::size_t>::max()) {}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_APP_QUERY_H_
+#define MAIDSAFE_LAUNCHER_APP_QUERY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/directory_info.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Bit flags identifying the fields of AppDetails.  These can be combined to form a field mask.
+enum AppField : std::uint32_t {
+  kAppName = 1 << 0,
+  kAppPath = 1 << 1,
+  kAppArgs = 1 << 2,
+  kAppPermittedDirs = 1 << 3,
+  kAppIcon = 1 << 4,
+  kAppAutoStart = 1 << 5,
+  kAllAppFields = (1 << 6) - 1
+};
+
+// A projection of an app onto the fields selected by a query.  Each pointer is null unless its
+// field was selected, in which case it points directly into the AppHandler's state; no fields are
+// copied.  The pointers are only valid for the duration of the visitor call.
+struct AppView {
+  AppView();
+
+  const AppName* name;
+  const boost::filesystem::path* path;
+  const AppArgs* args;
+  const std::set<DirectoryInfo>* permitted_dirs;
+  const SerialisedData* icon;
+  const bool* auto_start;
+  bool locally_available;
+};
+
+// Describes which apps to visit and which of their fields to project.  Matching apps are visited
+// in name order, the local ones before the non-local ones.  The first 'offset' matches are skipped,
+// and at most 'limit' matches are visited after that, so consecutive pages can be fetched by
+// advancing 'offset' by 'limit'.
+struct AppQuery {
+  enum class Availability { kLocal, kNonLocal, kAll };
+
+  AppQuery();
+
+  Availability availability;
+  std::uint32_t fields;  // mask of AppField values
+  bool auto_start_only;
+  AppName name_prefix;  // matching apps are found in O(log n)
+  // Optional further filter, applied after the others.
+  std::function<bool(const AppDetails&)> predicate;
+  std::size_t offset;
+  std::size_t limit;
+};
+
+using AppVisitor = std::function<void(const AppView&)>;
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_APP_QUERY_H_
@@ -0,0 +1,600 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_search_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAIDSAFE_LAUNCHER_USE_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+// Names are separated by this in the buffer of folded names, so no match can span two names.
+const char kSeparator('\0');
+// The index isn't compacted until it holds at least this many erased names.
+const std::size_t kMinCompactionCount(64);
+
+char Fold(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+std::string Fold(const std::string& input) {
+  std::string folded(input);
+  std::transform(folded.begin(), folded.end(), folded.begin(), [](char c) { return Fold(c); });
+  return folded;
+}
+
+// Folded letters and digits each get a bit of their own; other characters share the rest.
+std::uint64_t CharMask(const std::string& folded) {
+  std::uint64_t mask(0);
+  for (char c : folded) {
+    const unsigned char u(static_cast<unsigned char>(c));
+    unsigned bit;
+    if (u >= 'a' && u <= 'z')
+      bit = u - 'a';
+    else if (u >= '0' && u <= '9')
+      bit = 26 + (u - '0');
+    else
+      bit = 36 + u % 28;
+    mask |= std::uint64_t(1) << bit;
+  }
+  return mask;
+}
+
+bool IsWordStart(const char* name, std::uint32_t position) {
+  return position == 0 || !std::isalnum(static_cast<unsigned char>(name[position - 1]));
+}
+
+#ifdef MAIDSAFE_LAUNCHER_USE_SSE2
+unsigned CountTrailingZeros(std::uint32_t mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// Greedily matches 'query' as an in-order subsequence of 'name', returning false if it isn't one.
+// Otherwise 'score' is set; each matched character scores for following the previous one directly
+// or for starting a word, and is penalised for the gap since the previous one.  If 'can_load_32' is
+// true, 32 bytes may be read from 'name' regardless of 'length'.
+bool FuzzyMatch(const char* name, std::uint32_t length, bool can_load_32, const std::string& query,
+                int& score) {
+  const int kContiguousBonus(8), kWordStartBonus(4), kMaxGapPenalty(3);
+  score = 0;
+  std::uint32_t position(0);
+#ifdef MAIDSAFE_LAUNCHER_USE_SSE2
+  const bool vectorised(can_load_32 && length <= 32);
+  __m128i low, high;
+  if (vectorised) {
+    low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(name));
+    high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(name + 16));
+  }
+#else
+  static_cast<void>(can_load_32);
+#endif
+  for (std::size_t i(0); i < query.size(); ++i) {
+    std::uint32_t match_position(position);
+#ifdef MAIDSAFE_LAUNCHER_USE_SSE2
+    if (vectorised) {
+      // Find every occurrence of the character at once, and take the first one after the previous
+      // match.
+      const __m128i c(_mm_set1_epi8(query[i]));
+      const std::uint64_t occurrences(
+          static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(low, c))) |
+          (static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, c))) << 16));
+      const std::uint64_t candidates(occurrences & ((std::uint64_t(1) << length) - 1) &
+                                     ~((std::uint64_t(1) << position) - 1));
+      if (candidates == 0)
+        return false;
+      match_position = CountTrailingZeros(static_cast<unsigned>(candidates));
+    } else  // NOLINT
+#endif
+    {
+      while (match_position < length && name[match_position] != query[i])
+        ++match_position;
+      if (match_position == length)
+        return false;
+    }
+    if (i != 0 && match_position == position)
+      score += kContiguousBonus;
+    else if (IsWordStart(name, match_position))
+      score += kWordStartBonus;
+    score -= std::min(static_cast<int>(match_position - position), kMaxGapPenalty);
+    position = match_position + 1;
+  }
+  return true;
+}
+
+// Calls 'on_match' with the position of every occurrence of 'needle' in 'haystack', in ascending
+// order.  With SSE2, 32 candidate positions are tested at a time by comparing the first and last
+// characters of 'needle' against the corresponding bytes at each position, and only positions
+// where both match are compared in full.
+template <typename OnMatch>
+void FindAll(const std::string& haystack, const std::string& needle, OnMatch on_match) {
+  const std::size_t needle_size(needle.size()), haystack_size(haystack.size());
+  if (needle_size == 0 || needle_size > haystack_size)
+    return;
+  const char* const data(haystack.data());
+  const char* const middle(needle.data() + 1);
+  const std::size_t middle_size(needle_size < 2 ? 0 : needle_size - 2);
+  std::size_t position(0);
+#ifdef MAIDSAFE_LAUNCHER_USE_SSE2
+  const __m128i first(_mm_set1_epi8(needle.front()));
+  const __m128i last(_mm_set1_epi8(needle.back()));
+  auto candidates([&](std::size_t offset) {
+    const __m128i block_first(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)));
+    const __m128i block_last(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + needle_size - 1)));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+  });
+  // Test 32 positions per iteration, since candidates are rare.
+  for (; position + needle_size - 1 + 32 <= haystack_size; position += 32) {
+    std::uint32_t mask(candidates(position) | (candidates(position + 16) << 16));
+    while (mask != 0) {
+      const unsigned bit(CountTrailingZeros(mask));
+      if (std::memcmp(data + position + bit + 1, middle, middle_size) == 0)
+        on_match(position + bit);
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; position + needle_size <= haystack_size; ++position) {
+    if (data[position] == needle.front() && data[position + needle_size - 1] == needle.back() &&
+        std::memcmp(data + position + 1, middle, middle_size) == 0) {
+      on_match(position);
+    }
+  }
+}
+
+}  // unnamed namespace
+
+const AppSearchIndex::Id AppSearchIndex::kNone = std::numeric_limits<AppSearchIndex::Id>::max();
+
+AppSearchResult::AppSearchResult(AppName name_in, bool locally_available_in, Match match_in)
+    : name(std::move(name_in)), locally_available(locally_available_in), match(match_in) {}
+
+AppSearchIndex::Entry::Entry(Id offset_in, Id length_in, bool locally_available_in)
+    : offset(offset_in),
+      length(length_in),
+      next_in_node(kNone),
+      locally_available(locally_available_in),
+      live(true) {}
+
+AppSearchIndex::Node::Node(Id label_offset_in, Id label_length_in, Id depth_in)
+    : label_offset(label_offset_in),
+      label_length(label_length_in),
+      first_child(kNone),
+      next_sibling(kNone),
+      first_entry(kNone),
+      depth(depth_in),
+      min_length(kNone) {}
+
+AppSearchIndex::AppSearchIndex()
+    : folded_names_(),
+      entries_(),
+      names_(),
+      char_masks_(),
+      nodes_(1, Node(0, 0, 0)),
+      ids_(),
+      dead_count_(0) {}
+
+void AppSearchIndex::Insert(const AppName& app_name, bool locally_available) {
+  if (ids_.count(app_name) != 0) {
+    LOG(kError) << "App \"" << app_name << "\" is already in the search index.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  const std::string folded(Fold(app_name));
+  const Id id(static_cast<Id>(entries_.size()));
+  entries_.emplace_back(static_cast<Id>(folded_names_.size()), static_cast<Id>(folded.size()),
+                        locally_available);
+  names_.push_back(app_name);
+  char_masks_.push_back(CharMask(folded));
+  folded_names_ += folded;
+  folded_names_ += kSeparator;
+  ids_.emplace(app_name, id);
+  InsertIntoTrie(id);
+}
+
+void AppSearchIndex::Erase(const AppName& app_name) {
+  const Id id(FindId(app_name));
+  EraseFromTrie(id);
+  entries_[id].live = false;
+  char_masks_[id] = 0;
+  ids_.erase(app_name);
+  ++dead_count_;
+  CompactIfRequired();
+}
+
+void AppSearchIndex::Rename(const AppName& app_name, const AppName& new_name) {
+  const bool locally_available(entries_[FindId(app_name)].locally_available);
+  if (ids_.count(new_name) != 0) {
+    LOG(kError) << "App \"" << new_name << "\" is already in the search index.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  Erase(app_name);
+  Insert(new_name, locally_available);
+}
+
+void AppSearchIndex::SetLocallyAvailable(const AppName& app_name, bool locally_available) {
+  entries_[FindId(app_name)].locally_available = locally_available;
+}
+
+void AppSearchIndex::Apply(const std::vector<AppEvent>& events) {
+  for (const auto& event : events) {
+    switch (event.type) {
+      case AppEvent::Type::kAdded:
+        Insert(event.app_name, event.locally_available);
+        break;
+      case AppEvent::Type::kRemoved:
+        Erase(event.app_name);
+        break;
+      case AppEvent::Type::kRenamed:
+        Rename(event.old_name, event.app_name);
+        break;
+      case AppEvent::Type::kMovedToLocal:
+      case AppEvent::Type::kMovedToNonLocal:
+        SetLocallyAvailable(event.app_name, event.locally_available);
+        break;
+      case AppEvent::Type::kFieldUpdated:
+      default:
+        break;
+    }
+  }
+}
+
+void AppSearchIndex::Clear() {
+  folded_names_.clear();
+  entries_.clear();
+  names_.clear();
+  char_masks_.clear();
+  nodes_.assign(1, Node(0, 0, 0));
+  ids_.clear();
+  dead_count_ = 0;
+}
+
+std::vector<AppSearchResult> AppSearchIndex::Search(const std::string& query,
+                                                    std::size_t max_results) const {
+  std::vector<AppSearchResult> results;
+  if (query.empty() || max_results == 0)
+    return results;
+  const std::string folded_query(Fold(query));
+  std::vector<bool> matched(entries_.size(), false);
+  SearchPrefix(folded_query, max_results, results, matched);
+  if (results.size() < max_results)
+    SearchSubstring(folded_query, max_results, results, matched);
+  // A single-character fuzzy match is just a substring match.
+  if (results.size() < max_results && folded_query.size() > 1)
+    SearchFuzzy(folded_query, max_results, results, matched);
+  return results;
+}
+
+std::size_t AppSearchIndex::size() const { return ids_.size(); }
+
+void AppSearchIndex::InsertIntoTrie(Id entry_id) {
+  const Id length(entries_[entry_id].length);
+  const Id offset(entries_[entry_id].offset);
+  const char* const name(folded_names_.data() + offset);
+  Id node_id(0), position(0);
+  for (;;) {
+    nodes_[node_id].min_length = std::min(nodes_[node_id].min_length, length);
+    if (position == length) {
+      entries_[entry_id].next_in_node = nodes_[node_id].first_entry;
+      nodes_[node_id].first_entry = entry_id;
+      return;
+    }
+
+    // Find the child starting with the next character, or the sibling to insert a new one after.
+    const unsigned char next(static_cast<unsigned char>(name[position]));
+    Id previous(kNone), child(nodes_[node_id].first_child);
+    while (child != kNone &&
+           static_cast<unsigned char>(folded_names_[nodes_[child].label_offset]) < next) {
+      previous = child;
+      child = nodes_[child].next_sibling;
+    }
+    auto link_in([&](Id new_child) {
+      if (previous == kNone)
+        nodes_[node_id].first_child = new_child;
+      else
+        nodes_[previous].next_sibling = new_child;
+    });
+
+    if (child == kNone ||
+        static_cast<unsigned char>(folded_names_[nodes_[child].label_offset]) != next) {
+      const Id leaf(static_cast<Id>(nodes_.size()));
+      nodes_.emplace_back(offset + position, length - position, length);
+      nodes_[leaf].next_sibling = child;
+      link_in(leaf);
+      node_id = leaf;
+      position = length;
+      continue;
+    }
+
+    const char* const label(folded_names_.data() + nodes_[child].label_offset);
+    const Id label_length(nodes_[child].label_length);
+    Id common(1);
+    while (common < label_length && position + common < length &&
+           label[common] == name[position + common]) {
+      ++common;
+    }
+    if (common < label_length) {
+      // Split the child's edge, inserting a new node at the point where the names diverge.
+      const Id middle(static_cast<Id>(nodes_.size()));
+      nodes_.emplace_back(nodes_[child].label_offset, common, position + common);
+      nodes_[middle].min_length = nodes_[child].min_length;
+      nodes_[middle].first_child = child;
+      nodes_[middle].next_sibling = nodes_[child].next_sibling;
+      nodes_[child].next_sibling = kNone;
+      nodes_[child].label_offset += common;
+      nodes_[child].label_length -= common;
+      link_in(middle);
+      child = middle;
+    }
+    node_id = child;
+    position += common;
+  }
+}
+
+void AppSearchIndex::EraseFromTrie(Id entry_id) {
+  const Entry& entry(entries_[entry_id]);
+  const char* const name(folded_names_.data() + entry.offset);
+  std::vector<Id> path(1, 0);
+  Id position(0);
+  while (position < entry.length) {
+    Id child(nodes_[path.back()].first_child);
+    while (folded_names_[nodes_[child].label_offset] != name[position])
+      child = nodes_[child].next_sibling;
+    position += nodes_[child].label_length;
+    path.push_back(child);
+  }
+
+  Node& node(nodes_[path.back()]);
+  if (node.first_entry == entry_id) {
+    node.first_entry = entry.next_in_node;
+  } else {
+    Id previous(node.first_entry);
+    while (entries_[previous].next_in_node != entry_id)
+      previous = entries_[previous].next_in_node;
+    entries_[previous].next_in_node = entry.next_in_node;
+  }
+  for (auto itr(path.rbegin()); itr != path.rend(); ++itr)
+    RecomputeMinLength(*itr);
+}
+
+AppSearchIndex::Id AppSearchIndex::FindPrefixNode(const std::string& folded_query) const {
+  Id node_id(0);
+  std::size_t position(0);
+  while (position < folded_query.size()) {
+    Id child(nodes_[node_id].first_child);
+    while (child != kNone && folded_names_[nodes_[child].label_offset] != folded_query[position])
+      child = nodes_[child].next_sibling;
+    if (child == kNone)
+      return kNone;
+    const std::size_t compare_size(
+        std::min<std::size_t>(nodes_[child].label_length, folded_query.size() - position));
+    if (folded_names_.compare(nodes_[child].label_offset, compare_size, folded_query, position,
+                              compare_size) != 0) {
+      return kNone;
+    }
+    position += compare_size;
+    node_id = child;
+  }
+  return node_id;
+}
+
+void AppSearchIndex::RecomputeMinLength(Id node_id) {
+  Node& node(nodes_[node_id]);
+  node.min_length = node.first_entry == kNone ? kNone : node.depth;
+  for (Id child(node.first_child); child != kNone; child = nodes_[child].next_sibling)
+    node.min_length = std::min(node.min_length, nodes_[child].min_length);
+}
+
+void AppSearchIndex::CompactIfRequired() {
+  if (dead_count_ < kMinCompactionCount || dead_count_ <= ids_.size())
+    return;
+  std::vector<std::pair<AppName, bool>> live_entries;
+  live_entries.reserve(ids_.size());
+  for (std::size_t i(0); i < entries_.size(); ++i) {
+    if (entries_[i].live)
+      live_entries.emplace_back(std::move(names_[i]), entries_[i].locally_available);
+  }
+  Clear();
+  for (const auto& live_entry : live_entries)
+    Insert(live_entry.first, live_entry.second);
+}
+
+bool AppSearchIndex::ShorterOrFirst(Id lhs, Id rhs) const {
+  return entries_[lhs].length != entries_[rhs].length ? entries_[lhs].length < entries_[rhs].length
+                                                      : names_[lhs] < names_[rhs];
+}
+
+AppSearchIndex::Id AppSearchIndex::FindId(const AppName& app_name) const {
+  auto itr(ids_.find(app_name));
+  if (itr == ids_.end()) {
+    LOG(kError) << "App \"" << app_name << "\" isn't in the search index.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  return itr->second;
+}
+
+void AppSearchIndex::SearchPrefix(const std::string& folded_query, std::size_t max_results,
+                                  std::vector<AppSearchResult>& results,
+                                  std::vector<bool>& matched) const {
+  const Id subtree(FindPrefixNode(folded_query));
+  if (subtree == kNone)
+    return;
+
+  // Expand the subtree best-first, keyed on the length of the shortest name each candidate could
+  // yield, with entries taking precedence over nodes of the same length.  Once enough entries have
+  // been found, any further ones of the same length are also taken so the cut-off is stable.
+  struct Candidate {
+    Id length;
+    bool is_entry;
+    Id index;
+  };
+  auto lower_priority([](const Candidate& lhs, const Candidate& rhs) {
+    return std::make_tuple(lhs.length, !lhs.is_entry) > std::make_tuple(rhs.length, !rhs.is_entry);
+  });
+  std::priority_queue<Candidate, std::vector<Candidate>, decltype(lower_priority)> candidates(
+      lower_priority);
+  candidates.push(Candidate{nodes_[subtree].min_length, false, subtree});
+  std::vector<Id> found;
+  while (!candidates.empty()) {
+    const Candidate candidate(candidates.top());
+    if (candidate.length == kNone ||
+        (found.size() >= max_results && candidate.length > entries_[found.back()].length)) {
+      break;
+    }
+    candidates.pop();
+    if (candidate.is_entry) {
+      found.push_back(candidate.index);
+      continue;
+    }
+    const Node& node(nodes_[candidate.index]);
+    for (Id entry_id(node.first_entry); entry_id != kNone;
+         entry_id = entries_[entry_id].next_in_node) {
+      candidates.push(Candidate{node.depth, true, entry_id});
+    }
+    for (Id child(node.first_child); child != kNone; child = nodes_[child].next_sibling) {
+      if (nodes_[child].min_length != kNone)
+        candidates.push(Candidate{nodes_[child].min_length, false, child});
+    }
+  }
+
+  std::sort(found.begin(), found.end(),
+            [&](Id lhs, Id rhs) { return ShorterOrFirst(lhs, rhs); });
+  for (Id entry_id : found) {
+    matched[entry_id] = true;
+    if (results.size() == max_results)
+      continue;
+    const Entry& entry(entries_[entry_id]);
+    results.emplace_back(names_[entry_id], entry.locally_available,
+                         entry.length == folded_query.size() ? AppSearchResult::Match::kExact
+                                                             : AppSearchResult::Match::kPrefix);
+  }
+}
+
+void AppSearchIndex::SearchSubstring(const std::string& folded_query, std::size_t max_results,
+                                     std::vector<AppSearchResult>& results,
+                                     std::vector<bool>& matched) const {
+  struct Candidate {
+    Id entry_id;
+    bool word_start;
+    Id position;
+  };
+  std::vector<Candidate> candidates;
+  auto entry_itr(entries_.begin());
+  FindAll(folded_names_, folded_query, [&](std::size_t match_position) {
+    // Matches are reported in ascending order, so the owning entry is at or after the last one.
+    // Gallop forwards from there to bound the search, since matches are usually close together.
+    std::size_t step(1);
+    while (step < static_cast<std::size_t>(entries_.end() - entry_itr) &&
+           entry_itr[step].offset <= match_position) {
+      step *= 2;
+    }
+    const auto search_end(step < static_cast<std::size_t>(entries_.end() - entry_itr)
+                              ? entry_itr + step
+                              : entries_.end());
+    entry_itr = std::upper_bound(entry_itr + step / 2, search_end, match_position,
+                                 [](std::size_t position, const Entry& entry) {
+                                   return position < entry.offset;
+                                 }) - 1;
+    const Id entry_id(static_cast<Id>(entry_itr - entries_.begin()));
+    if (!entry_itr->live || matched[entry_id])
+      return;
+    const Id position(static_cast<Id>(match_position - entry_itr->offset));
+    const bool word_start(IsWordStart(folded_names_.data() + entry_itr->offset, position));
+    if (!candidates.empty() && candidates.back().entry_id == entry_id) {
+      if (word_start && !candidates.back().word_start) {
+        candidates.back().word_start = true;
+        candidates.back().position = position;
+      }
+      return;
+    }
+    candidates.push_back(Candidate{entry_id, word_start, position});
+  });
+
+  std::sort(candidates.begin(), candidates.end(), [&](const Candidate& lhs, const Candidate& rhs) {
+    if (lhs.word_start != rhs.word_start)
+      return lhs.word_start;
+    if (lhs.position != rhs.position)
+      return lhs.position < rhs.position;
+    return ShorterOrFirst(lhs.entry_id, rhs.entry_id);
+  });
+  for (const auto& candidate : candidates) {
+    matched[candidate.entry_id] = true;
+    if (results.size() == max_results)
+      continue;
+    results.emplace_back(names_[candidate.entry_id], entries_[candidate.entry_id].locally_available,
+                         AppSearchResult::Match::kSubstring);
+  }
+}
+
+void AppSearchIndex::SearchFuzzy(const std::string& folded_query, std::size_t max_results,
+                                 std::vector<AppSearchResult>& results,
+                                 const std::vector<bool>& matched) const {
+  const std::uint64_t query_mask(CharMask(folded_query));
+  std::vector<std::pair<int, Id>> candidates;
+  for (Id entry_id(0); entry_id < static_cast<Id>(char_masks_.size()); ++entry_id) {
+    // Erased entries have no bits set, so are also skipped here.
+    if ((char_masks_[entry_id] & query_mask) != query_mask || matched[entry_id])
+      continue;
+    const Entry& entry(entries_[entry_id]);
+    int score(0);
+    if (FuzzyMatch(folded_names_.data() + entry.offset, entry.length,
+                   entry.offset + 32 <= folded_names_.size(), folded_query, score)) {
+      candidates.emplace_back(score, entry_id);
+    }
+  }
+
+  const std::size_t wanted(std::min(candidates.size(), max_results - results.size()));
+  auto better([&](const std::pair<int, Id>& lhs, const std::pair<int, Id>& rhs) {
+    return lhs.first != rhs.first ? lhs.first > rhs.first : ShorterOrFirst(lhs.second, rhs.second);
+  });
+  std::partial_sort(candidates.begin(), candidates.begin() + wanted, candidates.end(), better);
+  for (std::size_t i(0); i < wanted; ++i) {
+    const Id entry_id(candidates[i].second);
+    results.emplace_back(names_[entry_id], entries_[entry_id].locally_available,
+                         AppSearchResult::Match::kFuzzy);
+  }
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,152 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_APP_SEARCH_INDEX_H_
+#define MAIDSAFE_LAUNCHER_APP_SEARCH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/launcher/app_events.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+class AppSearchIndexTest;
+}  // namespace test
+
+struct AppSearchResult {
+  // In order of decreasing rank.
+  enum class Match { kExact, kPrefix, kSubstring, kFuzzy };
+
+  AppSearchResult(AppName name_in, bool locally_available_in, Match match_in);
+
+  AppName name;
+  bool locally_available;
+  Match match;
+};
+
+// A case-insensitive (ASCII only) search index over app names, for as-you-type searching.
+//
+// The folded names are appended to a single contiguous buffer, and a path-compressed trie whose
+// edge labels point into that buffer is maintained over them.  Prefix queries walk the trie and
+// then expand its nodes shortest-name-first, so they only touch the nodes leading to the results
+// returned.  If there are too few prefix matches, the buffer is scanned for substring matches and
+// then for fuzzy, in-order subsequence matches, skipping any name which doesn't contain every
+// character of the query.  Both scans use SSE2 where available.
+//
+// Erased names are left in the buffer and trie until they make up over half of the index, at which
+// point both are rebuilt.  This class is not thread-safe.
+class AppSearchIndex {
+ public:
+  AppSearchIndex();
+
+  AppSearchIndex(const AppSearchIndex&) = delete;
+  AppSearchIndex(AppSearchIndex&&) = delete;
+  AppSearchIndex& operator=(const AppSearchIndex&) = delete;
+  AppSearchIndex& operator=(AppSearchIndex&&) = delete;
+
+  // Throws if 'app_name' is already indexed.
+  void Insert(const AppName& app_name, bool locally_available);
+  // The following throw if 'app_name' isn't indexed.
+  void Erase(const AppName& app_name);
+  void Rename(const AppName& app_name, const AppName& new_name);
+  void SetLocallyAvailable(const AppName& app_name, bool locally_available);
+  // Applies the changes described by 'events'.
+  void Apply(const std::vector<AppEvent>& events);
+  void Clear();
+
+  // Returns at most 'max_results' matches for 'query', best first.  Within each kind of match,
+  // exact and prefix matches are ordered shortest first, substring matches by whether they start a
+  // word and then by position, and fuzzy matches by how contiguous they are.
+  std::vector<AppSearchResult> Search(const std::string& query, std::size_t max_results) const;
+
+  std::size_t size() const;
+
+  friend class test::AppSearchIndexTest;
+
+ private:
+  using Id = std::uint32_t;
+
+  // The entries are kept small, and their names held separately in 'names_', so that scanning them
+  // is cache-friendly.
+  struct Entry {
+    Entry(Id offset_in, Id length_in, bool locally_available_in);
+
+    // Location of the folded name in 'folded_names_'.
+    Id offset, length;
+    // Next entry with the same folded name, if any.
+    Id next_in_node;
+    bool locally_available, live;
+  };
+
+  struct Node {
+    Node(Id label_offset_in, Id label_length_in, Id depth_in);
+
+    // The node's edge label is the substring of 'folded_names_' at 'label_offset'.
+    Id label_offset, label_length;
+    // Children are kept in a singly-linked list ordered by the first character of their labels.
+    Id first_child, next_sibling;
+    Id first_entry;
+    // Length of the folded names ending at this node.
+    Id depth;
+    // Length of the shortest folded name ending at or below this node.
+    Id min_length;
+  };
+
+  void InsertIntoTrie(Id entry_id);
+  void EraseFromTrie(Id entry_id);
+  // Returns the root of the subtree holding all names starting with 'folded_query', or kNone.
+  Id FindPrefixNode(const std::string& folded_query) const;
+  void RecomputeMinLength(Id node_id);
+  void CompactIfRequired();
+  Id FindId(const AppName& app_name) const;
+  // Orders entries by the length of their names, then by name.
+  bool ShorterOrFirst(Id lhs, Id rhs) const;
+
+  void SearchPrefix(const std::string& folded_query, std::size_t max_results,
+                    std::vector<AppSearchResult>& results, std::vector<bool>& matched) const;
+  void SearchSubstring(const std::string& folded_query, std::size_t max_results,
+                       std::vector<AppSearchResult>& results, std::vector<bool>& matched) const;
+  void SearchFuzzy(const std::string& folded_query, std::size_t max_results,
+                   std::vector<AppSearchResult>& results, const std::vector<bool>& matched) const;
+
+  static const Id kNone;
+
+  std::string folded_names_;
+  std::vector<Entry> entries_;
+  std::vector<AppName> names_;
+  // For each entry, a bit is set for every distinct character of its folded name (or none if it
+  // has been erased).  These are held separately so that filtering on them is a contiguous scan.
+  std::vector<std::uint64_t> char_masks_;
+  std::vector<Node> nodes_;
+  std::unordered_map<AppName, Id> ids_;
+  std::size_t dead_count_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_APP_SEARCH_INDEX_H_
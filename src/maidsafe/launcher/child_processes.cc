@@ -0,0 +1,337 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/child_processes.h"
+
+#include <cctype>
+#include <cerrno>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "asio/post.hpp"
+#include "asio/signal_set.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "asio/posix/stream_descriptor.hpp"
+#endif
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/on_scope_exit.h"
+
+#ifndef MAIDSAFE_WIN32
+extern char** environ;
+#endif
+
+namespace maidsafe {
+
+namespace launcher {
+
+std::vector<std::string> TokeniseArgs(const AppArgs& args) {
+  std::vector<std::string> tokens;
+  std::string token;
+  bool in_token{false};
+  char quote{0};
+  for (auto itr(args.begin()); itr != args.end(); ++itr) {
+    if (quote != 0) {
+      if (*itr == quote) {
+        quote = 0;
+      } else if (quote == '"' && *itr == '\\' && std::next(itr) != args.end() &&
+                 (*std::next(itr) == '"' || *std::next(itr) == '\\')) {
+        token += *++itr;
+      } else {
+        token += *itr;
+      }
+    } else if (*itr == '\'' || *itr == '"') {
+      quote = *itr;
+      in_token = true;
+    } else if (*itr == '\\') {
+      if (++itr == args.end()) {
+        LOG(kError) << "App args end with an escaping backslash.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+      }
+      token += *itr;
+      in_token = true;
+    } else if (std::isspace(static_cast<unsigned char>(*itr))) {
+      if (in_token)
+        tokens.push_back(std::move(token));
+      token.clear();
+      in_token = false;
+    } else {
+      token += *itr;
+      in_token = true;
+    }
+  }
+  if (quote != 0) {
+    LOG(kError) << "App args have an unterminated quote.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+  if (in_token)
+    tokens.push_back(std::move(token));
+  return tokens;
+}
+
+#ifdef MAIDSAFE_WIN32
+
+struct ChildProcesses::State {};
+
+ChildProcesses::ChildProcesses(asio::io_service& /*io_service*/)
+    : state_(std::make_shared<State>()) {}
+
+ChildProcesses::~ChildProcesses() = default;
+
+int ChildProcesses::Spawn(const boost::filesystem::path& path,
+                          const std::vector<std::string>& /*args*/, ExitHandler /*on_exit*/,
+                          int /*inherited_fd*/) {
+  LOG(kError) << "Can't spawn " << path << " - not yet supported on Windows.";
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+}
+
+std::size_t ChildProcesses::Count() const { return 0; }
+
+#else
+
+// Held by shared pointer so that handlers still queued on the io_service once the owning
+// ChildProcesses has been destroyed can detect that via a weak pointer.
+struct ChildProcesses::State {
+  struct Child {
+    ExitHandler on_exit;
+    // Null if the child is reaped on SIGCHLD instead.
+    std::unique_ptr<asio::posix::stream_descriptor> pidfd;
+  };
+
+  explicit State(asio::io_service& io_service_in)
+      : io_service(io_service_in), mutex(), children(), sigchld() {}
+
+  // Reaps 'pid' if it has exited, then invokes its exit handler.  Does nothing if it's still
+  // running or has already been reaped.
+  void TryReap(pid_t pid);
+  // These must be called with 'mutex' held.
+  static void WatchPidfd(const std::shared_ptr<State>& state, pid_t pid,
+                         asio::posix::stream_descriptor& pidfd);
+  static void AwaitSigchld(const std::shared_ptr<State>& state);
+
+  asio::io_service& io_service;
+  std::mutex mutex;
+  // Children which haven't yet been reaped, keyed by process ID.
+  std::map<pid_t, Child> children;
+  // Only created once a child can't be watched via a pidfd.
+  std::unique_ptr<asio::signal_set> sigchld;
+};
+
+namespace {
+
+int ExitCode(int status) {
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+  if (WIFSIGNALED(status))
+    return 128 + WTERMSIG(status);
+  return -1;
+}
+
+}  // unnamed namespace
+
+void ChildProcesses::State::TryReap(pid_t pid) {
+  int status{0};
+  pid_t result{0};
+  do {
+    result = waitpid(pid, &status, WNOHANG);
+  } while (result == -1 && errno == EINTR);
+  if (result == 0)
+    return;
+  const int wait_error(errno);
+
+  ExitHandler on_exit;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto itr(children.find(pid));
+    if (itr == children.end())
+      return;
+    on_exit = std::move(itr->second.on_exit);
+    children.erase(itr);
+  }
+
+  int exit_code{-1};
+  if (result == -1) {
+    LOG(kWarning) << "Failed to reap child process " << pid << ": "
+                  << std::error_code(wait_error, std::system_category()).message();
+  } else {
+    exit_code = ExitCode(status);
+  }
+  try {
+    if (on_exit)
+      on_exit(exit_code);
+  } catch (const std::exception& e) {
+    LOG(kError) << "Exit handler for child process " << pid
+                << " threw: " << boost::diagnostic_information(e);
+  }
+}
+
+void ChildProcesses::State::WatchPidfd(const std::shared_ptr<State>& state, pid_t pid,
+                                       asio::posix::stream_descriptor& pidfd) {
+  std::weak_ptr<State> weak_state(state);
+  pidfd.async_wait(asio::posix::stream_descriptor::wait_read,
+                   [weak_state, pid](const asio::error_code& error) {
+                     auto state(weak_state.lock());
+                     if (state && error != asio::error::operation_aborted)
+                       state->TryReap(pid);
+                   });
+}
+
+void ChildProcesses::State::AwaitSigchld(const std::shared_ptr<State>& state) {
+  std::weak_ptr<State> weak_state(state);
+  state->sigchld->async_wait([weak_state](const asio::error_code& error, int) {
+    auto state(weak_state.lock());
+    if (!state || error)
+      return;
+    // SIGCHLD isn't queued, so a single signal can stand for several exited children.
+    std::vector<pid_t> signalled;
+    {
+      std::lock_guard<std::mutex> lock{state->mutex};
+      for (const auto& child : state->children) {
+        if (!child.second.pidfd)
+          signalled.push_back(child.first);
+      }
+    }
+    for (pid_t pid : signalled)
+      state->TryReap(pid);
+    std::lock_guard<std::mutex> lock{state->mutex};
+    if (state->sigchld)
+      AwaitSigchld(state);
+  });
+}
+
+ChildProcesses::ChildProcesses(asio::io_service& io_service)
+    : state_(std::make_shared<State>(io_service)) {}
+
+ChildProcesses::~ChildProcesses() {
+  // Closing the pidfds and the signal set cancels any outstanding waits.
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  state_->children.clear();
+  state_->sigchld.reset();
+}
+
+int ChildProcesses::Spawn(const boost::filesystem::path& path,
+                          const std::vector<std::string>& args, ExitHandler on_exit,
+                          int inherited_fd) {
+  // argv points into 'program' and 'args' rather than copying them.
+  std::string program(path.string());
+  std::vector<char*> argv;
+  argv.reserve(args.size() + 2);
+  argv.push_back(&program[0]);
+  for (const auto& arg : args)
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  // glibc's posix_spawn always uses a vfork-style clone, so the launcher's address space isn't
+  // copied however large it is.  Elsewhere, POSIX_SPAWN_USEVFORK requests the same where defined.
+  posix_spawnattr_t attributes;
+  posix_spawnattr_init(&attributes);
+  on_scope_exit destroy_attributes{[&] { posix_spawnattr_destroy(&attributes); }};
+  sigset_t no_signals, default_signals;
+  sigemptyset(&no_signals);
+  sigemptyset(&default_signals);
+  sigaddset(&default_signals, SIGCHLD);
+  sigaddset(&default_signals, SIGPIPE);
+  short flags{POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF};
+#ifdef POSIX_SPAWN_USEVFORK
+  flags |= POSIX_SPAWN_USEVFORK;
+#endif
+  posix_spawnattr_setflags(&attributes, flags);
+  posix_spawnattr_setsigmask(&attributes, &no_signals);
+  posix_spawnattr_setsigdefault(&attributes, &default_signals);
+
+  // dup2 in the child clears close-on-exec on the duplicate, unless it's already kInheritedFd.  In
+  // that case it's first duplicated (close-on-exec) elsewhere.
+  posix_spawn_file_actions_t file_actions;
+  posix_spawn_file_actions_init(&file_actions);
+  on_scope_exit destroy_file_actions{[&] { posix_spawn_file_actions_destroy(&file_actions); }};
+  int duplicate_fd{-1};
+  on_scope_exit close_duplicate{[&] {
+    if (duplicate_fd != -1)
+      close(duplicate_fd);
+  }};
+  if (inherited_fd == kInheritedFd) {
+    duplicate_fd = fcntl(inherited_fd, F_DUPFD_CLOEXEC, kInheritedFd + 1);
+    if (duplicate_fd == -1) {
+      LOG(kError) << "Failed to duplicate descriptor " << inherited_fd << " for " << path << ": "
+                  << std::error_code(errno, std::system_category()).message();
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+    }
+    inherited_fd = duplicate_fd;
+  }
+  if (inherited_fd != -1)
+    posix_spawn_file_actions_adddup2(&file_actions, inherited_fd, kInheritedFd);
+
+  pid_t pid{0};
+  const int result(
+      posix_spawn(&pid, program.c_str(), &file_actions, &attributes, argv.data(), environ));
+  if (result != 0) {
+    LOG(kError) << "Failed to spawn " << path << ": "
+                << std::error_code(result, std::system_category()).message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  State::Child& child(state_->children[pid]);
+  child.on_exit = std::move(on_exit);
+#ifdef SYS_pidfd_open
+  const int pidfd(static_cast<int>(syscall(SYS_pidfd_open, pid, 0)));
+  if (pidfd != -1) {
+    child.pidfd = maidsafe::make_unique<asio::posix::stream_descriptor>(state_->io_service, pidfd);
+    State::WatchPidfd(state_, pid, *child.pidfd);
+    return pid;
+  }
+#endif
+  if (!state_->sigchld) {
+    state_->sigchld = maidsafe::make_unique<asio::signal_set>(state_->io_service, SIGCHLD);
+    State::AwaitSigchld(state_);
+  }
+  // The child may have exited before the signal set was created.
+  std::weak_ptr<State> weak_state(state_);
+  asio::post(state_->io_service, [weak_state, pid] {
+    if (auto state = weak_state.lock())
+      state->TryReap(pid);
+  });
+  return pid;
+}
+
+std::size_t ChildProcesses::Count() const {
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  return state_->children.size();
+}
+
+#endif
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CHILD_PROCESSES_H_
+#define MAIDSAFE_LAUNCHER_CHILD_PROCESSES_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "asio/io_service.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Splits 'args' into separate arguments at unquoted whitespace.  As in a POSIX shell, a backslash
+// outside quotes escapes the following character, and single or double quotes group characters
+// (including whitespace) into part of a single argument.  Within double quotes, a backslash only
+// escapes a double quote or a backslash.  No expansion of any kind is done.  Throws
+// invalid_argument if a quote is unterminated or 'args' ends with an escaping backslash.
+std::vector<std::string> TokeniseArgs(const AppArgs& args);
+
+// The descriptor number at which a child receives the descriptor passed to Spawn as 'inherited_fd'.
+const int kInheritedFd = 3;
+
+// Spawns child processes with posix_spawn, and reaps them asynchronously on 'io_service' so that no
+// thread blocks waiting for a child.  Where the kernel supports it (Linux 5.3 and later), each
+// child is watched via its own pidfd.  Otherwise SIGCHLD is handled via an asio::signal_set, and
+// each outstanding child is polled with a non-blocking waitpid when it's raised.
+//
+// Exit handlers are invoked on one of 'io_service''s threads with the child's exit code, or 128
+// plus the signal number if it was killed by a signal, or -1 if its status couldn't be retrieved.
+// Children still running when this is destroyed are left running, and their exit handlers are
+// never invoked.  Spawning isn't yet supported on Windows.
+//
+// All public functions are threadsafe.
+class ChildProcesses {
+ public:
+  using ExitHandler = std::function<void(int exit_code)>;
+
+  explicit ChildProcesses(asio::io_service& io_service);
+  ~ChildProcesses();
+
+  ChildProcesses(const ChildProcesses&) = delete;
+  ChildProcesses(ChildProcesses&&) = delete;
+  ChildProcesses& operator=(const ChildProcesses&) = delete;
+  ChildProcesses& operator=(ChildProcesses&&) = delete;
+
+  // Starts the executable at 'path' with 'args' as its arguments (its argv[0] is 'path').  The
+  // child inherits this process's environment, but not its signal mask or the dispositions of
+  // SIGCHLD and SIGPIPE.  If 'inherited_fd' isn't -1, the child also receives a duplicate of it as
+  // descriptor kInheritedFd, whether or not it's close-on-exec.  Returns the child's process ID, or
+  // throws if it can't be started.
+  int Spawn(const boost::filesystem::path& path, const std::vector<std::string>& args,
+            ExitHandler on_exit, int inherited_fd = -1);
+  // The number of children which haven't yet been reaped.
+  std::size_t Count() const;
+
+ private:
+  struct State;
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CHILD_PROCESSES_H_
@@ -0,0 +1,449 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/convert.h"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+// The header is
+//
+//   magic "MSCZ" | codec type (1 byte) | level (1 byte) | dictionary id (8 bytes, 0 if none) |
+//   uncompressed size (4 bytes)
+//
+// with integers little-endian.  zlib output always starts with 0x78, so can't match the magic.
+const char kMagic[] = "MSCZ";
+const std::size_t kMagicSize(sizeof(kMagic) - 1);
+const std::size_t kHeaderSize(kMagicSize + 1 + 1 + 8 + 4);
+
+// The kLz payload is a series of sequences, each of which is
+//
+//   literal count | literals | match length - kMinMatch | match offset
+//
+// with the counts as LEB128 varints.  The match is omitted from the final sequence, which is itself
+// omitted if the input ends with a match.  Match offsets count back from the current end of the
+// output, and may reach into the dictionary, which is treated as preceding the output.
+const std::size_t kMinMatch(4);
+const int kMinHashBits(10), kMaxHashBits(16);
+
+void ThrowParsingError(const char* reason) {
+  LOG(kError) << "Failed to decompress config file: " << reason;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+std::uint64_t DictionaryId(const std::string& dictionary) {
+  if (dictionary.empty())
+    return 0;
+  // 64-bit FNV-1a, never 0.
+  std::uint64_t hash(14695981039346656037ULL);
+  for (char c : dictionary) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+void AppendInteger(std::uint64_t value, std::size_t width, std::string& output) {
+  for (std::size_t i(0); i < width; ++i)
+    output += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+std::uint64_t ReadInteger(const char* data, std::size_t width) {
+  std::uint64_t value(0);
+  for (std::size_t i(0); i < width; ++i)
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+  return value;
+}
+
+void AppendVarint(std::size_t value, std::string& output) {
+  while (value >= 0x80) {
+    output += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  output += static_cast<char>(value);
+}
+
+std::size_t ReadVarint(const char*& position, const char* end) {
+  std::uint64_t value(0);
+  for (int shift(0); shift < 35; shift += 7) {
+    if (position == end)
+      ThrowParsingError("truncated");
+    const unsigned char byte(static_cast<unsigned char>(*position++));
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      if (value > std::numeric_limits<std::uint32_t>::max())
+        break;
+      return static_cast<std::size_t>(value);
+    }
+  }
+  ThrowParsingError("bad varint");
+  return 0;
+}
+
+std::uint32_t Hash(const char* data, int hash_bits) {
+  std::uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return (value * 2654435761U) >> (32 - hash_bits);
+}
+
+// Returns the length of the common prefix of 'first' and 'second', up to 'limit'.
+std::size_t MatchLength(const char* first, const char* second, std::size_t limit) {
+  std::size_t length(0);
+  while (length + 8 <= limit) {
+    std::uint64_t a, b;
+    std::memcpy(&a, first + length, 8);
+    std::memcpy(&b, second + length, 8);
+    if (a != b) {
+      while (first[length] == second[length])
+        ++length;
+      return length;
+    }
+    length += 8;
+  }
+  while (length < limit && first[length] == second[length])
+    ++length;
+  return length;
+}
+
+std::string LzCompress(const std::string& input, int level, const std::string& dictionary) {
+  if (dictionary.size() + input.size() > std::numeric_limits<std::int32_t>::max()) {
+    LOG(kError) << "Config file too large to compress.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+  const std::string history(dictionary + input);
+  const char* const data(history.data());
+  const std::size_t end(history.size());
+  // Size the hash table to the input, so that small files don't pay to clear a large table.
+  int hash_bits(kMinHashBits);
+  while (hash_bits < kMaxHashBits && (std::size_t(1) << hash_bits) < end)
+    ++hash_bits;
+  std::vector<std::int32_t> head(std::size_t(1) << hash_bits, -1);
+  // Level 1 keeps only the most recent position per hash, so needs no chain.
+  const std::size_t max_attempts(std::size_t(1) << (level - 1));
+  std::vector<std::int32_t> chain(max_attempts > 1 ? end : 0, -1);
+  auto insert([&](std::size_t position) {
+    if (position + kMinMatch > end)
+      return;
+    std::int32_t& bucket(head[Hash(data + position, hash_bits)]);
+    if (!chain.empty())
+      chain[position] = bucket;
+    bucket = static_cast<std::int32_t>(position);
+  });
+  for (std::size_t position(0); position < dictionary.size(); ++position)
+    insert(position);
+
+  std::string output;
+  output.reserve(input.size() / 2 + 16);
+  auto append_literals([&](std::size_t first, std::size_t last) {
+    AppendVarint(last - first, output);
+    output.append(data + first, last - first);
+  });
+
+  std::size_t position(dictionary.size()), literal_start(position), misses(0);
+  while (position + kMinMatch <= end) {
+    std::size_t best_length(0), best_position(0), attempts(0);
+    const std::size_t limit(end - position);
+    for (std::int32_t candidate(head[Hash(data + position, hash_bits)]);
+         candidate >= 0 && attempts < max_attempts;
+         candidate = chain.empty() ? -1 : chain[candidate], ++attempts) {
+      const std::size_t length(MatchLength(data + candidate, data + position, limit));
+      if (length > best_length) {
+        best_length = length;
+        best_position = static_cast<std::size_t>(candidate);
+        if (length == limit)
+          break;
+      }
+    }
+    if (best_length < kMinMatch) {
+      // Skip ahead faster through incompressible stretches at the lowest level.
+      insert(position);
+      position += (max_attempts == 1) ? 1 + (++misses >> 5) : 1;
+      continue;
+    }
+    misses = 0;
+    append_literals(literal_start, position);
+    AppendVarint(best_length - kMinMatch, output);
+    AppendVarint(position - best_position, output);
+    // At the lowest level, only the start and the last two positions of each match are indexed.
+    if (max_attempts == 1) {
+      insert(position);
+      insert(position + best_length - 2);
+      insert(position + best_length - 1);
+    } else {
+      for (std::size_t i(0); i < best_length; ++i)
+        insert(position + i);
+    }
+    position += best_length;
+    literal_start = position;
+  }
+  if (literal_start != end)
+    append_literals(literal_start, end);
+  return output;
+}
+
+std::string LzDecompress(const char* position, const char* end, std::size_t size,
+                         const std::string& dictionary) {
+  // Don't trust 'size' for the reservation: a corrupt payload could claim up to 4GB.
+  std::string output;
+  output.reserve(std::min(size, static_cast<std::size_t>(end - position) * 64));
+  while (output.size() < size) {
+    const std::size_t literal_count(ReadVarint(position, end));
+    if (literal_count > static_cast<std::size_t>(end - position) ||
+        literal_count > size - output.size()) {
+      ThrowParsingError("literals overrun");
+    }
+    output.append(position, literal_count);
+    position += literal_count;
+    if (output.size() == size)
+      break;
+
+    std::size_t length(ReadVarint(position, end) + kMinMatch);
+    const std::size_t offset(ReadVarint(position, end));
+    if (length > size - output.size())
+      ThrowParsingError("match overruns output");
+    if (offset == 0 || offset > dictionary.size() + output.size())
+      ThrowParsingError("bad match offset");
+    if (output.capacity() < output.size() + length)
+      output.reserve(std::max(output.capacity() * 2, output.size() + length));
+    // Copy in chunks, none of which overlap the bytes being written, so a short offset repeats
+    // its bytes with a doubling chunk size.
+    std::size_t source(dictionary.size() + output.size() - offset);
+    while (length != 0) {
+      std::size_t chunk(0);
+      if (source < dictionary.size()) {
+        chunk = std::min(length, dictionary.size() - source);
+        output.append(dictionary, source, chunk);
+      } else {
+        const std::size_t output_source(source - dictionary.size());
+        chunk = std::min(length, output.size() - output_source);
+        // Capacity was reserved above, so appending from 'output' can't invalidate the source.
+        output.append(output.data() + output_source, chunk);
+      }
+      source += chunk;
+      length -= chunk;
+    }
+  }
+  if (position != end)
+    ThrowParsingError("trailing bytes");
+  return output;
+}
+
+void CheckCodec(const ConfigCodec& codec) {
+  bool valid(false);
+  switch (codec.type) {
+    case ConfigCodec::Type::kNone:
+      valid = true;
+      break;
+    case ConfigCodec::Type::kGzip:
+    case ConfigCodec::Type::kLz:
+      valid = codec.level >= 1 && codec.level <= 9;
+      break;
+  }
+  if (!valid) {
+    LOG(kError) << "Invalid config codec " << static_cast<int>(codec.type) << " at level "
+                << codec.level;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+}
+
+}  // unnamed namespace
+
+ConfigCodec::ConfigCodec() : type(Type::kLz), level(1), dictionary(DefaultConfigDictionary()) {}
+
+ConfigCodec::ConfigCodec(Type type_in, int level_in, std::string dictionary_in)
+    : type(type_in), level(level_in), dictionary(std::move(dictionary_in)) {}
+
+const std::string& DefaultConfigDictionary() {
+  // Ordered with the most common fragments last, so that matches against them have the smallest
+  // offsets.  The "\0\0\0" sequences are the high bytes of the layout's field sizes.
+  static const char kFragments[] =
+      "\0\0\0C:\\Program Files (x86)\\\0\0\0C:\\Program Files\\\0\0\0/home/"
+      ".app/Contents/MacOS/\0\0\0/Applications/\0\0\0/opt/\0\0\0/usr/local/bin/"
+      "\0\0\0/usr/bin/\0\0\0--config=\0\0\0--port=\0\0\0--log_folder=\0\0\0--verbose"
+      ".exe\0\0\0--log_*=V\x01\0\0\0\0\0\0\0\x01";
+  static const std::string kDictionary(kFragments, sizeof(kFragments) - 1);
+  return kDictionary;
+}
+
+std::string TrainConfigDictionary(const std::vector<std::string>& samples, std::size_t max_size) {
+  // A simplified form of the cover algorithm: the samples are split into k-mers, each scored by
+  // the number of samples containing it, and the dictionary is built from the segments with the
+  // highest total score.  A k-mer's score is cleared once it's covered, so later segments favour
+  // content not yet in the dictionary.
+  const std::size_t kK(8), kSegmentSize(48);
+  auto key([](const std::string& sample, std::size_t position) {
+    std::uint64_t value;
+    std::memcpy(&value, &sample[position], sizeof(value));
+    return value;
+  });
+  std::unordered_map<std::uint64_t, std::uint32_t> scores;
+  for (const auto& sample : samples) {
+    std::unordered_set<std::uint64_t> seen;
+    for (std::size_t position(0); position + kK <= sample.size(); ++position) {
+      if (seen.insert(key(sample, position)).second)
+        ++scores[key(sample, position)];
+    }
+  }
+  // A k-mer found in a single sample is of no use in compressing the others.
+  for (auto& score : scores) {
+    if (score.second < 2)
+      score.second = 0;
+  }
+
+  std::vector<std::string> segments;
+  std::size_t total_size(0);
+  while (total_size < max_size) {
+    std::uint64_t best_score(0);
+    const std::string* best_sample(nullptr);
+    std::size_t best_start(0);
+    for (const auto& sample : samples) {
+      if (sample.size() < kK)
+        continue;
+      // Slide a window of 'window' k-mers along the sample, keeping its total score.
+      const std::size_t kmer_count(sample.size() - kK + 1);
+      const std::size_t window(std::min(kSegmentSize - kK + 1, kmer_count));
+      std::uint64_t score(0);
+      for (std::size_t position(0); position < kmer_count; ++position) {
+        score += scores[key(sample, position)];
+        if (position >= window)
+          score -= scores[key(sample, position - window)];
+        if (position + 1 >= window && score > best_score) {
+          best_score = score;
+          best_sample = &sample;
+          best_start = position + 1 - window;
+        }
+      }
+    }
+    if (best_score == 0)
+      break;
+    const std::size_t size(std::min(std::min(kSegmentSize, best_sample->size() - best_start),
+                                    max_size - total_size));
+    segments.push_back(best_sample->substr(best_start, size));
+    total_size += size;
+    for (std::size_t position(best_start); position + kK <= best_start + size; ++position)
+      scores[key(*best_sample, position)] = 0;
+  }
+
+  std::string dictionary;
+  dictionary.reserve(total_size);
+  for (auto itr(segments.rbegin()); itr != segments.rend(); ++itr)
+    dictionary += *itr;
+  return dictionary;
+}
+
+std::string CompressConfig(const std::string& input, const ConfigCodec& codec) {
+  CheckCodec(codec);
+  if (input.size() > std::numeric_limits<std::uint32_t>::max()) {
+    LOG(kError) << "Config file too large to compress.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+  const bool uses_dictionary(codec.type == ConfigCodec::Type::kLz);
+  std::string output(kMagic, kMagicSize);
+  output += static_cast<char>(codec.type);
+  output += static_cast<char>(codec.type == ConfigCodec::Type::kNone ? 0 : codec.level);
+  AppendInteger(uses_dictionary ? DictionaryId(codec.dictionary) : 0, 8, output);
+  AppendInteger(input.size(), 4, output);
+
+  switch (codec.type) {
+    case ConfigCodec::Type::kNone:
+      output += input;
+      break;
+    case ConfigCodec::Type::kGzip:
+      if (!input.empty()) {
+        output += convert::ToString(
+            crypto::Compress(crypto::UncompressedText(convert::ToByteVector(input)), codec.level)
+                .data.string());
+      }
+      break;
+    case ConfigCodec::Type::kLz:
+      output += LzCompress(input, codec.level, codec.dictionary);
+      break;
+  }
+  return output;
+}
+
+bool HasConfigCodecHeader(const char* data, std::size_t size) {
+  return size >= kHeaderSize && std::memcmp(data, kMagic, kMagicSize) == 0;
+}
+
+std::string DecompressConfig(const char* data, std::size_t size, const ConfigCodec& codec) {
+  if (!HasConfigCodecHeader(data, size))
+    ThrowParsingError("bad header");
+  const auto type(static_cast<ConfigCodec::Type>(data[kMagicSize]));
+  const std::uint64_t dictionary_id(ReadInteger(data + kMagicSize + 2, 8));
+  const std::size_t uncompressed_size(
+      static_cast<std::size_t>(ReadInteger(data + kMagicSize + 10, 4)));
+  if (type != ConfigCodec::Type::kLz && dictionary_id != 0)
+    ThrowParsingError("unexpected dictionary");
+  const char* const payload(data + kHeaderSize);
+  const char* const end(data + size);
+
+  std::string output;
+  switch (type) {
+    case ConfigCodec::Type::kNone:
+      output.assign(payload, end);
+      break;
+    case ConfigCodec::Type::kGzip:
+      if (payload != end) {
+        output = convert::ToString(
+            crypto::Uncompress(crypto::CompressedText(NonEmptyString(std::string(payload, end))))
+                .string());
+      }
+      break;
+    case ConfigCodec::Type::kLz: {
+      const std::string* dictionary(nullptr);
+      static const std::string kNoDictionary;
+      if (dictionary_id == 0)
+        dictionary = &kNoDictionary;
+      else if (dictionary_id == DictionaryId(codec.dictionary))
+        dictionary = &codec.dictionary;
+      else if (dictionary_id == DictionaryId(DefaultConfigDictionary()))
+        dictionary = &DefaultConfigDictionary();
+      else
+        ThrowParsingError("compression dictionary unavailable");
+      output = LzDecompress(payload, end, uncompressed_size, *dictionary);
+      break;
+    }
+    default:
+      ThrowParsingError("unknown codec");
+  }
+  if (output.size() != uncompressed_size)
+    ThrowParsingError("size mismatch");
+  return output;
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,80 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CONFIG_CODEC_H_
+#define MAIDSAFE_LAUNCHER_CONFIG_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace launcher {
+
+// The compression applied to the base config file before it is encrypted.
+struct ConfigCodec {
+  enum class Type : std::uint8_t {
+    kNone = 0,
+    // crypto::Compress (gzip).  'level' is from 1 (fastest) to 9 (smallest).
+    kGzip = 1,
+    // A byte-oriented LZ77 codec which can use a preset dictionary.  At level 1 it compresses
+    // around twice as fast as gzip level 1 (and over twenty times as fast as level 9), and
+    // decompresses several times as fast, at the cost of a larger output.  'level' is from 1
+    // (fastest: a single candidate match is tried per position) to 9 (up to 256 are tried).
+    kLz = 2
+  };
+
+  // The default is kLz at level 1 with the DefaultConfigDictionary.
+  ConfigCodec();
+  ConfigCodec(Type type_in, int level_in, std::string dictionary_in = std::string());
+
+  Type type;
+  int level;
+  // Only used by kLz.  The same dictionary must be supplied to decompress the output, unless it is
+  // the DefaultConfigDictionary, which is always available.
+  std::string dictionary;
+};
+
+// A dictionary of fragments common in the serialised config-only fields of apps: typical install
+// paths, executable suffixes and argument prefixes, with the framing of the config layout.
+const std::string& DefaultConfigDictionary();
+
+// Returns a dictionary of at most 'max_size' bytes made up of the substrings which are common to
+// the most 'samples' (e.g. serialised app records), with the most widely shared last.
+std::string TrainConfigDictionary(const std::vector<std::string>& samples, std::size_t max_size);
+
+// Returns 'input' compressed with 'codec', preceded by a header recording the codec type and level,
+// the identity of any dictionary used, and the size of 'input'.  Throws if 'codec' is invalid.
+std::string CompressConfig(const std::string& input, const ConfigCodec& codec);
+
+// Returns true if 'data' starts with the header written by 'CompressConfig'.  (Base files written
+// before the header was introduced hold raw gzip output, which can't match it.)
+bool HasConfigCodecHeader(const char* data, std::size_t size);
+
+// Reverses 'CompressConfig'.  If a dictionary was used, it must be either 'codec.dictionary' or the
+// DefaultConfigDictionary.  Throws a parsing_error if 'data' is malformed, or the dictionary is
+// unavailable.
+std::string DecompressConfig(const char* data, std::size_t size, const ConfigCodec& codec);
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CONFIG_CODEC_H_
@@ -0,0 +1,101 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_file_utils.h"
+
+#include <vector>
+
+#ifdef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+std::string ConfigDigest(const std::string& input) {
+  return crypto::Hash<crypto::SHA512>(input).string();
+}
+
+std::string ConfigMac(const std::string& mac_key, const std::string& data) {
+  return ConfigDigest(mac_key + ConfigDigest(mac_key + data));
+}
+
+std::string ToByteString(const crypto::AES256KeyAndIV& key_and_iv) {
+  return std::string(key_and_iv.string().begin(), key_and_iv.string().end());
+}
+
+crypto::AES256KeyAndIV DeriveKeyAndIv(const crypto::AES256KeyAndIV& key_and_iv,
+                                      const std::string& iv_seed) {
+  std::string bytes(ToByteString(key_and_iv));
+  std::string iv(ConfigDigest(bytes.substr(crypto::AES256_KeySize) + iv_seed));
+  std::vector<byte> derived(bytes.begin(), bytes.begin() + crypto::AES256_KeySize);
+  derived.insert(derived.end(), iv.begin(), iv.begin() + crypto::AES256_IVSize);
+  return crypto::AES256KeyAndIV{derived};
+}
+
+std::string EncodeUint64(std::uint64_t value, std::size_t width) {
+  std::string encoded(width, '\0');
+  for (std::size_t i(0); i < width; ++i)
+    encoded[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  return encoded;
+}
+
+std::uint64_t DecodeUint64(const char* data, std::size_t width) {
+  std::uint64_t value{0};
+  for (std::size_t i(0); i < width; ++i)
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+  return value;
+}
+
+// Directories can't be opened this way on Windows, where renames are made durable by the
+// filesystem's own journalling instead.
+void SyncToDisk(const fs::path& path) {
+#ifdef MAIDSAFE_WIN32
+  if (fs::is_directory(path))
+    return;
+  int file_descriptor(_wopen(path.wstring().c_str(), _O_RDWR | _O_BINARY));
+  bool synced(file_descriptor != -1 && _commit(file_descriptor) == 0);
+  if (file_descriptor != -1)
+    _close(file_descriptor);
+#else
+  int file_descriptor(open(path.c_str(), O_RDONLY));
+  bool synced(file_descriptor != -1 && fsync(file_descriptor) == 0);
+  if (file_descriptor != -1)
+    close(file_descriptor);
+#endif
+  if (!synced) {
+    LOG(kError) << "Failed to flush " << path << " to disk.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
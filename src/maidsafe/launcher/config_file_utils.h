@@ -0,0 +1,64 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CONFIG_FILE_UTILS_H_
+#define MAIDSAFE_LAUNCHER_CONFIG_FILE_UTILS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Helpers shared by the config file formats (see ConfigStore and ConfigRecordFile).
+
+const std::size_t kConfigDigestSize = 64;
+
+// SHA512 of 'input'.
+std::string ConfigDigest(const std::string& input);
+
+// A MAC of 'data' under 'mac_key'.  The digest is nested so that the MAC isn't open to
+// length-extension.
+std::string ConfigMac(const std::string& mac_key, const std::string& data);
+
+// Returns 'key_and_iv''s key and IV as raw bytes.
+std::string ToByteString(const crypto::AES256KeyAndIV& key_and_iv);
+
+// Returns 'key_and_iv''s key with an IV derived from its IV and 'iv_seed'.  Each distinct seed
+// yields a distinct IV, so every encryption under the key can be given its own.
+crypto::AES256KeyAndIV DeriveKeyAndIv(const crypto::AES256KeyAndIV& key_and_iv,
+                                      const std::string& iv_seed);
+
+// Little-endian fixed-width integers.
+std::string EncodeUint64(std::uint64_t value, std::size_t width = 8);
+std::uint64_t DecodeUint64(const char* data, std::size_t width = 8);
+
+// Flushes the file or directory at 'path' to stable storage.  Throws on failure.
+void SyncToDisk(const boost::filesystem::path& path);
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CONFIG_FILE_UTILS_H_
@@ -0,0 +1,189 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_format.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/launcher/app_field_traits.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+const char kMagic[] = "MSCAPP02";
+const std::size_t kMagicSize(sizeof(kMagic) - 1);
+
+void AppendUint32(std::size_t value, std::string& output) {
+  if (value > std::numeric_limits<std::uint32_t>::max()) {
+    LOG(kError) << "Config field too large to serialise.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+  for (int i(0); i < 4; ++i)
+    output += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void AppendString(const std::string& value, std::string& output) {
+  AppendUint32(value.size(), output);
+  output += value;
+}
+
+// Each app's record holds its config fields in declaration order: the strings and the path
+// size-prefixed, and auto_start as a single byte.
+void AppendField(const std::string& value, std::string& output) { AppendString(value, output); }
+
+void AppendField(const boost::filesystem::path& value, std::string& output) {
+  AppendString(value.string(), output);
+}
+
+void AppendField(bool value, std::string& output) { output += static_cast<char>(value ? 1 : 0); }
+
+std::size_t FieldSize(const std::string& value) { return 4 + value.size(); }
+
+std::size_t FieldSize(const boost::filesystem::path& value) { return 4 + value.string().size(); }
+
+std::size_t FieldSize(bool /*value*/) { return 1; }
+
+std::size_t RecordSize(const AppDetails& app) {
+  std::size_t size(0);
+  ForEachConfigField(
+      [&](auto field) { size += FieldSize(AppFieldTraits<decltype(field)>::Get(app)); });
+  return size;
+}
+
+void ThrowParsingError(const char* reason) {
+  LOG(kError) << "Failed to parse config file: " << reason;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+// Reads fields from the input in place, checking each against the bytes remaining.
+class Reader {
+ public:
+  Reader(const char* data, std::size_t size) : position_(data), end_(data + size) {}
+
+  std::size_t remaining() const { return static_cast<std::size_t>(end_ - position_); }
+
+  std::uint32_t ReadUint32() {
+    if (remaining() < 4)
+      ThrowParsingError("truncated");
+    std::uint32_t value{0};
+    for (int i(0); i < 4; ++i)
+      value |= static_cast<std::uint32_t>(static_cast<unsigned char>(position_[i])) << (8 * i);
+    position_ += 4;
+    return value;
+  }
+
+  // Returns the start of the next 'size' bytes, skipping over them.
+  const char* Skip(std::size_t size) {
+    if (remaining() < size)
+      ThrowParsingError("truncated");
+    const char* start(position_);
+    position_ += size;
+    return start;
+  }
+
+  // Returns [first, last) of the next size-prefixed string.
+  std::pair<const char*, const char*> ReadString() {
+    const std::uint32_t size(ReadUint32());
+    const char* first(Skip(size));
+    return std::make_pair(first, first + size);
+  }
+
+ private:
+  const char* position_;
+  const char* const end_;
+};
+
+void ReadField(Reader& reader, std::string& value) {
+  const auto field(reader.ReadString());
+  value.assign(field.first, field.second);
+}
+
+void ReadField(Reader& reader, boost::filesystem::path& value) {
+  const auto field(reader.ReadString());
+  value = boost::filesystem::path(field.first, field.second);
+}
+
+void ReadField(Reader& reader, bool& value) {
+  const char flag(*reader.Skip(1));
+  if (flag != 0 && flag != 1)
+    ThrowParsingError("bad auto_start value");
+  value = (flag == 1);
+}
+
+}  // unnamed namespace
+
+std::string SerialiseLocalApps(const PersistentSet<AppDetails>& local_apps) {
+  // The records are written from the traits, so a change to which fields are kInConfig changes this
+  // layout.  That must come with a new magic, after which this can be updated.
+  static_assert(kConfigAppFields == (kAppName | kAppPath | kAppArgs | kAppAutoStart),
+                "Changing the config fields changes the layout identified by kMagic.");
+  // Size the output exactly, so that it's allocated only once.
+  std::size_t size(kMagicSize + 4);
+  for (const auto& app : local_apps)
+    size += RecordSize(app);
+  std::string output;
+  output.reserve(size);
+
+  output.append(kMagic, kMagicSize);
+  AppendUint32(local_apps.size(), output);
+  for (const auto& app : local_apps) {
+    ForEachConfigField(
+        [&](auto field) { AppendField(AppFieldTraits<decltype(field)>::Get(app), output); });
+  }
+  return output;
+}
+
+bool HasLocalAppsLayout(const char* data, std::size_t size) {
+  return size >= kMagicSize && std::memcmp(data, kMagic, kMagicSize) == 0;
+}
+
+PersistentSet<AppDetails> ParseLocalApps(const char* data, std::size_t size) {
+  if (!HasLocalAppsLayout(data, size))
+    ThrowParsingError("bad magic");
+  Reader reader(data + kMagicSize, size - kMagicSize);
+  const std::uint32_t app_count(reader.ReadUint32());
+  // Reject a corrupt count before reserving space for it.  No record is smaller than an empty
+  // app's.
+  if (app_count > reader.remaining() / RecordSize(AppDetails()))
+    ThrowParsingError("app count exceeds input size");
+
+  std::vector<AppDetails> apps(app_count);
+  for (auto& app : apps) {
+    ForEachConfigField(
+        [&](auto field) { ReadField(reader, AppFieldTraits<decltype(field)>::Get(app)); });
+    if (&app != &apps.front() && !((&app - 1)->name < app.name))
+      ThrowParsingError("apps not in order");
+  }
+  if (reader.remaining() != 0)
+    ThrowParsingError("trailing bytes");
+  return PersistentSet<AppDetails>::FromSorted(std::move(apps));
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
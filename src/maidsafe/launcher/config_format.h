@@ -0,0 +1,63 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CONFIG_FORMAT_H_
+#define MAIDSAFE_LAUNCHER_CONFIG_FORMAT_H_
+
+#include <cstddef>
+#include <string>
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/persistent_set.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// The layout of the local apps in the base config file (before compression and encryption):
+//
+//   magic "MSCAPP02" | app count (4 bytes) | app records, in increasing order of name
+//
+// where each app record is
+//
+//   name size (4 bytes) | name | path size (4 bytes) | path | args size (4 bytes) | args |
+//   auto_start (1 byte, 0 or 1)
+//
+// and all integers are little-endian.  Only the config-only fields are held; the permitted dirs
+// and icon are held in the Account.
+
+// Returns the serialised form of the config-only fields of 'local_apps'.
+std::string SerialiseLocalApps(const PersistentSet<AppDetails>& local_apps);
+
+// Returns true if 'data' starts with the magic of the layout above.  Base files written before the
+// layout was introduced were serialised via ConvertToString, and start with an 8-byte app count
+// which can't match the magic.
+bool HasLocalAppsLayout(const char* data, std::size_t size);
+
+// Parses the output of 'SerialiseLocalApps' in a single pass over 'data', without copying it.
+// Each string field is built with a single allocation, and the returned set in O(n) since the
+// records are sorted.  The app count is checked against the size of the input before anything is
+// allocated.  Throws a parsing_error if 'data' is truncated, has trailing bytes, or is otherwise
+// malformed.
+PersistentSet<AppDetails> ParseLocalApps(const char* data, std::size_t size);
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CONFIG_FORMAT_H_
@@ -0,0 +1,703 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_record_file.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <tuple>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/app_field_traits.h"
+#include "maidsafe/launcher/config_file_utils.h"
+
+namespace fs = boost::filesystem;
+namespace bip = boost::interprocess;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+const std::string kIndexMagic("MSCIDX01"), kRecordsMagic("MSCREC01");
+const std::size_t kNonceSize(16), kIvSeedSize(16);
+const std::size_t kIndexHeaderSize(8 + 8 + kNonceSize);
+const std::size_t kRecordsHeaderSize(8 + 8);
+const std::size_t kRecordHeaderSize(8 + kIvSeedSize + 4);
+const std::size_t kMacSize(kConfigDigestSize);
+// The remainder of a free slot is only split off if it could hold a record.
+const std::uint32_t kMinSlotSize(kRecordHeaderSize + kMacSize + 32);
+
+enum class DeltaType : char { kPut = 0, kErase = 1 };
+
+void ThrowParsingError(const std::string& what) {
+  LOG(kError) << what;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+void AppendString(const std::string& value, std::string& output) {
+  output += EncodeUint64(value.size(), 4);
+  output += value;
+}
+
+// Reads the fields of a decrypted index block or record, checking every size against the end.
+class Reader {
+ public:
+  explicit Reader(const std::string& input)
+      : position_(input.data()), end_(input.data() + input.size()) {}
+
+  std::uint64_t ReadInteger(std::size_t width) {
+    Require(width);
+    std::uint64_t value(DecodeUint64(position_, width));
+    position_ += width;
+    return value;
+  }
+
+  std::string ReadString() {
+    std::size_t size(static_cast<std::size_t>(ReadInteger(4)));
+    Require(size);
+    std::string value(position_, size);
+    position_ += size;
+    return value;
+  }
+
+  bool AtEnd() const { return position_ == end_; }
+
+ private:
+  void Require(std::size_t size) const {
+    if (static_cast<std::size_t>(end_ - position_) < size)
+      ThrowParsingError("Config record or index block is truncated.");
+  }
+
+  const char* position_;
+  const char* const end_;
+};
+
+}  // unnamed namespace
+
+class ConfigRecordFile::Mapping {
+ public:
+  explicit Mapping(const fs::path& path)
+      : file_(path.string().c_str(), bip::read_only), region_(file_, bip::read_only) {}
+
+  const char* data() const { return static_cast<const char*>(region_.get_address()); }
+  std::size_t size() const { return region_.get_size(); }
+
+ private:
+  bip::file_mapping file_;
+  bip::mapped_region region_;
+};
+
+const std::uint64_t ConfigRecordFile::kMinCompactionSize(64 * 1024);
+
+ConfigRecordFile::Change::Change(bool erase_in, AppDetails app_in)
+    : erase(erase_in), app(std::move(app_in)) {}
+
+ConfigRecordFile::Location::Location() : offset(0), generation(0), capacity(0), auto_start(false) {}
+
+ConfigRecordFile::ConfigRecordFile(fs::path index_path, crypto::AES256KeyAndIV key_and_iv)
+    : index_path_(std::move(index_path)),
+      key_and_iv_(std::move(key_and_iv)),
+      mac_key_(ConfigDigest("record file mac key" + ToByteString(key_and_iv_))),
+      mutex_(),
+      locations_(),
+      free_slots_(),
+      records_id_(0),
+      records_end_(kRecordsHeaderSize),
+      live_size_(0),
+      free_size_(0),
+      next_generation_(1),
+      index_nonce_(),
+      index_base_size_(0),
+      index_size_(0),
+      next_index_sequence_number_(0),
+      exists_(false),
+      sync_rewrites_(true),
+      sync_every_write_(false),
+      mapping_() {}
+
+ConfigRecordFile::~ConfigRecordFile() = default;
+
+PersistentSet<AppDetails> ConfigRecordFile::LoadIndex() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  locations_.clear();
+  mapping_.reset();
+  exists_ = false;
+  std::string contents;
+  {
+    std::ifstream index(index_path_.string(), std::ios::binary);
+    if (!index)
+      return PersistentSet<AppDetails>();
+    contents.assign(std::istreambuf_iterator<char>(index), std::istreambuf_iterator<char>());
+  }
+  if (contents.size() < kIndexHeaderSize || contents.compare(0, kIndexMagic.size(), kIndexMagic))
+    ThrowParsingError("Config index at " + index_path_.string() + " has an invalid header.");
+  records_id_ = DecodeUint64(&contents[kIndexMagic.size()]);
+  index_nonce_ = contents.substr(kIndexMagic.size() + 8, kNonceSize);
+
+  std::size_t offset(kIndexHeaderSize);
+  std::uint64_t sequence_number{0};
+  while (offset < contents.size()) {
+    std::size_t remaining(contents.size() - offset);
+    std::uint32_t encrypted_size(
+        remaining >= 4 ? static_cast<std::uint32_t>(DecodeUint64(&contents[offset], 4)) : 0);
+    bool complete(remaining >= 4 && remaining - 4 >= encrypted_size + kMacSize &&
+                  encrypted_size != 0);
+    std::string encrypted_block;
+    if (complete) {
+      encrypted_block = contents.substr(offset + 4, encrypted_size);
+      complete = (ConfigMac(mac_key_, "index" + EncodeUint64(sequence_number) +
+                                          EncodeUint64(records_id_) + index_nonce_ +
+                                          encrypted_block) ==
+                  contents.substr(offset + 4 + encrypted_size, kMacSize));
+    }
+    if (!complete) {
+      // Only a torn final delta block can be the result of an interrupted write, since the base
+      // block is always written as part of a whole new file.
+      if (sequence_number == 0 || (remaining >= 4 && remaining - 4 > encrypted_size + kMacSize))
+        ThrowParsingError("Config index block " + std::to_string(sequence_number) +
+                          " failed authentication.");
+      LOG(kWarning) << "Discarding incomplete final block in config index at " << index_path_;
+      boost::system::error_code ec;
+      fs::resize_file(index_path_, offset, ec);
+      break;
+    }
+
+    NonEmptyString plaintext(crypto::SymmDecrypt(
+        crypto::CipherText{NonEmptyString{encrypted_block}},
+        DeriveKeyAndIv(key_and_iv_, index_nonce_ + EncodeUint64(sequence_number))));
+    Reader reader(plaintext.string());
+    std::uint64_t entry_count(reader.ReadInteger(4));
+    for (std::uint64_t i(0); i < entry_count; ++i) {
+      DeltaType type(sequence_number == 0 ? DeltaType::kPut
+                                          : static_cast<DeltaType>(reader.ReadInteger(1)));
+      AppName name(reader.ReadString());
+      if (type == DeltaType::kErase) {
+        locations_.erase(name);
+        continue;
+      }
+      if (type != DeltaType::kPut)
+        ThrowParsingError("Unknown entry type in config index at " + index_path_.string());
+      Location location;
+      std::uint64_t auto_start(reader.ReadInteger(1));
+      if (auto_start > 1)
+        ThrowParsingError("Invalid auto_start flag in config index at " + index_path_.string());
+      location.auto_start = (auto_start == 1);
+      location.offset = reader.ReadInteger(8);
+      location.capacity = static_cast<std::uint32_t>(reader.ReadInteger(4));
+      location.generation = reader.ReadInteger(8);
+      if (location.offset < kRecordsHeaderSize || location.capacity == 0)
+        ThrowParsingError("Invalid record location in config index at " + index_path_.string());
+      // The base block is sorted by name, so its entries can be appended in O(1) each.
+      if (sequence_number == 0)
+        locations_.emplace_hint(locations_.end(), std::move(name), location);
+      else
+        locations_[name] = location;
+    }
+    if (!reader.AtEnd())
+      ThrowParsingError("Trailing bytes in config index block " + std::to_string(sequence_number));
+    offset += 4 + encrypted_size + kMacSize;
+    if (sequence_number == 0)
+      index_base_size_ = offset - kIndexHeaderSize;
+    ++sequence_number;
+  }
+  index_size_ = offset;
+  next_index_sequence_number_ = sequence_number;
+
+  records_end_ = kRecordsHeaderSize;
+  live_size_ = 0;
+  next_generation_ = 1;
+  for (const auto& entry : locations_) {
+    records_end_ = std::max(records_end_, entry.second.offset + entry.second.capacity);
+    live_size_ += entry.second.capacity;
+    next_generation_ = std::max(next_generation_, entry.second.generation + 1);
+  }
+  RebuildFreeSlots();
+  MapRecords();
+  exists_ = true;
+
+  std::vector<AppDetails> apps;
+  apps.reserve(locations_.size());
+  for (const auto& entry : locations_) {
+    AppDetails app;
+    app.name = entry.first;
+    app.auto_start = entry.second.auto_start;
+    apps.push_back(std::move(app));
+  }
+  return PersistentSet<AppDetails>::FromSorted(std::move(apps));
+}
+
+PersistentSet<AppDetails> ConfigRecordFile::LoadRecords() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  std::vector<AppDetails> apps;
+  apps.reserve(locations_.size());
+  for (const auto& entry : locations_) {
+    AppDetails app;
+    app.name = entry.first;
+    std::tie(app.path, app.args) = ReadRecord(entry.first, entry.second);
+    app.auto_start = entry.second.auto_start;
+    apps.push_back(std::move(app));
+  }
+  return PersistentSet<AppDetails>::FromSorted(std::move(apps));
+}
+
+std::pair<fs::path, AppArgs> ConfigRecordFile::ReadPathAndArgs(const AppName& app_name) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto itr(locations_.find(app_name));
+  if (itr == locations_.end()) {
+    LOG(kError) << app_name << " has no record in " << index_path_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  }
+  return ReadRecord(app_name, itr->second);
+}
+
+void ConfigRecordFile::Apply(const std::vector<Change>& changes) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  // A record must always belong to an existing index.
+  assert(exists_);
+
+  // The new location of each app changed, or an unset one if it's erased.  'locations_' is only
+  // updated once the index delta has been written, and the superseded slots only freed then.
+  std::map<AppName, std::pair<bool, Location>> staged;
+  std::vector<Location> superseded;
+  std::vector<std::pair<std::uint64_t, std::string>> writes;
+  auto current([&](const AppName& name) -> const Location* {
+    auto staged_itr(staged.find(name));
+    if (staged_itr != staged.end())
+      return staged_itr->second.first ? &staged_itr->second.second : nullptr;
+    auto itr(locations_.find(name));
+    return itr == locations_.end() ? nullptr : &itr->second;
+  });
+
+  // Allocations are undone if anything fails before the index delta is written.
+  const auto free_slots(free_slots_);
+  const std::uint64_t records_end(records_end_), live_size(live_size_), free_size(free_size_);
+  try {
+    std::string delta;
+    std::uint64_t entry_count(0);
+    for (const auto& change : changes) {
+      const Location* const location(current(change.app.name));
+      if (change.erase) {
+        if (!location)
+          continue;
+        superseded.push_back(*location);
+        staged[change.app.name] = std::make_pair(false, Location());
+        delta += static_cast<char>(DeltaType::kErase);
+        AppendString(change.app.name, delta);
+      } else {
+        std::string record(EncodeRecord(change.app, next_generation_));
+        Location new_location(Allocate(static_cast<std::uint32_t>(record.size() + kMacSize)));
+        new_location.generation = next_generation_++;
+        new_location.auto_start = change.app.auto_start;
+        record += RecordMac(records_id_, new_location.offset, record);
+        writes.emplace_back(new_location.offset, std::move(record));
+        if (location)
+          superseded.push_back(*location);
+        staged[change.app.name] = std::make_pair(true, new_location);
+        delta += static_cast<char>(DeltaType::kPut);
+        AppendString(change.app.name, delta);
+        delta += static_cast<char>(new_location.auto_start ? 1 : 0);
+        delta += EncodeUint64(new_location.offset);
+        delta += EncodeUint64(new_location.capacity, 4);
+        delta += EncodeUint64(new_location.generation);
+      }
+      ++entry_count;
+    }
+    if (entry_count == 0)
+      return;
+
+    if (!writes.empty()) {
+      const fs::path records_path(RecordsPath(records_id_));
+      {
+        std::fstream records(records_path.string(),
+                             std::ios::binary | std::ios::in | std::ios::out);
+        for (const auto& write : writes) {
+          records.seekp(static_cast<std::streamoff>(write.first));
+          records.write(write.second.data(), write.second.size());
+        }
+        records.close();
+        if (!records.good()) {
+          LOG(kError) << "Failed to write config records at " << records_path;
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+        }
+      }
+      if (sync_every_write_)
+        SyncToDisk(records_path);
+    }
+    AppendIndexDelta(EncodeUint64(entry_count, 4) + delta);
+  } catch (...) {
+    free_slots_ = free_slots;
+    records_end_ = records_end;
+    live_size_ = live_size;
+    free_size_ = free_size;
+    throw;
+  }
+
+  for (auto& entry : staged) {
+    if (entry.second.first)
+      locations_[entry.first] = entry.second.second;
+    else
+      locations_.erase(entry.first);
+  }
+  for (const auto& location : superseded)
+    Free(location);
+  if (!mapping_ || records_end_ > mapping_->size())
+    MapRecords();
+
+  // Compact the index once its deltas outgrow its base block.
+  if (index_size_ - kIndexHeaderSize - index_base_size_ >
+      std::max<std::uint64_t>(kMinCompactionSize, index_base_size_)) {
+    WriteIndex();
+  }
+}
+
+void ConfigRecordFile::Rewrite(const PersistentSet<AppDetails>& local_apps) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  std::uint64_t new_records_id(0);
+  while (new_records_id == 0 || new_records_id == records_id_) {
+    new_records_id = (static_cast<std::uint64_t>(RandomUint32()) << 32) | RandomUint32();
+  }
+  const fs::path new_records_path(RecordsPath(new_records_id));
+
+  std::map<AppName, Location> new_locations;
+  std::string contents(kRecordsMagic + EncodeUint64(new_records_id));
+  for (const auto& app : local_apps) {
+    std::string record(EncodeRecord(app, next_generation_));
+    Location location;
+    location.offset = contents.size();
+    location.capacity = static_cast<std::uint32_t>(record.size() + kMacSize);
+    location.generation = next_generation_++;
+    location.auto_start = app.auto_start;
+    contents += record;
+    contents += RecordMac(new_records_id, location.offset, record);
+    new_locations.emplace_hint(new_locations.end(), app.name, location);
+  }
+  if (!WriteFile(new_records_path, contents)) {
+    LOG(kError) << "Failed to save config records at " << new_records_path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (sync_rewrites_)
+    SyncToDisk(new_records_path);
+
+  // Switch to the new records file, restoring the old state if the index can't be replaced.
+  std::map<AppName, Location> old_locations(std::move(new_locations));
+  std::swap(old_locations, locations_);
+  const auto old_free_slots(free_slots_);
+  const std::uint64_t old_records_id(records_id_), old_records_end(records_end_),
+      old_live_size(live_size_), old_free_size(free_size_);
+  records_id_ = new_records_id;
+  records_end_ = contents.size();
+  live_size_ = contents.size() - kRecordsHeaderSize;
+  free_size_ = 0;
+  free_slots_.clear();
+  try {
+    WriteIndex();
+  } catch (...) {
+    locations_ = std::move(old_locations);
+    free_slots_ = old_free_slots;
+    records_id_ = old_records_id;
+    records_end_ = old_records_end;
+    live_size_ = old_live_size;
+    free_size_ = old_free_size;
+    boost::system::error_code ec;
+    fs::remove(new_records_path, ec);
+    throw;
+  }
+  exists_ = true;
+  MapRecords();
+  RemoveStaleRecordsFiles();
+}
+
+void ConfigRecordFile::Remove() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  mapping_.reset();
+  boost::system::error_code ec;
+  fs::remove(index_path_, ec);
+  if (ec) {
+    LOG(kError) << "Failed to remove config index " << index_path_ << ": " << ec.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  // With no current records file, every records file is stale.
+  records_id_ = 0;
+  RemoveStaleRecordsFiles();
+  locations_.clear();
+  free_slots_.clear();
+  records_end_ = kRecordsHeaderSize;
+  live_size_ = free_size_ = index_base_size_ = index_size_ = next_index_sequence_number_ = 0;
+  exists_ = false;
+}
+
+void ConfigRecordFile::SetSyncPolicy(bool sync_rewrites, bool sync_every_write) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  sync_rewrites_ = sync_rewrites;
+  sync_every_write_ = sync_every_write;
+}
+
+bool ConfigRecordFile::Exists() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return exists_;
+}
+
+bool ConfigRecordFile::NeedsCompaction() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return free_size_ > std::max(kMinCompactionSize, live_size_);
+}
+
+fs::path ConfigRecordFile::RecordsPath(std::uint64_t records_id) const {
+  std::ostringstream stream;
+  stream << index_path_.string() << ".records." << std::hex << std::setfill('0') << std::setw(16)
+         << records_id;
+  return fs::path(stream.str());
+}
+
+void ConfigRecordFile::MapRecords() {
+  const fs::path records_path(RecordsPath(records_id_));
+  mapping_.reset();
+  try {
+    mapping_.reset(new Mapping(records_path));
+  } catch (const bip::interprocess_exception& error) {
+    LOG(kError) << "Failed to map config records at " << records_path << ": " << error.what();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (mapping_->size() < kRecordsHeaderSize ||
+      std::string(mapping_->data(), kRecordsMagic.size()) != kRecordsMagic ||
+      DecodeUint64(mapping_->data() + kRecordsMagic.size()) != records_id_) {
+    mapping_.reset();
+    ThrowParsingError("Config records at " + records_path.string() + " have an invalid header.");
+  }
+}
+
+std::pair<fs::path, AppArgs> ConfigRecordFile::ReadRecord(const AppName& app_name,
+                                                          const Location& location) const {
+  if (!mapping_ || location.offset + kRecordHeaderSize > mapping_->size())
+    ThrowParsingError("Config record of " + app_name + " is missing.");
+  const char* const data(mapping_->data() + location.offset);
+  const std::size_t encrypted_size(
+      static_cast<std::size_t>(DecodeUint64(data + 8 + kIvSeedSize, 4)));
+  const std::size_t record_size(kRecordHeaderSize + encrypted_size);
+  if (DecodeUint64(data) != location.generation || encrypted_size == 0 ||
+      record_size + kMacSize > location.capacity ||
+      location.offset + record_size + kMacSize > mapping_->size()) {
+    ThrowParsingError("Config record of " + app_name + " is missing or stale.");
+  }
+  const std::string record(data, record_size);
+  if (RecordMac(records_id_, location.offset, record) !=
+      std::string(data + record_size, kMacSize)) {
+    ThrowParsingError("Config record of " + app_name + " failed authentication.");
+  }
+
+  NonEmptyString plaintext(crypto::SymmDecrypt(
+      crypto::CipherText{NonEmptyString{record.substr(kRecordHeaderSize)}},
+      DeriveKeyAndIv(key_and_iv_, record.substr(8, kIvSeedSize))));
+  Reader reader(plaintext.string());
+  if (reader.ReadString() != app_name)
+    ThrowParsingError("Config record of " + app_name + " belongs to another app.");
+  fs::path path(reader.ReadString());
+  AppArgs args(reader.ReadString());
+  if (!reader.AtEnd())
+    ThrowParsingError("Trailing bytes in config record of " + app_name);
+  return std::make_pair(std::move(path), std::move(args));
+}
+
+std::string ConfigRecordFile::EncodeRecord(const AppDetails& app,
+                                           std::uint64_t generation) const {
+  // The index holds the name and auto_start flag, and the record the path and args.  This split is
+  // written by hand, so this only catches a change to the traits: a change to what's written here
+  // or in WriteIndex must be checked against it by hand.
+  static_assert(kConfigAppFields == (kAppName | kAppPath | kAppArgs | kAppAutoStart),
+                "The index and records must hold exactly the fields whose traits are kInConfig.");
+  std::string plaintext;
+  AppendString(app.name, plaintext);
+  AppendString(app.path.string(), plaintext);
+  AppendString(app.args, plaintext);
+  const std::string iv_seed(RandomString(kIvSeedSize));
+  crypto::CipherText cipher_text(crypto::SymmEncrypt(NonEmptyString{plaintext},
+                                                     DeriveKeyAndIv(key_and_iv_, iv_seed)));
+  const std::string& encrypted_record(cipher_text->string());
+
+  std::string record(EncodeUint64(generation));
+  record += iv_seed;
+  record += EncodeUint64(encrypted_record.size(), 4);
+  record += encrypted_record;
+  return record;
+}
+
+std::string ConfigRecordFile::RecordMac(std::uint64_t records_id, std::uint64_t offset,
+                                        const std::string& record) const {
+  return ConfigMac(mac_key_, "record" + EncodeUint64(records_id) + EncodeUint64(offset) + record);
+}
+
+std::string ConfigRecordFile::EncodeBlock(const std::string& plaintext,
+                                          std::uint64_t sequence_number) const {
+  crypto::CipherText cipher_text(crypto::SymmEncrypt(
+      NonEmptyString{plaintext},
+      DeriveKeyAndIv(key_and_iv_, index_nonce_ + EncodeUint64(sequence_number))));
+  const std::string& encrypted_block(cipher_text->string());
+  std::string block(EncodeUint64(encrypted_block.size(), 4));
+  block += encrypted_block;
+  block += ConfigMac(mac_key_, "index" + EncodeUint64(sequence_number) +
+                                   EncodeUint64(records_id_) + index_nonce_ + encrypted_block);
+  return block;
+}
+
+void ConfigRecordFile::WriteIndex() {
+  std::string base(EncodeUint64(locations_.size(), 4));
+  for (const auto& entry : locations_) {
+    AppendString(entry.first, base);
+    base += static_cast<char>(entry.second.auto_start ? 1 : 0);
+    base += EncodeUint64(entry.second.offset);
+    base += EncodeUint64(entry.second.capacity, 4);
+    base += EncodeUint64(entry.second.generation);
+  }
+  const std::string old_nonce(index_nonce_);
+  index_nonce_ = RandomString(kNonceSize);
+  std::string contents(kIndexMagic + EncodeUint64(records_id_) + index_nonce_);
+  const std::string base_block(EncodeBlock(base, 0));
+  contents += base_block;
+
+  // Write to a temporary file and rename it over the index, as for ConfigStore's base file.
+  const fs::path temp_path(index_path_.string() + ".tmp");
+  bool written(WriteFile(temp_path, contents));
+  if (!written) {
+    LOG(kError) << "Failed to save config index at " << temp_path;
+  } else {
+    if (sync_rewrites_)
+      SyncToDisk(temp_path);
+    boost::system::error_code ec;
+    fs::rename(temp_path, index_path_, ec);
+    if (ec) {
+      LOG(kError) << "Failed to replace config index at " << index_path_ << ": " << ec.message();
+      written = false;
+    }
+  }
+  if (!written) {
+    index_nonce_ = old_nonce;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (sync_rewrites_)
+    SyncToDisk(index_path_.has_parent_path() ? index_path_.parent_path() : fs::path("."));
+  index_base_size_ = base_block.size();
+  index_size_ = contents.size();
+  next_index_sequence_number_ = 1;
+}
+
+void ConfigRecordFile::AppendIndexDelta(const std::string& plaintext) {
+  const std::string block(EncodeBlock(plaintext, next_index_sequence_number_));
+  {
+    std::ofstream index(index_path_.string(), std::ios::binary | std::ios::app);
+    index.write(block.data(), block.size());
+    index.close();
+    if (index.good()) {
+      index_size_ += block.size();
+      ++next_index_sequence_number_;
+      if (sync_every_write_)
+        SyncToDisk(index_path_);
+      return;
+    }
+  }
+
+  // Trim any partially-written block so that subsequent blocks aren't appended after it.
+  LOG(kError) << "Failed to append to config index at " << index_path_;
+  boost::system::error_code ec;
+  fs::resize_file(index_path_, index_size_, ec);
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+ConfigRecordFile::Location ConfigRecordFile::Allocate(std::uint32_t size) {
+  Location location;
+  auto itr(free_slots_.lower_bound(size));
+  if (itr == free_slots_.end()) {
+    location.offset = records_end_;
+    location.capacity = size;
+    records_end_ += size;
+  } else {
+    location.offset = itr->second;
+    location.capacity = itr->first;
+    free_size_ -= itr->first;
+    free_slots_.erase(itr);
+    if (location.capacity - size >= kMinSlotSize) {
+      free_slots_.emplace(location.capacity - size, location.offset + size);
+      free_size_ += location.capacity - size;
+      location.capacity = size;
+    }
+  }
+  live_size_ += location.capacity;
+  return location;
+}
+
+void ConfigRecordFile::Free(const Location& location) {
+  free_slots_.emplace(location.capacity, location.offset);
+  free_size_ += location.capacity;
+  live_size_ -= location.capacity;
+}
+
+void ConfigRecordFile::RebuildFreeSlots() {
+  // Every gap between live records is free, so opening the file needn't read the records.
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> live;
+  live.reserve(locations_.size());
+  for (const auto& entry : locations_)
+    live.emplace_back(entry.second.offset, entry.second.capacity);
+  std::sort(live.begin(), live.end());
+  free_slots_.clear();
+  free_size_ = 0;
+  std::uint64_t position(kRecordsHeaderSize);
+  for (const auto& slot : live) {
+    while (slot.first > position) {
+      std::uint32_t gap(static_cast<std::uint32_t>(std::min<std::uint64_t>(
+          slot.first - position, std::numeric_limits<std::uint32_t>::max())));
+      free_slots_.emplace(gap, position);
+      free_size_ += gap;
+      position += gap;
+    }
+    position = std::max(position, slot.first + slot.second);
+  }
+}
+
+void ConfigRecordFile::RemoveStaleRecordsFiles() const {
+  const fs::path directory(index_path_.has_parent_path() ? index_path_.parent_path()
+                                                         : fs::path("."));
+  const std::string prefix(index_path_.filename().string() + ".records.");
+  const std::string current(RecordsPath(records_id_).filename().string());
+  boost::system::error_code ec;
+  for (fs::directory_iterator itr(directory, ec), end; !ec && itr != end; itr.increment(ec)) {
+    const std::string filename(itr->path().filename().string());
+    if (filename.compare(0, prefix.size(), prefix) == 0 && filename != current) {
+      boost::system::error_code remove_ec;
+      fs::remove(itr->path(), remove_ec);
+      if (remove_ec)
+        LOG(kWarning) << "Failed to remove stale config records " << itr->path();
+    }
+  }
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
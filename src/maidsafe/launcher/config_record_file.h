@@ -0,0 +1,168 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CONFIG_RECORD_FILE_H_
+#define MAIDSAFE_LAUNCHER_CONFIG_RECORD_FILE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/persistent_set.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+class ConfigRecordFileTest;
+}  // namespace test
+
+// Persists the local apps' config-only fields with each app's path and args in its own
+// individually encrypted and authenticated record, so that opening the file only reads a small
+// index, and an app's path and args can be decrypted on demand.  Intended for very large numbers of
+// local apps.  Two files are used:
+//
+//   the index, at the config file path:
+//     magic "MSCIDX01" | records file id (8 bytes) | nonce (16 bytes) | base block | delta blocks
+//   the records file, at the config file path + ".records." + the id in hex:
+//     magic "MSCREC01" | records file id (8 bytes) | record slots
+//
+// The base block lists each app's name, auto_start flag and record location; each delta block
+// records the puts and erases of a single 'Apply'.  Index blocks are encrypted and authenticated
+// like ConfigStore's journal records, and a torn final delta block is likewise ignored.  Each
+// record is
+//
+//   generation (8 bytes) | IV seed (16 bytes) | ciphertext size (4 bytes) | ciphertext | MAC
+//
+// where the MAC covers the records file id, the record's offset, generation, IV seed and
+// ciphertext, and the index holds the generation expected at each location.  Records therefore
+// can't be moved, swapped or rolled back.  The records file is memory-mapped, and only the
+// requested record is touched by a read.
+//
+// A changed record is written to the best-fitting free slot in the records file, or appended if
+// none is large enough, and only once the index delta recording its new location has been written
+// is its previous slot treated as free.  A live record is never overwritten, so a write
+// interrupted at any point leaves the previous version readable.  Once the free space exceeds both
+// the live records and 'kMinCompactionSize', 'Rewrite' should be called.  It writes a new records
+// file, then atomically replaces the index, and then removes the old records file.  The index's
+// delta blocks are compacted internally, without touching the records.
+//
+// All public functions are threadsafe.  Functions throw on error.
+class ConfigRecordFile {
+ public:
+  static const std::uint64_t kMinCompactionSize;
+
+  ConfigRecordFile(boost::filesystem::path index_path, crypto::AES256KeyAndIV key_and_iv);
+  ~ConfigRecordFile();
+
+  ConfigRecordFile(const ConfigRecordFile&) = delete;
+  ConfigRecordFile(ConfigRecordFile&&) = delete;
+  ConfigRecordFile& operator=(const ConfigRecordFile&) = delete;
+  ConfigRecordFile& operator=(ConfigRecordFile&&) = delete;
+
+  // Reads the index, returning the local apps with only their name and auto_start fields set.
+  // Returns an empty set if the files don't exist.
+  PersistentSet<AppDetails> LoadIndex();
+  // Reads every record, returning the local apps with all their config-only fields set.
+  // 'LoadIndex' must have been called first.
+  PersistentSet<AppDetails> LoadRecords() const;
+  // Decrypts the single record of 'app_name'.  Throws no_such_element if there is none.
+  std::pair<boost::filesystem::path, AppArgs> ReadPathAndArgs(const AppName& app_name) const;
+
+  // A put of 'app', or if 'erase' is true, an erase of the app named 'app.name'.
+  struct Change {
+    Change(bool erase_in, AppDetails app_in);
+
+    bool erase;
+    AppDetails app;
+  };
+
+  // Writes a record for each put in 'changes', then records all of 'changes' (in order) in a
+  // single index delta.  Erases of apps which have no record are ignored.
+  void Apply(const std::vector<Change>& changes);
+  // Replaces both files with ones holding just 'local_apps'.
+  void Rewrite(const PersistentSet<AppDetails>& local_apps);
+  // Removes both files from disk.
+  void Remove();
+
+  // If 'sync_rewrites', files are flushed before and after replacing the index.  If
+  // 'sync_every_write', records and index deltas are also flushed on every 'Apply'.
+  void SetSyncPolicy(bool sync_rewrites, bool sync_every_write);
+
+  bool Exists() const;
+  bool NeedsCompaction() const;
+
+  friend class test::ConfigRecordFileTest;
+
+ private:
+  struct Location {
+    Location();
+
+    std::uint64_t offset, generation;
+    std::uint32_t capacity;
+    bool auto_start;
+  };
+  class Mapping;
+
+  boost::filesystem::path RecordsPath(std::uint64_t records_id) const;
+  void MapRecords();
+  std::pair<boost::filesystem::path, AppArgs> ReadRecord(const AppName& app_name,
+                                                         const Location& location) const;
+  // Returns the record for 'app' without its MAC, which depends on where it's written.
+  std::string EncodeRecord(const AppDetails& app, std::uint64_t generation) const;
+  std::string RecordMac(std::uint64_t records_id, std::uint64_t offset,
+                        const std::string& record) const;
+  std::string EncodeBlock(const std::string& plaintext, std::uint64_t sequence_number) const;
+  void WriteIndex();
+  void AppendIndexDelta(const std::string& plaintext);
+  // Takes the best-fitting free slot able to hold 'size' bytes, or the end of the records file.
+  Location Allocate(std::uint32_t size);
+  void Free(const Location& location);
+  void RebuildFreeSlots();
+  void RemoveStaleRecordsFiles() const;
+
+  const boost::filesystem::path index_path_;
+  const crypto::AES256KeyAndIV key_and_iv_;
+  const std::string mac_key_;
+  mutable std::mutex mutex_;
+  std::map<AppName, Location> locations_;
+  // Free slots, keyed by capacity, holding offsets.
+  std::multimap<std::uint32_t, std::uint64_t> free_slots_;
+  std::uint64_t records_id_, records_end_, live_size_, free_size_, next_generation_;
+  std::string index_nonce_;
+  std::uint64_t index_base_size_, index_size_, next_index_sequence_number_;
+  bool exists_, sync_rewrites_, sync_every_write_;
+  std::unique_ptr<Mapping> mapping_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CONFIG_RECORD_FILE_H_
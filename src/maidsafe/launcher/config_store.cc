@@ -0,0 +1,392 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "cereal/types/string.hpp"
+
+#include "maidsafe/common/convert.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+#include "maidsafe/common/serialisation/types/boost_filesystem.h"
+
+#include "maidsafe/launcher/config_file_utils.h"
+#include "maidsafe/launcher/config_format.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+const std::string kJournalMagic("MSCJRN01");
+const std::size_t kNonceSize(16);
+const std::size_t kHeaderSize(8 + kConfigDigestSize + kNonceSize);
+const std::size_t kMacSize(kConfigDigestSize);
+
+}  // unnamed namespace
+
+const std::uint64_t ConfigStore::kMinCompactionSize(64 * 1024);
+
+ConfigStore::ConfigStore(fs::path config_file_path, crypto::AES256KeyAndIV key_and_iv,
+                         Format format)
+    : config_file_path_(std::move(config_file_path)),
+      journal_path_(config_file_path_.string() + ".journal"),
+      temp_path_(config_file_path_.string() + ".tmp"),
+      key_and_iv_(std::move(key_and_iv)),
+      mac_key_(ConfigDigest("journal mac key" + ToByteString(key_and_iv_))),
+      base_digest_(ConfigDigest(std::string())),
+      base_size_(0),
+      journal_size_(0),
+      next_sequence_number_(0),
+      exists_(false),
+      fsync_policy_(FsyncPolicy::kOnRewrite),
+      codec_(),
+      batching_(false),
+      pending_records_(),
+      pending_record_count_(0),
+      pending_changes_(),
+      record_file_(format == Format::kIndexedRecords
+                       ? std::make_shared<ConfigRecordFile>(config_file_path_, key_and_iv_)
+                       : nullptr) {
+  SetFsyncPolicy(fsync_policy_);
+}
+
+PersistentSet<AppDetails> ConfigStore::Load() {
+  if (record_file_) {
+    record_file_->LoadIndex();
+    return record_file_->LoadRecords();
+  }
+  return LoadIndex();
+}
+
+PersistentSet<AppDetails> ConfigStore::LoadIndex() {
+  if (record_file_)
+    return record_file_->LoadIndex();
+  PersistentSet<AppDetails> local_apps;
+  if (!fs::exists(config_file_path_))
+    return local_apps;
+  assert(fs::is_regular_file(config_file_path_));
+  exists_ = true;
+
+  // Read from file.
+  NonEmptyString encrypted_contents{ReadFile(config_file_path_).value()};
+  base_digest_ = ConfigDigest(encrypted_contents.string());
+  base_size_ = encrypted_contents.string().size();
+
+  // Decrypt and uncompress the contents.  Base files written before the codec header was
+  // introduced are always gzip-compressed.
+  NonEmptyString compressed_contents(
+      crypto::SymmDecrypt(crypto::CipherText{encrypted_contents}, key_and_iv_));
+  const auto& compressed(compressed_contents.string());
+  const char* const compressed_data(reinterpret_cast<const char*>(compressed.data()));
+  const std::string serialised(
+      HasConfigCodecHeader(compressed_data, compressed.size())
+          ? DecompressConfig(compressed_data, compressed.size(), codec_)
+          : convert::ToString(
+                crypto::Uncompress(crypto::CompressedText(compressed_contents)).string()));
+
+  // Parse the set of local apps directly from the decompressed buffer.  Base files written before
+  // the current layout was introduced are parsed via a stream instead.
+  if (HasLocalAppsLayout(serialised.data(), serialised.size())) {
+    local_apps = ParseLocalApps(serialised.data(), serialised.size());
+  } else {
+    std::stringstream str_stream{serialised};
+    std::size_t app_count(ConvertFromStream<std::size_t>(str_stream));
+    for (std::size_t i{0}; i < app_count; ++i) {
+      AppDetails app_details;
+      ConvertFromStream(str_stream, app_details.name, app_details.path, app_details.args,
+                        app_details.auto_start);
+      local_apps.insert(std::move(app_details));
+    }
+  }
+
+  ReplayJournal(local_apps);
+  return local_apps;
+}
+
+void ConfigStore::RecordPut(const AppDetails& app) { Append(RecordType::kPut, app.name, app); }
+
+void ConfigStore::RecordErase(const AppName& app_name) {
+  Append(RecordType::kErase, app_name, AppDetails());
+}
+
+void ConfigStore::RecordRename(const AppName& old_name, const AppDetails& renamed_app) {
+  if (record_file_) {
+    RecordErase(old_name);
+    return RecordPut(renamed_app);
+  }
+  Append(RecordType::kRename, old_name, renamed_app);
+}
+
+void ConfigStore::RecordBatch(const std::function<void()>& record_changes) {
+  assert(!batching_);
+  batching_ = true;
+  on_scope_exit reset_batch{[&] {
+    batching_ = false;
+    pending_records_.clear();
+    pending_record_count_ = 0;
+    pending_changes_.clear();
+  }};
+  record_changes();
+  if (pending_record_count_ != 0)
+    WriteRecords(pending_records_, pending_record_count_);
+  if (!pending_changes_.empty())
+    record_file_->Apply(pending_changes_);
+}
+
+void ConfigStore::Rewrite(const PersistentSet<AppDetails>& local_apps) {
+  if (record_file_)
+    return record_file_->Rewrite(local_apps);
+
+  // Serialise the set of local apps.  Omit their 'permitted_dirs' and 'icon' fields since they're
+  // held in the serialised Account.
+  const std::string serialised_contents(SerialiseLocalApps(local_apps));
+
+  // Compress and encrypt the serialised contents.
+  auto encrypted_contents(crypto::SymmEncrypt(
+      NonEmptyString{CompressConfig(serialised_contents, codec_)}, key_and_iv_));
+
+  // Write to a temporary file and rename it over the base file, so that a crash can't leave a
+  // partially-written base file.
+  if (!WriteFile(temp_path_, encrypted_contents->string())) {
+    LOG(kError) << "Failed to save config file at " << temp_path_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (fsync_policy_ != FsyncPolicy::kNever)
+    SyncToDisk(temp_path_);
+  boost::system::error_code ec;
+  fs::rename(temp_path_, config_file_path_, ec);
+  if (ec) {
+    LOG(kError) << "Failed to replace config file at " << config_file_path_ << ": "
+                << ec.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  if (fsync_policy_ != FsyncPolicy::kNever)
+    SyncToDisk(config_file_path_.has_parent_path() ? config_file_path_.parent_path()
+                                                   : fs::path("."));
+  exists_ = true;
+  base_digest_ = ConfigDigest(encrypted_contents->string());
+  base_size_ = encrypted_contents->string().size();
+  ResetJournal();
+}
+
+void ConfigStore::Remove() {
+  if (record_file_)
+    return record_file_->Remove();
+  boost::system::error_code ec;
+  fs::remove(journal_path_, ec);
+  if (!ec)
+    fs::remove(config_file_path_, ec);
+  if (ec) {
+    LOG(kError) << "Failed to remove config file " << config_file_path_ << ": " << ec.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  exists_ = false;
+  base_digest_ = ConfigDigest(std::string());
+  base_size_ = journal_size_ = next_sequence_number_ = 0;
+}
+
+void ConfigStore::SetFsyncPolicy(FsyncPolicy fsync_policy) {
+  fsync_policy_ = fsync_policy;
+  if (record_file_) {
+    record_file_->SetSyncPolicy(fsync_policy_ != FsyncPolicy::kNever,
+                                fsync_policy_ == FsyncPolicy::kOnEveryWrite);
+  }
+}
+
+bool ConfigStore::Exists() const { return record_file_ ? record_file_->Exists() : exists_; }
+
+bool ConfigStore::NeedsCompaction() const {
+  if (record_file_)
+    return record_file_->NeedsCompaction();
+  return journal_size_ > std::max(kMinCompactionSize, base_size_);
+}
+
+void ConfigStore::Append(RecordType type, const AppName& app_name, const AppDetails& app) {
+  if (record_file_) {
+    assert(type != RecordType::kRename);
+    ConfigRecordFile::Change change(type == RecordType::kErase, app);
+    change.app.name = app_name;
+    if (batching_)
+      pending_changes_.push_back(std::move(change));
+    else
+      record_file_->Apply({change});
+    return;
+  }
+
+  // A journal record must always apply to an existing base file.
+  assert(exists_);
+
+  const std::uint64_t sequence_number(next_sequence_number_ + pending_record_count_);
+  std::string serialised_record(ConvertToString(static_cast<std::uint8_t>(type), app_name,
+                                                app.name, app.path, app.args, app.auto_start));
+  crypto::CipherText cipher_text(crypto::SymmEncrypt(NonEmptyString{serialised_record},
+                                                     RecordKeyAndIv(sequence_number)));
+  const std::string& encrypted_record(cipher_text->string());
+
+  std::string record(EncodeUint64(encrypted_record.size(), 4));
+  record += encrypted_record;
+  record += RecordMac(sequence_number, encrypted_record);
+
+  if (batching_) {
+    pending_records_ += record;
+    ++pending_record_count_;
+  } else {
+    WriteRecords(record, 1);
+  }
+}
+
+void ConfigStore::WriteRecords(const std::string& records, std::uint64_t record_count) {
+  {
+    std::ofstream journal(journal_path_.string(), std::ios::binary | std::ios::app);
+    journal.write(records.data(), records.size());
+    journal.close();
+    if (journal.good()) {
+      journal_size_ += records.size();
+      next_sequence_number_ += record_count;
+      if (fsync_policy_ == FsyncPolicy::kOnEveryWrite)
+        SyncToDisk(journal_path_);
+      return;
+    }
+  }
+
+  // Trim any partially-written records so that subsequent records aren't appended after them.
+  LOG(kError) << "Failed to append to config journal at " << journal_path_;
+  boost::system::error_code ec;
+  fs::resize_file(journal_path_, journal_size_, ec);
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+}
+
+void ConfigStore::ResetJournal() {
+  std::string header(kJournalMagic);
+  header += base_digest_;
+  journal_nonce_ = RandomString(kNonceSize);
+  header += journal_nonce_;
+  assert(header.size() == kHeaderSize);
+  if (!WriteFile(journal_path_, header)) {
+    LOG(kError) << "Failed to reset config journal at " << journal_path_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  journal_size_ = header.size();
+  next_sequence_number_ = 0;
+}
+
+void ConfigStore::ReplayJournal(PersistentSet<AppDetails>& local_apps) {
+  std::string contents;
+  {
+    std::ifstream journal(journal_path_.string(), std::ios::binary);
+    if (journal)
+      contents.assign(std::istreambuf_iterator<char>(journal), std::istreambuf_iterator<char>());
+  }
+
+  // A missing or unreadable header, or one for a different base file, means the base file already
+  // holds every change - the journal was either never written or not reset after a rewrite.
+  if (contents.size() < kHeaderSize || contents.compare(0, kJournalMagic.size(), kJournalMagic) ||
+      contents.compare(kJournalMagic.size(), kConfigDigestSize, base_digest_)) {
+    if (!contents.empty())
+      LOG(kWarning) << "Ignoring config journal at " << journal_path_ << " (stale or invalid)";
+    return ResetJournal();
+  }
+  journal_nonce_ = contents.substr(kJournalMagic.size() + kConfigDigestSize, kNonceSize);
+
+  std::size_t offset(kHeaderSize);
+  std::uint64_t sequence_number{0};
+  while (offset < contents.size()) {
+    std::size_t remaining(contents.size() - offset);
+    std::uint32_t encrypted_size(
+        remaining >= 4 ? static_cast<std::uint32_t>(DecodeUint64(&contents[offset], 4)) : 0);
+    bool complete(remaining >= 4 && remaining - 4 >= encrypted_size + kMacSize);
+    std::string encrypted_record;
+    if (complete) {
+      encrypted_record = contents.substr(offset + 4, encrypted_size);
+      complete = (RecordMac(sequence_number, encrypted_record) ==
+                  contents.substr(offset + 4 + encrypted_size, kMacSize));
+      if (!complete && remaining != 4 + encrypted_size + kMacSize) {
+        LOG(kError) << "Config journal record " << sequence_number << " failed authentication.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      }
+    }
+    if (!complete) {
+      LOG(kWarning) << "Discarding incomplete final record in config journal at "
+                    << journal_path_;
+      boost::system::error_code ec;
+      fs::resize_file(journal_path_, offset, ec);
+      break;
+    }
+
+    NonEmptyString serialised_record(crypto::SymmDecrypt(
+        crypto::CipherText{NonEmptyString{encrypted_record}}, RecordKeyAndIv(sequence_number)));
+    std::stringstream str_stream{serialised_record.string()};
+    std::uint8_t type{0};
+    AppName app_name;
+    AppDetails app;
+    ConvertFromStream(str_stream, type, app_name, app.name, app.path, app.args, app.auto_start);
+    AppDetails key;
+    key.name = app_name;
+    switch (static_cast<RecordType>(type)) {
+      case RecordType::kPut:
+        local_apps.insert_or_replace(std::move(app));
+        break;
+      case RecordType::kErase:
+        local_apps.erase(key);
+        break;
+      case RecordType::kRename:
+        local_apps.erase(key);
+        local_apps.insert_or_replace(std::move(app));
+        break;
+      default:
+        LOG(kError) << "Unknown record type in config journal at " << journal_path_;
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+    offset += 4 + encrypted_size + kMacSize;
+    ++sequence_number;
+  }
+  journal_size_ = offset;
+  next_sequence_number_ = sequence_number;
+}
+
+crypto::AES256KeyAndIV ConfigStore::RecordKeyAndIv(std::uint64_t sequence_number) const {
+  // Each record gets its own IV, derived from the config IV, the journal's random nonce and the
+  // record's sequence number.  The key is unchanged.
+  return DeriveKeyAndIv(key_and_iv_, journal_nonce_ + EncodeUint64(sequence_number));
+}
+
+std::string ConfigStore::RecordMac(std::uint64_t sequence_number,
+                                   const std::string& encrypted_record) const {
+  return ConfigMac(mac_key_, EncodeUint64(sequence_number) + base_digest_ + journal_nonce_ +
+                                 encrypted_record);
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,165 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CONFIG_STORE_H_
+#define MAIDSAFE_LAUNCHER_CONFIG_STORE_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/config_codec.h"
+#include "maidsafe/launcher/config_record_file.h"
+#include "maidsafe/launcher/persistent_set.h"
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+class ConfigStoreTest;
+}  // namespace test
+
+// Persists the local apps' config-only fields (name, path, args and auto_start) in two files: a
+// compressed and encrypted base file holding the full set of local apps, and an append-only journal
+// next to it holding one record per change made since the base file was last written.
+// The layout of the base file's contents is described in config_format.h; the compression applied
+// to them is set by 'SetCodec' and recorded in the file, so changing it doesn't affect reading
+// existing files.
+//
+// Each journal record is encrypted with its own IV and authenticated with a MAC over its sequence
+// number, the digest of the base file it applies to, and its ciphertext.  Records can't therefore
+// be reordered, or replayed against a different base file.  Once the journal grows larger than
+// both 'kMinCompactionSize' and the base file, it should be compacted by calling 'Rewrite', which
+// replaces the base file and empties the journal.  The cost of a change is thus proportional to the
+// size of the change, amortised over the compactions.
+//
+// The base file is replaced atomically by writing to a temporary file which is then renamed over
+// it.  How often data is flushed to stable storage is controlled by the FsyncPolicy.
+//
+// Alternatively, with Format::kIndexedRecords, the config file is the index of a ConfigRecordFile,
+// and each app's path and args are held in their own record, read on demand.  The 'Record...'
+// functions then write single records rather than journal entries.  This suits very large numbers
+// of local apps, since 'LoadIndex' needn't read any records.  Each file records its format, so the
+// two aren't interchangeable: the format must match the one the file was written with.
+//
+// This class is not threadsafe.  Functions throw on error.
+class ConfigStore {
+ public:
+  static const std::uint64_t kMinCompactionSize;
+
+  enum class FsyncPolicy {
+    kNever,         // leave flushing to the OS
+    kOnRewrite,     // flush the base file and its directory before and after it is renamed
+    kOnEveryWrite,  // as for kOnRewrite, and also flush the journal after every append
+  };
+
+  enum class Format { kJournal, kIndexedRecords };
+
+  ConfigStore(boost::filesystem::path config_file_path, crypto::AES256KeyAndIV key_and_iv,
+              Format format = Format::kJournal);
+
+  ConfigStore(const ConfigStore&) = delete;
+  ConfigStore(ConfigStore&&) = delete;
+  ConfigStore& operator=(const ConfigStore&) = delete;
+  ConfigStore& operator=(ConfigStore&&) = delete;
+
+  // Reads the base file and replays the journal over it.  A final journal record which is
+  // truncated or fails authentication is assumed to be the result of an interrupted write and is
+  // ignored; a corrupt record followed by further records causes an exception to be thrown.  A
+  // journal not belonging to the current base file is ignored, since the base file then postdates
+  // it.
+  PersistentSet<AppDetails> Load();
+  // As for 'Load', except that with Format::kIndexedRecords only the apps' names and auto_start
+  // fields are read; their paths and args are left empty, to be read from 'record_file()'.
+  PersistentSet<AppDetails> LoadIndex();
+
+  // Each of these appends a single record to the journal, or writes a single record.
+  void RecordPut(const AppDetails& app);
+  void RecordErase(const AppName& app_name);
+  void RecordRename(const AppName& old_name, const AppDetails& renamed_app);
+
+  // Invokes 'record_changes', which should call the 'Record...' functions above, and appends all of
+  // the resulting records to the journal in a single write (or to the index in a single delta).  If
+  // the write fails, none of the records are kept.
+  void RecordBatch(const std::function<void()>& record_changes);
+
+  // Rewrites the base file from 'local_apps' and empties the journal.
+  void Rewrite(const PersistentSet<AppDetails>& local_apps);
+
+  // Removes the base file and journal from disk.
+  void Remove();
+
+  void SetFsyncPolicy(FsyncPolicy fsync_policy);
+  // Sets the compression used by subsequent calls to 'Rewrite'.  A base file compressed with a
+  // dictionary other than the DefaultConfigDictionary can only be loaded if 'codec' holds it.
+  // Records written with Format::kIndexedRecords aren't compressed.
+  void SetCodec(ConfigCodec codec) { codec_ = std::move(codec); }
+
+  bool Exists() const;
+  bool NeedsCompaction() const;
+
+  const boost::filesystem::path& config_file_path() const { return config_file_path_; }
+  const boost::filesystem::path& journal_path() const { return journal_path_; }
+  Format format() const { return record_file_ ? Format::kIndexedRecords : Format::kJournal; }
+  // Null unless the format is kIndexedRecords.  The record file is threadsafe, so may be read from
+  // while this store is in use elsewhere.
+  std::shared_ptr<ConfigRecordFile> record_file() const { return record_file_; }
+
+  friend class test::ConfigStoreTest;
+
+ private:
+  enum class RecordType : std::uint8_t { kPut = 0, kErase = 1, kRename = 2 };
+
+  void Append(RecordType type, const AppName& app_name, const AppDetails& app);
+  void WriteRecords(const std::string& records, std::uint64_t record_count);
+  void ResetJournal();
+  void ReplayJournal(PersistentSet<AppDetails>& local_apps);
+  crypto::AES256KeyAndIV RecordKeyAndIv(std::uint64_t sequence_number) const;
+  std::string RecordMac(std::uint64_t sequence_number, const std::string& cipher_text) const;
+
+  const boost::filesystem::path config_file_path_, journal_path_, temp_path_;
+  const crypto::AES256KeyAndIV key_and_iv_;
+  const std::string mac_key_;
+  std::string base_digest_, journal_nonce_;
+  std::uint64_t base_size_, journal_size_, next_sequence_number_;
+  bool exists_;
+  FsyncPolicy fsync_policy_;
+  ConfigCodec codec_;
+  // Records held back while a batch is being recorded.
+  bool batching_;
+  std::string pending_records_;
+  std::uint64_t pending_record_count_;
+  std::vector<ConfigRecordFile::Change> pending_changes_;
+  const std::shared_ptr<ConfigRecordFile> record_file_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CONFIG_STORE_H_
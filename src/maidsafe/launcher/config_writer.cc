@@ -0,0 +1,170 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_writer.h"
+
+#include <cassert>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+const std::chrono::milliseconds ConfigWriter::kDefaultGroupCommitDelay(2);
+
+ConfigWriter::ConfigWriter(std::unique_ptr<ConfigStore> config_store,
+                           std::chrono::milliseconds group_commit_delay)
+    : config_store_(std::move(config_store)),
+      group_commit_delay_(group_commit_delay),
+      queue_(),
+      submitted_(0),
+      committed_(0),
+      durable_(0),
+      last_error_(),
+      stopping_(false),
+      needs_full_rewrite_(false),
+      mutex_(),
+      queued_condition_(),
+      committed_condition_(),
+      thread_() {
+  assert(config_store_);
+  thread_ = std::thread([this] { Run(); });
+}
+
+ConfigWriter::~ConfigWriter() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  queued_condition_.notify_one();
+  thread_.join();
+}
+
+ConfigWriter::Ticket ConfigWriter::Record(std::vector<ConfigChange> changes,
+                                          PersistentSet<AppDetails> local_apps) {
+  return Submit(Job{JobType::kRecord, std::move(changes), std::move(local_apps)});
+}
+
+ConfigWriter::Ticket ConfigWriter::Rewrite(PersistentSet<AppDetails> local_apps) {
+  return Submit(Job{JobType::kRewrite, std::vector<ConfigChange>(), std::move(local_apps)});
+}
+
+ConfigWriter::Ticket ConfigWriter::Remove() {
+  return Submit(Job{JobType::kRemove, std::vector<ConfigChange>(), PersistentSet<AppDetails>()});
+}
+
+void ConfigWriter::Wait(Ticket ticket) {
+  std::unique_lock<std::mutex> lock{mutex_};
+  assert(ticket <= submitted_);
+  committed_condition_.wait(lock, [&] { return committed_ >= ticket; });
+  if (durable_ < ticket) {
+    assert(last_error_);
+    std::rethrow_exception(last_error_);
+  }
+}
+
+void ConfigWriter::Flush() {
+  Ticket ticket{0};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ticket = submitted_;
+  }
+  Wait(ticket);
+}
+
+ConfigWriter::Ticket ConfigWriter::Submit(Job job) {
+  Ticket ticket{0};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    assert(!stopping_);
+    queue_.push_back(std::move(job));
+    ticket = ++submitted_;
+  }
+  queued_condition_.notify_one();
+  return ticket;
+}
+
+void ConfigWriter::Run() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  for (;;) {
+    queued_condition_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty())  // we're stopping and everything has been written
+      return;
+
+    // Give any closely-following changes a chance to join this commit.
+    if (!stopping_ && group_commit_delay_ != std::chrono::milliseconds(0))
+      queued_condition_.wait_for(lock, group_commit_delay_, [&] { return stopping_; });
+
+    std::vector<Job> jobs;
+    jobs.swap(queue_);
+    const Ticket last_ticket(submitted_);
+    lock.unlock();
+
+    std::exception_ptr error;
+    try {
+      Commit(jobs);
+    } catch (const std::exception& e) {
+      LOG(kError) << "Failed to write config file: " << e.what();
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    committed_ = last_ticket;
+    if (error)
+      last_error_ = error;
+    else
+      durable_ = last_ticket;
+    committed_condition_.notify_all();
+  }
+}
+
+void ConfigWriter::Commit(const std::vector<Job>& jobs) {
+  assert(!jobs.empty());
+  const Job& last_job(jobs.back());
+
+  // If any job in the group needs the base file to be rewritten or removed, the state after the
+  // last job is written in full, which subsumes all of the journal records in the group.
+  bool requires_rewrite{needs_full_rewrite_};
+  for (const auto& job : jobs)
+    requires_rewrite = requires_rewrite || job.type != JobType::kRecord;
+
+  // Assume failure until the write completes, so that a partial write is repaired next time.
+  needs_full_rewrite_ = true;
+  if (last_job.type == JobType::kRemove) {
+    config_store_->Remove();
+  } else if (requires_rewrite) {
+    config_store_->Rewrite(last_job.local_apps);
+  } else {
+    config_store_->RecordBatch([&] {
+      for (const auto& job : jobs) {
+        for (const auto& change : job.changes)
+          change(*config_store_);
+      }
+    });
+    if (config_store_->NeedsCompaction())
+      config_store_->Rewrite(last_job.local_apps);
+  }
+  needs_full_rewrite_ = false;
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,124 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_CONFIG_WRITER_H_
+#define MAIDSAFE_LAUNCHER_CONFIG_WRITER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/config_store.h"
+#include "maidsafe/launcher/persistent_set.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+class ConfigWriterTest;
+}  // namespace test
+
+// Owns a ConfigStore and applies changes to it on a dedicated thread, so that callers never block
+// on disk I/O.  Each of the submitting functions returns immediately with a ticket which can be
+// passed to 'Wait' to block until that change (and all those submitted before it) is on disk.
+//
+// Changes which arrive while a previous commit is in progress, or within 'group_commit_delay' of
+// the first queued change, are merged into a single commit: one append to the journal, or a single
+// rewrite of the base file if any of the merged changes requires one.  If a commit fails, the
+// error is logged and reported to any waiters, and the next commit rewrites the base file in full
+// so that the file can't be left missing any changes.
+//
+// Every submission carries the full set of local apps after the change, which is O(1) to copy and
+// lets the writer rewrite or compact the base file without reference to the caller's state.
+//
+// All public functions are threadsafe.
+class ConfigWriter {
+ public:
+  using Ticket = std::uint64_t;
+  // Each records a single change in the journal of the ConfigStore it's invoked on.
+  using ConfigChange = std::function<void(ConfigStore&)>;
+
+  static const std::chrono::milliseconds kDefaultGroupCommitDelay;
+
+  explicit ConfigWriter(std::unique_ptr<ConfigStore> config_store,
+                        std::chrono::milliseconds group_commit_delay = kDefaultGroupCommitDelay);
+  // Writes any outstanding changes before returning.
+  ~ConfigWriter();
+
+  ConfigWriter(const ConfigWriter&) = delete;
+  ConfigWriter(ConfigWriter&&) = delete;
+  ConfigWriter& operator=(const ConfigWriter&) = delete;
+  ConfigWriter& operator=(ConfigWriter&&) = delete;
+
+  // Queues 'changes' to be appended to the journal.  'local_apps' must reflect the changes.
+  Ticket Record(std::vector<ConfigChange> changes, PersistentSet<AppDetails> local_apps);
+  // Queues a full rewrite of the base file from 'local_apps'.
+  Ticket Rewrite(PersistentSet<AppDetails> local_apps);
+  // Queues removal of the base file and journal.
+  Ticket Remove();
+
+  // Blocks until the change identified by 'ticket' has been committed.  Throws the error from the
+  // failed commit if it couldn't be written, and hasn't since been made durable by a later commit.
+  void Wait(Ticket ticket);
+  // Waits for all changes submitted so far.
+  void Flush();
+
+  friend class test::ConfigWriterTest;
+
+ private:
+  enum class JobType { kRecord, kRewrite, kRemove };
+
+  struct Job {
+    JobType type;
+    std::vector<ConfigChange> changes;
+    PersistentSet<AppDetails> local_apps;
+  };
+
+  Ticket Submit(Job job);
+  void Run();
+  void Commit(const std::vector<Job>& jobs);
+
+  const std::unique_ptr<ConfigStore> config_store_;
+  const std::chrono::milliseconds group_commit_delay_;
+  std::vector<Job> queue_;
+  // 'submitted_' is the ticket of the most recently queued job, 'committed_' that of the most
+  // recently processed job (successfully or not) and 'durable_' that of the most recent job known
+  // to be on disk.
+  Ticket submitted_, committed_, durable_;
+  std::exception_ptr last_error_;
+  bool stopping_;
+  // Only accessed by the writer thread.
+  bool needs_full_rewrite_;
+  std::mutex mutex_;
+  std::condition_variable queued_condition_, committed_condition_;
+  std::thread thread_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_CONFIG_WRITER_H_
@@ -20,15 +20,19 @@
 #define MAIDSAFE_LAUNCHER_LAUNCH_H_
 
 #include <chrono>
+#include <functional>
+#include <utility>
 
 #include "asio/io_service_strand.hpp"
-#include "asio/steady_timer.hpp"
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/config.h"
 #include "maidsafe/common/tcp/connection.h"
-#include "maidsafe/common/tcp/listener.h"
 
+#include "maidsafe/launcher/launch_latencies.h"
+#include "maidsafe/launcher/launch_listener.h"
+#include "maidsafe/launcher/local_connection.h"
+#include "maidsafe/launcher/timer_wheel.h"
 #include "maidsafe/launcher/types.h"
 
 namespace maidsafe {
@@ -36,12 +40,20 @@ namespace maidsafe {
 namespace launcher {
 
 struct Launch {
-  Launch(AppName name_in, AsioService& asio_service,
-         const std::chrono::steady_clock::duration& expiry_time)
+  Launch(AppName name_in, AsioService& asio_service)
       : name(std::move(name_in)),
         strand(asio_service.service()),
-        timer(asio_service.service(), expiry_time),
-        connection() {}
+        timeouts(),
+        phase_start(),
+        timer(),
+        connected(false),
+        connection(),
+        local_connection(),
+        token(),
+        session_key(),
+        finished(false),
+        on_settled(),
+        on_complete() {}
   Launch() = delete;
   ~Launch() = default;
   Launch(const Launch&) = delete;
@@ -51,9 +63,27 @@ struct Launch {
 
   AppName name;
   asio::io_service::strand strand;
-  asio::steady_timer timer;
+  LaunchTimeouts timeouts;
+  // When the current phase (connecting, then handshaking) started.
+  std::chrono::steady_clock::time_point phase_start;
+  // The connect timeout until the app connects, then the handshake timeout.
+  TimerWheel::Timer timer;
+  // Set once the app has connected over TCP, or sent its first message over the socket pair.
+  bool connected;
+  // Exactly one of these is set: 'connection' once the app connects over TCP, or
+  // 'local_connection' from the start of a launch over a socket pair.
   tcp::ConnectionPtr connection;
-  tcp::ListenerPtr listener;
+  LocalConnectionPtr local_connection;
+  // Empty unless the launch is over TCP.
+  LaunchToken token;
+  // Empty until the app has sent a valid session key.
+  tcp::Message session_key;
+  // Set once the launch has completed or failed.
+  bool finished;
+  // Invoked once the app has connected or the launch has failed, then reset.
+  std::function<void()> on_settled;
+  // Invoked once the launch has finished, then reset.
+  LaunchHandler on_complete;
 };
 
 }  // namespace launcher
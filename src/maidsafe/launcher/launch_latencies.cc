@@ -0,0 +1,290 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/launch_latencies.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/config_file_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+const std::string kMagic("MSCLAT01");
+const std::size_t kIvSeedSize(16);
+
+std::size_t BucketIndex(std::chrono::steady_clock::duration latency) {
+  const double milliseconds(
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(latency).count());
+  if (milliseconds <= 1.0)
+    return 0;
+  const auto index(static_cast<std::size_t>(std::ceil(4.0 * std::log2(milliseconds))));
+  return std::min(index, LatencyHistogram::kBucketCount - 1);
+}
+
+std::chrono::milliseconds BucketUpperBound(std::size_t index) {
+  return std::chrono::milliseconds(
+      static_cast<std::chrono::milliseconds::rep>(std::ceil(std::pow(2.0, index / 4.0))));
+}
+
+void ThrowParsingError(const char* reason) {
+  LOG(kWarning) << "Failed to parse launch latencies: " << reason;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+// Reads little-endian integers and strings, throwing parsing_error on overrunning the input.
+class Reader {
+ public:
+  explicit Reader(const std::string& input)
+      : position_(input.data()), end_(input.data() + input.size()) {}
+
+  std::uint64_t ReadUint(std::size_t width) { return DecodeUint64(Skip(width), width); }
+
+  std::string ReadString() {
+    const auto size(static_cast<std::size_t>(ReadUint(4)));
+    return std::string(Skip(size), size);
+  }
+
+  bool AtEnd() const { return position_ == end_; }
+
+ private:
+  const char* Skip(std::size_t size) {
+    if (static_cast<std::size_t>(end_ - position_) < size)
+      ThrowParsingError("truncated");
+    const char* const start(position_);
+    position_ += size;
+    return start;
+  }
+
+  const char* position_;
+  const char* const end_;
+};
+
+// Only the non-empty buckets are written, as (index, count) pairs.
+void AppendHistogram(const LatencyHistogram& histogram, std::string& output) {
+  const auto& counts(histogram.BucketCounts());
+  output += EncodeUint64(std::count_if(counts.begin(), counts.end(),
+                                       [](std::uint64_t count) { return count != 0; }),
+                         1);
+  for (std::size_t index(0); index < counts.size(); ++index) {
+    if (counts[index] != 0)
+      output += EncodeUint64(index, 1) + EncodeUint64(counts[index]);
+  }
+}
+
+LatencyHistogram ReadHistogram(Reader& reader) {
+  LatencyHistogram::Counts counts{};
+  const auto bucket_count(reader.ReadUint(1));
+  for (std::uint64_t i(0); i < bucket_count; ++i) {
+    const auto index(reader.ReadUint(1));
+    if (index >= counts.size())
+      ThrowParsingError("bad bucket index");
+    counts[index] = reader.ReadUint(8);
+  }
+  return LatencyHistogram(counts);
+}
+
+}  // unnamed namespace
+
+const std::size_t LatencyHistogram::kBucketCount;
+const std::uint64_t LatencyHistogram::kDecayThreshold;
+
+LaunchTimeoutPolicy::LaunchTimeoutPolicy()
+    : LaunchTimeoutPolicy(std::chrono::seconds(5), std::chrono::seconds(1),
+                          std::chrono::seconds(30)) {}
+
+LaunchTimeoutPolicy::LaunchTimeoutPolicy(std::chrono::milliseconds initial_timeout_in,
+                                         std::chrono::milliseconds min_timeout_in,
+                                         std::chrono::milliseconds max_timeout_in)
+    : percentile(0.99),
+      multiplier(3.0),
+      min_samples(10),
+      initial_timeout(initial_timeout_in),
+      min_timeout(min_timeout_in),
+      max_timeout(max_timeout_in) {
+  assert(min_timeout <= max_timeout);
+}
+
+LatencyHistogram::LatencyHistogram() : counts_(), sample_count_(0) {}
+
+LatencyHistogram::LatencyHistogram(const Counts& counts) : counts_(counts), sample_count_(0) {
+  for (std::uint64_t count : counts_) {
+    sample_count_ += count;
+    if (count >= kDecayThreshold || sample_count_ >= kDecayThreshold) {
+      LOG(kError) << "Latency histogram counts exceed the decay threshold.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+    }
+  }
+}
+
+void LatencyHistogram::Add(std::chrono::steady_clock::duration latency) {
+  ++counts_[BucketIndex(latency)];
+  if (++sample_count_ < kDecayThreshold)
+    return;
+  sample_count_ = 0;
+  for (auto& count : counts_) {
+    count /= 2;
+    sample_count_ += count;
+  }
+}
+
+std::chrono::milliseconds LatencyHistogram::Percentile(double percentile) const {
+  assert(percentile >= 0.0 && percentile <= 1.0);
+  if (sample_count_ == 0)
+    return std::chrono::milliseconds(0);
+  const auto rank(std::max(
+      std::uint64_t{1}, static_cast<std::uint64_t>(std::ceil(percentile * sample_count_))));
+  std::uint64_t cumulative(0);
+  for (std::size_t index(0); index < kBucketCount; ++index) {
+    cumulative += counts_[index];
+    if (cumulative >= rank)
+      return BucketUpperBound(index);
+  }
+  return BucketUpperBound(kBucketCount - 1);
+}
+
+std::chrono::milliseconds LaunchTimeout(const LaunchTimeoutPolicy& policy,
+                                        const LatencyHistogram& latencies) {
+  if (latencies.SampleCount() < policy.min_samples)
+    return policy.initial_timeout;
+  const std::chrono::milliseconds timeout(static_cast<std::chrono::milliseconds::rep>(
+      std::ceil(latencies.Percentile(policy.percentile).count() * policy.multiplier)));
+  return std::max(policy.min_timeout, std::min(policy.max_timeout, timeout));
+}
+
+LaunchLatencies::LaunchLatencies(fs::path file_path, crypto::AES256KeyAndIV key_and_iv,
+                                 LaunchTimeoutPolicy connect_policy,
+                                 LaunchTimeoutPolicy handshake_policy)
+    : file_path_(std::move(file_path)),
+      key_and_iv_(std::move(key_and_iv)),
+      connect_policy_(std::move(connect_policy)),
+      handshake_policy_(std::move(handshake_policy)),
+      mutex_(),
+      apps_(),
+      changed_(false) {
+  Load();
+}
+
+void LaunchLatencies::Add(const AppName& app_name, LaunchPhase phase,
+                          std::chrono::steady_clock::duration latency) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  AppLatencies& app(apps_[app_name]);
+  (phase == LaunchPhase::kConnect ? app.connect : app.handshake).Add(latency);
+  changed_ = true;
+}
+
+std::uint64_t LaunchLatencies::TimedOut(const AppName& app_name, LaunchPhase phase) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  AppLatencies& app(apps_[app_name]);
+  return ++(phase == LaunchPhase::kConnect ? app.connect_timeouts : app.handshake_timeouts);
+}
+
+LaunchTimeouts LaunchLatencies::Timeouts(const AppName& app_name) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto itr(apps_.find(app_name));
+  if (itr == apps_.end())
+    return LaunchTimeouts{connect_policy_.initial_timeout, handshake_policy_.initial_timeout};
+  return LaunchTimeouts{LaunchTimeout(connect_policy_, itr->second.connect),
+                        LaunchTimeout(handshake_policy_, itr->second.handshake)};
+}
+
+LatencyHistogram LaunchLatencies::Histogram(const AppName& app_name, LaunchPhase phase) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto itr(apps_.find(app_name));
+  if (itr == apps_.end())
+    return LatencyHistogram();
+  return phase == LaunchPhase::kConnect ? itr->second.connect : itr->second.handshake;
+}
+
+void LaunchLatencies::Save() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (!changed_)
+    return;
+  std::string plaintext(EncodeUint64(apps_.size(), 4));
+  for (const auto& app : apps_) {
+    plaintext += EncodeUint64(app.first.size(), 4) + app.first;
+    AppendHistogram(app.second.connect, plaintext);
+    AppendHistogram(app.second.handshake, plaintext);
+  }
+  const std::string iv_seed(RandomString(kIvSeedSize));
+  crypto::CipherText cipher_text(crypto::SymmEncrypt(NonEmptyString{plaintext},
+                                                     DeriveKeyAndIv(key_and_iv_, iv_seed)));
+
+  // Write to a temporary file and rename it over the old one, as for the config file.  The
+  // latencies are only advisory, so aren't synced to disk.
+  const fs::path temp_path(file_path_.string() + ".new");
+  if (!WriteFile(temp_path, kMagic + iv_seed + cipher_text->string())) {
+    LOG(kError) << "Failed to save launch latencies at " << temp_path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  boost::system::error_code ec;
+  fs::rename(temp_path, file_path_, ec);
+  if (ec) {
+    LOG(kError) << "Failed to replace launch latencies at " << file_path_ << ": " << ec.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  changed_ = false;
+}
+
+void LaunchLatencies::Load() {
+  std::string contents;
+  boost::system::error_code ec;
+  if (!fs::exists(file_path_, ec) || !ReadFile(file_path_, &contents))
+    return;
+  try {
+    if (contents.compare(0, kMagic.size(), kMagic) != 0 ||
+        contents.size() <= kMagic.size() + kIvSeedSize) {
+      ThrowParsingError("bad header");
+    }
+    NonEmptyString plaintext(crypto::SymmDecrypt(
+        crypto::CipherText{NonEmptyString{contents.substr(kMagic.size() + kIvSeedSize)}},
+        DeriveKeyAndIv(key_and_iv_, contents.substr(kMagic.size(), kIvSeedSize))));
+    Reader reader(plaintext.string());
+    std::map<AppName, AppLatencies> apps;
+    for (auto app_count(reader.ReadUint(4)); app_count != 0; --app_count) {
+      AppLatencies& app(apps[reader.ReadString()]);
+      app.connect = ReadHistogram(reader);
+      app.handshake = ReadHistogram(reader);
+    }
+    if (!reader.AtEnd())
+      ThrowParsingError("trailing bytes");
+    apps_ = std::move(apps);
+  } catch (const std::exception& e) {
+    LOG(kWarning) << "Discarding launch latencies at " << file_path_ << ": "
+                  << boost::diagnostic_information(e);
+  }
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,144 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_LAUNCH_LATENCIES_H_
+#define MAIDSAFE_LAUNCHER_LAUNCH_LATENCIES_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// The stages of a launch which are each timed out: the app connecting to the launcher, then
+// completing the handshake over that connection.
+enum class LaunchPhase { kConnect, kHandshake };
+
+// Controls how a launch phase's timeout is derived from the app's observed latencies for that
+// phase.  The timeout is the 'percentile' latency multiplied by 'multiplier', clamped to
+// ['min_timeout', 'max_timeout'], or 'initial_timeout' until at least 'min_samples' latencies have
+// been observed.
+struct LaunchTimeoutPolicy {
+  LaunchTimeoutPolicy();
+  LaunchTimeoutPolicy(std::chrono::milliseconds initial_timeout_in,
+                      std::chrono::milliseconds min_timeout_in,
+                      std::chrono::milliseconds max_timeout_in);
+
+  double percentile;
+  double multiplier;
+  std::size_t min_samples;
+  std::chrono::milliseconds initial_timeout, min_timeout, max_timeout;
+};
+
+// Counts latencies in buckets whose bounds grow geometrically, four per doubling from 1 ms, so
+// that any percentile is overestimated by at most 19%.  Once 'kDecayThreshold' samples are held,
+// every count is halved so that recent latencies outweigh older ones.
+class LatencyHistogram {
+ public:
+  static const std::size_t kBucketCount = 96;
+  static const std::uint64_t kDecayThreshold = 1024;
+  using Counts = std::array<std::uint64_t, kBucketCount>;
+
+  LatencyHistogram();
+  // Throws invalid_argument if the counts total 'kDecayThreshold' or more.
+  explicit LatencyHistogram(const Counts& counts);
+
+  void Add(std::chrono::steady_clock::duration latency);
+  std::uint64_t SampleCount() const { return sample_count_; }
+  // 'percentile' must be in the range [0.0, 1.0].  Returns the upper bound of the bucket holding
+  // that percentile's sample, or zero if there are no samples.
+  std::chrono::milliseconds Percentile(double percentile) const;
+  const Counts& BucketCounts() const { return counts_; }
+
+ private:
+  Counts counts_;
+  std::uint64_t sample_count_;
+};
+
+// Returns the timeout for a launch phase whose observed latencies are 'latencies'.
+std::chrono::milliseconds LaunchTimeout(const LaunchTimeoutPolicy& policy,
+                                        const LatencyHistogram& latencies);
+
+struct LaunchTimeouts {
+  std::chrono::milliseconds connect, handshake;
+};
+
+// Records each app's connect and handshake latencies, and derives its timeouts for each phase from
+// them.  The histograms are held in the file at 'file_path', encrypted under 'key_and_iv', and are
+// loaded on construction.  If the file is missing or can't be parsed, every app starts afresh.
+//
+// All public functions are threadsafe.
+class LaunchLatencies {
+ public:
+  LaunchLatencies(boost::filesystem::path file_path, crypto::AES256KeyAndIV key_and_iv,
+                  LaunchTimeoutPolicy connect_policy, LaunchTimeoutPolicy handshake_policy);
+
+  LaunchLatencies(const LaunchLatencies&) = delete;
+  LaunchLatencies(LaunchLatencies&&) = delete;
+  LaunchLatencies& operator=(const LaunchLatencies&) = delete;
+  LaunchLatencies& operator=(LaunchLatencies&&) = delete;
+
+  // Only a phase which completed in time should be added.  A handshake latency should only be added
+  // once the app has sent a valid session key and confirmed, since a hanging or misbehaving app
+  // says nothing about how long a genuine handshake takes, and would only inflate the timeout.
+  void Add(const AppName& app_name, LaunchPhase phase, std::chrono::steady_clock::duration latency);
+  // Counts a phase which timed out, returning the number of times it has done so for 'app_name'
+  // since construction.  It isn't sampled, so never raises the timeout: were the timeout added as
+  // a latency, every stall would push the percentile up until the timeout reached 'max_timeout'.
+  std::uint64_t TimedOut(const AppName& app_name, LaunchPhase phase);
+  LaunchTimeouts Timeouts(const AppName& app_name) const;
+  LatencyHistogram Histogram(const AppName& app_name, LaunchPhase phase) const;
+  // Writes the histograms to the file if they've changed since it was loaded or last written.
+  // Throws filesystem_io_error on failure.
+  void Save();
+
+ private:
+  struct AppLatencies {
+    AppLatencies() : connect(), handshake(), connect_timeouts(0), handshake_timeouts(0) {}
+
+    LatencyHistogram connect, handshake;
+    // Not persisted.
+    std::uint64_t connect_timeouts, handshake_timeouts;
+  };
+
+  void Load();
+
+  const boost::filesystem::path file_path_;
+  const crypto::AES256KeyAndIV key_and_iv_;
+  const LaunchTimeoutPolicy connect_policy_, handshake_policy_;
+  mutable std::mutex mutex_;
+  std::map<AppName, AppLatencies> apps_;
+  bool changed_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_LAUNCH_LATENCIES_H_
@@ -0,0 +1,189 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/launch_listener.h"
+
+#include <cassert>
+#include <utility>
+
+#include "asio/dispatch.hpp"
+#include "asio/steady_timer.hpp"
+
+#include "maidsafe/common/encode.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+// Tokens are this many random bytes, hex-encoded.
+const std::size_t kTokenSize(16);
+
+}  // unnamed namespace
+
+// The state of a single accepted connection.  Until it has presented a token, the connection is
+// held here (and closed if the timer expires first).  Once it has presented a registered token, its
+// messages and closure are forwarded to that registration's handlers.  Only accessed on the strand.
+struct LaunchListener::Route {
+  Route(asio::io_service& io_service, tcp::ConnectionPtr connection_in)
+      : timer(io_service),
+        connection(std::move(connection_in)),
+        identified(false),
+        on_message(),
+        on_closed() {}
+
+  asio::steady_timer timer;
+  tcp::ConnectionPtr connection;
+  bool identified;
+  tcp::MessageReceivedFunctor on_message;
+  tcp::ConnectionClosedFunctor on_closed;
+};
+
+std::shared_ptr<LaunchListener> LaunchListener::MakeShared(
+    asio::io_service& io_service, std::chrono::steady_clock::duration identify_timeout) {
+  std::shared_ptr<LaunchListener> launch_listener(new LaunchListener(io_service, identify_timeout));
+  launch_listener->StartListening();
+  return launch_listener;
+}
+
+LaunchListener::LaunchListener(asio::io_service& io_service,
+                               std::chrono::steady_clock::duration identify_timeout)
+    : io_service_(io_service),
+      strand_(io_service),
+      identify_timeout_(identify_timeout),
+      listener_(),
+      mutex_(),
+      registrations_() {}
+
+LaunchListener::~LaunchListener() { StopListening(); }
+
+void LaunchListener::StartListening() {
+  std::weak_ptr<LaunchListener> weak_this(shared_from_this());
+  listener_ = tcp::Listener::MakeShared(strand_, [weak_this](tcp::ConnectionPtr connection) {
+    auto launch_listener(weak_this.lock());
+    if (launch_listener && connection)
+      launch_listener->HandleNewConnection(connection);
+  }, static_cast<tcp::Port>((RandomUint32() % 64512) + 1024));
+}
+
+LaunchToken LaunchListener::Register(ConnectionHandler on_connection,
+                                     tcp::MessageReceivedFunctor on_message,
+                                     tcp::ConnectionClosedFunctor on_closed) {
+  Registration registration{std::move(on_connection), std::move(on_message), std::move(on_closed)};
+  std::lock_guard<std::mutex> lock{mutex_};
+  for (;;) {
+    LaunchToken token(hex::Encode(RandomString(kTokenSize)));
+    if (registrations_.emplace(token, std::move(registration)).second)
+      return token;
+  }
+}
+
+bool LaunchListener::Unregister(const LaunchToken& token) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return registrations_.erase(token) != 0;
+}
+
+tcp::Port LaunchListener::ListeningPort() const { return listener_->ListeningPort(); }
+
+std::size_t LaunchListener::PendingCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return registrations_.size();
+}
+
+void LaunchListener::StopListening() {
+  if (listener_)
+    listener_->StopListening();
+  // Destroyed once the lock is released, since the handlers may hold whatever holds this.
+  std::map<LaunchToken, Registration> withdrawn;
+  std::lock_guard<std::mutex> lock{mutex_};
+  withdrawn.swap(registrations_);
+}
+
+void LaunchListener::HandleNewConnection(tcp::ConnectionPtr connection) {
+  assert(strand_.running_in_this_thread());
+  // The route holds the connection until it identifies itself, and is held in turn by the
+  // connection's handlers.  The cycle is broken once the connection identifies, closes or expires.
+  auto route(std::make_shared<Route>(io_service_, connection));
+  std::weak_ptr<LaunchListener> weak_this(shared_from_this());
+
+  route->timer.expires_from_now(identify_timeout_);
+  route->timer.async_wait([weak_this, route](const asio::error_code& error) {
+    auto launch_listener(weak_this.lock());
+    if (!launch_listener || error == asio::error::operation_aborted)
+      return;
+    asio::dispatch(launch_listener->strand_, [route] {
+      if (route->identified || !route->connection)
+        return;
+      LOG(kWarning) << "Connection didn't present a launch token in time.";
+      tcp::ConnectionPtr connection(std::move(route->connection));
+      connection->Close();
+    });
+  });
+
+  connection->Start(
+      [weak_this, route](tcp::Message message) {
+        if (route->identified) {
+          if (route->on_message)
+            route->on_message(std::move(message));
+          return;
+        }
+        if (auto launch_listener = weak_this.lock())
+          launch_listener->Identify(*route, message);
+      },
+      [route] {
+        route->timer.cancel();
+        route->connection.reset();
+        if (route->on_closed)
+          route->on_closed();
+      });
+}
+
+void LaunchListener::Identify(Route& route, const tcp::Message& message) {
+  // Only the first message on a connection is taken as its token, whether or not it's recognised.
+  route.identified = true;
+  route.timer.cancel();
+  tcp::ConnectionPtr connection(std::move(route.connection));
+  if (!connection)
+    return;
+
+  const LaunchToken token(message.begin(), message.end());
+  Registration registration;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto itr(registrations_.find(token));
+    if (itr == registrations_.end()) {
+      LOG(kWarning) << "Connection presented an unknown or spent launch token.";
+      connection->Close();
+      return;
+    }
+    registration = std::move(itr->second);
+    registrations_.erase(itr);
+  }
+
+  route.on_message = std::move(registration.on_message);
+  route.on_closed = std::move(registration.on_closed);
+  if (registration.on_connection)
+    registration.on_connection(connection);
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
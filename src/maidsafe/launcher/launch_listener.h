@@ -0,0 +1,103 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_LAUNCH_LISTENER_H_
+#define MAIDSAFE_LAUNCHER_LAUNCH_LISTENER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "asio/io_service.hpp"
+#include "asio/io_service_strand.hpp"
+
+#include "maidsafe/common/tcp/connection.h"
+#include "maidsafe/common/tcp/listener.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Identifies a single launch to the LaunchListener.  The launched app is passed it on its command
+// line and must send it, unchanged, as the first message on its connection to the launcher.
+using LaunchToken = std::string;
+
+// A single local listener shared by all launches.  Rather than each launch binding its own
+// listener on a random port, each registers for a random single-use token, and connections are
+// routed to the launch whose token they present.  Connections which present an unknown token, or
+// don't present one within the identify timeout, are closed.
+//
+// All handlers are invoked on the listener's strand.  All public functions are threadsafe.
+class LaunchListener : public std::enable_shared_from_this<LaunchListener> {
+ public:
+  using ConnectionHandler = std::function<void(tcp::ConnectionPtr)>;
+
+  static std::shared_ptr<LaunchListener> MakeShared(
+      asio::io_service& io_service, std::chrono::steady_clock::duration identify_timeout);
+  ~LaunchListener();
+
+  LaunchListener(const LaunchListener&) = delete;
+  LaunchListener(LaunchListener&&) = delete;
+  LaunchListener& operator=(const LaunchListener&) = delete;
+  LaunchListener& operator=(LaunchListener&&) = delete;
+
+  // Returns a new token.  When a connection presents it, 'on_connection' is invoked with the
+  // connection, and any further messages and its closure are passed to 'on_message' and
+  // 'on_closed'.  The token is then spent, so a second connection presenting it is refused.
+  LaunchToken Register(ConnectionHandler on_connection, tcp::MessageReceivedFunctor on_message,
+                       tcp::ConnectionClosedFunctor on_closed);
+  // Withdraws 'token' so that no connection can present it.  Returns false if it's already been
+  // presented or withdrawn.
+  bool Unregister(const LaunchToken& token);
+  tcp::Port ListeningPort() const;
+  // The number of registered tokens which haven't yet been presented or withdrawn.
+  std::size_t PendingCount() const;
+  // Stops accepting connections, and withdraws every registered token.
+  void StopListening();
+
+ private:
+  struct Registration {
+    ConnectionHandler on_connection;
+    tcp::MessageReceivedFunctor on_message;
+    tcp::ConnectionClosedFunctor on_closed;
+  };
+  struct Route;
+
+  LaunchListener(asio::io_service& io_service,
+                 std::chrono::steady_clock::duration identify_timeout);
+  void StartListening();
+  void HandleNewConnection(tcp::ConnectionPtr connection);
+  void Identify(Route& route, const tcp::Message& message);
+
+  asio::io_service& io_service_;
+  asio::io_service::strand strand_;
+  const std::chrono::steady_clock::duration identify_timeout_;
+  tcp::ListenerPtr listener_;
+  mutable std::mutex mutex_;
+  std::map<LaunchToken, Registration> registrations_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_LAUNCH_LISTENER_H_
@@ -0,0 +1,167 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/launch_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "asio/post.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+std::shared_ptr<LaunchScheduler> LaunchScheduler::MakeShared(asio::io_service& io_service,
+                                                              const std::vector<AppName>& apps,
+                                                              const AutoStartOptions& options,
+                                                              StartFunctor start) {
+  std::shared_ptr<LaunchScheduler> scheduler(new LaunchScheduler(
+      io_service, std::max<std::size_t>(options.max_concurrent_launches, 1), std::move(start)));
+  for (const auto& app_name : apps) {
+    auto itr(options.apps.find(app_name));
+    scheduler->apps_[app_name].priority = (itr == options.apps.end() ? 0 : itr->second.priority);
+  }
+  for (auto& app : scheduler->apps_) {
+    auto itr(options.apps.find(app.first));
+    if (itr != options.apps.end()) {
+      for (const auto& dependency : itr->second.launch_after) {
+        auto dependency_itr(scheduler->apps_.find(dependency));
+        if (dependency_itr == scheduler->apps_.end() || dependency == app.first)
+          continue;
+        dependency_itr->second.dependents.push_back(app.first);
+        ++app.second.unsettled_dependencies;
+      }
+    }
+    if (app.second.unsettled_dependencies == 0)
+      scheduler->ready_.emplace(app.second.priority, app.first);
+    else
+      scheduler->blocked_.insert(app.first);
+  }
+  return scheduler;
+}
+
+LaunchScheduler::LaunchScheduler(asio::io_service& io_service,
+                                 std::size_t max_concurrent_launches, StartFunctor start)
+    : io_service_(io_service),
+      max_concurrent_launches_(max_concurrent_launches),
+      start_(std::move(start)),
+      mutex_(),
+      cond_var_(),
+      stopped_(false),
+      apps_(),
+      blocked_(),
+      ready_(),
+      in_progress_(),
+      calls_in_progress_(0) {}
+
+void LaunchScheduler::Start() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  StartReady();
+}
+
+void LaunchScheduler::Stop() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  stopped_ = true;
+  cond_var_.wait(lock, [&] { return calls_in_progress_ == 0; });
+}
+
+std::size_t LaunchScheduler::PendingCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return blocked_.size() + ready_.size();
+}
+
+std::size_t LaunchScheduler::InProgressCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return in_progress_.size();
+}
+
+void LaunchScheduler::StartReady() {
+  while (!stopped_ && in_progress_.size() < max_concurrent_launches_) {
+    if (ready_.empty()) {
+      if (!in_progress_.empty() || blocked_.empty())
+        return;
+      // Nothing is ready or in progress, so the blocked apps' dependencies can never all settle.
+      auto cycle_breaker(std::min_element(
+          blocked_.begin(), blocked_.end(), [&](const AppName& lhs, const AppName& rhs) {
+            return ReadyOrder()(std::make_pair(apps_[lhs].priority, lhs),
+                                std::make_pair(apps_[rhs].priority, rhs));
+          }));
+      LOG(kWarning) << "Launch-after dependencies of " << *cycle_breaker
+                    << " form a cycle; launching it regardless.";
+      App& app(apps_[*cycle_breaker]);
+      app.unsettled_dependencies = 0;
+      ready_.emplace(app.priority, *cycle_breaker);
+      blocked_.erase(cycle_breaker);
+    }
+    const AppName app_name(ready_.begin()->second);
+    ready_.erase(ready_.begin());
+    in_progress_.insert(app_name);
+    auto self(shared_from_this());
+    asio::post(io_service_, [self, app_name] { self->Launch(app_name); });
+  }
+}
+
+void LaunchScheduler::Launch(const AppName& app_name) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (stopped_) {
+      in_progress_.erase(app_name);
+      return;
+    }
+    ++calls_in_progress_;
+  }
+
+  bool started{false};
+  try {
+    auto self(shared_from_this());
+    start_(app_name, [self, app_name] { self->Settle(app_name); });
+    started = true;
+  } catch (const std::exception& e) {
+    LOG(kError) << "Failed to auto-start " << app_name << ": " << boost::diagnostic_information(e);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    --calls_in_progress_;
+    cond_var_.notify_all();
+  }
+  if (!started)
+    Settle(app_name);
+}
+
+void LaunchScheduler::Settle(const AppName& app_name) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (in_progress_.erase(app_name) == 0)
+    return;
+  for (const auto& dependent_name : apps_[app_name].dependents) {
+    App& dependent(apps_[dependent_name]);
+    if (dependent.unsettled_dependencies == 0 || --dependent.unsettled_dependencies != 0)
+      continue;
+    if (blocked_.erase(dependent_name) != 0)
+      ready_.emplace(dependent.priority, dependent_name);
+  }
+  StartReady();
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
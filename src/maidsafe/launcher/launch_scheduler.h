@@ -0,0 +1,136 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_LAUNCH_SCHEDULER_H_
+#define MAIDSAFE_LAUNCHER_LAUNCH_SCHEDULER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "asio/io_service.hpp"
+
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Controls the order in which auto-start apps are launched after login.
+struct AutoStartOptions {
+  struct AppOptions {
+    AppOptions() : priority(0), launch_after() {}
+
+    // Among the apps ready to launch, those with a higher priority are launched first.
+    int priority;
+    // Apps which must have finished launching (successfully or not) before this one starts.  Apps
+    // which aren't being auto-started are ignored.
+    std::set<AppName> launch_after;
+  };
+
+  AutoStartOptions() : apps(), max_concurrent_launches(4) {}
+
+  // Apps not listed here have default options.
+  std::map<AppName, AppOptions> apps;
+  // The most launches in progress at once.  A launch is in progress until the app connects to the
+  // Launcher or the launch fails.
+  std::size_t max_concurrent_launches;
+};
+
+// Launches a set of apps asynchronously on 'io_service', at most 'max_concurrent_launches' at a
+// time, ordered by priority and by their launch-after dependencies.  Apps with equal priority are
+// launched in name order.  If the dependencies form a cycle, it's broken by launching the highest
+// priority app in it once nothing else can proceed.
+//
+// All public functions are threadsafe.
+class LaunchScheduler : public std::enable_shared_from_this<LaunchScheduler> {
+ public:
+  // Begins launching 'app_name'.  'on_settled' must be called, from any thread, when the launch
+  // has finished (successfully or not).  If this throws, the launch is taken to have failed.
+  // Calling 'on_settled' more than once, or after this has thrown, is harmless.
+  using StartFunctor =
+      std::function<void(const AppName& app_name, std::function<void()> on_settled)>;
+
+  static std::shared_ptr<LaunchScheduler> MakeShared(asio::io_service& io_service,
+                                                     const std::vector<AppName>& apps,
+                                                     const AutoStartOptions& options,
+                                                     StartFunctor start);
+
+  LaunchScheduler(const LaunchScheduler&) = delete;
+  LaunchScheduler(LaunchScheduler&&) = delete;
+  LaunchScheduler& operator=(const LaunchScheduler&) = delete;
+  LaunchScheduler& operator=(LaunchScheduler&&) = delete;
+
+  // Starts launching.  Returns immediately.
+  void Start();
+  // Stops any further launches from starting, blocking until any calls to the StartFunctor already
+  // in progress have returned.  Must not be called from within the StartFunctor.
+  void Stop();
+  // The number of apps not yet started, and the number started but not yet settled.
+  std::size_t PendingCount() const;
+  std::size_t InProgressCount() const;
+
+ private:
+  struct App {
+    App() : priority(0), unsettled_dependencies(0), dependents() {}
+    int priority;
+    std::size_t unsettled_dependencies;
+    std::vector<AppName> dependents;
+  };
+
+  // Orders ready apps by descending priority, then by name.
+  struct ReadyOrder {
+    bool operator()(const std::pair<int, AppName>& lhs,
+                    const std::pair<int, AppName>& rhs) const {
+      return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    }
+  };
+
+  LaunchScheduler(asio::io_service& io_service, std::size_t max_concurrent_launches,
+                  StartFunctor start);
+  // Posts as many ready apps as the concurrency cap allows.  Must be called with 'mutex_' held.
+  void StartReady();
+  void Launch(const AppName& app_name);
+  void Settle(const AppName& app_name);
+
+  asio::io_service& io_service_;
+  const std::size_t max_concurrent_launches_;
+  const StartFunctor start_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_var_;
+  bool stopped_;
+  std::map<AppName, App> apps_;
+  // Each app is in exactly one of these until it settles.
+  std::set<AppName> blocked_;
+  std::set<std::pair<int, AppName>, ReadyOrder> ready_;
+  std::set<AppName> in_progress_;
+  // The number of calls to 'start_' which haven't yet returned.
+  std::size_t calls_in_progress_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_LAUNCH_SCHEDULER_H_
@@ -18,7 +18,15 @@
 
 #include "maidsafe/launcher/launcher.h"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "asio/io_service_strand.hpp"
 #include "asio/dispatch.hpp"
@@ -26,14 +34,15 @@
 #include "maidsafe/common/application_support_directories.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
+#include "maidsafe/common/on_scope_exit.h"
 #ifdef TESTING
 #include "maidsafe/common/test.h"
 #endif
-#include "maidsafe/common/tcp/listener.h"
 
 #include "maidsafe/launcher/account.h"
 #include "maidsafe/launcher/account_getter.h"
 #include "maidsafe/launcher/launch.h"
+#include "maidsafe/launcher/retry_policy.h"
 
 namespace maidsafe {
 
@@ -41,6 +50,9 @@ namespace launcher {
 
 namespace {
 
+// The granularity of launches' connect and handshake deadlines.
+const std::chrono::milliseconds kTimerResolution(10);
+
 boost::filesystem::path GetConfigFilePath() {
 #if defined(USE_FAKE_STORE)
   return Launcher::FakeStorePath() / "config.txt";
@@ -53,6 +65,23 @@ boost::filesystem::path GetConfigFilePath() {
 #endif
 }
 
+// Invokes the launch's 'on_settled', at most once.
+void Settle(Launch& launch) {
+  std::function<void()> on_settled;
+  std::swap(on_settled, launch.on_settled);
+  if (on_settled)
+    on_settled();
+}
+
+// Marks the launch as finished, and invokes its 'on_complete' at most once.
+void Complete(Launch& launch, bool completed) {
+  launch.finished = true;
+  LaunchHandler on_complete;
+  std::swap(on_complete, launch.on_complete);
+  if (on_complete)
+    on_complete(completed);
+}
+
 authentication::UserCredentials ConvertToCredentials(Keyword keyword, Pin pin, Password password) {
   authentication::UserCredentials user_credentials;
   user_credentials.keyword =
@@ -71,13 +100,19 @@ const std::chrono::steady_clock::duration Launcher::handshake_timeout_(std::chro
 
 
 
-Launcher::Launcher(Keyword keyword, Pin pin, Password password, AccountGetter& account_getter)
+Launcher::Launcher(Keyword keyword, Pin pin, Password password, AccountGetter& account_getter,
+                   const AutoStartOptions& auto_start_options)
     : asio_service_(5),
+      child_processes_(asio_service_.service()),
+      launch_listener_(LaunchListener::MakeShared(asio_service_.service(), handshake_timeout_)),
+      timer_wheel_(TimerWheel::MakeShared(asio_service_.service(), kTimerResolution)),
       network_client_(),
       account_handler_(),
       account_mutex_(),
       app_handler_(),
-      rollback_snapshot_() {
+      undo_log_(),
+      launch_latencies_(),
+      auto_start_scheduler_() {
   account_handler_.Login(ConvertToCredentials(keyword, pin, password), account_getter);
 #ifdef ROUTING_AND_NFS_UPDATED
 #ifdef USE_FAKE_STORE
@@ -91,17 +126,27 @@ Launcher::Launcher(Keyword keyword, Pin pin, Password password, AccountGetter& a
       MemoryUsage(1 << 7), Launcher::FakeStoreDiskUsage(), nullptr, Launcher::FakeStorePath());
 #endif
   app_handler_.Initialise(GetConfigFilePath(), account_handler_.account_.get(), &account_mutex_);
-  // Auto-start any relevant apps
-  std::set<AppDetails> local_apps(app_handler_.GetApps(true));
-  for (const auto& app : local_apps) {
-    if (app.auto_start)
-      LaunchApp(app.name, app.path, std::move(app.args));
-  }
+  InitialiseLaunchLatencies();
+  // Auto-start any relevant apps in the background, so that login doesn't wait for them.  This
+  // doesn't need every local app's path and args to be loaded.  One app failing to start doesn't
+  // stop the others.
+  const auto auto_start_apps(app_handler_.GetAutoStartApps());
+  auto_start_scheduler_ = LaunchScheduler::MakeShared(
+      asio_service_.service(), std::vector<AppName>(auto_start_apps.begin(), auto_start_apps.end()),
+      auto_start_options, [this](const AppName& app_name, std::function<void()> on_settled) {
+        auto path_and_args(app_handler_.GetPathAndArgs(app_name));
+        LaunchApp(app_name, path_and_args.first, path_and_args.second,
+                  HandshakeTransport::kSocketPair, std::move(on_settled));
+      });
+  auto_start_scheduler_->Start();
 }
 
 Launcher::Launcher(Keyword keyword, Pin pin, Password password,
                    passport::MaidAndSigner&& maid_and_signer)
     : asio_service_(1),
+      child_processes_(asio_service_.service()),
+      launch_listener_(LaunchListener::MakeShared(asio_service_.service(), handshake_timeout_)),
+      timer_wheel_(TimerWheel::MakeShared(asio_service_.service(), kTimerResolution)),
 #ifdef ROUTING_AND_NFS_UPDATED
 #ifdef USE_FAKE_STORE
       network_client_(std::make_shared<NetworkClient>(FakeStorePath(), FakeStoreDiskUsage())),
@@ -116,15 +161,45 @@ Launcher::Launcher(Keyword keyword, Pin pin, Password password,
                        ConvertToCredentials(keyword, pin, password), *network_client_),
       account_mutex_(),
       app_handler_(),
-      rollback_snapshot_() {
+      undo_log_(),
+      launch_latencies_(),
+      auto_start_scheduler_() {
   app_handler_.Initialise(GetConfigFilePath(), account_handler_.account_.get(), &account_mutex_);
+  InitialiseLaunchLatencies();
+}
+
+Launcher::~Launcher() {
+  // Launches' handlers run on 'asio_service_' and use the other members, so no more may start, and
+  // every asio thread is joined, before any member is destroyed.
+  if (auto_start_scheduler_)
+    auto_start_scheduler_->Stop();
+  launch_listener_->StopListening();
+  timer_wheel_->CancelAll();
+  asio_service_.Stop();
 }
 
-std::unique_ptr<Launcher> Launcher::Login(Keyword keyword, Pin pin, Password password) {
+void Launcher::InitialiseLaunchLatencies() {
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  // Until enough launches of an app have been observed, the fixed timeouts apply.
+  launch_latencies_ = maidsafe::make_unique<LaunchLatencies>(
+      GetConfigFilePath().parent_path() / "launch_latencies",
+      account_handler_.account_->config_file_aes_key_and_iv,
+      LaunchTimeoutPolicy(duration_cast<milliseconds>(connect_timeout_), std::chrono::seconds(2),
+                          std::chrono::minutes(2)),
+      LaunchTimeoutPolicy(duration_cast<milliseconds>(handshake_timeout_), std::chrono::seconds(1),
+                          std::chrono::seconds(30)));
+}
+
+std::unique_ptr<Launcher> Launcher::Login(Keyword keyword, Pin pin, Password password,
+                                          AutoStartOptions auto_start_options) {
   std::unique_ptr<AccountGetter> account_getter{AccountGetter::CreateAccountGetter().get()};
+  // A hedged read which lost its race may still be running on the getter's threads.  Rather than
+  // waiting for it, the getter is destroyed once it has finished.
+  on_scope_exit destroy_account_getter{[&] { DestroyDetached(std::move(account_getter)); }};
   // Can't use make_unique since Launcher's c'tor is private.
-  return std::move(
-      std::unique_ptr<Launcher>(new Launcher{keyword, pin, password, *account_getter}));
+  return std::move(std::unique_ptr<Launcher>(
+      new Launcher{keyword, pin, password, *account_getter, auto_start_options}));
 }
 
 std::unique_ptr<Launcher> Launcher::CreateAccount(Keyword keyword, Pin pin, Password password) {
@@ -166,11 +241,49 @@ DiskUsage Launcher::FakeStoreDiskUsage(const DiskUsage* const disk_usage) {
 
 void Launcher::LogoutAndStop() {
   SaveSession(true);
+  app_handler_.FlushConfig();
+  try {
+    launch_latencies_->Save();
+  } catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to save launch latencies: " << boost::diagnostic_information(e);
+  }
 #ifndef USE_FAKE_STORE
   network_client_->Stop();
 #endif
 }
 
+std::set<AppDetails> Launcher::GetApps(bool locally_available) const {
+  return app_handler_.GetApps(locally_available);
+}
+
+AppHandler::StatePtr Launcher::GetAppsState() const { return app_handler_.GetState(); }
+
+std::size_t Launcher::QueryApps(const AppQuery& query, const AppVisitor& visitor) const {
+  return app_handler_.Query(query, visitor);
+}
+
+std::vector<AppSearchResult> Launcher::SearchApps(const std::string& query,
+                                                  std::size_t max_results) const {
+  return app_handler_.Search(query, max_results);
+}
+
+std::vector<AppName> Launcher::AppsWithPath(const boost::filesystem::path& path) const {
+  return app_handler_.GetState()->indexes.AppsWithPath(path);
+}
+
+std::vector<AppName> Launcher::AppsWithDirectory(const Identity& directory_id) const {
+  return app_handler_.GetState()->indexes.AppsWithDirectory(directory_id);
+}
+
+AppEventSubscriptionId Launcher::SubscribeToAppEvents(AppEventHandler handler,
+                                                      std::uint64_t resume_after_sequence_number) {
+  return app_handler_.Subscribe(std::move(handler), resume_after_sequence_number);
+}
+
+void Launcher::UnsubscribeFromAppEvents(AppEventSubscriptionId subscription_id) {
+  app_handler_.Unsubscribe(subscription_id);
+}
+
 void Launcher::AddApp(AppName app_name, boost::filesystem::path app_path, AppArgs app_args,
                       SerialisedData app_icon, bool auto_start) {
   AddOrLinkApp(std::move(app_name), std::move(app_path), std::move(app_args), &app_icon,
@@ -184,185 +297,387 @@ void Launcher::LinkApp(AppName app_name, boost::filesystem::path app_path, AppAr
 
 void Launcher::AddOrLinkApp(AppName app_name, boost::filesystem::path app_path, AppArgs app_args,
                             const SerialisedData* const app_icon, bool auto_start) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  AppDetails app{app_handler_.AddOrLinkApp(std::move(app_name), std::move(app_path),
-                                           std::move(app_args), app_icon, auto_start)};
+  app_handler_.AddOrLinkApp(std::move(app_name), std::move(app_path), std::move(app_args), app_icon,
+                            auto_start, &undo_log_);
   if (app_icon) {  // we're adding the app
                    // TODO(Fraser#5#): 2015-01-23 - Add the app.dir to network_client_
   }
-  if (!rollback_snapshot_)
-    rollback_snapshot_ = snapshot;
-  strong_guarantee.Release();
 }
 
 void Launcher::UpdateAppName(const AppName& app_name, const AppName& new_name) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.UpdateName(app_name, new_name);
-  if (!rollback_snapshot_)
-    rollback_snapshot_ = snapshot;
-  strong_guarantee.Release();
+  UpdateApp<field::Name>(app_name, new_name);
 }
 
 void Launcher::UpdateAppPath(const AppName& app_name, const boost::filesystem::path& new_path) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.UpdatePath(app_name, new_path);
-  // No need to keep snapshot since app path isn't held in the account, so no need to rollback.
-  strong_guarantee.Release();
+  UpdateApp<field::Path>(app_name, new_path);
 }
 
 void Launcher::UpdateAppArgs(const AppName& app_name, const AppArgs& new_args) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.UpdateArgs(app_name, new_args);
-  // No need to keep snapshot since app args aren't held in the account, so no need to rollback.
-  strong_guarantee.Release();
+  UpdateApp<field::Args>(app_name, new_args);
 }
 
 void Launcher::UpdateAppSafeDriveAccess(const AppName& app_name,
                                         DirectoryInfo::AccessRights new_rights) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  // TODO(Fraser#5#): 2015-01-20 - Replace "SafeDrive" string with constant defined... where?
-  DirectoryInfo safe_dir("SafeDrive", Identity{}, Identity{}, new_rights);
-  {
-    std::lock_guard<std::mutex> lock{account_mutex_};
-    // TODO(Fraser#5#): 2015-01-20 - Confirm with Lee if these IDs should be used.
-    safe_dir.parent_id = Identity{account_handler_.account_->unique_user_id};
-    safe_dir.directory_id = account_handler_.account_->root_parent_id;
-  }
-  app_handler_.UpdatePermittedDirs(app_name, safe_dir);
-  if (!rollback_snapshot_)
-    rollback_snapshot_ = snapshot;
-  strong_guarantee.Release();
+  UpdateApp<field::PermittedDirs>(app_name, SafeDriveDir(new_rights));
 }
 
 void Launcher::UpdateAppIcon(const AppName& app_name, const SerialisedData& new_icon) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.UpdateIcon(app_name, new_icon);
-  if (!rollback_snapshot_)
-    rollback_snapshot_ = snapshot;
-  strong_guarantee.Release();
+  UpdateApp<field::Icon>(app_name, new_icon);
 }
 
 void Launcher::UpdateAppAutoStart(const AppName& app_name, bool new_auto_start_value) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.UpdateAutoStart(app_name, new_auto_start_value);
-  // No need to keep snapshot since auto_start isn't held in the account, so no need to rollback.
-  strong_guarantee.Release();
+  UpdateApp<field::AutoStart>(app_name, new_auto_start_value);
+}
+
+template <typename Field>
+void Launcher::UpdateApp(const AppName& app_name,
+                         const typename AppFieldTraits<Field>::UpdateType& new_value) {
+  app_handler_.Update<Field>(app_name, new_value, &undo_log_);
+}
+
+DirectoryInfo::AccessRights Launcher::AppAccessRights(const AppName& app_name,
+                                                     const boost::filesystem::path& path) const {
+  return app_handler_.GetState()->indexes.permissions().AccessRights(app_name, path);
+}
+
+void Launcher::RevokeDirectoryAccess(const boost::filesystem::path& directory) {
+  app_handler_.RevokeAccess(directory, &undo_log_);
 }
 
 void Launcher::RemoveAppLocally(const AppName& app_name) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.RemoveLocally(app_name);
-  // No need to keep snapshot since this only applies to apps in the local config file, so no need
-  // to rollback.
-  strong_guarantee.Release();
+  app_handler_.RemoveLocally(app_name, &undo_log_);
 }
 
 void Launcher::RemoveAppFromNetwork(const AppName& app_name) {
-  auto snapshot(app_handler_.GetSnapshot());
-  on_scope_exit strong_guarantee{[&] { RevertAppHandler(std::move(snapshot)); }};
-  app_handler_.RemoveFromNetwork(app_name);
-  if (!rollback_snapshot_)
-    rollback_snapshot_ = snapshot;
-  strong_guarantee.Release();
+  app_handler_.RemoveFromNetwork(app_name, &undo_log_);
+}
+
+Launcher::Batch Launcher::BeginBatch() { return Batch(*this); }
+
+void Launcher::CommitBatch(const std::vector<AppHandler::Operation>& operations) {
+  app_handler_.ApplyBatch(operations, &undo_log_);
+}
+
+DirectoryInfo Launcher::SafeDriveDir(DirectoryInfo::AccessRights rights) const {
+  // TODO(Fraser#5#): 2015-01-20 - Replace "SafeDrive" string with constant defined... where?
+  DirectoryInfo safe_dir("SafeDrive", Identity{}, Identity{}, rights);
+  std::lock_guard<std::mutex> lock{account_mutex_};
+  // TODO(Fraser#5#): 2015-01-20 - Confirm with Lee if these IDs should be used.
+  safe_dir.parent_id = Identity{account_handler_.account_->unique_user_id};
+  safe_dir.directory_id = account_handler_.account_->root_parent_id;
+  return safe_dir;
+}
+
+Launcher::Batch::Batch(Launcher& launcher)
+    : launcher_(launcher), operations_() {}
+
+Launcher::Batch::Batch(Batch&& other)
+    : launcher_(other.launcher_), operations_(std::move(other.operations_)) {}
+
+void Launcher::Batch::AddApp(AppName app_name, boost::filesystem::path app_path,
+                             AppArgs app_args, SerialisedData app_icon, bool auto_start) {
+  auto& operation(Queue(AppHandler::Operation::Type::kAdd, app_name));
+  operation.new_values.path = std::move(app_path);
+  operation.new_values.args = std::move(app_args);
+  operation.new_values.icon = std::move(app_icon);
+  operation.new_values.auto_start = auto_start;
+}
+
+void Launcher::Batch::LinkApp(AppName app_name, boost::filesystem::path app_path,
+                              AppArgs app_args, bool auto_start) {
+  auto& operation(Queue(AppHandler::Operation::Type::kLink, app_name));
+  operation.new_values.path = std::move(app_path);
+  operation.new_values.args = std::move(app_args);
+  operation.new_values.auto_start = auto_start;
+}
+
+void Launcher::Batch::UpdateAppName(const AppName& app_name, const AppName& new_name) {
+  Queue(AppHandler::Operation::Type::kUpdateName, app_name).new_values.name = new_name;
+}
+
+void Launcher::Batch::UpdateAppPath(const AppName& app_name,
+                                    const boost::filesystem::path& new_path) {
+  Queue(AppHandler::Operation::Type::kUpdatePath, app_name).new_values.path = new_path;
+}
+
+void Launcher::Batch::UpdateAppArgs(const AppName& app_name, const AppArgs& new_args) {
+  Queue(AppHandler::Operation::Type::kUpdateArgs, app_name).new_values.args = new_args;
+}
+
+void Launcher::Batch::UpdateAppSafeDriveAccess(const AppName& app_name,
+                                               DirectoryInfo::AccessRights new_rights) {
+  Queue(AppHandler::Operation::Type::kUpdatePermittedDirs, app_name)
+      .new_dir = launcher_.SafeDriveDir(new_rights);
+}
+
+void Launcher::Batch::UpdateAppIcon(const AppName& app_name, const SerialisedData& new_icon) {
+  Queue(AppHandler::Operation::Type::kUpdateIcon, app_name).new_values.icon = new_icon;
+}
+
+void Launcher::Batch::UpdateAppAutoStart(const AppName& app_name, bool new_auto_start_value) {
+  Queue(AppHandler::Operation::Type::kUpdateAutoStart, app_name)
+      .new_values.auto_start = new_auto_start_value;
+}
+
+void Launcher::Batch::RemoveAppLocally(const AppName& app_name) {
+  // This only applies to apps in the local config file.
+  Queue(AppHandler::Operation::Type::kRemoveLocally, app_name);
+}
+
+void Launcher::Batch::RemoveAppFromNetwork(const AppName& app_name) {
+  Queue(AppHandler::Operation::Type::kRemoveFromNetwork, app_name);
+}
+
+void Launcher::Batch::Commit() {
+  std::vector<AppHandler::Operation> operations;
+  operations.swap(operations_);
+  if (!operations.empty())
+    launcher_.CommitBatch(operations);
+}
+
+AppHandler::Operation& Launcher::Batch::Queue(AppHandler::Operation::Type type,
+                                              const AppName& app_name) {
+  operations_.emplace_back(type, app_name);
+  return operations_.back();
 }
 
-void Launcher::LaunchApp(const AppName& app_name) {
+void Launcher::LaunchApp(const AppName& app_name, HandshakeTransport transport,
+                         LaunchHandler on_complete) {
   auto path_and_args(app_handler_.GetPathAndArgs(app_name));
-  LaunchApp(app_name, path_and_args.first, std::move(path_and_args.second));
+  LaunchApp(app_name, path_and_args.first, std::move(path_and_args.second), transport, nullptr,
+            std::move(on_complete));
 }
 
-void Launcher::LaunchApp(const AppName& app_name, const boost::filesystem::path& /*path*/,
-                         AppArgs args) {
+void Launcher::LaunchApp(const AppName& app_name, const boost::filesystem::path& path,
+                         const AppArgs& args, HandshakeTransport transport,
+                         std::function<void()> on_settled, LaunchHandler on_complete) {
+  std::vector<std::string> argv(TokeniseArgs(args));
+
   // Set up struct to hold launch information
-  auto launch(std::make_shared<Launch>(app_name, asio_service_, connect_timeout_));
-
-  // Start listening
-  launch->listener = tcp::Listener::MakeShared(launch->strand, [=](tcp::ConnectionPtr connection) {
-    HandleNewConnection(launch, connection);
-  }, static_cast<tcp::Port>((RandomUint32() % 64512) + 1024));
-
-  // Set the steady_timer's timeout handler
-  launch->timer.async_wait([=](const asio::error_code& error) {
-    if (!error || error != asio::error::operation_aborted) {
-      LOG(kWarning) << "Error waiting for " << launch->name << " to connect: " << error.message();
-      asio::dispatch(launch->strand, [=] { HandleNewConnection(launch, nullptr); });
-    }
+  auto launch(std::make_shared<Launch>(app_name, asio_service_));
+  launch->on_settled = std::move(on_settled);
+  launch->on_complete = std::move(on_complete);
+
+  // Arm the connect timeout, derived from the app's previous launches
+  launch->timeouts = launch_latencies_->Timeouts(app_name);
+  launch->phase_start = std::chrono::steady_clock::now();
+  launch->timer = timer_wheel_->Arm(launch->timeouts.connect, [=] {
+    const auto count(launch_latencies_->TimedOut(launch->name, LaunchPhase::kConnect));
+    LOG(kWarning) << "Timed out waiting for " << launch->name << " to connect (" << count
+                  << " time" << (count == 1 ? "" : "s") << " this session).";
+    asio::dispatch(launch->strand, [=] { HandleNewConnection(launch, nullptr); });
   });
 
-  tcp::Port port(launch->listener->ListeningPort());
-  args += (" --launcher_port=" + std::to_string(port));
-  // TODO(Fraser#5#): 2015-01-29 - start process
+  // Set up the app's end of the handshake, falling back to TCP if there's no socket pair
+  LocalConnectionPtr app_end;
+  if (transport == HandshakeTransport::kSocketPair)
+    app_end = StartLocalConnection(launch);
+  if (app_end) {
+    argv.push_back("--launcher_fd=" + std::to_string(kInheritedFd));
+  } else {
+    std::vector<std::string> tcp_args(RegisterTcpLaunch(launch));
+    argv.insert(argv.end(), tcp_args.begin(), tcp_args.end());
+  }
+
+  try {
+    child_processes_.Spawn(path, argv, [=](int exit_code) { HandleExit(launch, exit_code); },
+                           app_end ? app_end->NativeHandle() : -1);
+  } catch (const std::exception&) {
+    asio::dispatch(launch->strand, [=] {
+      if (timer_wheel_->Cancel(launch->timer))
+        HandleNewConnection(launch, nullptr);
+    });
+    throw;
+  }
+  // The app has its own duplicate of its end, so ours is closed on leaving scope.
+}
+
+LocalConnectionPtr Launcher::StartLocalConnection(std::shared_ptr<Launch> launch) {
+  std::pair<LocalConnectionPtr, LocalConnectionPtr> ends;
+  try {
+    ends = LocalConnection::MakePair(launch->strand);
+  } catch (const std::exception& e) {
+    LOG(kWarning) << "Falling back to TCP to launch " << launch->name << ": "
+                  << boost::diagnostic_information(e);
+    return nullptr;
+  }
+  launch->local_connection = ends.first;
+  // The connection's handlers are already invoked on the launch's strand.
+  launch->local_connection->Start(
+      [=](tcp::Message message) { HandleLocalMessage(launch, std::move(message)); },
+      [=] { HandleConnectionClosed(launch); });
+  return ends.second;
+}
+
+std::vector<std::string> Launcher::RegisterTcpLaunch(std::shared_ptr<Launch> launch) {
+  // Register to be handed the app's connection once it presents the launch's token
+  launch->token = launch_listener_->Register(
+      [=](tcp::ConnectionPtr connection) {
+        asio::dispatch(launch->strand, [=] { HandleNewConnection(launch, connection); });
+      },
+      [=](tcp::Message message) {
+        asio::dispatch(launch->strand, [=] { HandleMessage(launch, std::move(message)); });
+      },
+      [=] { asio::dispatch(launch->strand, [=] { HandleConnectionClosed(launch); }); });
+  return {"--launcher_port=" + std::to_string(launch_listener_->ListeningPort()),
+          "--launch_token=" + launch->token};
+}
+
+void Launcher::HandleExit(std::shared_ptr<Launch> launch, int exit_code) {
+  asio::dispatch(launch->strand, [=] {
+    LOG(kInfo) << launch->name << " exited with code " << exit_code << '.';
+    // Once a transport is attached, whatever the app sent before exiting may not have been read
+    // yet, so its closing or the connect timeout decides the launch.
+    if (launch->connected || launch->local_connection || !launch->token.empty())
+      return;
+    if (timer_wheel_->Cancel(launch->timer))
+      HandleNewConnection(launch, nullptr);
+  });
 }
 
 void Launcher::SaveSession(bool force) {
   std::lock_guard<std::mutex> lock{account_mutex_};
-  if (!force && !rollback_snapshot_)
-    return;
-  account_handler_.Save(*network_client_);
-  rollback_snapshot_ = boost::none;
+  const bool account_modified(std::any_of(
+      std::begin(undo_log_), std::end(undo_log_),
+      [](const AppHandler::Operation& inverse) { return inverse.ModifiesAccount(); }));
+  if (force || account_modified)
+    account_handler_.Save(*network_client_);
+  undo_log_.clear();
 }
 
+void Launcher::FlushConfig() { app_handler_.FlushConfig(); }
+
 void Launcher::RevertToLastSavedSession() {
-  std::lock_guard<std::mutex> lock{account_mutex_};
-  if (!rollback_snapshot_)
+  // The log is taken under 'account_mutex_', but must be applied without it, since 'app_handler_'
+  // acquires it too.
+  AppHandler::UndoLog undo_log;
+  {
+    std::lock_guard<std::mutex> lock{account_mutex_};
+    undo_log.swap(undo_log_);
+  }
+  if (undo_log.empty())
     return;
-  RevertAppHandler(*rollback_snapshot_);
-  rollback_snapshot_ = boost::none;
-}
-
-void Launcher::RevertAppHandler(AppHandler::Snapshot snapshot) {
+  // The inverses are applied as a single batch, newest first.
+  const AppHandler::UndoLog inverses(undo_log.rbegin(), undo_log.rend());
   try {
-    app_handler_.ApplySnapshot(std::move(snapshot));
+    app_handler_.ApplyBatch(inverses);
   } catch (const common_error&) {
-    LOG(kError) << "Failed to revert operation.";
+    // Nothing was reverted, so the entries go back ahead of any logged since they were taken.
+    {
+      std::lock_guard<std::mutex> lock{account_mutex_};
+      undo_log_.insert(std::begin(undo_log_), std::begin(undo_log), std::end(undo_log));
+    }
+    LOG(kError) << "Failed to revert to last saved session.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
   }
 }
 
+NetworkMetrics Launcher::GetNetworkMetrics() const {
+  std::lock_guard<std::mutex> lock{account_mutex_};
+  return account_handler_.GetNetworkMetrics();
+}
+
 void Launcher::HandleNewConnection(std::shared_ptr<Launch> launch, tcp::ConnectionPtr connection) {
   assert(launch->strand.running_in_this_thread());
 
-  launch->listener->StopListening();
-  launch->listener.reset();
-
-  if (!connection)  // We've timed out or run into some other error.
+  if (!connection) {  // We've timed out or run into some other error.
+    if (!launch->token.empty())
+      launch_listener_->Unregister(launch->token);
+    CloseConnection(launch);
+    Settle(*launch);
+    Complete(*launch, false);
     return;
+  }
 
-  // Try to reset the timer's timeout deadline
-  asio::error_code error;
-  if (launch->timer.expires_from_now(handshake_timeout_, error) <= 0 || error)  // Failed to cancel
+  if (!StartHandshake(launch))
     return;
 
-  launch->timer.async_wait([=](const asio::error_code& error) {
-    if (!error || error != asio::error::operation_aborted) {
-      LOG(kWarning) << "Error waiting for " << launch->name << " to handshake: " << error.message();
-      asio::dispatch(launch->strand, [=] { connection->Close(); });
-    }
-  });
-
+  // The launch listener has already started the connection, and forwards its messages.
   launch->connection = connection;
-  connection->Start([=](tcp::Message message) { HandleMessage(launch, std::move(message)); },
-                    [=] { launch->timer.cancel(); });
+}
 
+void Launcher::HandleLocalMessage(std::shared_ptr<Launch> launch, tcp::Message message) {
+  assert(launch->strand.running_in_this_thread());
+  // Over a socket pair, the app's first message stands in for its connection.
+  if (!launch->connected && !StartHandshake(launch))
+    return;
+  HandleMessage(launch, std::move(message));
+}
 
+bool Launcher::StartHandshake(std::shared_ptr<Launch> launch) {
+  assert(launch->strand.running_in_this_thread());
+  // Replace the connect timeout with the handshake one, unless it has already expired
+  if (!timer_wheel_->Cancel(launch->timer))
+    return false;
+  const auto now(std::chrono::steady_clock::now());
+  launch_latencies_->Add(launch->name, LaunchPhase::kConnect, now - launch->phase_start);
+  launch->phase_start = now;
+  launch->connected = true;
+  Settle(*launch);
+
+  launch->timer = timer_wheel_->Arm(launch->timeouts.handshake, [=] {
+    const auto count(launch_latencies_->TimedOut(launch->name, LaunchPhase::kHandshake));
+    LOG(kWarning) << "Timed out waiting for " << launch->name << " to handshake (" << count
+                  << " time" << (count == 1 ? "" : "s") << " this session).";
+    asio::dispatch(launch->strand, [=] {
+      CloseConnection(launch);
+      Complete(*launch, false);
+    });
+  });
+  return true;
+}
+
+void Launcher::HandleConnectionClosed(std::shared_ptr<Launch> launch) {
+  assert(launch->strand.running_in_this_thread());
+  // Closing before connecting fails the launch, unless the connect timeout already has.
+  const bool in_time(timer_wheel_->Cancel(launch->timer));
+  if (!launch->connected) {
+    if (in_time)
+      HandleNewConnection(launch, nullptr);
+    return;
+  }
+  // Closing before confirming the handshake fails the launch, unless it has already been decided.
+  if (in_time)
+    Complete(*launch, false);
+}
 
-  // receive the app's session key
-  // send it the directory list
-  // wait for connection to drop or timeout
-  // orphan child
+void Launcher::CloseConnection(std::shared_ptr<Launch> launch) {
+  assert(launch->strand.running_in_this_thread());
+  if (launch->connection)
+    launch->connection->Close();
+  if (launch->local_connection)
+    launch->local_connection->Close();
 }
 
-void Launcher::HandleMessage(std::shared_ptr<Launch> launch, tcp::Message /*message*/) {
+void Launcher::HandleMessage(std::shared_ptr<Launch> launch, tcp::Message message) {
   assert(launch->strand.running_in_this_thread());
-  static_cast<void>(launch);
+  if (launch->finished)
+    return;
+
+  // The app's first message must be its session key.
+  if (launch->session_key.empty()) {
+    if (message.size() != kSessionKeySize) {
+      LOG(kWarning) << launch->name << " sent a session key of " << message.size()
+                    << " bytes rather than " << kSessionKeySize << '.';
+      if (timer_wheel_->Cancel(launch->timer)) {
+        CloseConnection(launch);
+        Complete(*launch, false);
+      }
+      return;
+    }
+    launch->session_key = std::move(message);
+    // TODO(Team) - Send the app its directory list, and only then accept its confirmation.
+    return;
+  }
+
+  // Its next message confirms the handshake, after which the app no longer needs the Launcher.
+  // Only such validated handshakes are sampled.
+  if (!timer_wheel_->Cancel(launch->timer))
+    return;
+  launch_latencies_->Add(launch->name, LaunchPhase::kHandshake,
+                         std::chrono::steady_clock::now() - launch->phase_start);
+  CloseConnection(launch);
+  Complete(*launch, true);
 }
 
 }  // namespace launcher
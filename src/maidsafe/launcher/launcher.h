@@ -20,23 +20,35 @@
 #define MAIDSAFE_LAUNCHER_LAUNCHER_H_
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "boost/filesystem/path.hpp"
-#include "boost/optional.hpp"
 
 #include "maidsafe/directory_info.h"
 #include "maidsafe/common/asio_service.h"
-#include "maidsafe/common/on_scope_exit.h"
 #include "maidsafe/common/tcp/connection.h"
 #include "maidsafe/passport/passport.h"
 
 #include "maidsafe/launcher/account_handler.h"
 #include "maidsafe/launcher/app_handler.h"
 #include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/app_events.h"
+#include "maidsafe/launcher/app_field_traits.h"
+#include "maidsafe/launcher/app_query.h"
+#include "maidsafe/launcher/app_search_index.h"
+#include "maidsafe/launcher/child_processes.h"
+#include "maidsafe/launcher/launch_latencies.h"
+#include "maidsafe/launcher/launch_listener.h"
+#include "maidsafe/launcher/launch_scheduler.h"
+#include "maidsafe/launcher/local_connection.h"
+#include "maidsafe/launcher/timer_wheel.h"
 #include "maidsafe/launcher/types.h"
 
 namespace maidsafe {
@@ -57,13 +69,54 @@ struct Launch;
 // A non-local app can be added locally by calling 'LinkApp', not 'AddApp'.
 class Launcher {
  public:
+  // Collects app operations to be applied together as a single transaction by 'Commit'.  Each
+  // function queues the operation of the same name on the Launcher; nothing is validated or
+  // applied until 'Commit' is called.  The Launcher must outlive the Batch.  Not threadsafe.
+  class Batch {
+   public:
+    Batch(const Batch&) = delete;
+    Batch(Batch&& other);
+    Batch& operator=(const Batch&) = delete;
+    Batch& operator=(Batch&&) = delete;
+
+    void AddApp(AppName app_name, boost::filesystem::path app_path, AppArgs app_args,
+                SerialisedData app_icon, bool auto_start);
+    void LinkApp(AppName app_name, boost::filesystem::path app_path, AppArgs app_args,
+                 bool auto_start);
+    void UpdateAppName(const AppName& app_name, const AppName& new_name);
+    void UpdateAppPath(const AppName& app_name, const boost::filesystem::path& new_path);
+    void UpdateAppArgs(const AppName& app_name, const AppArgs& new_args);
+    void UpdateAppSafeDriveAccess(const AppName& app_name, DirectoryInfo::AccessRights new_rights);
+    void UpdateAppIcon(const AppName& app_name, const SerialisedData& new_icon);
+    void UpdateAppAutoStart(const AppName& app_name, bool new_auto_start_value);
+    void RemoveAppLocally(const AppName& app_name);
+    void RemoveAppFromNetwork(const AppName& app_name);
+
+    // Validates and applies the queued operations in order under a single lock acquisition, and
+    // writes the config file once.  If any operation fails, none of them are applied.  The Batch
+    // is emptied by this call, whether or not it succeeds.
+    void Commit();
+
+   private:
+    friend class Launcher;
+    explicit Batch(Launcher& launcher);
+    AppHandler::Operation& Queue(AppHandler::Operation::Type type, const AppName& app_name);
+
+    Launcher& launcher_;
+    std::vector<AppHandler::Operation> operations_;
+  };
+
+  ~Launcher();
   Launcher(const Launcher&) = delete;
   Launcher(Launcher&&) = delete;
   Launcher& operator=(const Launcher&) = delete;
   Launcher& operator=(Launcher&&) = delete;
 
   // Retrieves and decrypts account info and starts a new session by logging into the network.
-  static std::unique_ptr<Launcher> Login(Keyword keyword, Pin pin, Password password);
+  // Returns as soon as the account is decrypted; apps with auto_start set are then launched in the
+  // background as directed by 'auto_start_options'.
+  static std::unique_ptr<Launcher> Login(Keyword keyword, Pin pin, Password password,
+                                         AutoStartOptions auto_start_options = AutoStartOptions());
 
   // This function should be used when creating a new account, i.e. where an account has never
   // been put to the network.  Creates a new account, encrypts it and puts it to the network.
@@ -77,6 +130,34 @@ class Launcher {
   // non-locally-available ones depending on the value of 'locally_available'.
   std::set<AppDetails> GetApps(bool locally_available) const;
 
+  // Returns an immutable view of both sets of apps as at the most recent change.  Unlike 'GetApps',
+  // this doesn't block on, or contend with, any concurrent changes and doesn't copy any apps, so
+  // is suitable for frequent polling.  The view is unaffected by subsequent changes.
+  AppHandler::StatePtr GetAppsState() const;
+
+  // Visits the apps matching 'query', projected onto only the fields it requests, without copying
+  // any of them.  Returns the number of apps visited.  See AppQuery for details.
+  std::size_t QueryApps(const AppQuery& query, const AppVisitor& visitor) const;
+
+  // Returns up to 'max_results' apps whose names match 'query' case-insensitively, best first:
+  // exact matches, then prefix, substring and fuzzy (in-order subsequence) ones.  Intended to be
+  // called on every keystroke of an incremental search.
+  std::vector<AppSearchResult> SearchApps(const std::string& query, std::size_t max_results) const;
+
+  // Return the names of the local apps whose executable is at 'path', and of the apps which have
+  // been permitted access to the directory identified by 'directory_id'.  Both are index lookups.
+  std::vector<AppName> AppsWithPath(const boost::filesystem::path& path) const;
+  std::vector<AppName> AppsWithDirectory(const Identity& directory_id) const;
+
+  // Subscribes 'handler' to the changes made to the apps, delivered as ordered AppEventBatches
+  // (one per transaction), rather than having to re-fetch the apps via 'GetApps'.  To resume from a
+  // known point, pass the sequence number of the last batch handled, or that of the AppsState
+  // which the subscriber last fetched.  See AppHandler::Subscribe for details.
+  AppEventSubscriptionId SubscribeToAppEvents(
+      AppEventHandler handler,
+      std::uint64_t resume_after_sequence_number = AppHandler::kLatestSequenceNumber);
+  void UnsubscribeFromAppEvents(AppEventSubscriptionId subscription_id);
+
   // Adds an instance of 'app_name' to the set of local apps.  Throws if the app has already been
   // added locally or non-locally.  (To add an app which has previously been added non-locally, use
   // the 'LinkApp' function.)
@@ -98,6 +179,15 @@ class Launcher {
   void UpdateAppIcon(const AppName& app_name, const SerialisedData& new_icon);
   void UpdateAppAutoStart(const AppName& app_name, bool new_auto_start_value);
 
+  // Returns the rights which 'app_name' has to 'path', i.e. those of the nearest directory at or
+  // above 'path' among the app's permitted directories, or kNone.  O(path length).
+  DirectoryInfo::AccessRights AppAccessRights(const AppName& app_name,
+                                              const boost::filesystem::path& path) const;
+
+  // Revokes all apps' access to 'directory' and to every directory below it which they have been
+  // permitted.  Access granted via a directory above 'directory' isn't affected.
+  void RevokeDirectoryAccess(const boost::filesystem::path& directory);
+
   // Removes an instance of the app indicated by 'app_name' from the set of locally-available apps.
   // Throws if the app isn't in the set.
   void RemoveAppLocally(const AppName& app_name);
@@ -106,34 +196,72 @@ class Launcher {
   // apps.  Throws if the app isn't in the set.
   void RemoveAppFromNetwork(const AppName& app_name);
 
+  // Returns an empty Batch, allowing any number of the above app operations to be applied as a
+  // single transaction.  This is much cheaper than calling the individual functions when making
+  // many changes, since the config file is only written once.
+  Batch BeginBatch();
+
   // Save the account to the network.  If 'force' is false, the account is only saved if there are
   // unsaved changes in the account (e.g. if AddApp has been called).  If 'force' is true, the
   // account is saved unconditionally.  If the functions throws an exception indicating a temporary
   // problem, it is safe to retry SaveSession, otherwise the user probably needs to take action.
   void SaveSession(bool force = false);
 
+  // Changes to the locally-available apps are written to the local config file in the background.
+  // This blocks until all changes made so far have been written, and throws if any couldn't be.
+  void FlushConfig();
+
   // Reverts the internal state back to the last successful 'SaveSession' call, or the initial state
-  // if there have been no 'SaveSession' calls.
+  // if there have been no 'SaveSession' calls.  Every change made since then is undone, including
+  // changes to the locally-available apps which didn't modify the account.
   void RevertToLastSavedSession();
 
+  // Returns counts of the network attempts, retries and hedged reads made while logging in and
+  // saving the session.
+  NetworkMetrics GetNetworkMetrics() const;
+
   // Launches a new instance of the app indicated by 'app_name' as a detached child.
   //
-  // The app will be passed the Launcher's TCP listening port in a command line argument
-  // "--launcher_port=X" where X will be a random port between 1025 and 65535 inclusive.  The app
-  // must then establish a TCP connection to the launcher on the loopback address at this port
-  // within the 'connect_timeout_' duration or the launch attempt fails.
+  // The app's args are split into separate arguments as described for 'TokeniseArgs'.  How the app
+  // connects to the Launcher depends on 'transport':
+  //
+  // With kSocketPair (the default), the app inherits an already connected Unix domain socket as
+  // descriptor 3, and is passed a final command line argument "--launcher_fd=3".  Its first message
+  // on this socket must be sent within the 'connect_timeout_' duration or the launch attempt fails.
+  // If a socket pair can't be created (e.g. on Windows), the launch falls back to TCP.
+  //
+  // With kTcp, the app is passed two final command line arguments: "--launcher_port=X" where X is
+  // the port of the Launcher's TCP listener (shared by all launches), and "--launch_token=Y" where
+  // Y is a random token identifying this launch.  The app must then establish a TCP connection to
+  // the launcher on the loopback address at this port within the 'connect_timeout_' duration, and
+  // send Y as its first message within the 'handshake_timeout_' duration, or the launch fails.
   //
-  // Once the connection is established, the app should immediately pass through its session public
-  // key and wait for the Launcher to reply with the set of NFS directories to which it has access.
-  // The app should then reply to confirm receipt, at which time the connection is closed and the
-  // app is orphaned so that it no longer depends on the Launcher running.
+  // Messages on either transport are framed identically.  Once connected, the app should
+  // immediately pass through its session public key and wait for the Launcher to reply with the
+  // set of NFS directories to which it has access.  The app should then reply to confirm receipt,
+  // at which time the connection is closed and the app is orphaned so that it no longer depends on
+  // the Launcher running.  The launch fails at once if the session key isn't 'kSessionKeySize'
+  // bytes, or the connection closes before the app confirms.  (The directory list isn't yet sent,
+  // so the app's next message after its session key is taken as its confirmation.)
   //
   // The time from the connection being established until the Launcher receives the final
   // confirmation from the app must be within the 'handshake_timeout_' duration or the launch fails.
   //
+  // 'connect_timeout_' and 'handshake_timeout_' only apply to an app's first few launches.  The
+  // latencies of its connects which completed in time, and of handshakes it completed validly, are
+  // recorded (and saved locally on logging out), and once enough have been observed, each timeout
+  // becomes a multiple of the app's 99th percentile latency for that phase, bounded so that a stuck
+  // app fails within seconds while a slow one is given up to a few minutes.  Phases which time out
+  // aren't recorded, so never raise the timeout.
+  //
+  // 'on_complete', if non-null, is invoked on one of the Launcher's threads once the launch has
+  // finished.
+  //
   // For apps, there is a blocking function to handle this entire process in the API project named
   // 'RegisterAppSession'.
-  void LaunchApp(const AppName& app_name);
+  void LaunchApp(const AppName& app_name,
+                 HandshakeTransport transport = HandshakeTransport::kSocketPair,
+                 LaunchHandler on_complete = nullptr);
 
   static const std::chrono::steady_clock::duration connect_timeout_;
   static const std::chrono::steady_clock::duration handshake_timeout_;
@@ -146,28 +274,78 @@ class Launcher {
 
  private:
   // For already existing accounts.
-  Launcher(Keyword keyword, Pin pin, Password password, AccountGetter& account_getter);
+  Launcher(Keyword keyword, Pin pin, Password password, AccountGetter& account_getter,
+           const AutoStartOptions& auto_start_options);
 
   // For new accounts.  Throws on failure to create account.
   Launcher(Keyword keyword, Pin pin, Password password, passport::MaidAndSigner&& maid_and_signer);
 
+  void InitialiseLaunchLatencies();
+
   void AddOrLinkApp(AppName app_name, boost::filesystem::path app_path, AppArgs app_args,
                     const SerialisedData* const app_icon, bool auto_start);
 
-  void RevertAppHandler(AppHandler::Snapshot snapshot);
+  template <typename Field>
+  void UpdateApp(const AppName& app_name,
+                 const typename AppFieldTraits<Field>::UpdateType& new_value);
+
+  DirectoryInfo SafeDriveDir(DirectoryInfo::AccessRights rights) const;
+
+  void CommitBatch(const std::vector<AppHandler::Operation>& operations);
+
+  // 'on_settled', if non-null, is invoked once the app has connected or the launch has failed.
+  void LaunchApp(const AppName& app_name, const boost::filesystem::path& path,
+                 const AppArgs& args, HandshakeTransport transport,
+                 std::function<void()> on_settled = nullptr, LaunchHandler on_complete = nullptr);
+
+  // Starts the launch's end of a socket pair, and returns the app's end.  Returns null if a socket
+  // pair can't be created.
+  LocalConnectionPtr StartLocalConnection(std::shared_ptr<Launch> launch);
 
-  void LaunchApp(const AppName& app_name, const boost::filesystem::path& path, AppArgs args);
+  // Registers the launch with the shared TCP listener, and returns the app's extra arguments.
+  std::vector<std::string> RegisterTcpLaunch(std::shared_ptr<Launch> launch);
+
+  // Fails the launch if the app exited with no transport attached.  Otherwise the connection
+  // closing or the connect timeout decides it, so that nothing the app sent before exiting is
+  // missed.
+  void HandleExit(std::shared_ptr<Launch> launch, int exit_code);
 
   void HandleNewConnection(std::shared_ptr<Launch> launch, tcp::ConnectionPtr connection);
 
+  void HandleLocalMessage(std::shared_ptr<Launch> launch, tcp::Message message);
+
+  // Moves the launch from waiting for the app to connect to waiting for it to handshake.  Returns
+  // false if the launch has already timed out.
+  bool StartHandshake(std::shared_ptr<Launch> launch);
+
+  // Fails the launch unless it has already finished.
+  void HandleConnectionClosed(std::shared_ptr<Launch> launch);
+
+  void CloseConnection(std::shared_ptr<Launch> launch);
+
+  // Fails the launch at once if the app's first message isn't a session key of kSessionKeySize
+  // bytes, and completes it on the next.
   void HandleMessage(std::shared_ptr<Launch> launch, tcp::Message message);
 
+  // Stopped first on destruction, since handlers run on it use the members below.
   AsioService asio_service_;
+  // Must be destroyed before 'asio_service_'.
+  ChildProcesses child_processes_;
+  std::shared_ptr<LaunchListener> launch_listener_;
+  // Holds every launch's connect or handshake deadline.
+  std::shared_ptr<TimerWheel> timer_wheel_;
   std::shared_ptr<NetworkClient> network_client_;
   AccountHandler account_handler_;
   mutable std::mutex account_mutex_;
   AppHandler app_handler_;
-  boost::optional<AppHandler::Snapshot> rollback_snapshot_;
+  // The inverses of every operation applied since the last 'SaveSession' call, oldest first,
+  // whether or not it modified the account.  Only accessed under 'account_mutex_': 'app_handler_'
+  // appends to it while holding that lock.
+  AppHandler::UndoLog undo_log_;
+  // Each app's observed connect and handshake latencies, from which its timeouts are derived.
+  std::unique_ptr<LaunchLatencies> launch_latencies_;
+  // Null unless logged in to an existing account.  Stopped on destruction.
+  std::shared_ptr<LaunchScheduler> auto_start_scheduler_;
 };
 
 }  // namespace launcher
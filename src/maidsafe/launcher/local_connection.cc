@@ -0,0 +1,243 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/local_connection.h"
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "asio/buffer.hpp"
+#include "asio/dispatch.hpp"
+#include "asio/read.hpp"
+#include "asio/write.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+#ifdef MAIDSAFE_WIN32
+
+std::pair<LocalConnectionPtr, LocalConnectionPtr> LocalConnection::MakePair(
+    asio::io_service::strand& /*strand*/) {
+  LOG(kError) << "Socket pairs aren't yet supported on Windows.";
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+}
+
+LocalConnectionPtr LocalConnection::MakeShared(asio::io_service::strand& /*strand*/,
+                                               int /*native_handle*/) {
+  LOG(kError) << "Socket pairs aren't yet supported on Windows.";
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+}
+
+LocalConnection::LocalConnection(asio::io_service::strand& /*strand*/) {}
+
+LocalConnection::~LocalConnection() {}
+
+void LocalConnection::Start(tcp::MessageReceivedFunctor /*on_message_received*/,
+                            tcp::ConnectionClosedFunctor /*on_connection_closed*/) {}
+
+void LocalConnection::Send(tcp::Message /*message*/) {}
+
+void LocalConnection::Close() {}
+
+int LocalConnection::NativeHandle() { return -1; }
+
+#else
+
+namespace {
+
+// Creates a close-on-exec socket pair.  Where SOCK_CLOEXEC is available the flag is set atomically,
+// so that a child spawned concurrently on another thread can't inherit either end.
+void CreateSocketPair(int (&fds)[2]) {
+#ifdef SOCK_CLOEXEC
+  const int result(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds));
+#else
+  int result(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  if (result == 0 && (fcntl(fds[0], F_SETFD, FD_CLOEXEC) == -1 ||
+                      fcntl(fds[1], F_SETFD, FD_CLOEXEC) == -1)) {
+    const int fcntl_error(errno);
+    close(fds[0]);
+    close(fds[1]);
+    errno = fcntl_error;
+    result = -1;
+  }
+#endif
+  if (result != 0) {
+    LOG(kError) << "Failed to create socket pair: "
+                << std::error_code(errno, std::system_category()).message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+}
+
+}  // unnamed namespace
+
+std::pair<LocalConnectionPtr, LocalConnectionPtr> LocalConnection::MakePair(
+    asio::io_service::strand& strand) {
+  int fds[2];
+  CreateSocketPair(fds);
+  LocalConnectionPtr first, second;
+  try {
+    first = MakeShared(strand, fds[0]);
+  } catch (const std::exception&) {
+    close(fds[1]);
+    throw;
+  }
+  second = MakeShared(strand, fds[1]);
+  return std::make_pair(std::move(first), std::move(second));
+}
+
+LocalConnectionPtr LocalConnection::MakeShared(asio::io_service::strand& strand,
+                                               int native_handle) {
+  LocalConnectionPtr connection(new LocalConnection(strand));
+  asio::error_code error;
+  connection->socket_.assign(asio::local::stream_protocol(), native_handle, error);
+  if (error) {
+    close(native_handle);
+    LOG(kError) << "Failed to adopt socket " << native_handle << ": " << error.message();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+  }
+  return connection;
+}
+
+LocalConnection::LocalConnection(asio::io_service::strand& strand)
+    : strand_(strand),
+      socket_(strand.get_io_service()),
+      on_message_received_(),
+      on_connection_closed_(),
+      receive_size_(),
+      receive_buffer_(),
+      send_queue_(),
+      send_size_() {}
+
+LocalConnection::~LocalConnection() {
+  asio::error_code ignored_error;
+  socket_.close(ignored_error);
+}
+
+void LocalConnection::Start(tcp::MessageReceivedFunctor on_message_received,
+                            tcp::ConnectionClosedFunctor on_connection_closed) {
+  auto self(shared_from_this());
+  asio::dispatch(strand_, [=] {
+    self->on_message_received_ = on_message_received;
+    self->on_connection_closed_ = on_connection_closed;
+    self->ReadSize();
+  });
+}
+
+void LocalConnection::Send(tcp::Message message) {
+  if (message.size() > kMaxMessageSize) {
+    LOG(kError) << "Message of " << message.size() << " bytes exceeds the maximum size.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+  auto self(shared_from_this());
+  auto data(std::make_shared<tcp::Message>(std::move(message)));
+  asio::dispatch(strand_, [self, data] {
+    if (!self->socket_.is_open())
+      return;
+    self->send_queue_.push_back(std::move(*data));
+    if (self->send_queue_.size() == 1)
+      self->DoSend();
+  });
+}
+
+void LocalConnection::Close() {
+  auto self(shared_from_this());
+  asio::dispatch(strand_, [self] { self->DoClose(); });
+}
+
+int LocalConnection::NativeHandle() { return socket_.native_handle(); }
+
+void LocalConnection::ReadSize() {
+  auto self(shared_from_this());
+  asio::async_read(socket_, asio::buffer(receive_size_),
+                   strand_.wrap([self](const asio::error_code& error, std::size_t) {
+                     if (error)
+                       return self->DoClose();
+                     std::uint32_t size(0);
+                     for (unsigned char byte : self->receive_size_)
+                       size = (size << 8) | byte;
+                     if (size > kMaxMessageSize) {
+                       LOG(kError) << "Incoming message of " << size
+                                   << " bytes exceeds the maximum size.";
+                       return self->DoClose();
+                     }
+                     self->receive_buffer_.resize(size);
+                     self->ReadData();
+                   }));
+}
+
+void LocalConnection::ReadData() {
+  auto self(shared_from_this());
+  asio::async_read(socket_, asio::buffer(receive_buffer_),
+                   strand_.wrap([self](const asio::error_code& error, std::size_t) {
+                     if (error)
+                       return self->DoClose();
+                     if (self->on_message_received_)
+                       self->on_message_received_(std::move(self->receive_buffer_));
+                     self->receive_buffer_.clear();
+                     if (self->socket_.is_open())
+                       self->ReadSize();
+                   }));
+}
+
+void LocalConnection::DoSend() {
+  const std::uint32_t size(static_cast<std::uint32_t>(send_queue_.front().size()));
+  for (std::size_t i(0); i < send_size_.size(); ++i)
+    send_size_[i] = static_cast<unsigned char>(size >> (8 * (send_size_.size() - 1 - i)));
+  const std::array<asio::const_buffer, 2> buffers{
+      {asio::buffer(send_size_), asio::buffer(send_queue_.front())}};
+  auto self(shared_from_this());
+  asio::async_write(socket_, buffers,
+                    strand_.wrap([self](const asio::error_code& error, std::size_t) {
+                      if (error) {
+                        self->send_queue_.clear();
+                        return self->DoClose();
+                      }
+                      self->send_queue_.pop_front();
+                      if (!self->send_queue_.empty() && self->socket_.is_open())
+                        self->DoSend();
+                    }));
+}
+
+void LocalConnection::DoClose() {
+  asio::error_code ignored_error;
+  // Any outstanding write still refers to the front of the send queue, which is cleared once it's
+  // been aborted.
+  socket_.close(ignored_error);
+  on_message_received_ = nullptr;
+  tcp::ConnectionClosedFunctor on_connection_closed;
+  std::swap(on_connection_closed, on_connection_closed_);
+  if (on_connection_closed)
+    on_connection_closed();
+}
+
+#endif
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,97 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_LOCAL_CONNECTION_H_
+#define MAIDSAFE_LAUNCHER_LOCAL_CONNECTION_H_
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include "asio/io_service_strand.hpp"
+#ifndef MAIDSAFE_WIN32
+#include "asio/local/stream_protocol.hpp"
+#endif
+
+#include "maidsafe/common/tcp/connection.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+class LocalConnection;
+using LocalConnectionPtr = std::shared_ptr<LocalConnection>;
+
+// One end of a pre-connected Unix domain socket pair, used for the launch handshake in place of a
+// TCP connection.  Since the pair is created by the launcher and one end is inherited by the app,
+// there's no listening, accepting or connecting, and no other local process can intercept it.
+//
+// The interface mirrors tcp::Connection: messages are framed with a 4-byte big-endian length, and
+// handlers are invoked on the strand passed on construction.  Socket pairs aren't yet supported
+// on Windows, where the factory functions throw.
+class LocalConnection : public std::enable_shared_from_this<LocalConnection> {
+ public:
+  static const std::uint32_t kMaxMessageSize = 1024 * 1024;
+
+  // Returns a connected pair.  The second end is meant to be inherited by a child: pass its
+  // NativeHandle() to ChildProcesses::Spawn, then destroy it.  Both ends are close-on-exec, so
+  // neither is leaked to other children.
+  static std::pair<LocalConnectionPtr, LocalConnectionPtr> MakePair(
+      asio::io_service::strand& strand);
+  // Takes ownership of 'native_handle', an already connected socket, e.g. one inherited by an app.
+  static LocalConnectionPtr MakeShared(asio::io_service::strand& strand, int native_handle);
+  ~LocalConnection();
+
+  LocalConnection(const LocalConnection&) = delete;
+  LocalConnection(LocalConnection&&) = delete;
+  LocalConnection& operator=(const LocalConnection&) = delete;
+  LocalConnection& operator=(LocalConnection&&) = delete;
+
+  // Starts reading.  'on_closed' is invoked once, when either end closes or on any error.
+  void Start(tcp::MessageReceivedFunctor on_message_received,
+             tcp::ConnectionClosedFunctor on_connection_closed);
+  void Send(tcp::Message message);
+  void Close();
+  int NativeHandle();
+
+ private:
+  explicit LocalConnection(asio::io_service::strand& strand);
+#ifndef MAIDSAFE_WIN32
+  void ReadSize();
+  void ReadData();
+  void DoSend();
+  void DoClose();
+
+  asio::io_service::strand& strand_;
+  asio::local::stream_protocol::socket socket_;
+  tcp::MessageReceivedFunctor on_message_received_;
+  tcp::ConnectionClosedFunctor on_connection_closed_;
+  std::array<unsigned char, 4> receive_size_;
+  tcp::Message receive_buffer_;
+  std::deque<tcp::Message> send_queue_;
+  std::array<unsigned char, 4> send_size_;
+#endif
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_LOCAL_CONNECTION_H_
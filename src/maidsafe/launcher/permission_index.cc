@@ -0,0 +1,197 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/permission_index.h"
+
+#include <algorithm>
+#include <set>
+
+#include "maidsafe/launcher/app_indexes.h"
+#include "maidsafe/launcher/persistent_set.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+std::vector<std::string> PathElements(const fs::path& path) {
+  std::vector<std::string> elements;
+  for (const auto& element : fs::path(CanonicalAppPath(path)))
+    elements.push_back(element.string());
+  return elements;
+}
+
+}  // unnamed namespace
+
+struct PermissionIndex::Node {
+  struct Child {
+    std::string element;
+    NodePtr node;
+  };
+
+  struct ChildLess {
+    bool operator()(const Child& lhs, const Child& rhs) const { return lhs.element < rhs.element; }
+  };
+
+  // All of one app's grants of this node's directory.  There is normally only one, but nothing
+  // prevents an app holding several DirectoryInfos with the same path.
+  struct AppGrants {
+    AppName app_name;
+    std::set<DirectoryInfo> dirs;
+  };
+
+  struct AppGrantsLess {
+    bool operator()(const AppGrants& lhs, const AppGrants& rhs) const {
+      return lhs.app_name < rhs.app_name;
+    }
+  };
+
+  Node();
+
+  PersistentSet<Child, ChildLess> children;
+  PersistentSet<AppGrants, AppGrantsLess> grants;
+};
+
+PermissionIndex::Node::Node() : children(), grants() {}
+
+PermissionIndex::PermissionIndex() : root_() {}
+
+void PermissionIndex::Add(const AppName& app_name, const DirectoryInfo& dir) {
+  root_ = Add(root_, PathElements(dir.path), 0, app_name, dir);
+}
+
+void PermissionIndex::Remove(const AppName& app_name, const DirectoryInfo& dir) {
+  root_ = Remove(root_, PathElements(dir.path), 0, app_name, dir);
+}
+
+DirectoryInfo::AccessRights PermissionIndex::AccessRights(const AppName& app_name,
+                                                          const fs::path& path) const {
+  auto rights(DirectoryInfo::AccessRights::kNone);
+  const std::vector<std::string> elements(PathElements(path));
+  const Node::AppGrants grants_key{app_name, {}};
+  const Node* node(root_.get());
+  for (std::size_t index(0); node; ++index) {
+    auto grants_itr(node->grants.find(grants_key));
+    if (grants_itr != node->grants.end()) {
+      // A nearer grant overrides any further up the path, whether it gives more or fewer rights.
+      rights = DirectoryInfo::AccessRights::kNone;
+      for (const auto& dir : grants_itr->dirs)
+        rights = std::max(rights, dir.access_rights);
+    }
+    if (index == elements.size())
+      break;
+    auto child_itr(node->children.find(Node::Child{elements[index], nullptr}));
+    node = child_itr == node->children.end() ? nullptr : child_itr->node.get();
+  }
+  return rights;
+}
+
+std::vector<PermissionIndex::Grant> PermissionIndex::GrantsUnder(const fs::path& directory) const {
+  std::vector<Grant> grants;
+  const Node* node(root_.get());
+  for (const auto& element : PathElements(directory)) {
+    if (!node)
+      break;
+    auto child_itr(node->children.find(Node::Child{element, nullptr}));
+    node = child_itr == node->children.end() ? nullptr : child_itr->node.get();
+  }
+  if (!node)
+    return grants;
+
+  std::vector<const Node*> to_visit(1, node);
+  while (!to_visit.empty()) {
+    node = to_visit.back();
+    to_visit.pop_back();
+    for (const auto& app_grants : node->grants) {
+      for (const auto& dir : app_grants.dirs)
+        grants.emplace_back(app_grants.app_name, dir);
+    }
+    for (const auto& child : node->children)
+      to_visit.push_back(child.node.get());
+  }
+  return grants;
+}
+
+PermissionIndex::NodePtr PermissionIndex::Add(const NodePtr& node,
+                                              const std::vector<std::string>& elements,
+                                              std::size_t index, const AppName& app_name,
+                                              const DirectoryInfo& dir) {
+  // Copying a node is O(1), since its sets are persistent.
+  auto updated(node ? std::make_shared<Node>(*node) : std::make_shared<Node>());
+  if (index == elements.size()) {
+    Node::AppGrants app_grants{app_name, {}};
+    auto itr(updated->grants.find(app_grants));
+    if (itr != updated->grants.end())
+      app_grants.dirs = itr->dirs;
+    app_grants.dirs.erase(dir);
+    app_grants.dirs.insert(dir);
+    updated->grants.insert_or_replace(std::move(app_grants));
+  } else {
+    Node::Child child{elements[index], nullptr};
+    auto itr(updated->children.find(child));
+    child.node = Add(itr == updated->children.end() ? nullptr : itr->node, elements, index + 1,
+                     app_name, dir);
+    updated->children.insert_or_replace(std::move(child));
+  }
+  return updated;
+}
+
+PermissionIndex::NodePtr PermissionIndex::Remove(const NodePtr& node,
+                                                 const std::vector<std::string>& elements,
+                                                 std::size_t index, const AppName& app_name,
+                                                 const DirectoryInfo& dir) {
+  if (!node)
+    return node;
+  std::shared_ptr<Node> updated;
+  if (index == elements.size()) {
+    Node::AppGrants app_grants{app_name, {}};
+    auto itr(node->grants.find(app_grants));
+    if (itr == node->grants.end() || itr->dirs.count(dir) == 0)
+      return node;
+    updated = std::make_shared<Node>(*node);
+    app_grants.dirs = itr->dirs;
+    app_grants.dirs.erase(dir);
+    if (app_grants.dirs.empty())
+      updated->grants.erase(app_grants);
+    else
+      updated->grants.insert_or_replace(std::move(app_grants));
+  } else {
+    Node::Child child{elements[index], nullptr};
+    auto itr(node->children.find(child));
+    if (itr == node->children.end())
+      return node;
+    child.node = Remove(itr->node, elements, index + 1, app_name, dir);
+    if (child.node == itr->node)
+      return node;
+    updated = std::make_shared<Node>(*node);
+    if (child.node)
+      updated->children.insert_or_replace(std::move(child));
+    else
+      updated->children.erase(child);
+  }
+  if (updated->grants.empty() && updated->children.empty())
+    return nullptr;
+  return updated;
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,85 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_PERMISSION_INDEX_H_
+#define MAIDSAFE_LAUNCHER_PERMISSION_INDEX_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/directory_info.h"
+
+#include "maidsafe/launcher/types.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// An index of the permitted directories of all apps, keyed by directory path.  Granting an app a
+// directory gives it access to the whole subtree below that directory, so a lookup walks the path
+// from the root, taking the rights of the deepest directory granted to the app.
+//
+// The index is a trie with one edge per path element (of the path's CanonicalAppPath), and each of
+// its nodes holds the grants of the directory it represents.  Lookups, grants and revocations cost
+// O(path length), and enumerating the grants in a subtree only visits that subtree.  The nodes are
+// immutable and shared between copies, with changes copying only the path from the root to the
+// changed node, so copying a PermissionIndex is O(1).
+class PermissionIndex {
+ public:
+  using Grant = std::pair<AppName, DirectoryInfo>;
+
+  PermissionIndex();
+
+  // Grants 'dir' to 'app_name', replacing any grant of the same directory (e.g. with different
+  // access rights).
+  void Add(const AppName& app_name, const DirectoryInfo& dir);
+  // Revokes 'app_name''s grant of 'dir'.  Does nothing if there is no such grant.
+  void Remove(const AppName& app_name, const DirectoryInfo& dir);
+
+  // Returns the rights of the directory nearest to 'path' (at or above it) granted to 'app_name',
+  // or kNone if there is no such directory.
+  DirectoryInfo::AccessRights AccessRights(const AppName& app_name,
+                                           const boost::filesystem::path& path) const;
+  // Returns every grant of 'directory' or of any directory below it.
+  std::vector<Grant> GrantsUnder(const boost::filesystem::path& directory) const;
+
+  bool empty() const { return !root_; }
+
+ private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  static NodePtr Add(const NodePtr& node, const std::vector<std::string>& elements,
+                     std::size_t index, const AppName& app_name, const DirectoryInfo& dir);
+  // Returns null if the node is left with no grants or children.
+  static NodePtr Remove(const NodePtr& node, const std::vector<std::string>& elements,
+                        std::size_t index, const AppName& app_name, const DirectoryInfo& dir);
+
+  NodePtr root_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_PERMISSION_INDEX_H_
@@ -0,0 +1,337 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_PERSISTENT_SET_H_
+#define MAIDSAFE_LAUNCHER_PERSISTENT_SET_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/config.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// An ordered set implemented as a persistent (immutable) AVL tree.  Copying a PersistentSet is O(1)
+// since the copy shares the whole tree with the original.  Modifying a set copies only the O(log n)
+// nodes on the path to the affected element; all other nodes remain shared with any copies.  The
+// elements themselves are held via shared_ptr, so path-copying never copies an element.
+//
+// The interface mirrors the subset of std::set used in this project.  Only const iteration is
+// supported.  Iterators are invalidated if the set they were obtained from is modified or destroyed
+// (they remain valid if a copy of the set taken beforehand is still alive).
+//
+// Instances are not threadsafe, but distinct copies sharing structure may be used concurrently.
+template <typename T, typename Compare = std::less<T>>
+class PersistentSet {
+ private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+  using ValuePtr = std::shared_ptr<const T>;
+
+  struct Node {
+    Node(ValuePtr value_in, NodePtr left_in, NodePtr right_in)
+        : value(std::move(value_in)),
+          left(std::move(left_in)),
+          right(std::move(right_in)),
+          height(1 + std::max(Height(left), Height(right))) {}
+    ValuePtr value;
+    NodePtr left, right;
+    int height;
+  };
+
+ public:
+  using value_type = T;
+  using key_compare = Compare;
+  using size_type = std::size_t;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() : stack_() {}
+    reference operator*() const { return *stack_.back()->value; }
+    pointer operator->() const { return stack_.back()->value.get(); }
+    const_iterator& operator++() {
+      const Node* current(stack_.back());
+      stack_.pop_back();
+      PushLeftSpine(current->right.get());
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator previous(*this);
+      ++*this;
+      return previous;
+    }
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+      return lhs.stack_.empty() ? rhs.stack_.empty()
+                                : !rhs.stack_.empty() && lhs.stack_.back() == rhs.stack_.back();
+    }
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    friend class PersistentSet;
+    void PushLeftSpine(const Node* node) {
+      while (node) {
+        stack_.push_back(node);
+        node = node->left.get();
+      }
+    }
+    // The top of the stack is the current node.  The nodes below it are the ancestors still to be
+    // visited, i.e. those from which the path to the current node descends leftwards.
+    std::vector<const Node*> stack_;
+  };
+  using iterator = const_iterator;
+
+  PersistentSet() : root_(), size_(0), compare_() {}
+
+  template <typename InputIterator>
+  PersistentSet(InputIterator first, InputIterator last)
+      : root_(), size_(0), compare_() {
+    for (; first != last; ++first)
+      insert(*first);
+  }
+
+  // Builds a set from 'values', which must be sorted and free of equivalent elements, in O(n) and
+  // with a single allocation per element.
+  static PersistentSet FromSorted(std::vector<T> values) {
+    assert(std::adjacent_find(values.begin(), values.end(), [](const T& lhs, const T& rhs) {
+             return !Compare()(lhs, rhs);
+           }) == values.end());
+    PersistentSet set;
+    set.root_ = Build(values, 0, values.size());
+    set.size_ = values.size();
+    return set;
+  }
+
+  PersistentSet(const PersistentSet&) = default;
+  PersistentSet(PersistentSet&& other) MAIDSAFE_NOEXCEPT : root_(std::move(other.root_)),
+                                                           size_(other.size_),
+                                                           compare_(std::move(other.compare_)) {
+    other.size_ = 0;
+  }
+  PersistentSet& operator=(const PersistentSet&) = default;
+  PersistentSet& operator=(PersistentSet&& other) MAIDSAFE_NOEXCEPT {
+    root_ = std::move(other.root_);
+    size_ = other.size_;
+    compare_ = std::move(other.compare_);
+    other.size_ = 0;
+    return *this;
+  }
+
+  const_iterator begin() const {
+    const_iterator itr;
+    itr.PushLeftSpine(root_.get());
+    return itr;
+  }
+  const_iterator end() const { return const_iterator(); }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+
+  const_iterator find(const T& key) const {
+    const_iterator itr;
+    const Node* node(root_.get());
+    while (node) {
+      if (compare_(key, *node->value)) {
+        itr.stack_.push_back(node);
+        node = node->left.get();
+      } else if (compare_(*node->value, key)) {
+        node = node->right.get();
+      } else {
+        itr.stack_.push_back(node);
+        return itr;
+      }
+    }
+    return end();
+  }
+
+  size_type count(const T& key) const { return find(key) == end() ? 0 : 1; }
+
+  // Returns an iterator to the first element which isn't less than 'key'.
+  const_iterator lower_bound(const T& key) const {
+    const_iterator itr;
+    const Node* node(root_.get());
+    while (node) {
+      if (compare_(*node->value, key)) {
+        node = node->right.get();
+      } else {
+        itr.stack_.push_back(node);
+        node = node->left.get();
+      }
+    }
+    return itr;
+  }
+
+  // Returns true if 'value' was inserted, false if an equivalent element already existed (in which
+  // case the set is unchanged).
+  bool insert(T value) { return insert(std::make_shared<const T>(std::move(value))); }
+
+  // As above, but the set shares 'value' with the caller rather than holding its own copy.
+  bool insert(std::shared_ptr<const T> value) {
+    assert(value);
+    bool inserted{false};
+    root_ = Insert(root_, std::move(value), false, inserted);
+    if (inserted)
+      ++size_;
+    return inserted;
+  }
+
+  // Inserts 'value', replacing any existing equivalent element.  Returns true if 'value' was newly
+  // inserted, false if it replaced an existing element.  Replacing doesn't change the shape of the
+  // tree, so no rotations are done.
+  bool insert_or_replace(T value) {
+    return insert_or_replace(std::make_shared<const T>(std::move(value)));
+  }
+
+  bool insert_or_replace(std::shared_ptr<const T> value) {
+    assert(value);
+    bool inserted{false};
+    root_ = Insert(root_, std::move(value), true, inserted);
+    if (inserted)
+      ++size_;
+    return inserted;
+  }
+
+  // Returns the number of elements erased (0 or 1).
+  size_type erase(const T& key) {
+    bool erased{false};
+    root_ = Erase(root_, key, erased);
+    if (!erased)
+      return 0;
+    --size_;
+    return 1;
+  }
+
+  void clear() {
+    root_.reset();
+    size_ = 0;
+  }
+
+  friend void swap(PersistentSet& lhs, PersistentSet& rhs) MAIDSAFE_NOEXCEPT {
+    using std::swap;
+    swap(lhs.root_, rhs.root_);
+    swap(lhs.size_, rhs.size_);
+    swap(lhs.compare_, rhs.compare_);
+  }
+
+ private:
+  static int Height(const NodePtr& node) { return node ? node->height : 0; }
+
+  static NodePtr MakeNode(ValuePtr value, NodePtr left, NodePtr right) {
+    return std::make_shared<const Node>(std::move(value), std::move(left), std::move(right));
+  }
+
+  // Returns a node holding 'value' with the given children, rotating if the heights of the children
+  // differ by more than one.
+  static NodePtr Balance(ValuePtr value, NodePtr left, NodePtr right) {
+    const int left_height(Height(left)), right_height(Height(right));
+    if (left_height > right_height + 1) {
+      if (Height(left->left) >= Height(left->right)) {
+        return MakeNode(left->value, left->left,
+                        MakeNode(std::move(value), left->right, std::move(right)));
+      }
+      return MakeNode(left->right->value,
+                      MakeNode(left->value, left->left, left->right->left),
+                      MakeNode(std::move(value), left->right->right, std::move(right)));
+    }
+    if (right_height > left_height + 1) {
+      if (Height(right->right) >= Height(right->left)) {
+        return MakeNode(right->value, MakeNode(std::move(value), std::move(left), right->left),
+                        right->right);
+      }
+      return MakeNode(right->left->value,
+                      MakeNode(std::move(value), std::move(left), right->left->left),
+                      MakeNode(right->value, right->left->right, right->right));
+    }
+    return MakeNode(std::move(value), std::move(left), std::move(right));
+  }
+
+  // Returns a perfectly-balanced tree holding the elements of 'values' in [first, last).
+  static NodePtr Build(std::vector<T>& values, std::size_t first, std::size_t last) {
+    if (first == last)
+      return nullptr;
+    const std::size_t middle(first + (last - first) / 2);
+    NodePtr left(Build(values, first, middle));
+    NodePtr right(Build(values, middle + 1, last));
+    return MakeNode(std::make_shared<const T>(std::move(values[middle])), std::move(left),
+                    std::move(right));
+  }
+
+  NodePtr Insert(const NodePtr& node, ValuePtr value, bool replace, bool& inserted) const {
+    if (!node) {
+      inserted = true;
+      return MakeNode(std::move(value), nullptr, nullptr);
+    }
+    if (compare_(*value, *node->value))
+      return Balance(node->value, Insert(node->left, std::move(value), replace, inserted),
+                     node->right);
+    if (compare_(*node->value, *value))
+      return Balance(node->value, node->left,
+                     Insert(node->right, std::move(value), replace, inserted));
+    inserted = false;
+    return replace ? MakeNode(std::move(value), node->left, node->right) : node;
+  }
+
+  NodePtr Erase(const NodePtr& node, const T& key, bool& erased) const {
+    if (!node)
+      return node;
+    if (compare_(key, *node->value))
+      return Balance(node->value, Erase(node->left, key, erased), node->right);
+    if (compare_(*node->value, key))
+      return Balance(node->value, node->left, Erase(node->right, key, erased));
+    erased = true;
+    if (!node->left)
+      return node->right;
+    if (!node->right)
+      return node->left;
+    const Node* successor(node->right.get());
+    while (successor->left)
+      successor = successor->left.get();
+    return Balance(successor->value, node->left, EraseMin(node->right));
+  }
+
+  static NodePtr EraseMin(const NodePtr& node) {
+    if (!node->left)
+      return node->right;
+    return Balance(node->value, EraseMin(node->left), node->right);
+  }
+
+  NodePtr root_;
+  size_type size_;
+  Compare compare_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_PERSISTENT_SET_H_
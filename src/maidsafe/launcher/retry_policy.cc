@@ -0,0 +1,154 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/retry_policy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <system_error>
+
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+RetryPolicy::RetryPolicy()
+    : max_attempts(4),
+      initial_backoff(std::chrono::milliseconds(200)),
+      max_backoff(std::chrono::seconds(5)),
+      backoff_multiplier(2.0),
+      jitter(0.5) {}
+
+RetryPolicy::RetryPolicy(int max_attempts_in, std::chrono::milliseconds initial_backoff_in,
+                         std::chrono::milliseconds max_backoff_in, double backoff_multiplier_in,
+                         double jitter_in)
+    : max_attempts(max_attempts_in),
+      initial_backoff(initial_backoff_in),
+      max_backoff(max_backoff_in),
+      backoff_multiplier(backoff_multiplier_in),
+      jitter(jitter_in) {
+  assert(max_attempts > 0);
+  assert(backoff_multiplier >= 1.0);
+  assert(jitter >= 0.0 && jitter <= 1.0);
+}
+
+HedgePolicy::HedgePolicy()
+    : enabled(true),
+      percentile(0.95),
+      min_samples(20),
+      initial_delay(std::chrono::milliseconds(500)),
+      min_delay(std::chrono::milliseconds(20)),
+      max_delay(std::chrono::seconds(5)) {}
+
+NetworkOperationStats::NetworkOperationStats()
+    : attempts(0),
+      retries(0),
+      hedges_sent(0),
+      hedges_won(0),
+      permanent_failures(0),
+      exhausted_failures(0) {}
+
+NetworkMetrics::NetworkMetrics()
+    : attempts(0),
+      retries(0),
+      hedges_sent(0),
+      hedges_won(0),
+      permanent_failures(0),
+      exhausted_failures(0) {}
+
+NetworkMetrics::NetworkMetrics(const NetworkOperationStats& stats)
+    : attempts(stats.attempts.load()),
+      retries(stats.retries.load()),
+      hedges_sent(stats.hedges_sent.load()),
+      hedges_won(stats.hedges_won.load()),
+      permanent_failures(stats.permanent_failures.load()),
+      exhausted_failures(stats.exhausted_failures.load()) {}
+
+LatencyTracker::LatencyTracker(std::size_t window_size)
+    : window_size_(window_size), samples_(), next_index_(0), mutex_() {
+  assert(window_size_ != 0);
+  samples_.reserve(window_size_);
+}
+
+void LatencyTracker::Add(std::chrono::steady_clock::duration latency) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (samples_.size() < window_size_)
+    samples_.push_back(latency);
+  else
+    samples_[next_index_] = latency;
+  next_index_ = (next_index_ + 1) % window_size_;
+}
+
+std::size_t LatencyTracker::SampleCount() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return samples_.size();
+}
+
+std::chrono::steady_clock::duration LatencyTracker::Percentile(double percentile) const {
+  assert(percentile >= 0.0 && percentile <= 1.0);
+  std::vector<std::chrono::steady_clock::duration> samples;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    samples = samples_;
+  }
+  if (samples.empty())
+    return std::chrono::steady_clock::duration::zero();
+  auto index(static_cast<std::size_t>(std::ceil(percentile * samples.size())));
+  index = std::min(samples.size() - 1, index == 0 ? 0 : index - 1);
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+bool IsTransient(const std::exception& error) {
+  const auto* const system_error(dynamic_cast<const std::system_error*>(&error));
+  if (!system_error)
+    return false;
+  const std::error_code& code(system_error->code());
+  return code == make_error_code(RoutingErrors::timed_out) ||
+         code == make_error_code(RoutingErrors::not_connected) ||
+         code == make_error_code(NfsErrors::timed_out) ||
+         code == std::errc::timed_out || code == std::errc::connection_reset ||
+         code == std::errc::connection_aborted || code == std::errc::network_unreachable ||
+         code == std::errc::resource_unavailable_try_again;
+}
+
+std::chrono::milliseconds BackoffDelay(const RetryPolicy& policy, int retry) {
+  assert(retry > 0);
+  double delay{static_cast<double>(policy.initial_backoff.count()) *
+               std::pow(policy.backoff_multiplier, retry - 1)};
+  delay = std::min(delay, static_cast<double>(policy.max_backoff.count()));
+  double random_fraction{static_cast<double>(RandomUint32()) /
+                         static_cast<double>(std::numeric_limits<std::uint32_t>::max())};
+  delay -= delay * policy.jitter * random_fraction;
+  return std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(delay));
+}
+
+std::chrono::milliseconds HedgeDelay(const HedgePolicy& policy, const LatencyTracker& latencies) {
+  if (latencies.SampleCount() < policy.min_samples)
+    return policy.initial_delay;
+  auto delay(std::chrono::duration_cast<std::chrono::milliseconds>(
+      latencies.Percentile(policy.percentile)));
+  return std::max(policy.min_delay, std::min(policy.max_delay, delay));
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,233 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_RETRY_POLICY_H_
+#define MAIDSAFE_LAUNCHER_RETRY_POLICY_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// Controls how often, and how far apart, a failed network operation is retried.  The delay before
+// retry 'n' (1-based) is 'initial_backoff * backoff_multiplier^(n-1)', capped at 'max_backoff', of
+// which a random fraction up to 'jitter' is subtracted to avoid retries from many clients landing
+// in lockstep.  Only errors for which 'IsTransient' returns true are retried.
+struct RetryPolicy {
+  RetryPolicy();
+  RetryPolicy(int max_attempts_in, std::chrono::milliseconds initial_backoff_in,
+              std::chrono::milliseconds max_backoff_in, double backoff_multiplier_in,
+              double jitter_in);
+
+  int max_attempts;
+  std::chrono::milliseconds initial_backoff, max_backoff;
+  double backoff_multiplier;
+  double jitter;
+};
+
+// Controls hedging of read requests.  If a read hasn't completed after the hedge delay, a duplicate
+// request is issued and whichever reply arrives first is used.  The hedge delay is the
+// 'percentile' latency of recent successful reads, clamped to ['min_delay', 'max_delay'], or
+// 'initial_delay' until at least 'min_samples' reads have been observed.
+struct HedgePolicy {
+  HedgePolicy();
+
+  bool enabled;
+  double percentile;
+  std::size_t min_samples;
+  std::chrono::milliseconds initial_delay, min_delay, max_delay;
+};
+
+// Counters for network operations.  Threadsafe.
+struct NetworkOperationStats {
+  NetworkOperationStats();
+  NetworkOperationStats(const NetworkOperationStats&) = delete;
+  NetworkOperationStats(NetworkOperationStats&&) = delete;
+  NetworkOperationStats& operator=(const NetworkOperationStats&) = delete;
+  NetworkOperationStats& operator=(NetworkOperationStats&&) = delete;
+
+  std::atomic<std::uint64_t> attempts, retries, hedges_sent, hedges_won, permanent_failures,
+      exhausted_failures;
+};
+
+// Plain copy of the values held in a 'NetworkOperationStats' at a given point in time.
+struct NetworkMetrics {
+  NetworkMetrics();
+  explicit NetworkMetrics(const NetworkOperationStats& stats);
+
+  std::uint64_t attempts, retries, hedges_sent, hedges_won, permanent_failures,
+      exhausted_failures;
+};
+
+// Keeps a bounded window of the most recently recorded latencies.  Threadsafe.
+class LatencyTracker {
+ public:
+  explicit LatencyTracker(std::size_t window_size = 256);
+
+  LatencyTracker(const LatencyTracker&) = delete;
+  LatencyTracker(LatencyTracker&&) = delete;
+  LatencyTracker& operator=(const LatencyTracker&) = delete;
+  LatencyTracker& operator=(LatencyTracker&&) = delete;
+
+  void Add(std::chrono::steady_clock::duration latency);
+  std::size_t SampleCount() const;
+  // 'percentile' must be in the range [0.0, 1.0].  Returns zero if there are no samples.
+  std::chrono::steady_clock::duration Percentile(double percentile) const;
+
+ private:
+  const std::size_t window_size_;
+  std::vector<std::chrono::steady_clock::duration> samples_;
+  std::size_t next_index_;
+  mutable std::mutex mutex_;
+};
+
+// Returns true if 'error' indicates a problem which may succeed if retried (e.g. a timeout or a
+// temporary loss of connection), false if retrying can't help (e.g. parsing or decryption failure,
+// data not found or already existing).
+bool IsTransient(const std::exception& error);
+
+// Returns the jittered delay to wait before retry number 'retry' (1-based).
+std::chrono::milliseconds BackoffDelay(const RetryPolicy& policy, int retry);
+
+// Returns the delay to wait before sending a hedged duplicate of a read request.
+std::chrono::milliseconds HedgeDelay(const HedgePolicy& policy, const LatencyTracker& latencies);
+
+// Invokes 'operation' until it succeeds, throws a non-transient error, or 'policy.max_attempts'
+// have been made.  The last error is rethrown on failure.
+template <typename Operation>
+auto RetryWithBackoff(const RetryPolicy& policy, NetworkOperationStats& stats,
+                      Operation operation) -> decltype(operation()) {
+  for (int attempt{1};; ++attempt) {
+    try {
+      ++stats.attempts;
+      return operation();
+    } catch (const std::exception& e) {
+      if (!IsTransient(e)) {
+        ++stats.permanent_failures;
+        throw;
+      }
+      if (attempt >= policy.max_attempts) {
+        LOG(kError) << "Giving up after " << attempt << " attempts: " << e.what();
+        ++stats.exhausted_failures;
+        throw;
+      }
+      ++stats.retries;
+      auto delay(BackoffDelay(policy, attempt));
+      LOG(kWarning) << "Attempt " << attempt << " failed with transient error (" << e.what()
+                    << ").  Retrying in " << delay.count() << "ms.";
+      std::this_thread::sleep_for(delay);
+    }
+  }
+}
+
+// Shared between a hedged read's caller and the requests it issued.
+template <typename Result>
+struct HedgedReply {
+  HedgedReply() : mutex(), cond_var(), value(), error(), outstanding(0) {}
+
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  boost::optional<Result> value;
+  std::exception_ptr error;
+  int outstanding;
+};
+
+// Posts 'read' to 'io_service', and if it hasn't completed within the hedge delay, posts a
+// duplicate.  Returns the first successful result, or rethrows the first error if all fail.  A
+// request which loses the race isn't waited for: it runs to completion on 'io_service', so whatever
+// 'read' refers to must outlive it.  Destroying its owner via DestroyDetached avoids then blocking
+// on it.
+template <typename IoService, typename Read>
+auto HedgedRead(IoService& io_service, const HedgePolicy& policy,
+                std::shared_ptr<LatencyTracker> latencies,
+                std::shared_ptr<NetworkOperationStats> stats, Read read) -> decltype(read()) {
+  using Result = decltype(read());
+  auto reply(std::make_shared<HedgedReply<Result>>());
+  auto issue_read([&](bool is_hedge) {
+    {
+      std::lock_guard<std::mutex> lock{reply->mutex};
+      ++reply->outstanding;
+    }
+    io_service.post([reply, latencies, stats, read, is_hedge] {
+      const auto start(std::chrono::steady_clock::now());
+      boost::optional<Result> value;
+      std::exception_ptr error;
+      try {
+        value = read();
+        latencies->Add(std::chrono::steady_clock::now() - start);
+      } catch (const std::exception&) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock{reply->mutex};
+      --reply->outstanding;
+      if (reply->value)  // a sibling request has already succeeded
+        return;
+      if (value) {
+        reply->value = std::move(value);
+        if (is_hedge)
+          ++stats->hedges_won;
+      } else if (!reply->error) {
+        reply->error = error;
+      }
+      reply->cond_var.notify_all();
+    });
+  });
+
+  issue_read(false);
+  std::unique_lock<std::mutex> lock{reply->mutex};
+  if (policy.enabled &&
+      !reply->cond_var.wait_for(lock, HedgeDelay(policy, *latencies),
+                                [&] { return reply->value || reply->error; })) {
+    lock.unlock();
+    ++stats->hedges_sent;
+    issue_read(true);
+    lock.lock();
+  }
+  reply->cond_var.wait(lock, [&] { return reply->value || reply->outstanding == 0; });
+  if (reply->value)
+    return *reply->value;
+  std::rethrow_exception(reply->error);
+}
+
+// Destroys 'owner' on a detached thread, so that the caller needn't wait for requests which lost a
+// HedgedRead to finish on threads which 'owner' joins when destroyed.
+template <typename T>
+void DestroyDetached(std::unique_ptr<T> owner) {
+  std::thread([](std::unique_ptr<T> detached) { detached.reset(); }, std::move(owner)).detach();
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_RETRY_POLICY_H_
@@ -0,0 +1,101 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_field_traits.h"
+
+#include <cstdint>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/app_events.h"
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+// Applies an update of 'Field' taking its new value from 'source', and returns the changed fields.
+template <typename Field>
+std::uint32_t UpdateFrom(const AppDetails& source, AppDetails& app) {
+  using Traits = AppFieldTraits<Field>;
+  const AppDetails original(app);
+  Traits::Update(app, Traits::Get(source));
+  return ChangedFields(original, app);
+}
+
+}  // unnamed namespace
+
+TEST(AppFieldTraitsTest, BEH_Masks) {
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppName | kAppPermittedDirs | kAppIcon),
+            kAccountAppFields);
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppName | kAppPath | kAppArgs | kAppAutoStart),
+            kConfigAppFields);
+
+  // Only the name orders apps.
+  std::uint32_t sort_keys{0}, visited{0};
+  ForEachAppField([&](auto field) {
+    using Traits = AppFieldTraits<decltype(field)>;
+    EXPECT_EQ(0U, visited & Traits::kField);
+    visited |= Traits::kField;
+    if (Traits::kIsSortKey)
+      sort_keys |= Traits::kField;
+  });
+  EXPECT_EQ(static_cast<std::uint32_t>(kAllAppFields), visited);
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppName), sort_keys);
+}
+
+TEST(AppFieldTraitsTest, BEH_Update) {
+  const AppDetails source(CreateRandomAppDetails());
+  AppDetails app(CreateRandomAppDetails());
+  app.auto_start = !source.auto_start;
+
+  // Each update changes only its own field.
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppName), UpdateFrom<field::Name>(source, app));
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppPath), UpdateFrom<field::Path>(source, app));
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppArgs), UpdateFrom<field::Args>(source, app));
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppIcon), UpdateFrom<field::Icon>(source, app));
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppAutoStart), UpdateFrom<field::AutoStart>(source, app));
+  EXPECT_EQ(0U, UpdateFrom<field::AutoStart>(source, app));
+
+  // Permitted dirs are updated one directory at a time, and removed by kNone access rights.
+  DirectoryInfo dir(CreateRandomDirectoryInfo());
+  dir.access_rights = DirectoryInfo::AccessRights::kReadOnly;
+  using DirsTraits = AppFieldTraits<field::PermittedDirs>;
+  const std::size_t dir_count(app.permitted_dirs.size());
+  DirsTraits::Update(app, dir);
+  EXPECT_EQ(dir_count + 1, DirsTraits::Get(app).size());
+  dir.access_rights = DirectoryInfo::AccessRights::kReadWrite;
+  DirsTraits::Update(app, dir);
+  ASSERT_EQ(dir_count + 1, DirsTraits::Get(app).size());
+  EXPECT_EQ(DirectoryInfo::AccessRights::kReadWrite, DirsTraits::Get(app).find(dir)->access_rights);
+  dir.access_rights = DirectoryInfo::AccessRights::kNone;
+  DirsTraits::Update(app, dir);
+  EXPECT_EQ(dir_count, DirsTraits::Get(app).size());
+  EXPECT_EQ(0U, DirsTraits::Get(app).count(dir));
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -18,7 +18,14 @@
 
 #include "maidsafe/launcher/app_handler.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iterator>
 #include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
 
 #include "asio/ip/address_v6.hpp"
 #include "boost/filesystem/operations.hpp"
@@ -55,8 +62,8 @@ class AppHandlerTest : public testing::Test {
       account_.apps.insert(CreateRandomAppDetails());
   }
 
-  fs::path SnapshotConfigFile(const AppHandler::Snapshot& snapshot) {
-    return *snapshot.config_file;
+  std::set<AppDetails> SnapshotLocalApps(const AppHandler::Snapshot& snapshot) {
+    return std::set<AppDetails>(snapshot.local_apps.begin(), snapshot.local_apps.end());
   }
 
   const maidsafe::test::TestPath test_root_;
@@ -82,58 +89,699 @@ TEST_F(AppHandlerTest, BEH_Snapshot) {
   std::set<AppDetails> apps;
   for (std::uint32_t i{0}; i < app_count; ++i) {
     AppDetails app{CreateRandomAppDetails()};
-    AppDetails added_app(
+    auto added_app(
         app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start));
-    app.permitted_dirs.insert(*added_app.permitted_dirs.begin());
+    app.permitted_dirs.insert(*added_app->permitted_dirs.begin());
     for (const auto& dir : app.permitted_dirs)
       app_handler.UpdatePermittedDirs(app.name, dir);
     ASSERT_TRUE(apps.insert(std::move(app)).second);
   }
+  app_handler.FlushConfig();
   ASSERT_TRUE(fs::exists(config_file));
   ASSERT_TRUE(Equals(apps, app_handler.GetApps(true)));
 
-  // Check that creating a snapshot copies the config file and that copying and moving a snapshot
-  // doesn't affect the file copy being destroyed when the final snapshot copy is destroyed.
-  fs::path snapshot_config_file;
+  // Check that creating, copying and moving a snapshot doesn't touch the disk, and that the
+  // snapshot isn't affected by subsequent changes to the AppHandler.
   {
     AppHandler::Snapshot snapshot0;
     {
       AppHandler::Snapshot snapshot1;
       {
         AppHandler::Snapshot snapshot2(app_handler.GetSnapshot());
-        snapshot_config_file = SnapshotConfigFile(snapshot2);
-        EXPECT_TRUE(fs::exists(snapshot_config_file));
-        EXPECT_EQ(ReadFile(config_file).value(), ReadFile(snapshot_config_file).value());
         snapshot1 = snapshot2;
       }
-      EXPECT_TRUE(fs::exists(snapshot_config_file));
-      EXPECT_EQ(ReadFile(config_file).value(), ReadFile(snapshot_config_file).value());
       snapshot0 = std::move(snapshot1);
     }
-    EXPECT_TRUE(fs::exists(snapshot_config_file));
-    EXPECT_EQ(ReadFile(config_file).value(), ReadFile(snapshot_config_file).value());
+    // The config directory holds the config file and its journal only.
+    EXPECT_EQ(2, std::distance(fs::directory_iterator(*test_root_), fs::directory_iterator()));
+    EXPECT_TRUE(Equals(apps, SnapshotLocalApps(snapshot0)));
+    app_handler.RemoveLocally(apps.begin()->name);
+    EXPECT_EQ(app_count - 1, app_handler.GetApps(true).size());
+    EXPECT_TRUE(Equals(apps, SnapshotLocalApps(snapshot0)));
+    app_handler.ApplySnapshot(snapshot0);
+    EXPECT_TRUE(Equals(apps, app_handler.GetApps(true)));
   }
-  EXPECT_FALSE(fs::exists(snapshot_config_file));
 
   // Keep a copy of the current snapshot to try applying later
   auto snapshot(maidsafe::make_unique<AppHandler::Snapshot>(app_handler.GetSnapshot()));
-  snapshot_config_file = SnapshotConfigFile(*snapshot);
-  auto config_file_contents(ReadFile(config_file).value());
 
   // Check that applying the "empty" snapshot clears the data and removes the config file
   ASSERT_EQ(app_count, app_handler.GetApps(true).size());
   ASSERT_TRUE(fs::exists(config_file));
   app_handler.ApplySnapshot(std::move(*empty_snapshot));
   EXPECT_TRUE(app_handler.GetApps(true).empty());
+  app_handler.FlushConfig();
   EXPECT_FALSE(fs::exists(config_file));
   empty_snapshot.reset();
 
   // Check that applying the other snapshot renews the data and config file.
   app_handler.ApplySnapshot(std::move(*snapshot));
   EXPECT_TRUE(Equals(apps, app_handler.GetApps(true)));
+  app_handler.FlushConfig();
   EXPECT_TRUE(fs::exists(config_file));
-  EXPECT_EQ(config_file_contents, ReadFile(config_file).value());
-  EXPECT_FALSE(fs::exists(snapshot_config_file));
+
+  // Check that changes recorded in the config journal are seen by a new AppHandler.
+  AppDetails renamed_app(*apps.begin());
+  apps.erase(apps.begin());
+  const AppName old_name(renamed_app.name);
+  renamed_app.name = RandomAlphaNumericString(20);
+  app_handler.UpdateName(old_name, renamed_app.name);
+  renamed_app.args = RandomAlphaNumericString(30);
+  app_handler.UpdateArgs(renamed_app.name, renamed_app.args);
+  ASSERT_TRUE(apps.insert(renamed_app).second);
+  const AppName removed_name(apps.rbegin()->name);
+  app_handler.RemoveLocally(removed_name);
+  apps.erase(std::prev(apps.end()));
+  ASSERT_TRUE(Equals(apps, app_handler.GetApps(true)));
+
+  app_handler.FlushConfig();
+  AppHandler reloaded_app_handler;
+  reloaded_app_handler.Initialise(config_file, &account_, &account_mutex_);
+  EXPECT_TRUE(Equals(apps, reloaded_app_handler.GetApps(true), kIgnoreIcon));
+}
+
+TEST_F(AppHandlerTest, BEH_ApplyBatch) {
+  AppHandler app_handler;
+  fs::path config_file{*test_root_ / "config.txt"};
+  app_handler.Initialise(config_file, &account_, &account_mutex_);
+  using Operation = AppHandler::Operation;
+
+  // Add a batch of apps and update some of them in the same batch.
+  std::vector<Operation> operations;
+  std::set<AppDetails> apps;
+  for (int i{0}; i < 20; ++i) {
+    AppDetails app{CreateRandomAppDetails()};
+    operations.emplace_back(Operation::Type::kAdd, app.name);
+    operations.back().new_values = app;
+    if (i % 2 == 0) {
+      app.args = RandomAlphaNumericString(20);
+      operations.emplace_back(Operation::Type::kUpdateArgs, app.name);
+      operations.back().new_values.args = app.args;
+    }
+    ASSERT_TRUE(apps.insert(app).second);
+  }
+  app_handler.ApplyBatch(operations);
+  EXPECT_TRUE(Equals(apps, app_handler.GetApps(true), kIgnorePermittedDirs));
+  const auto account_apps(account_.apps);
+
+  // A batch with a failing operation part way through mustn't change anything.
+  operations.clear();
+  operations.emplace_back(Operation::Type::kRemoveLocally, apps.begin()->name);
+  operations.emplace_back(Operation::Type::kUpdateName, apps.rbegin()->name);
+  operations.back().new_values.name = RandomAlphaNumericString(20);
+  operations.emplace_back(Operation::Type::kLink, RandomAlphaNumericString(20));
+  EXPECT_TRUE(ThrowsAs([&] { app_handler.ApplyBatch(operations); },
+                       CommonErrors::unable_to_handle_request));
+  EXPECT_TRUE(Equals(apps, app_handler.GetApps(true), kIgnorePermittedDirs));
+  EXPECT_TRUE(Equals(account_apps, account_.apps));
+
+  // The changes from a successful batch are persisted to the config file.
+  operations.pop_back();
+  app_handler.ApplyBatch(operations);
+  AppDetails renamed_app(*apps.rbegin());
+  renamed_app.name = operations.back().new_values.name;
+  apps.erase(apps.begin());
+  apps.erase(std::prev(apps.end()));
+  apps.insert(renamed_app);
+  EXPECT_TRUE(Equals(apps, app_handler.GetApps(true), kIgnorePermittedDirs));
+
+  app_handler.FlushConfig();
+  AppHandler reloaded_app_handler;
+  reloaded_app_handler.Initialise(config_file, &account_, &account_mutex_);
+  EXPECT_TRUE(
+      Equals(apps, reloaded_app_handler.GetApps(true), kIgnorePermittedDirs | kIgnoreIcon));
+}
+
+TEST_F(AppHandlerTest, BEH_DeferredLoad) {
+  // With the indexed record format, only the config file's index is read by 'Initialise'.
+  const fs::path config_file{*test_root_ / "config.txt"};
+  const auto format(ConfigStore::Format::kIndexedRecords);
+  std::set<AppDetails> apps;
+  {
+    AppHandler app_handler;
+    app_handler.Initialise(config_file, &account_, &account_mutex_,
+                           ConfigStore::FsyncPolicy::kOnRewrite, ConfigCodec(), format);
+    for (int i{0}; i < 50; ++i) {
+      AppDetails app{CreateRandomAppDetails()};
+      apps.insert(
+          *app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start));
+    }
+    app_handler.FlushConfig();
+  }
+
+  // The auto-start apps and any single app's path and args are available without waiting for the
+  // rest to be loaded.
+  AppHandler reloaded_app_handler;
+  reloaded_app_handler.Initialise(config_file, &account_, &account_mutex_,
+                                  ConfigStore::FsyncPolicy::kOnRewrite, ConfigCodec(), format);
+  std::set<AppName> auto_start_names;
+  for (const auto& app : apps) {
+    if (app.auto_start)
+      auto_start_names.insert(app.name);
+  }
+  const auto auto_start_apps(reloaded_app_handler.GetAutoStartApps());
+  EXPECT_EQ(auto_start_names,
+            std::set<AppName>(auto_start_apps.begin(), auto_start_apps.end()));
+  for (const auto& app : apps) {
+    const auto path_and_args(reloaded_app_handler.GetPathAndArgs(app.name));
+    EXPECT_EQ(app.path, path_and_args.first);
+    EXPECT_EQ(app.args, path_and_args.second);
+  }
+  EXPECT_TRUE(ThrowsAs([&] { reloaded_app_handler.GetPathAndArgs(RandomAlphaNumericString(20)); },
+                       CommonErrors::no_such_element));
+
+  // Everything else waits for the load to finish.
+  EXPECT_TRUE(Equals(apps, reloaded_app_handler.GetApps(true), kIgnoreIcon));
+  AppDetails updated_app(*apps.begin());
+  apps.erase(apps.begin());
+  updated_app.args = RandomAlphaNumericString(30);
+  reloaded_app_handler.UpdateArgs(updated_app.name, updated_app.args);
+  apps.insert(updated_app);
+  reloaded_app_handler.FlushConfig();
+
+  AppHandler rereloaded_app_handler;
+  rereloaded_app_handler.Initialise(config_file, &account_, &account_mutex_,
+                                    ConfigStore::FsyncPolicy::kOnRewrite, ConfigCodec(), format);
+  EXPECT_EQ(updated_app.args, rereloaded_app_handler.GetPathAndArgs(updated_app.name).second);
+  EXPECT_TRUE(Equals(apps, rereloaded_app_handler.GetApps(true), kIgnoreIcon));
+}
+
+TEST_F(AppHandlerTest, BEH_PublishedState) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  AppHandler::StatePtr initial_state(app_handler.GetState());
+  EXPECT_TRUE(initial_state->local_apps.empty());
+  EXPECT_EQ(account_.apps.size(), initial_state->non_local_apps.size());
+  EXPECT_EQ(initial_state, app_handler.GetState());
+
+  // Readers polling concurrently with changes must always see a complete state: each app is either
+  // local or non-local, and every published state is at least as new as the previous one.
+  const std::size_t non_local_count(account_.apps.size());
+  std::atomic<bool> done{false};
+  auto reader(std::async(std::launch::async, [&] {
+    std::size_t previous_local_count{0};
+    while (!done) {
+      AppHandler::StatePtr state(app_handler.GetState());
+      std::size_t local_count(state->local_apps.size());
+      if (local_count + state->non_local_apps.size() < non_local_count ||
+          local_count < previous_local_count) {
+        return false;
+      }
+      previous_local_count = local_count;
+    }
+    return true;
+  }));
+  for (int i{0}; i < 50; ++i) {
+    AppDetails app{CreateRandomAppDetails()};
+    app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start);
+  }
+  done = true;
+  EXPECT_TRUE(reader.get());
+
+  // Earlier states are unaffected by the changes.
+  EXPECT_TRUE(initial_state->local_apps.empty());
+  AppHandler::StatePtr final_state(app_handler.GetState());
+  EXPECT_EQ(50U, final_state->local_apps.size());
+  EXPECT_TRUE(Equals(app_handler.GetApps(true),
+                     std::set<AppDetails>(final_state->local_apps.begin(),
+                                          final_state->local_apps.end())));
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_InPlaceUpdates) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  AppDetails app{CreateRandomAppDetails()};
+
+  // The added app is shared with the local set rather than copied into it.
+  auto added_app(
+      app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start));
+  AppHandler::StatePtr state(app_handler.GetState());
+  ASSERT_EQ(1U, state->local_apps.count(app));
+  EXPECT_EQ(added_app.get(), &*state->local_apps.find(app));
+  EXPECT_EQ(app.icon, added_app->icon);
+
+  // Updates which don't rename the app modify the Account's element in place.
+  auto account_itr(account_.apps.find(app));
+  ASSERT_TRUE(account_itr != account_.apps.end());
+  const AppDetails* const account_app(&*account_itr);
+  const auto* const account_icon(account_itr->icon.data());
+  app_handler.UpdateAutoStart(app.name, !app.auto_start);
+  app_handler.UpdateArgs(app.name, app.args + "a");
+  account_itr = account_.apps.find(app);
+  ASSERT_TRUE(account_itr != account_.apps.end());
+  EXPECT_EQ(account_app, &*account_itr);
+  EXPECT_EQ(account_icon, account_itr->icon.data());
+  EXPECT_EQ(!app.auto_start, account_itr->auto_start);
+  EXPECT_EQ(app.args + "a", account_itr->args);
+
+  // Renaming moves the Account's element to its new position without copying its fields.
+  const AppName new_name(app.name + "a");
+  app_handler.UpdateName(app.name, new_name);
+  EXPECT_EQ(0U, account_.apps.count(app));
+  AppDetails renamed;
+  renamed.name = new_name;
+  account_itr = account_.apps.find(renamed);
+  ASSERT_TRUE(account_itr != account_.apps.end());
+  EXPECT_EQ(account_icon, account_itr->icon.data());
+
+  // The Account and the local set remain consistent, and earlier states are unaffected.
+  EXPECT_TRUE(Equals(std::set<AppDetails>{*account_itr}, app_handler.GetApps(true)));
+  EXPECT_EQ(1U, state->local_apps.count(app));
+  EXPECT_EQ(app.auto_start, state->local_apps.find(app)->auto_start);
+  EXPECT_EQ(app.args, state->local_apps.find(app)->args);
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_UndoLog) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  std::vector<AppDetails> apps;
+  for (int i{0}; i < 2; ++i) {
+    apps.push_back(CreateRandomAppDetails());
+    app_handler.AddOrLinkApp(apps.back().name, apps.back().path, apps.back().args,
+                             &apps.back().icon, apps.back().auto_start);
+  }
+  const std::set<AppDetails> local_apps(app_handler.GetApps(true));
+  const std::set<AppDetails> non_local_apps(app_handler.GetApps(false));
+  ASSERT_LE(2U, non_local_apps.size());
+  apps.push_back(*non_local_apps.begin());
+  apps.push_back(*std::next(non_local_apps.begin()));
+  const std::set<AppDetails> account_apps(account_.apps);
+
+  // Each change appends its inverses to the log.
+  AppHandler::UndoLog undo_log;
+  AppDetails added_app{CreateRandomAppDetails()};
+  app_handler.AddOrLinkApp(added_app.name, added_app.path, added_app.args, &added_app.icon,
+                           added_app.auto_start, &undo_log);
+  app_handler.AddOrLinkApp(apps[2].name, apps[2].path, apps[2].args, nullptr, apps[2].auto_start,
+                           &undo_log);
+  const AppName new_name(apps[0].name + "a");
+  app_handler.Update<field::Name>(apps[0].name, new_name, &undo_log);
+  app_handler.Update<field::Path>(new_name, apps[1].path, &undo_log);
+  app_handler.Update<field::Args>(new_name, apps[1].args, &undo_log);
+  app_handler.Update<field::Icon>(new_name, apps[1].icon, &undo_log);
+  app_handler.Update<field::AutoStart>(new_name, !apps[0].auto_start, &undo_log);
+  DirectoryInfo dir(CreateRandomDirectoryInfo());
+  dir.access_rights = DirectoryInfo::AccessRights::kReadOnly;
+  app_handler.Update<field::PermittedDirs>(new_name, dir, &undo_log);
+  app_handler.RemoveLocally(apps[1].name, &undo_log);
+  app_handler.RemoveFromNetwork(apps[3].name, &undo_log);
+  ASSERT_EQ(10U, undo_log.size());
+  const std::vector<bool> expected_modifies_account{true, false, true,  false, false,
+                                                    true, false, true, false, true};
+  for (std::size_t i{0}; i < undo_log.size(); ++i)
+    EXPECT_EQ(expected_modifies_account[i], undo_log[i].ModifiesAccount()) << "Inverse " << i;
+
+  // A failed change appends nothing.
+  EXPECT_THROW(app_handler.Update<field::Name>(added_app.name, apps[2].name, &undo_log),
+               common_error);
+  EXPECT_THROW(app_handler.RemoveLocally(apps[1].name, &undo_log), common_error);
+  ASSERT_EQ(10U, undo_log.size());
+
+  // Applying the inverses newest first restores the original state, including the Account.
+  app_handler.ApplyBatch(AppHandler::UndoLog(undo_log.rbegin(), undo_log.rend()));
+  EXPECT_TRUE(Equals(local_apps, app_handler.GetApps(true)));
+  EXPECT_TRUE(Equals(non_local_apps, app_handler.GetApps(false)));
+  EXPECT_TRUE(Equals(account_apps, account_.apps));
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_ErrorCodes) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  AppDetails app{CreateRandomAppDetails()}, missing_app{CreateRandomAppDetails()};
+  std::error_code ec;
+  ASSERT_TRUE(!!app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start,
+                                         ec));
+  EXPECT_FALSE(ec);
+  const std::set<AppDetails> local_apps(app_handler.GetApps(true));
+  const std::set<AppDetails> account_apps(account_.apps);
+  const std::uint64_t sequence_number(app_handler.GetState()->sequence_number);
+
+  // Expected failures are reported via the error code, and change nothing.
+  AppHandler::UndoLog undo_log;
+  EXPECT_FALSE(app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start,
+                                        ec, &undo_log));
+  EXPECT_EQ(make_error_code(CommonErrors::unable_to_handle_request), ec);
+  EXPECT_FALSE(app_handler.AddOrLinkApp(missing_app.name, missing_app.path, missing_app.args,
+                                        nullptr, missing_app.auto_start, ec, &undo_log));
+  EXPECT_EQ(make_error_code(CommonErrors::unable_to_handle_request), ec);
+  app_handler.Update<field::Args>(missing_app.name, missing_app.args, ec, &undo_log);
+  EXPECT_EQ(make_error_code(CommonErrors::no_such_element), ec);
+  app_handler.Update<field::Name>(app.name, account_apps.begin()->name == app.name
+                                                ? std::next(account_apps.begin())->name
+                                                : account_apps.begin()->name,
+                                  ec, &undo_log);
+  EXPECT_EQ(make_error_code(CommonErrors::unable_to_handle_request), ec);
+  app_handler.RemoveLocally(missing_app.name, ec, &undo_log);
+  EXPECT_EQ(make_error_code(CommonErrors::no_such_element), ec);
+  EXPECT_TRUE(app_handler.GetPathAndArgs(missing_app.name, ec).first.empty());
+  EXPECT_EQ(make_error_code(CommonErrors::no_such_element), ec);
+  EXPECT_TRUE(undo_log.empty());
+  EXPECT_TRUE(Equals(local_apps, app_handler.GetApps(true)));
+  EXPECT_TRUE(Equals(account_apps, account_.apps));
+  EXPECT_EQ(sequence_number, app_handler.GetState()->sequence_number);
+
+  // Success clears the error code, and the throwing overloads throw the same errors.
+  EXPECT_EQ(app.path, app_handler.GetPathAndArgs(app.name, ec).first);
+  EXPECT_FALSE(ec);
+  app_handler.Update<field::AutoStart>(missing_app.name, true, ec);
+  app_handler.Update<field::AutoStart>(app.name, !app.auto_start, ec);
+  EXPECT_FALSE(ec);
+  EXPECT_THROW(app_handler.Update<field::Args>(missing_app.name, missing_app.args), common_error);
+  EXPECT_THROW(app_handler.RemoveLocally(missing_app.name), common_error);
+  EXPECT_THROW(app_handler.GetPathAndArgs(missing_app.name), common_error);
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_Query) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  std::set<AppDetails> local_apps;
+  for (int i{0}; i < 40; ++i) {
+    AppDetails app{CreateRandomAppDetails()};
+    app.name = (i % 2 == 0 ? "Prefix" : "Other") + app.name;
+    app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start);
+    local_apps.insert(app);
+  }
+  const std::set<AppDetails> non_local_apps(app_handler.GetApps(false));
+
+  // Only the requested fields are projected, and apps are visited in order, local ones first.
+  AppQuery query;
+  query.fields = kAppName | kAppAutoStart;
+  std::vector<AppName> visited;
+  std::size_t local_count{0};
+  EXPECT_EQ(local_apps.size() + non_local_apps.size(),
+            app_handler.Query(query, [&](const AppView& view) {
+              EXPECT_TRUE(view.name && view.auto_start);
+              EXPECT_FALSE(view.path || view.args || view.permitted_dirs || view.icon);
+              if (view.locally_available)
+                ++local_count;
+              visited.push_back(*view.name);
+            }));
+  EXPECT_EQ(local_apps.size(), local_count);
+  std::vector<AppName> expected;
+  for (const auto& app : local_apps)
+    expected.push_back(app.name);
+  for (const auto& app : non_local_apps)
+    expected.push_back(app.name);
+  EXPECT_EQ(expected, visited);
+
+  // Filter by prefix and auto_start, and page through the results.
+  expected.clear();
+  for (const auto& app : local_apps) {
+    if (app.name.compare(0, 6, "Prefix") == 0 && app.auto_start)
+      expected.push_back(app.name);
+  }
+  query.availability = AppQuery::Availability::kLocal;
+  query.fields = kAppName;
+  query.name_prefix = "Prefix";
+  query.auto_start_only = true;
+  query.limit = 3;
+  visited.clear();
+  for (query.offset = 0; query.offset <= expected.size(); query.offset += query.limit) {
+    std::size_t count(
+        app_handler.Query(query, [&](const AppView& view) { visited.push_back(*view.name); }));
+    EXPECT_LE(count, query.limit);
+  }
+  EXPECT_EQ(expected, visited);
+
+  // An arbitrary predicate can further restrict the matches.
+  query = AppQuery();
+  query.availability = AppQuery::Availability::kNonLocal;
+  const AppName wanted(non_local_apps.rbegin()->name);
+  query.predicate = [&](const AppDetails& app) { return app.name == wanted; };
+  EXPECT_EQ(1U, app_handler.Query(query, [&](const AppView& view) {
+    EXPECT_FALSE(view.locally_available);
+    EXPECT_EQ(wanted, *view.name);
+    EXPECT_EQ(non_local_apps.rbegin()->icon, *view.icon);
+  }));
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_Events) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  EXPECT_EQ(0U, app_handler.GetState()->sequence_number);
+  std::vector<AppEventBatch> batches;
+  auto subscription_id(
+      app_handler.Subscribe([&](const AppEventBatch& batch) { batches.push_back(batch); }));
+  const auto snapshot(app_handler.GetSnapshot());
+  const AppDetails linked(*account_.apps.begin());
+  const AppName removed_from_network(account_.apps.rbegin()->name);
+
+  // Each change is delivered as a separate batch, with contiguous sequence numbers.
+  AppDetails added{CreateRandomAppDetails()};
+  app_handler.AddOrLinkApp(added.name, added.path, added.args, &added.icon, added.auto_start);
+  app_handler.AddOrLinkApp(linked.name, linked.path, linked.args, nullptr, linked.auto_start);
+  app_handler.UpdateArgs(added.name, added.args + "a");
+  const AppName new_name(added.name + "a");
+  app_handler.UpdateName(added.name, new_name);
+  ASSERT_EQ(4U, batches.size());
+  for (std::size_t i(0); i < batches.size(); ++i) {
+    EXPECT_EQ(i + 1, batches[i].sequence_number);
+    ASSERT_EQ(1U, batches[i].events.size());
+    EXPECT_TRUE(batches[i].events[0].locally_available);
+  }
+  EXPECT_EQ(AppEvent::Type::kAdded, batches[0].events[0].type);
+  EXPECT_EQ(added.name, batches[0].events[0].app_name);
+  EXPECT_EQ(AppEvent::Type::kMovedToLocal, batches[1].events[0].type);
+  EXPECT_EQ(linked.name, batches[1].events[0].app_name);
+  EXPECT_EQ(AppEvent::Type::kFieldUpdated, batches[2].events[0].type);
+  EXPECT_EQ(static_cast<std::uint32_t>(kAppArgs), batches[2].events[0].fields);
+  EXPECT_EQ(AppEvent::Type::kRenamed, batches[3].events[0].type);
+  EXPECT_EQ(new_name, batches[3].events[0].app_name);
+  EXPECT_EQ(added.name, batches[3].events[0].old_name);
+  EXPECT_EQ(4U, app_handler.GetState()->sequence_number);
+
+  // A batch of operations produces a single batch of events, and a failed one produces none.
+  using Operation = AppHandler::Operation;
+  std::vector<Operation> operations;
+  operations.emplace_back(Operation::Type::kRemoveLocally, new_name);
+  operations.emplace_back(Operation::Type::kRemoveFromNetwork, removed_from_network);
+  app_handler.ApplyBatch(operations);
+  operations.emplace_back(Operation::Type::kRemoveLocally, new_name);
+  EXPECT_TRUE(ThrowsAs([&] { app_handler.ApplyBatch(operations); },
+                       CommonErrors::no_such_element));
+  ASSERT_EQ(5U, batches.size());
+  ASSERT_EQ(2U, batches[4].events.size());
+  EXPECT_EQ(AppEvent::Type::kRemoved, batches[4].events[0].type);
+  EXPECT_TRUE(batches[4].events[0].locally_available);
+  EXPECT_EQ(AppEvent::Type::kRemoved, batches[4].events[1].type);
+  EXPECT_FALSE(batches[4].events[1].locally_available);
+
+  // Subscribers can resume from an earlier point, and the missed batches are replayed first.
+  std::vector<std::uint64_t> resumed;
+  auto resumed_id(app_handler.Subscribe(
+      [&](const AppEventBatch& batch) { resumed.push_back(batch.sequence_number); }, 2));
+  EXPECT_EQ((std::vector<std::uint64_t>{3, 4, 5}), resumed);
+
+  // Reverting to a snapshot produces the diff between the two states.
+  app_handler.ApplySnapshot(snapshot);
+  ASSERT_EQ(6U, batches.size());
+  EXPECT_EQ((std::vector<std::uint64_t>{3, 4, 5, 6}), resumed);
+  std::size_t moved(0), added_back(0);
+  for (const auto& event : batches[5].events) {
+    if (event.type == AppEvent::Type::kMovedToNonLocal && event.app_name == linked.name)
+      ++moved;
+    else if (event.type == AppEvent::Type::kAdded && !event.locally_available)
+      ++added_back;
+  }
+  EXPECT_EQ(1U, moved);
+  EXPECT_EQ(1U, added_back);
+  EXPECT_TRUE(Equals(std::set<AppDetails>(), app_handler.GetApps(true)));
+
+  // Unsubscribed handlers receive nothing further, and a throwing handler doesn't affect others.
+  app_handler.Unsubscribe(subscription_id);
+  app_handler.Unsubscribe(resumed_id);
+  app_handler.Subscribe([](const AppEventBatch&) { throw std::runtime_error("Handler error"); });
+  app_handler.Subscribe([&](const AppEventBatch& batch) { batches.push_back(batch); });
+  app_handler.AddOrLinkApp(added.name, added.path, added.args, &added.icon, added.auto_start);
+  EXPECT_EQ(7U, batches.size());
+  EXPECT_EQ(4U, resumed.size());
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_Search) {
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  const auto snapshot(app_handler.GetSnapshot());
+  const AppName linked(account_.apps.rbegin()->name);
+  auto best_match([&](const AppName& name) {
+    auto results(app_handler.Search(name, 1));
+    return results.empty() ? AppSearchResult(AppName(), false, AppSearchResult::Match::kFuzzy)
+                           : results[0];
+  });
+
+  // The non-local apps from the Account are indexed on initialisation.
+  for (const auto& app : account_.apps) {
+    const AppSearchResult result(best_match(app.name));
+    EXPECT_EQ(app.name, result.name);
+    EXPECT_FALSE(result.locally_available);
+    EXPECT_EQ(AppSearchResult::Match::kExact, result.match);
+  }
+
+  // The index follows adds, links, renames and removals.
+  AppDetails app{CreateRandomAppDetails()};
+  app.name = "Droop" + app.name;
+  app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start);
+  app_handler.AddOrLinkApp(linked, app.path, app.args, nullptr, false);
+  EXPECT_EQ(linked, best_match(linked).name);
+  EXPECT_TRUE(best_match(linked).locally_available);
+  auto results(app_handler.Search("droop", 10));
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(app.name, results[0].name);
+  EXPECT_EQ(AppSearchResult::Match::kPrefix, results[0].match);
+
+  const AppName new_name("Renamed" + app.name);
+  app_handler.UpdateName(app.name, new_name);
+  results = app_handler.Search("droop", 10);
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(new_name, results[0].name);
+  EXPECT_EQ(AppSearchResult::Match::kSubstring, results[0].match);
+  app_handler.RemoveLocally(new_name);
+  EXPECT_TRUE(app_handler.Search("droop", 10).empty());
+
+  // Reverting to a snapshot restores the index too.
+  app_handler.ApplySnapshot(snapshot);
+  EXPECT_EQ(linked, best_match(linked).name);
+  EXPECT_FALSE(best_match(linked).locally_available);
+  app_handler.FlushConfig();
+}
+
+TEST_F(AppHandlerTest, BEH_SecondaryIndexes) {
+  AppHandler app_handler;
+  fs::path config_file{*test_root_ / "config.txt"};
+  app_handler.Initialise(config_file, &account_, &account_mutex_);
+  // Checks the published indexes against full scans of the published sets.
+  auto expect_consistent([&] {
+    const AppHandler::StatePtr state(app_handler.GetState());
+    std::set<AppName> auto_start_apps;
+    for (const auto& app : state->local_apps) {
+      if (app.auto_start)
+        auto_start_apps.insert(app.name);
+    }
+    EXPECT_EQ(auto_start_apps, std::set<AppName>(state->indexes.auto_start_apps().begin(),
+                                                 state->indexes.auto_start_apps().end()));
+    for (const auto* apps : {&state->local_apps, &state->non_local_apps}) {
+      for (const auto& app : *apps) {
+        const auto with_path(state->indexes.AppsWithPath(app.path));
+        EXPECT_EQ(apps == &state->local_apps ? 1 : 0,
+                  std::count(with_path.begin(), with_path.end(), app.name));
+        for (const auto& dir : app.permitted_dirs) {
+          const auto with_directory(state->indexes.AppsWithDirectory(dir.directory_id));
+          EXPECT_EQ(1, std::count(with_directory.begin(), with_directory.end(), app.name));
+        }
+      }
+    }
+  });
+  expect_consistent();
+  const auto snapshot(app_handler.GetSnapshot());
+
+  // Add, link and update apps.
+  AppDetails app{CreateRandomAppDetails()};
+  app.auto_start = true;
+  const AppName linked(account_.apps.begin()->name);
+  app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start);
+  app_handler.AddOrLinkApp(linked, app.path, app.args, nullptr, false);
+  EXPECT_EQ(2U, app_handler.GetState()->indexes.AppsWithPath(app.path).size());
+  expect_consistent();
+  const DirectoryInfo dir(CreateRandomDirectoryInfo());
+  app_handler.UpdatePermittedDirs(linked, dir);
+  EXPECT_EQ(std::vector<AppName>{linked},
+            app_handler.GetState()->indexes.AppsWithDirectory(dir.directory_id));
+  app_handler.UpdateAutoStart(app.name, false);
+  app_handler.UpdatePath(linked, "other" / app.path);
+  expect_consistent();
+  EXPECT_TRUE(app_handler.GetState()->indexes.auto_start_apps().empty());
+  EXPECT_EQ(std::vector<AppName>{app.name}, app_handler.GetState()->indexes.AppsWithPath(app.path));
+  const AppName new_name(RandomAlphaNumericString(20));
+  app_handler.UpdateName(app.name, new_name);
+  app_handler.UpdateAutoStart(new_name, true);
+  EXPECT_EQ(std::vector<AppName>{new_name},
+            app_handler.GetState()->indexes.AppsWithPath(app.path));
+  expect_consistent();
+
+  // A failed batch leaves the indexes unchanged.
+  using Operation = AppHandler::Operation;
+  std::vector<Operation> operations;
+  operations.emplace_back(Operation::Type::kRemoveLocally, new_name);
+  operations.emplace_back(Operation::Type::kLink, RandomAlphaNumericString(20));
+  EXPECT_TRUE(ThrowsAs([&] { app_handler.ApplyBatch(operations); },
+                       CommonErrors::unable_to_handle_request));
+  EXPECT_EQ(std::vector<AppName>{new_name},
+            app_handler.GetState()->indexes.AppsWithPath(app.path));
+  expect_consistent();
+
+  // Removals are reflected, as is applying a snapshot.
+  app_handler.RemoveLocally(new_name);
+  app_handler.RemoveFromNetwork(linked);
+  EXPECT_TRUE(app_handler.GetState()->indexes.AppsWithDirectory(dir.directory_id).empty());
+  expect_consistent();
+  app_handler.ApplySnapshot(snapshot);
+  expect_consistent();
+  EXPECT_TRUE(app_handler.GetState()->indexes.AppsWithPath(app.path).empty());
+
+  // The indexes are rebuilt on initialisation from the config file.
+  app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start);
+  app_handler.FlushConfig();
+  AppHandler reloaded_app_handler;
+  reloaded_app_handler.Initialise(config_file, &account_, &account_mutex_);
+  const AppHandler::StatePtr state(reloaded_app_handler.GetState());
+  EXPECT_EQ(1U, state->indexes.auto_start_apps().count(app.name));
+  EXPECT_EQ(std::vector<AppName>{app.name}, state->indexes.AppsWithPath(app.path));
+}
+
+TEST_F(AppHandlerTest, BEH_RevokeAccess) {
+  using Rights = DirectoryInfo::AccessRights;
+  AppHandler app_handler;
+  app_handler.Initialise(*test_root_ / "config.txt", &account_, &account_mutex_);
+  std::vector<AppName> names;
+  for (int i{0}; i < 3; ++i) {
+    AppDetails app{CreateRandomAppDetails()};
+    app_handler.AddOrLinkApp(app.name, app.path, app.args, &app.icon, app.auto_start);
+    names.push_back(app.name);
+  }
+  auto make_dir([](const fs::path& path, Rights rights) {
+    DirectoryInfo dir(CreateRandomDirectoryInfo());
+    dir.path = path;
+    dir.access_rights = rights;
+    return dir;
+  });
+  app_handler.UpdatePermittedDirs(names[0], make_dir("/shared", Rights::kReadWrite));
+  app_handler.UpdatePermittedDirs(names[1], make_dir("/shared/docs", Rights::kReadOnly));
+  app_handler.UpdatePermittedDirs(names[2], make_dir("/shared/docs/x", Rights::kReadWrite));
+  const DirectoryInfo other_dir(make_dir("/other", Rights::kReadOnly));
+  app_handler.UpdatePermittedDirs(names[2], other_dir);
+  auto access_rights([&](const AppName& name, const fs::path& path) {
+    return app_handler.GetState()->indexes.permissions().AccessRights(name, path);
+  });
+  EXPECT_EQ(Rights::kReadWrite, access_rights(names[0], "/shared/docs/x/y"));
+  EXPECT_EQ(Rights::kReadOnly, access_rights(names[1], "/shared/docs/x/y"));
+  EXPECT_EQ(Rights::kReadWrite, access_rights(names[2], "/shared/docs/x/y"));
+  const auto snapshot(app_handler.GetSnapshot());
+
+  // Revoking a subtree removes the grants within it from the apps' details too, but leaves grants
+  // of its ancestors and of unrelated directories.
+  app_handler.RevokeAccess("/shared/docs");
+  EXPECT_EQ(Rights::kReadWrite, access_rights(names[0], "/shared/docs/x/y"));
+  EXPECT_EQ(Rights::kNone, access_rights(names[1], "/shared/docs/x/y"));
+  EXPECT_EQ(Rights::kNone, access_rights(names[2], "/shared/docs/x/y"));
+  EXPECT_EQ(Rights::kReadOnly, access_rights(names[2], "/other"));
+  for (const auto& app : app_handler.GetApps(true)) {
+    for (const auto& dir : app.permitted_dirs)
+      EXPECT_NE(0U, dir.path.string().find("/shared/docs")) << app.name;
+  }
+  EXPECT_TRUE(app_handler.GetState()->indexes.permissions().GrantsUnder("/shared/docs").empty());
+  EXPECT_EQ(std::vector<AppName>{names[2]},
+            app_handler.GetState()->indexes.AppsWithDirectory(other_dir.directory_id));
+
+  // Applying a snapshot restores the permission index along with the apps.
+  app_handler.ApplySnapshot(snapshot);
+  EXPECT_EQ(Rights::kReadOnly, access_rights(names[1], "/shared/docs/x/y"));
+  EXPECT_EQ(Rights::kReadWrite, access_rights(names[2], "/shared/docs/x/y"));
+  app_handler.FlushConfig();
 }
 
 }  // namespace test
@@ -0,0 +1,172 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_indexes.h"
+
+#include <set>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+std::set<AppName> AsSet(const std::vector<AppName>& names) {
+  return std::set<AppName>(names.begin(), names.end());
+}
+
+std::set<AppName> AutoStartApps(const AppIndexes& indexes) {
+  return std::set<AppName>(indexes.auto_start_apps().begin(), indexes.auto_start_apps().end());
+}
+
+}  // unnamed namespace
+
+TEST(AppIndexesTest, BEH_CanonicalAppPath) {
+  EXPECT_EQ("a/c", CanonicalAppPath("a/./b/../c"));
+  EXPECT_EQ(CanonicalAppPath("a/b"), CanonicalAppPath("a/b/"));
+  EXPECT_EQ(CanonicalAppPath("a/b"), CanonicalAppPath("./a//b"));
+  EXPECT_EQ("/y", CanonicalAppPath("/x/../../y"));
+  EXPECT_EQ("../../a", CanonicalAppPath("../b/../../a"));
+  EXPECT_NE(CanonicalAppPath("/a/b"), CanonicalAppPath("a/b"));
+}
+
+TEST(AppIndexesTest, BEH_InsertAndErase) {
+  AppIndexes indexes;
+  AppDetails local_app{CreateRandomAppDetails()}, non_local_app{CreateRandomAppDetails()};
+  local_app.path = "/opt/app/bin/../bin/app";
+  local_app.auto_start = true;
+  non_local_app.path = local_app.path;
+  non_local_app.auto_start = true;
+  const Identity shared_dir_id(local_app.permitted_dirs.begin()->directory_id);
+  DirectoryInfo shared_dir(CreateRandomDirectoryInfo());
+  shared_dir.directory_id = shared_dir_id;
+  non_local_app.permitted_dirs.insert(shared_dir);
+
+  indexes.Insert(local_app, true);
+  indexes.Insert(non_local_app, false);
+  const AppIndexes copy(indexes);
+
+  // Only local apps are auto-started or indexed by path, but all apps are indexed by directory.
+  EXPECT_EQ(std::set<AppName>{local_app.name}, AutoStartApps(indexes));
+  EXPECT_EQ(std::vector<AppName>{local_app.name}, indexes.AppsWithPath("/opt/app/bin/app"));
+  EXPECT_TRUE(indexes.AppsWithPath("/opt/app/app").empty());
+  EXPECT_EQ((std::set<AppName>{local_app.name, non_local_app.name}),
+            AsSet(indexes.AppsWithDirectory(shared_dir_id)));
+  for (const auto& dir : non_local_app.permitted_dirs) {
+    if (dir.directory_id != shared_dir_id) {
+      EXPECT_EQ(std::vector<AppName>{non_local_app.name},
+                indexes.AppsWithDirectory(dir.directory_id));
+    }
+  }
+  EXPECT_TRUE(indexes.AppsWithDirectory(Identity{MakeIdentity()}).empty());
+
+  // Moving the non-local app to local adds it to the path and auto-start indexes.
+  indexes.Erase(non_local_app, false);
+  EXPECT_EQ(std::vector<AppName>{local_app.name}, indexes.AppsWithDirectory(shared_dir_id));
+  indexes.Insert(non_local_app, true);
+  EXPECT_EQ((std::set<AppName>{local_app.name, non_local_app.name}), AutoStartApps(indexes));
+  EXPECT_EQ((std::set<AppName>{local_app.name, non_local_app.name}),
+            AsSet(indexes.AppsWithPath("/opt/app/./bin/app")));
+
+  indexes.Erase(local_app, true);
+  indexes.Erase(non_local_app, true);
+  EXPECT_TRUE(indexes.auto_start_apps().empty());
+  EXPECT_TRUE(indexes.AppsWithPath(local_app.path).empty());
+  EXPECT_TRUE(indexes.AppsWithDirectory(shared_dir_id).empty());
+
+  // The copy is unaffected by the changes.
+  EXPECT_EQ(std::set<AppName>{local_app.name}, AutoStartApps(copy));
+  EXPECT_EQ((std::set<AppName>{local_app.name, non_local_app.name}),
+            AsSet(copy.AppsWithDirectory(shared_dir_id)));
+
+  // Rebuilding from the sets gives the same indexes as incremental updates.
+  PersistentSet<AppDetails> local_apps, non_local_apps;
+  local_apps.insert(local_app);
+  non_local_apps.insert(non_local_app);
+  indexes.Rebuild(local_apps, non_local_apps);
+  EXPECT_EQ(AutoStartApps(copy), AutoStartApps(indexes));
+  EXPECT_EQ(copy.AppsWithPath(local_app.path), indexes.AppsWithPath(local_app.path));
+  EXPECT_EQ(AsSet(copy.AppsWithDirectory(shared_dir_id)),
+            AsSet(indexes.AppsWithDirectory(shared_dir_id)));
+}
+
+TEST(AppIndexesTest, FUNC_IndexMatchesScan) {
+  const int kAppCount(20000), kQueryCount(50);
+  PersistentSet<AppDetails> local_apps, non_local_apps;
+  std::vector<AppDetails> queried_apps;
+  for (int i(0); i < kAppCount; ++i) {
+    AppDetails app{CreateRandomAppDetails()};
+    if (i % (kAppCount / kQueryCount) == 0)
+      queried_apps.push_back(app);
+    (i % 2 == 0 ? local_apps : non_local_apps).insert(std::move(app));
+  }
+  AppIndexes indexes;
+  indexes.Rebuild(local_apps, non_local_apps);
+
+  std::vector<std::set<AppName>> indexed_results, scanned_results;
+  indexed_results.push_back(AutoStartApps(indexes));
+  for (const auto& app : queried_apps) {
+    indexed_results.push_back(AsSet(indexes.AppsWithPath(app.path)));
+    indexed_results.push_back(
+        AsSet(indexes.AppsWithDirectory(app.permitted_dirs.begin()->directory_id)));
+  }
+
+  std::set<AppName> auto_start_apps;
+  for (const auto& app : local_apps) {
+    if (app.auto_start)
+      auto_start_apps.insert(app.name);
+  }
+  scanned_results.push_back(auto_start_apps);
+  for (const auto& queried_app : queried_apps) {
+    const std::string path(CanonicalAppPath(queried_app.path));
+    const Identity& directory_id(queried_app.permitted_dirs.begin()->directory_id);
+    std::set<AppName> with_path, with_directory;
+    for (const auto& app : local_apps) {
+      if (CanonicalAppPath(app.path) == path)
+        with_path.insert(app.name);
+    }
+    for (const auto* apps : {&local_apps, &non_local_apps}) {
+      for (const auto& app : *apps) {
+        for (const auto& dir : app.permitted_dirs) {
+          if (dir.directory_id == directory_id)
+            with_directory.insert(app.name);
+        }
+      }
+    }
+    scanned_results.push_back(with_path);
+    scanned_results.push_back(with_directory);
+  }
+
+  EXPECT_EQ(scanned_results, indexed_results);
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,273 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/app_search_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <limits>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+class AppSearchIndexTest : public testing::Test {
+ protected:
+  using Match = AppSearchResult::Match;
+
+  AppSearchIndexTest() : index_() {}
+
+  std::vector<AppName> Names(const std::vector<AppSearchResult>& results) {
+    std::vector<AppName> names;
+    for (const auto& result : results)
+      names.push_back(result.name);
+    return names;
+  }
+
+  static std::string Lower(std::string input) {
+    for (auto& c : input)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return input;
+  }
+
+  // The reference implementation: 'name' matches if it contains the folded query as a subsequence.
+  static bool IsSubsequence(const std::string& query, const std::string& name) {
+    const std::string folded_query(Lower(query)), folded_name(Lower(name));
+    std::size_t position(0);
+    for (char c : folded_name) {
+      if (position < folded_query.size() && c == folded_query[position])
+        ++position;
+    }
+    return position == folded_query.size();
+  }
+
+  std::size_t NodeCount() const { return index_.nodes_.size(); }
+
+  AppSearchIndex index_;
+};
+
+TEST_F(AppSearchIndexTest, BEH_Ranking) {
+  index_.Insert("Droop", true);
+  index_.Insert("DropBox", false);
+  index_.Insert("Dr", true);
+  index_.Insert("Address Drill", false);
+  index_.Insert("Hydra", true);
+  index_.Insert("d-r-o-o-p", false);
+  index_.Insert("Unrelated", true);
+  EXPECT_EQ(7U, index_.size());
+
+  auto results(index_.Search("DR", 10));
+  EXPECT_EQ((std::vector<AppName>{"Dr", "Droop", "DropBox", "Address Drill", "Hydra", "d-r-o-o-p"}),
+            Names(results));
+  ASSERT_EQ(6U, results.size());
+  EXPECT_EQ(Match::kExact, results[0].match);
+  EXPECT_TRUE(results[0].locally_available);
+  EXPECT_EQ(Match::kPrefix, results[1].match);
+  EXPECT_EQ(Match::kPrefix, results[2].match);
+  EXPECT_FALSE(results[2].locally_available);
+  EXPECT_EQ(Match::kSubstring, results[3].match);
+  EXPECT_EQ(Match::kSubstring, results[4].match);
+  EXPECT_EQ(Match::kFuzzy, results[5].match);
+
+  // Results are limited, the best being kept.
+  EXPECT_EQ((std::vector<AppName>{"Dr", "Droop"}), Names(index_.Search("dr", 2)));
+  EXPECT_EQ((std::vector<AppName>{"Droop", "d-r-o-o-p"}), Names(index_.Search("DROOP", 10)));
+  EXPECT_TRUE(index_.Search("", 10).empty());
+  EXPECT_TRUE(index_.Search("xyz", 10).empty());
+  EXPECT_TRUE(index_.Search("Dr", 0).empty());
+}
+
+TEST_F(AppSearchIndexTest, BEH_IncrementalUpdates) {
+  index_.Insert("Alpha", true);
+  index_.Insert("Beta", false);
+  EXPECT_TRUE(ThrowsAs([&] { index_.Insert("Alpha", false); },
+                       CommonErrors::unable_to_handle_request));
+  EXPECT_TRUE(ThrowsAs([&] { index_.Erase("Gamma"); }, CommonErrors::no_such_element));
+  EXPECT_TRUE(ThrowsAs([&] { index_.Rename("Alpha", "Beta"); },
+                       CommonErrors::unable_to_handle_request));
+
+  index_.Rename("Alpha", "Gamma");
+  EXPECT_TRUE(index_.Search("alp", 10).empty());
+  auto results(index_.Search("gam", 10));
+  ASSERT_EQ(1U, results.size());
+  EXPECT_TRUE(results[0].locally_available);
+
+  index_.SetLocallyAvailable("Beta", true);
+  results = index_.Search("beta", 10);
+  ASSERT_EQ(1U, results.size());
+  EXPECT_TRUE(results[0].locally_available);
+
+  // Events produced by the AppHandler are applied in order.
+  std::vector<AppEvent> events;
+  events.emplace_back(AppEvent::Type::kAdded, "Delta", false);
+  events.emplace_back(AppEvent::Type::kRenamed, "Epsilon", true);
+  events.back().old_name = "Gamma";
+  events.emplace_back(AppEvent::Type::kMovedToNonLocal, "Beta", false);
+  events.emplace_back(AppEvent::Type::kFieldUpdated, "Beta", false);
+  events.emplace_back(AppEvent::Type::kRemoved, "Delta", false);
+  index_.Apply(events);
+  EXPECT_EQ(2U, index_.size());
+  EXPECT_EQ((std::vector<AppName>{"Epsilon"}), Names(index_.Search("e", 1)));
+  results = index_.Search("beta", 10);
+  ASSERT_EQ(1U, results.size());
+  EXPECT_FALSE(results[0].locally_available);
+
+  // Erased names are eventually compacted away.
+  std::vector<AppName> names;
+  for (int i(0); i < 500; ++i)
+    names.push_back(RandomAlphaNumericString(20));
+  for (const auto& name : names)
+    index_.Insert(name, false);
+  const std::size_t full_node_count(NodeCount());
+  for (std::size_t i(0); i < names.size() - 10; ++i)
+    index_.Erase(names[i]);
+  EXPECT_LT(NodeCount(), full_node_count / 2);
+  for (std::size_t i(names.size() - 10); i < names.size(); ++i)
+    EXPECT_EQ(names[i], index_.Search(names[i], 1).at(0).name);
+  EXPECT_EQ(12U, index_.size());
+  index_.Clear();
+  EXPECT_EQ(0U, index_.size());
+  EXPECT_TRUE(index_.Search("e", 10).empty());
+}
+
+TEST_F(AppSearchIndexTest, BEH_MatchesLinearScan) {
+  // Use a small alphabet so that queries have plenty of matches of every kind.
+  const std::string alphabet("abcABC -");
+  std::set<AppName> names;
+  while (names.size() < 2000) {
+    std::string name(RandomUint32() % 12 + 1, 'a');
+    for (auto& c : name)
+      c = alphabet[RandomUint32() % alphabet.size()];
+    if (names.insert(name).second)
+      index_.Insert(name, RandomUint32() % 2 == 0);
+  }
+  // Exercise removals and renames too.
+  for (int i(0); i < 300; ++i) {
+    auto itr(names.begin());
+    std::advance(itr, RandomUint32() % names.size());
+    const AppName new_name(*itr + "-" + std::to_string(i));
+    if (i % 2 == 0) {
+      index_.Rename(*itr, new_name);
+      names.insert(new_name);
+    } else {
+      index_.Erase(*itr);
+    }
+    names.erase(itr);
+  }
+
+  for (int i(0); i < 200; ++i) {
+    std::string query(RandomUint32() % 4 + 1, 'a');
+    for (auto& c : query)
+      c = alphabet[RandomUint32() % alphabet.size()];
+    const auto results(index_.Search(query, std::numeric_limits<std::size_t>::max()));
+    std::set<AppName> expected;
+    for (const auto& name : names) {
+      if (IsSubsequence(query, name))
+        expected.insert(name);
+    }
+    const auto found(Names(results));
+    EXPECT_EQ(expected, std::set<AppName>(found.begin(), found.end())) << "Query: " << query;
+    EXPECT_EQ(expected.size(), found.size()) << "Query: " << query;
+    // Results are grouped by kind of match, best first.
+    EXPECT_TRUE(std::is_sorted(results.begin(), results.end(),
+                               [](const AppSearchResult& lhs, const AppSearchResult& rhs) {
+                                 return lhs.match < rhs.match;
+                               }));
+    for (const auto& result : results) {
+      const std::string folded_query(Lower(query)), folded_name(Lower(result.name));
+      if (result.match == Match::kExact)
+        EXPECT_EQ(folded_query, folded_name);
+      else if (result.match == Match::kPrefix)
+        EXPECT_EQ(0U, folded_name.find(folded_query));
+      else if (result.match == Match::kSubstring)
+        EXPECT_NE(std::string::npos, folded_name.find(folded_query, 1));
+      else
+        EXPECT_EQ(std::string::npos, folded_name.find(folded_query));
+    }
+  }
+}
+
+TEST_F(AppSearchIndexTest, FUNC_KeystrokeSearch) {
+  const std::size_t kAppCount(100000), kMaxResults(50);
+  std::vector<AppName> names;
+  for (std::size_t i(0); i < kAppCount; ++i) {
+    names.push_back(RandomAlphaNumericString(8, 30));
+    index_.Insert(names.back(), i % 2 == 0);
+  }
+
+  // Simulate typing several queries a character at a time.  Each keystroke's results must be the
+  // best 'kMaxResults' of the matches a linear scan finds.
+  std::vector<std::string> keystrokes;
+  for (const std::string& query :
+       {std::string("DROOP"), std::string("launcher"), RandomAlphaNumericString(6)}) {
+    for (std::size_t length(1); length <= query.size(); ++length)
+      keystrokes.push_back(query.substr(0, length));
+  }
+  std::chrono::steady_clock::duration search_time(0);
+  for (const auto& keystroke : keystrokes) {
+    const auto start(std::chrono::steady_clock::now());
+    const auto results(index_.Search(keystroke, kMaxResults));
+    search_time += std::chrono::steady_clock::now() - start;
+
+    const std::string folded_query(Lower(keystroke));
+    std::vector<Match> expected_matches;
+    for (const auto& name : names) {
+      const std::string folded_name(Lower(name));
+      const auto position(folded_name.find(folded_query));
+      if (folded_name == folded_query)
+        expected_matches.push_back(Match::kExact);
+      else if (position == 0)
+        expected_matches.push_back(Match::kPrefix);
+      else if (position != std::string::npos)
+        expected_matches.push_back(Match::kSubstring);
+      else if (IsSubsequence(keystroke, name))
+        expected_matches.push_back(Match::kFuzzy);
+    }
+    std::sort(expected_matches.begin(), expected_matches.end());
+    expected_matches.resize(std::min(expected_matches.size(), kMaxResults));
+
+    std::vector<Match> matches;
+    for (const auto& result : results) {
+      EXPECT_TRUE(IsSubsequence(keystroke, result.name)) << keystroke << ": " << result.name;
+      matches.push_back(result.match);
+    }
+    EXPECT_EQ(expected_matches, matches) << "Query: " << keystroke;
+  }
+  LOG(kInfo) << "Mean search time over " << kAppCount << " apps: "
+             << std::chrono::duration_cast<std::chrono::microseconds>(search_time).count() /
+                    keystrokes.size()
+             << " us";
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
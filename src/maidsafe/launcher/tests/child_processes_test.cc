@@ -0,0 +1,117 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/child_processes.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef MAIDSAFE_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/on_scope_exit.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+TEST(ChildProcessesTest, BEH_TokeniseArgs) {
+  using Args = std::vector<std::string>;
+  EXPECT_EQ(Args{}, TokeniseArgs(""));
+  EXPECT_EQ(Args{}, TokeniseArgs(" \t "));
+  EXPECT_EQ((Args{"-a", "--b=c", "d"}), TokeniseArgs("  -a\t--b=c   d "));
+  EXPECT_EQ((Args{"a b", "c'd", "", "e\"f\\g"}),
+            TokeniseArgs("'a b' \"c'd\" '' \"e\\\"f\\\\g\""));
+  EXPECT_EQ((Args{"a b", "x\\y"}), TokeniseArgs("a\\ b 'x\\y'"));
+  EXPECT_EQ((Args{"--dir=/a b/c"}), TokeniseArgs("--dir='/a b'/c"));
+  EXPECT_THROW(TokeniseArgs("'unterminated"), common_error);
+  EXPECT_THROW(TokeniseArgs("a\\"), common_error);
+}
+
+#ifndef MAIDSAFE_WIN32
+TEST(ChildProcessesTest, BEH_SpawnAndReap) {
+  AsioService asio_service(2);
+  ChildProcesses child_processes(asio_service.service());
+
+  // Each child's exit code is delivered to its own handler, including when it's killed.
+  const int kChildCount(20);
+  std::vector<std::shared_ptr<std::promise<int>>> exits;
+  for (int i(0); i < kChildCount; ++i) {
+    exits.push_back(std::make_shared<std::promise<int>>());
+    auto exit(exits.back());
+    const std::string script(i % 2 == 0 ? "exit " + std::to_string(i) : "kill -9 $$");
+    EXPECT_LT(0, child_processes.Spawn("/bin/sh", {"-c", script},
+                                       [exit](int exit_code) { exit->set_value(exit_code); }));
+  }
+  for (int i(0); i < kChildCount; ++i) {
+    auto exit_code(exits[i]->get_future());
+    ASSERT_EQ(std::future_status::ready, exit_code.wait_for(std::chrono::seconds(10)));
+    EXPECT_EQ(i % 2 == 0 ? i : 128 + 9, exit_code.get());
+  }
+  EXPECT_EQ(0U, child_processes.Count());
+
+  // Arguments are passed unchanged, without being re-split.
+  std::promise<int> exit;
+  child_processes.Spawn("/bin/sh", {"-c", "test \"$0\" = 'a b'", "a b"},
+                        [&](int exit_code) { exit.set_value(exit_code); });
+  EXPECT_EQ(0, exit.get_future().get());
+
+  EXPECT_THROW(child_processes.Spawn("/nonexistent/app", {}, nullptr), common_error);
+  EXPECT_EQ(0U, child_processes.Count());
+  asio_service.Stop();
+}
+
+TEST(ChildProcessesTest, BEH_InheritedFd) {
+  AsioService asio_service(1);
+  ChildProcesses child_processes(asio_service.service());
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  on_scope_exit close_fds{[&] {
+    close(fds[0]);
+    close(fds[1]);
+  }};
+  ASSERT_NE(-1, fcntl(fds[1], F_SETFD, FD_CLOEXEC));
+
+  // The child receives the descriptor at kInheritedFd, even though it's close-on-exec here.
+  std::promise<int> exit;
+  const std::string script("printf inherited >&" + std::to_string(kInheritedFd));
+  child_processes.Spawn("/bin/sh", {"-c", script},
+                        [&](int exit_code) { exit.set_value(exit_code); }, fds[1]);
+  EXPECT_EQ(0, exit.get_future().get());
+  char buffer[16] = {0};
+  EXPECT_EQ(9, read(fds[0], buffer, sizeof(buffer) - 1));
+  EXPECT_EQ(std::string("inherited"), std::string(buffer));
+  asio_service.Stop();
+}
+#endif
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
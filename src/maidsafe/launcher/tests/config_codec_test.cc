@@ -0,0 +1,145 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_codec.h"
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/config_format.h"
+#include "maidsafe/launcher/persistent_set.h"
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+using Type = ConfigCodec::Type;
+
+std::string TypicalContents(int app_count) {
+  PersistentSet<AppDetails> apps;
+  while (static_cast<int>(apps.size()) < app_count)
+    apps.insert(CreateTypicalAppDetails());
+  return SerialiseLocalApps(apps);
+}
+
+std::string RoundTrip(const std::string& input, const ConfigCodec& codec) {
+  const std::string compressed(CompressConfig(input, codec));
+  EXPECT_TRUE(HasConfigCodecHeader(compressed.data(), compressed.size()));
+  return DecompressConfig(compressed.data(), compressed.size(), codec);
+}
+
+}  // unnamed namespace
+
+TEST(ConfigCodecTest, BEH_RoundTrip) {
+  std::vector<std::string> samples;
+  for (int i(0); i < 50; ++i)
+    samples.push_back(TypicalContents(1));
+  const std::vector<ConfigCodec> codecs{
+      ConfigCodec(), ConfigCodec(Type::kNone, 0), ConfigCodec(Type::kGzip, 1),
+      ConfigCodec(Type::kGzip, 9), ConfigCodec(Type::kLz, 1), ConfigCodec(Type::kLz, 9),
+      ConfigCodec(Type::kLz, 5, TrainConfigDictionary(samples, 1024))};
+  const std::vector<std::string> inputs{
+      std::string(), std::string(1, 'a'), std::string(10000, 'a'), std::string(3, '\0'),
+      RandomString(10000), TypicalContents(100), std::string("abcabcabcabd")};
+  for (const auto& codec : codecs) {
+    for (const auto& input : inputs) {
+      EXPECT_EQ(input, RoundTrip(input, codec)) << "Codec " << static_cast<int>(codec.type)
+                                                << " at level " << codec.level;
+    }
+  }
+
+  // Invalid codecs are rejected.
+  EXPECT_TRUE(ThrowsAs([] { CompressConfig("a", ConfigCodec(Type::kGzip, 0)); },
+                       CommonErrors::invalid_argument));
+  EXPECT_TRUE(ThrowsAs([] { CompressConfig("a", ConfigCodec(Type::kLz, 10)); },
+                       CommonErrors::invalid_argument));
+  EXPECT_TRUE(ThrowsAs([] { CompressConfig("a", ConfigCodec(static_cast<Type>(7), 1)); },
+                       CommonErrors::invalid_argument));
+}
+
+TEST(ConfigCodecTest, BEH_Dictionaries) {
+  std::vector<std::string> samples;
+  for (int i(0); i < 200; ++i)
+    samples.push_back(TypicalContents(1));
+  const std::string dictionary(TrainConfigDictionary(samples, 2048));
+  EXPECT_FALSE(dictionary.empty());
+  EXPECT_LE(dictionary.size(), 2048U);
+  EXPECT_TRUE(TrainConfigDictionary(std::vector<std::string>(), 2048).empty());
+  EXPECT_TRUE(TrainConfigDictionary(samples, 0).empty());
+
+  // Small inputs compress better with a dictionary than without.
+  const std::string input(TypicalContents(3));
+  const ConfigCodec trained(Type::kLz, 9, dictionary), plain(Type::kLz, 9),
+      default_codec(Type::kLz, 9, DefaultConfigDictionary());
+  const std::string with_trained(CompressConfig(input, trained)),
+      with_default(CompressConfig(input, default_codec)), without(CompressConfig(input, plain));
+  EXPECT_LT(with_trained.size(), without.size());
+  EXPECT_LT(with_default.size(), without.size());
+
+  // The default dictionary is always available, but any other must be supplied.
+  EXPECT_EQ(input, DecompressConfig(with_default.data(), with_default.size(), plain));
+  EXPECT_EQ(input, DecompressConfig(with_trained.data(), with_trained.size(), trained));
+  EXPECT_TRUE(ThrowsAs([&] { DecompressConfig(with_trained.data(), with_trained.size(), plain); },
+                       CommonErrors::parsing_error));
+}
+
+TEST(ConfigCodecTest, BEH_RejectsMalformedInput) {
+  const std::string input(TypicalContents(20));
+  for (const auto& codec : {ConfigCodec(), ConfigCodec(Type::kNone, 0)}) {
+    const std::string compressed(CompressConfig(input, codec));
+    EXPECT_FALSE(HasConfigCodecHeader(compressed.data(), 17));
+    for (std::size_t size(18); size < compressed.size(); ++size) {
+      EXPECT_TRUE(ThrowsAs([&] { DecompressConfig(compressed.data(), size, codec); },
+                           CommonErrors::parsing_error)) << "Size " << size;
+    }
+    EXPECT_TRUE(ThrowsAs(
+        [&] {
+          const std::string padded(compressed + '\0');
+          DecompressConfig(padded.data(), padded.size(), codec);
+        },
+        CommonErrors::parsing_error));
+
+    // Corrupting any byte after the codec type and level either yields some output or throws a
+    // parsing_error.  (Detecting tampering is left to the encryption layer.)
+    for (std::size_t i(6); i < compressed.size(); ++i) {
+      std::string corrupted(compressed);
+      corrupted[i] = static_cast<char>(corrupted[i] ^ (1 << (RandomUint32() % 8)));
+      try {
+        DecompressConfig(corrupted.data(), corrupted.size(), codec);
+      } catch (const maidsafe_error& error) {
+        EXPECT_EQ(make_error_code(CommonErrors::parsing_error), error.code());
+      }
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,115 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_format.h"
+
+#include <set>
+#include <string>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+const int kConfigOnly = kIgnorePermittedDirs | kIgnoreIcon;
+
+std::set<AppDetails> Parse(const std::string& serialised) {
+  auto apps(ParseLocalApps(serialised.data(), serialised.size()));
+  return std::set<AppDetails>(apps.begin(), apps.end());
+}
+
+}  // unnamed namespace
+
+TEST(ConfigFormatTest, BEH_RoundTrip) {
+  EXPECT_TRUE(Parse(SerialiseLocalApps(PersistentSet<AppDetails>())).empty());
+
+  std::set<AppDetails> apps;
+  for (int i(0); i < 100; ++i)
+    apps.insert(CreateRandomAppDetails());
+  // Include empty and non-ASCII fields.
+  AppDetails app(CreateRandomAppDetails());
+  app.path.clear();
+  app.args.clear();
+  apps.insert(app);
+  app = CreateRandomAppDetails();
+  app.args = std::string("\0\xff\n", 3);
+  apps.insert(app);
+
+  const std::string serialised(SerialiseLocalApps(PersistentSet<AppDetails>(apps.begin(),
+                                                                             apps.end())));
+  EXPECT_TRUE(HasLocalAppsLayout(serialised.data(), serialised.size()));
+  EXPECT_TRUE(Equals(apps, Parse(serialised), kConfigOnly));
+}
+
+TEST(ConfigFormatTest, BEH_RejectsMalformedInput) {
+  std::set<AppDetails> apps;
+  for (int i(0); i < 3; ++i)
+    apps.insert(CreateRandomAppDetails());
+  const std::string serialised(SerialiseLocalApps(PersistentSet<AppDetails>(apps.begin(),
+                                                                             apps.end())));
+  auto parse([](const std::string& input) { Parse(input); });
+
+  // Wrong magic.
+  EXPECT_FALSE(HasLocalAppsLayout(serialised.data(), 7));
+  std::string bad(serialised);
+  bad[0] = 'X';
+  EXPECT_FALSE(HasLocalAppsLayout(bad.data(), bad.size()));
+  EXPECT_TRUE(ThrowsAs([&] { parse(bad); }, CommonErrors::parsing_error));
+
+  // Truncated at every point, or with trailing bytes.
+  for (std::size_t size(8); size < serialised.size(); ++size) {
+    EXPECT_TRUE(ThrowsAs([&] { parse(serialised.substr(0, size)); }, CommonErrors::parsing_error))
+        << "Size " << size;
+  }
+  EXPECT_TRUE(ThrowsAs([&] { parse(serialised + '\0'); }, CommonErrors::parsing_error));
+
+  // An app count too large for the input is rejected up front.
+  bad = serialised;
+  bad.replace(8, 4, "\xff\xff\xff\x7f", 4);
+  EXPECT_TRUE(ThrowsAs([&] { parse(bad); }, CommonErrors::parsing_error));
+
+  // A bad auto_start flag.
+  bad = serialised;
+  bad.back() = 2;
+  EXPECT_TRUE(ThrowsAs([&] { parse(bad); }, CommonErrors::parsing_error));
+
+  // Apps out of order, or duplicated.
+  const auto first(SerialiseLocalApps(PersistentSet<AppDetails>(apps.begin(), ++apps.begin())));
+  const auto last(SerialiseLocalApps(PersistentSet<AppDetails>(--apps.end(), apps.end())));
+  const std::string two_apps_header(std::string("MSCAPP02") + std::string("\x02\0\0\0", 4));
+  EXPECT_NO_THROW(parse(two_apps_header + first.substr(12) + last.substr(12)));
+  EXPECT_TRUE(ThrowsAs([&] { parse(two_apps_header + last.substr(12) + first.substr(12)); },
+                       CommonErrors::parsing_error));
+  EXPECT_TRUE(ThrowsAs([&] { parse(two_apps_header + first.substr(12) + first.substr(12)); },
+                       CommonErrors::parsing_error));
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
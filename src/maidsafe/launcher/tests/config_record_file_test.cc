@@ -0,0 +1,329 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_record_file.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/config_store.h"
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+class ConfigRecordFileTest : public testing::Test {
+ protected:
+  using Change = ConfigRecordFile::Change;
+
+  ConfigRecordFileTest()
+      : test_root_(maidsafe::test::CreateTestPath("MaidSafe_TestConfigRecordFile")),
+        index_path_(*test_root_ / "config.txt"),
+        key_and_iv_(RandomBytes(crypto::AES256_KeySize + crypto::AES256_IVSize)) {}
+
+  std::set<AppDetails> Reload() {
+    ConfigRecordFile file(index_path_, key_and_iv_);
+    file.LoadIndex();
+    auto local_apps(file.LoadRecords());
+    return std::set<AppDetails>(local_apps.begin(), local_apps.end());
+  }
+
+  static std::string ReadContents(const fs::path& path) {
+    std::ifstream file(path.string(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  static void WriteContents(const fs::path& path, const std::string& contents) {
+    std::ofstream file(path.string(), std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+  }
+
+  fs::path RecordsPath(const ConfigRecordFile& file) const {
+    return file.RecordsPath(file.records_id_);
+  }
+
+  std::uint64_t RecordOffset(const ConfigRecordFile& file, const AppName& app_name) const {
+    return file.locations_.at(app_name).offset;
+  }
+
+  std::size_t FileCount() const {
+    return static_cast<std::size_t>(
+        std::distance(fs::directory_iterator(*test_root_), fs::directory_iterator()));
+  }
+
+  // Ignore the fields which aren't held in the config file.
+  static const int kConfigOnly = kIgnorePermittedDirs | kIgnoreIcon;
+
+  const maidsafe::test::TestPath test_root_;
+  const fs::path index_path_;
+  const crypto::AES256KeyAndIV key_and_iv_;
+};
+
+TEST_F(ConfigRecordFileTest, BEH_RoundTrip) {
+  ConfigRecordFile file(index_path_, key_and_iv_);
+  EXPECT_TRUE(file.LoadIndex().empty());
+  EXPECT_FALSE(file.Exists());
+
+  std::set<AppDetails> apps;
+  for (int i(0); i < 20; ++i)
+    apps.insert(CreateRandomAppDetails());
+  file.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  EXPECT_TRUE(file.Exists());
+  EXPECT_EQ(2U, FileCount());
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  // The index holds only the names and auto_start values; each record is read on demand.
+  {
+    ConfigRecordFile reloaded(index_path_, key_and_iv_);
+    auto index(reloaded.LoadIndex());
+    ASSERT_EQ(apps.size(), index.size());
+    auto itr(index.begin());
+    for (const auto& app : apps) {
+      EXPECT_EQ(app.name, itr->name);
+      EXPECT_EQ(app.auto_start, itr->auto_start);
+      EXPECT_TRUE(itr->path.empty() && itr->args.empty());
+      auto path_and_args(reloaded.ReadPathAndArgs(app.name));
+      EXPECT_EQ(app.path, path_and_args.first);
+      EXPECT_EQ(app.args, path_and_args.second);
+      ++itr;
+    }
+    EXPECT_TRUE(ThrowsAs([&] { reloaded.ReadPathAndArgs(RandomAlphaNumericString(10)); },
+                         CommonErrors::no_such_element));
+  }
+
+  // Puts, updates, renames and erases, in a single delta, applied in order.
+  AppDetails added(CreateRandomAppDetails()), updated(*apps.begin()), renamed(*apps.rbegin());
+  apps.erase(updated);
+  apps.erase(renamed);
+  updated.args = RandomAlphaNumericString(500);
+  updated.auto_start = !updated.auto_start;
+  const AppDetails old_renamed(renamed);
+  renamed.name = RandomAlphaNumericString(20);
+  file.Apply({Change(false, added), Change(false, updated), Change(true, old_renamed),
+              Change(false, renamed), Change(true, CreateRandomAppDetails())});
+  apps.insert(added);
+  apps.insert(updated);
+  apps.insert(renamed);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+  auto path_and_args(file.ReadPathAndArgs(updated.name));
+  EXPECT_EQ(updated.args, path_and_args.second);
+
+  // A put followed by an erase of the same app in one delta leaves it erased.
+  file.Apply({Change(false, CreateRandomAppDetails()), Change(true, added)});
+  apps.erase(added);
+  auto reloaded(Reload());
+  EXPECT_EQ(apps.size() + 1, reloaded.size());
+  EXPECT_EQ(0U, reloaded.count(added));
+
+  file.Remove();
+  EXPECT_FALSE(file.Exists());
+  EXPECT_TRUE(fs::is_empty(*test_root_));
+  EXPECT_TRUE(Reload().empty());
+}
+
+TEST_F(ConfigRecordFileTest, BEH_FreeSlotsAndCompaction) {
+  ConfigRecordFile file(index_path_, key_and_iv_);
+  file.LoadIndex();
+  std::set<AppDetails> apps;
+  for (int i(0); i < 100; ++i)
+    apps.insert(CreateRandomAppDetails());
+  file.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  const fs::path first_records_path(RecordsPath(file));
+
+  // Each update frees a slot which the next can reuse, so once the original slot has been replaced
+  // the records file stops growing.  The live record is never overwritten.
+  AppDetails app(*apps.begin());
+  for (int i(0); i < 2; ++i) {
+    const std::uint64_t previous_offset(RecordOffset(file, app.name));
+    app.args = RandomAlphaNumericString(100);
+    file.Apply({Change(false, app)});
+    EXPECT_NE(previous_offset, RecordOffset(file, app.name));
+  }
+  const auto records_size(fs::file_size(first_records_path));
+  for (int i(0); i < 10; ++i) {
+    const std::uint64_t previous_offset(RecordOffset(file, app.name));
+    app.args = RandomAlphaNumericString(100);
+    file.Apply({Change(false, app)});
+    EXPECT_NE(previous_offset, RecordOffset(file, app.name));
+    EXPECT_EQ(records_size, fs::file_size(first_records_path));
+  }
+  apps.erase(app);
+  apps.insert(app);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  // Free slots are rebuilt when the file is reopened.
+  {
+    ConfigRecordFile reopened(index_path_, key_and_iv_);
+    reopened.LoadIndex();
+    app.args = RandomAlphaNumericString(100);
+    reopened.Apply({Change(false, app)});
+    EXPECT_EQ(records_size, fs::file_size(first_records_path));
+    apps.erase(app);
+    apps.insert(app);
+  }
+
+  // Once most records are erased, compaction is needed, and it replaces the records file.
+  file.LoadIndex();
+  EXPECT_FALSE(file.NeedsCompaction());
+  std::vector<Change> erases;
+  while (apps.size() > 10) {
+    erases.emplace_back(true, *apps.begin());
+    apps.erase(apps.begin());
+  }
+  std::vector<Change> growth;
+  for (int i(0); i < 100; ++i) {
+    AppDetails large(CreateRandomAppDetails());
+    large.args = RandomAlphaNumericString(1000);
+    growth.emplace_back(false, large);
+    erases.emplace_back(true, large);
+  }
+  file.Apply(growth);
+  file.Apply(erases);
+  EXPECT_TRUE(file.NeedsCompaction());
+  file.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  EXPECT_FALSE(file.NeedsCompaction());
+  EXPECT_FALSE(fs::exists(first_records_path));
+  EXPECT_LT(fs::file_size(RecordsPath(file)), records_size);
+  EXPECT_EQ(2U, FileCount());
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+}
+
+TEST_F(ConfigRecordFileTest, BEH_InterruptedWritesAndTampering) {
+  ConfigRecordFile file(index_path_, key_and_iv_);
+  file.LoadIndex();
+  std::set<AppDetails> apps;
+  for (int i(0); i < 10; ++i)
+    apps.insert(CreateRandomAppDetails());
+  file.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  const AppDetails first(CreateRandomAppDetails()), second(CreateRandomAppDetails());
+  file.Apply({Change(false, first)});
+  const std::string one_delta(ReadContents(index_path_));
+  file.Apply({Change(false, second)});
+  const std::string two_deltas(ReadContents(index_path_));
+  apps.insert(first);
+
+  // A torn final delta is ignored (and trimmed), as if the last 'Apply' had never happened.
+  for (std::size_t size(one_delta.size() + 1); size < two_deltas.size(); size += 7) {
+    WriteContents(index_path_, two_deltas.substr(0, size));
+    EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly)) << "Size " << size;
+    EXPECT_EQ(one_delta.size(), fs::file_size(index_path_));
+  }
+
+  // A corrupt delta followed by another can't be the result of an interrupted write.
+  std::string corrupted(two_deltas);
+  corrupted[one_delta.size() - 10] ^= 1;
+  WriteContents(index_path_, corrupted);
+  EXPECT_TRUE(ThrowsAs([&] { Reload(); }, CommonErrors::parsing_error));
+  WriteContents(index_path_, two_deltas);
+  apps.insert(second);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  // A tampered record fails authentication, without affecting the others.
+  ConfigRecordFile reloaded(index_path_, key_and_iv_);
+  reloaded.LoadIndex();
+  const fs::path records_path(RecordsPath(reloaded));
+  const std::string records(ReadContents(records_path));
+  corrupted = records;
+  corrupted[RecordOffset(reloaded, first.name) + 40] ^= 1;
+  WriteContents(records_path, corrupted);
+  reloaded.LoadIndex();
+  EXPECT_TRUE(ThrowsAs([&] { reloaded.ReadPathAndArgs(first.name); },
+                       CommonErrors::parsing_error));
+  EXPECT_EQ(second.path, reloaded.ReadPathAndArgs(second.name).first);
+
+  // So does a record moved to another app's slot.
+  const std::uint64_t first_offset(RecordOffset(reloaded, first.name)),
+      second_offset(RecordOffset(reloaded, second.name));
+  corrupted = records;
+  corrupted.replace(second_offset, 100, records.substr(first_offset, 100));
+  WriteContents(records_path, corrupted);
+  reloaded.LoadIndex();
+  EXPECT_TRUE(ThrowsAs([&] { reloaded.ReadPathAndArgs(second.name); },
+                       CommonErrors::parsing_error));
+
+  // The wrong key can't read the index.
+  WriteContents(records_path, records);
+  ConfigRecordFile wrong_key(
+      index_path_, crypto::AES256KeyAndIV(RandomBytes(crypto::AES256_KeySize +
+                                                      crypto::AES256_IVSize)));
+  EXPECT_TRUE(ThrowsAs([&] { wrong_key.LoadIndex(); }, CommonErrors::parsing_error));
+}
+
+TEST_F(ConfigRecordFileTest, FUNC_StartupTime) {
+  // Compares the time taken to open a config file holding many local apps in the journal format
+  // (which decrypts everything) with that taken to read just the index of the record format.
+  using Clock = std::chrono::steady_clock;
+  auto elapsed([](Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+  });
+  for (std::size_t app_count : {10000, 50000}) {
+    std::set<AppDetails> apps;
+    while (apps.size() < app_count)
+      apps.insert(CreateTypicalAppDetails());
+    const PersistentSet<AppDetails> local_apps(apps.begin(), apps.end());
+    std::vector<AppName> names;
+    for (const auto& app : apps)
+      names.push_back(app.name);
+    std::cout << "Opening a config file holding " << app_count << " local apps:\n";
+
+    const fs::path journal_config(*test_root_ / "journal_config.txt");
+    ConfigStore(journal_config, key_and_iv_).Rewrite(local_apps);
+    auto start(Clock::now());
+    EXPECT_EQ(app_count, ConfigStore(journal_config, key_and_iv_).Load().size());
+    std::cout << "  journal format, full load:   " << std::setw(6) << elapsed(start) << " ms\n";
+
+    ConfigRecordFile(index_path_, key_and_iv_).Rewrite(local_apps);
+    ConfigRecordFile file(index_path_, key_and_iv_);
+    start = Clock::now();
+    EXPECT_EQ(app_count, file.LoadIndex().size());
+    std::cout << "  record format, index only:   " << std::setw(6) << elapsed(start) << " ms\n";
+    start = Clock::now();
+    for (int i(0); i < 100; ++i)
+      file.ReadPathAndArgs(names[RandomUint32() % app_count]);
+    std::cout << "  record format, 100 reads:    " << std::setw(6) << elapsed(start) << " ms\n";
+    start = Clock::now();
+    EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+    std::cout << "  record format, full load:    " << std::setw(6) << elapsed(start) << " ms\n";
+  }
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,430 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_store.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/convert.h"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+#include "maidsafe/common/serialisation/types/boost_filesystem.h"
+
+#include "maidsafe/launcher/config_codec.h"
+#include "maidsafe/launcher/config_format.h"
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+class ConfigStoreTest : public testing::Test {
+ protected:
+  ConfigStoreTest()
+      : test_root_(maidsafe::test::CreateTestPath("MaidSafe_TestConfigStore")),
+        config_file_(*test_root_ / "config.txt"),
+        key_and_iv_(RandomBytes(crypto::AES256_KeySize + crypto::AES256_IVSize)) {}
+
+  std::set<AppDetails> Reload() {
+    ConfigStore store(config_file_, key_and_iv_);
+    auto local_apps(store.Load());
+    return std::set<AppDetails>(local_apps.begin(), local_apps.end());
+  }
+
+  static std::string ReadJournal(const fs::path& journal_path) {
+    std::ifstream journal(journal_path.string(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(journal), std::istreambuf_iterator<char>());
+  }
+
+  // Ignore the fields which aren't held in the config file.
+  static const int kConfigOnly = kIgnorePermittedDirs | kIgnoreIcon;
+
+  std::uint64_t JournalSize(const ConfigStore& store) const { return store.journal_size_; }
+
+  // Returns 'apps' serialised as they were before the current layout was introduced.
+  static std::string LegacyContents(const std::set<AppDetails>& apps) {
+    std::string contents(ConvertToString(apps.size()));
+    for (const auto& app : apps)
+      contents += ConvertToString(app.name, app.path, app.args, app.auto_start);
+    return contents;
+  }
+
+  std::string EncryptedLegacyContents(const std::set<AppDetails>& apps) const {
+    return crypto::SymmEncrypt(
+               crypto::Compress(
+                   crypto::UncompressedText(convert::ToByteVector(LegacyContents(apps))), 9)
+                   .data,
+               key_and_iv_)
+        ->string();
+  }
+
+  // Returns 'count' serialised single-app sets, for training a compression dictionary.
+  static std::vector<std::string> TypicalSamples(int count) {
+    std::vector<std::string> samples;
+    for (int i(0); i < count; ++i) {
+      PersistentSet<AppDetails> app;
+      app.insert(CreateTypicalAppDetails());
+      samples.push_back(SerialiseLocalApps(app));
+    }
+    return samples;
+  }
+
+  const maidsafe::test::TestPath test_root_;
+  const fs::path config_file_;
+  const crypto::AES256KeyAndIV key_and_iv_;
+};
+
+TEST_F(ConfigStoreTest, BEH_RecordAndReplay) {
+  ConfigStore store(config_file_, key_and_iv_);
+  EXPECT_TRUE(store.Load().empty());
+  EXPECT_FALSE(store.Exists());
+  EXPECT_TRUE(fs::is_empty(*test_root_));
+
+  std::set<AppDetails> apps;
+  for (int i(0); i < 10; ++i)
+    apps.insert(CreateRandomAppDetails());
+  store.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  EXPECT_TRUE(store.Exists());
+  EXPECT_TRUE(fs::exists(store.journal_path()));
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+  const auto base_contents(ReadFile(config_file_).value());
+
+  // Each kind of change is applied by replaying the journal, and leaves the base file untouched.
+  AppDetails added(CreateRandomAppDetails());
+  store.RecordPut(added);
+  apps.insert(added);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  AppDetails updated(*apps.begin());
+  apps.erase(apps.begin());
+  updated.args = RandomAlphaNumericString(50);
+  updated.auto_start = !updated.auto_start;
+  store.RecordPut(updated);
+  apps.insert(updated);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  AppDetails renamed(*apps.rbegin());
+  const AppName old_name(renamed.name);
+  apps.erase(renamed);
+  renamed.name = RandomAlphaNumericString(20);
+  store.RecordRename(old_name, renamed);
+  apps.insert(renamed);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  store.RecordErase(added.name);
+  apps.erase(added);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+  EXPECT_EQ(base_contents, ReadFile(config_file_).value());
+
+  // A reloaded store can append further records.
+  {
+    ConfigStore reloaded(config_file_, key_and_iv_);
+    reloaded.Load();
+    AppDetails added_after_reload(CreateRandomAppDetails());
+    reloaded.RecordPut(added_after_reload);
+    apps.insert(added_after_reload);
+  }
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  store.Remove();
+  EXPECT_FALSE(store.Exists());
+  EXPECT_TRUE(fs::is_empty(*test_root_));
+}
+
+TEST_F(ConfigStoreTest, BEH_RecordBatch) {
+  ConfigStore store(config_file_, key_and_iv_);
+  store.Load();
+  store.Rewrite(PersistentSet<AppDetails>());
+  const std::uint64_t empty_journal_size(JournalSize(store));
+
+  // Nothing is written until all of the batch's records have been made.
+  std::set<AppDetails> apps;
+  store.RecordBatch([&] {
+    for (int i(0); i < 10; ++i) {
+      AppDetails app(CreateRandomAppDetails());
+      store.RecordPut(app);
+      apps.insert(app);
+      EXPECT_EQ(empty_journal_size, fs::file_size(store.journal_path()));
+    }
+    store.RecordErase(apps.begin()->name);
+    apps.erase(apps.begin());
+  });
+  EXPECT_EQ(JournalSize(store), fs::file_size(store.journal_path()));
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  // An empty batch writes nothing.
+  store.RecordBatch([] {});
+  EXPECT_EQ(JournalSize(store), fs::file_size(store.journal_path()));
+}
+
+TEST_F(ConfigStoreTest, BEH_Compaction) {
+  ConfigStore store(config_file_, key_and_iv_);
+  store.Load();
+  PersistentSet<AppDetails> apps;
+  store.Rewrite(apps);
+  const std::uint64_t empty_journal_size(JournalSize(store));
+
+  while (!store.NeedsCompaction()) {
+    AppDetails app(CreateRandomAppDetails());
+    store.RecordPut(app);
+    apps.insert(app);
+  }
+  EXPECT_GT(JournalSize(store), ConfigStore::kMinCompactionSize);
+  EXPECT_EQ(JournalSize(store), fs::file_size(store.journal_path()));
+
+  store.Rewrite(apps);
+  EXPECT_FALSE(store.NeedsCompaction());
+  EXPECT_EQ(empty_journal_size, JournalSize(store));
+  EXPECT_EQ(empty_journal_size, fs::file_size(store.journal_path()));
+  EXPECT_TRUE(Equals(std::set<AppDetails>(apps.begin(), apps.end()), Reload(), kConfigOnly));
+}
+
+TEST_F(ConfigStoreTest, BEH_TornFinalRecord) {
+  ConfigStore store(config_file_, key_and_iv_);
+  store.Load();
+  std::set<AppDetails> apps;
+  apps.insert(CreateRandomAppDetails());
+  store.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  AppDetails first(CreateRandomAppDetails()), second(CreateRandomAppDetails());
+  store.RecordPut(first);
+  apps.insert(first);
+  const std::uint64_t good_size(fs::file_size(store.journal_path()));
+  store.RecordPut(second);
+
+  // Simulate a crash part way through writing the second record.
+  const std::uint64_t torn_size(
+      good_size + 1 + RandomUint32() % (fs::file_size(store.journal_path()) - good_size - 1));
+  fs::resize_file(store.journal_path(), torn_size);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+  EXPECT_EQ(good_size, fs::file_size(store.journal_path()));
+
+  // Records appended after recovery are replayed as normal.
+  ConfigStore recovered(config_file_, key_and_iv_);
+  recovered.Load();
+  recovered.RecordPut(second);
+  apps.insert(second);
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+}
+
+TEST_F(ConfigStoreTest, BEH_CorruptRecord) {
+  ConfigStore store(config_file_, key_and_iv_);
+  store.Load();
+  store.Rewrite(PersistentSet<AppDetails>());
+  store.RecordPut(CreateRandomAppDetails());
+  const std::uint64_t first_record_end(fs::file_size(store.journal_path()));
+  store.RecordPut(CreateRandomAppDetails());
+
+  // Flip a byte in the first record, which isn't the final one, so can't be a torn write.
+  std::string contents(ReadJournal(store.journal_path()));
+  contents[static_cast<std::size_t>(first_record_end) - 1] ^= 0x01;
+  ASSERT_TRUE(WriteFile(store.journal_path(), contents));
+  EXPECT_TRUE(ThrowsAs([&] { Reload(); }, CommonErrors::parsing_error));
+}
+
+TEST_F(ConfigStoreTest, BEH_StaleJournal) {
+  ConfigStore store(config_file_, key_and_iv_);
+  store.Load();
+  std::set<AppDetails> apps;
+  store.Rewrite(PersistentSet<AppDetails>());
+  AppDetails app(CreateRandomAppDetails());
+  store.RecordPut(app);
+  apps.insert(app);
+  const std::string stale_journal(ReadJournal(store.journal_path()));
+
+  // Simulate a crash after rewriting the base file but before resetting the journal: the old
+  // journal's records are already in the base file and mustn't be replayed over it.
+  store.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  ASSERT_TRUE(WriteFile(store.journal_path(), stale_journal));
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+  EXPECT_GT(stale_journal.size(), fs::file_size(store.journal_path()));
+}
+
+TEST_F(ConfigStoreTest, BEH_LegacyBaseFile) {
+  // Base files written before the current layout was introduced are still loaded.
+  std::set<AppDetails> apps;
+  for (int i(0); i < 10; ++i)
+    apps.insert(CreateRandomAppDetails());
+  ASSERT_TRUE(WriteFile(config_file_, EncryptedLegacyContents(apps)));
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+
+  // Subsequent changes are replayed over the legacy base file, and a rewrite replaces it.
+  {
+    ConfigStore store(config_file_, key_and_iv_);
+    store.Load();
+    AppDetails app(CreateRandomAppDetails());
+    store.RecordPut(app);
+    apps.insert(app);
+    EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+    store.Rewrite(PersistentSet<AppDetails>(apps.begin(), apps.end()));
+  }
+  EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+}
+
+TEST_F(ConfigStoreTest, FUNC_LoadTime) {
+  const std::size_t kAppCount(10000);
+  const int kIterations(10);
+  std::set<AppDetails> apps;
+  while (apps.size() < kAppCount)
+    apps.insert(CreateRandomAppDetails());
+  const PersistentSet<AppDetails> local_apps(apps.begin(), apps.end());
+  ConfigStore(config_file_, key_and_iv_).Rewrite(local_apps);
+
+  using Clock = std::chrono::steady_clock;
+  auto mean_since([&](Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start) /
+           kIterations;
+  });
+
+  // The whole load: read, decrypt, uncompress and parse.
+  std::set<AppDetails> loaded;
+  auto start(Clock::now());
+  for (int i(0); i < kIterations; ++i)
+    loaded = Reload();
+  const auto load_time(mean_since(start));
+  EXPECT_TRUE(Equals(apps, loaded, kConfigOnly));
+
+  // Parsing alone, compared with decoding the legacy layout via a stream as was previously done.
+  // Both must give the same apps.
+  const std::string serialised(SerialiseLocalApps(local_apps)), legacy(LegacyContents(apps));
+  PersistentSet<AppDetails> parsed, legacy_parsed;
+  start = Clock::now();
+  for (int i(0); i < kIterations; ++i)
+    parsed = ParseLocalApps(serialised.data(), serialised.size());
+  const auto parse_time(mean_since(start));
+  start = Clock::now();
+  for (int i(0); i < kIterations; ++i) {
+    legacy_parsed = PersistentSet<AppDetails>();
+    std::stringstream str_stream{legacy};
+    std::size_t app_count(ConvertFromStream<std::size_t>(str_stream));
+    for (std::size_t j{0}; j < app_count; ++j) {
+      AppDetails app;
+      ConvertFromStream(str_stream, app.name, app.path, app.args, app.auto_start);
+      legacy_parsed.insert(std::move(app));
+    }
+  }
+  const auto legacy_parse_time(mean_since(start));
+  const std::set<AppDetails> parsed_apps(parsed.begin(), parsed.end());
+  EXPECT_TRUE(Equals(apps, parsed_apps, kConfigOnly));
+  EXPECT_TRUE(Equals(std::set<AppDetails>(legacy_parsed.begin(), legacy_parsed.end()), parsed_apps,
+                     kConfigOnly));
+
+  LOG(kInfo) << "Config load time for " << kAppCount << " local apps: " << load_time.count()
+             << " us, of which parsing " << parse_time.count() << " us (legacy stream parsing "
+             << legacy_parse_time.count() << " us)";
+}
+
+TEST_F(ConfigStoreTest, BEH_Codecs) {
+  std::set<AppDetails> apps;
+  for (int i(0); i < 10; ++i)
+    apps.insert(CreateTypicalAppDetails());
+  const PersistentSet<AppDetails> local_apps(apps.begin(), apps.end());
+
+  // Files written with any codec using no dictionary or the default one can be loaded regardless
+  // of the loading store's codec.
+  for (const auto& codec : {ConfigCodec(ConfigCodec::Type::kNone, 0),
+                            ConfigCodec(ConfigCodec::Type::kGzip, 1), ConfigCodec(),
+                            ConfigCodec(ConfigCodec::Type::kLz, 9)}) {
+    ConfigStore store(config_file_, key_and_iv_);
+    store.SetCodec(codec);
+    store.Rewrite(local_apps);
+    EXPECT_TRUE(Equals(apps, Reload(), kConfigOnly));
+  }
+
+  // A file written with a trained dictionary needs that dictionary to be loaded.
+  const ConfigCodec trained(ConfigCodec::Type::kLz, 1,
+                            TrainConfigDictionary(TypicalSamples(100), 1024));
+  {
+    ConfigStore store(config_file_, key_and_iv_);
+    store.SetCodec(trained);
+    store.Rewrite(local_apps);
+  }
+  EXPECT_TRUE(ThrowsAs([&] { Reload(); }, CommonErrors::parsing_error));
+  ConfigStore store(config_file_, key_and_iv_);
+  store.SetCodec(trained);
+  const auto loaded(store.Load());
+  EXPECT_TRUE(Equals(apps, std::set<AppDetails>(loaded.begin(), loaded.end()), kConfigOnly));
+}
+
+TEST_F(ConfigStoreTest, FUNC_WriteLatency) {
+  // Compares the time taken to rewrite the base file, and its resulting size, for each codec.
+  // Previously every rewrite used gzip at level 9.
+  const std::string trained_dictionary(TrainConfigDictionary(TypicalSamples(500), 4096));
+  using Type = ConfigCodec::Type;
+  const std::vector<std::pair<std::string, ConfigCodec>> codecs{
+      {"none", ConfigCodec(Type::kNone, 0)},
+      {"gzip-1", ConfigCodec(Type::kGzip, 1)},
+      {"gzip-6", ConfigCodec(Type::kGzip, 6)},
+      {"gzip-9", ConfigCodec(Type::kGzip, 9)},
+      {"lz-1", ConfigCodec(Type::kLz, 1, std::string())},
+      {"lz-1+default", ConfigCodec()},
+      {"lz-1+trained", ConfigCodec(Type::kLz, 1, trained_dictionary)},
+      {"lz-6+trained", ConfigCodec(Type::kLz, 6, trained_dictionary)}};
+
+  using Clock = std::chrono::steady_clock;
+  const int kIterations(20);
+  for (std::size_t app_count : {10, 100, 1000, 10000}) {
+    std::set<AppDetails> apps;
+    while (apps.size() < app_count)
+      apps.insert(CreateTypicalAppDetails());
+    const PersistentSet<AppDetails> local_apps(apps.begin(), apps.end());
+    std::cout << "Rewriting " << app_count << " local apps ("
+              << SerialiseLocalApps(local_apps).size() << " bytes serialised):\n";
+    for (const auto& codec : codecs) {
+      ConfigStore store(config_file_, key_and_iv_);
+      store.SetFsyncPolicy(ConfigStore::FsyncPolicy::kNever);
+      store.SetCodec(codec.second);
+      const auto start(Clock::now());
+      for (int i(0); i < kIterations; ++i)
+        store.Rewrite(local_apps);
+      const auto write_time(std::chrono::duration_cast<std::chrono::microseconds>(
+                                Clock::now() - start) / kIterations);
+      const auto loaded(store.Load());
+      EXPECT_TRUE(Equals(apps, std::set<AppDetails>(loaded.begin(), loaded.end()), kConfigOnly));
+      std::cout << "  " << std::setw(14) << std::left << codec.first << std::right
+                << std::setw(8) << write_time.count() << " us  " << std::setw(8)
+                << fs::file_size(config_file_) << " bytes\n";
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
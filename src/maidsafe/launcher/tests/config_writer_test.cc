@@ -0,0 +1,143 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/config_writer.h"
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+class ConfigWriterTest : public testing::Test {
+ protected:
+  ConfigWriterTest()
+      : test_root_(maidsafe::test::CreateTestPath("MaidSafe_TestConfigWriter")),
+        config_file_(*test_root_ / "config.txt"),
+        key_and_iv_(RandomBytes(crypto::AES256_KeySize + crypto::AES256_IVSize)) {}
+
+  std::unique_ptr<ConfigWriter> MakeWriter(const fs::path& config_file,
+                                           std::chrono::milliseconds group_commit_delay) {
+    return maidsafe::make_unique<ConfigWriter>(
+        maidsafe::make_unique<ConfigStore>(config_file, key_and_iv_), group_commit_delay);
+  }
+
+  std::set<AppDetails> Reload(const fs::path& config_file) {
+    ConfigStore store(config_file, key_and_iv_);
+    auto local_apps(store.Load());
+    return std::set<AppDetails>(local_apps.begin(), local_apps.end());
+  }
+
+  static ConfigWriter::ConfigChange Put(const AppDetails& app) {
+    return [app](ConfigStore& config_store) { config_store.RecordPut(app); };
+  }
+
+  static const int kConfigOnly = kIgnorePermittedDirs | kIgnoreIcon;
+
+  const maidsafe::test::TestPath test_root_;
+  const fs::path config_file_;
+  const crypto::AES256KeyAndIV key_and_iv_;
+};
+
+TEST_F(ConfigWriterTest, BEH_GroupCommit) {
+  auto writer(MakeWriter(config_file_, std::chrono::milliseconds(50)));
+  PersistentSet<AppDetails> apps;
+  std::vector<ConfigWriter::Ticket> tickets;
+  tickets.push_back(writer->Rewrite(apps));
+  for (int i(0); i < 100; ++i) {
+    AppDetails app(CreateRandomAppDetails());
+    apps.insert(app);
+    tickets.push_back(writer->Record(std::vector<ConfigWriter::ConfigChange>(1, Put(app)), apps));
+  }
+
+  // Tickets are issued in order, and waiting on one means all earlier ones are also on disk.
+  for (std::size_t i(1); i < tickets.size(); ++i)
+    EXPECT_LT(tickets[i - 1], tickets[i]);
+  writer->Wait(tickets[tickets.size() / 2]);
+  EXPECT_TRUE(fs::exists(config_file_));
+  writer->Flush();
+  EXPECT_FALSE(fs::exists(config_file_.string() + ".tmp"));
+  EXPECT_TRUE(Equals(std::set<AppDetails>(apps.begin(), apps.end()), Reload(config_file_),
+                     kConfigOnly));
+
+  // Removal supersedes any earlier queued changes.
+  writer->Record(std::vector<ConfigWriter::ConfigChange>(1, Put(CreateRandomAppDetails())),
+                 apps);
+  writer->Remove();
+  writer->Flush();
+  EXPECT_TRUE(fs::is_empty(*test_root_));
+}
+
+TEST_F(ConfigWriterTest, BEH_DestructorFlushes) {
+  PersistentSet<AppDetails> apps;
+  {
+    auto writer(MakeWriter(config_file_, std::chrono::milliseconds(1000)));
+    writer->Rewrite(apps);
+    for (int i(0); i < 10; ++i) {
+      AppDetails app(CreateRandomAppDetails());
+      apps.insert(app);
+      writer->Record(std::vector<ConfigWriter::ConfigChange>(1, Put(app)), apps);
+    }
+  }
+  EXPECT_TRUE(Equals(std::set<AppDetails>(apps.begin(), apps.end()), Reload(config_file_),
+                     kConfigOnly));
+}
+
+TEST_F(ConfigWriterTest, BEH_FailedCommitIsReportedAndRepaired) {
+  // Writing into a directory which doesn't exist yet fails.
+  const fs::path config_dir(*test_root_ / "not_yet_created");
+  const fs::path config_file(config_dir / "config.txt");
+  auto writer(MakeWriter(config_file, std::chrono::milliseconds(0)));
+  PersistentSet<AppDetails> apps;
+  AppDetails first(CreateRandomAppDetails());
+  apps.insert(first);
+  auto ticket(writer->Rewrite(apps));
+  EXPECT_TRUE(ThrowsAs([&] { writer->Wait(ticket); }, CommonErrors::filesystem_io_error));
+  EXPECT_TRUE(ThrowsAs([&] { writer->Flush(); }, CommonErrors::filesystem_io_error));
+
+  // The next commit must write the full state, including the change which previously failed.
+  ASSERT_TRUE(fs::create_directories(config_dir));
+  AppDetails second(CreateRandomAppDetails());
+  apps.insert(second);
+  ticket = writer->Record(std::vector<ConfigWriter::ConfigChange>(1, Put(second)), apps);
+  EXPECT_NO_THROW(writer->Wait(ticket));
+  EXPECT_TRUE(Equals(std::set<AppDetails>(apps.begin(), apps.end()), Reload(config_file),
+                     kConfigOnly));
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
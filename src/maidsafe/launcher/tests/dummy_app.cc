@@ -16,61 +16,212 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+// A stand-in app for testing and benchmarking the Launcher.  It connects over whichever transport
+// it was launched with, sends a session key, then sends its confirmation, completing the handshake.
+// Its own options are:
+//
+//   --think_time_ms=N  wait N milliseconds before sending each message (default 0)
+//   --behaviour=B      one of:
+//                        complete    handshake as above (the default)
+//                        drop        close the connection without sending anything
+//                        garbage     send random bytes of the wrong size in place of the session
+//                                    key, then never confirm
+//                        hang        send the session key, then never confirm
+//                        exit_early  exit without connecting
+//
+// Whatever its behaviour, it exits once the Launcher closes the connection (or after ten minutes at
+// most), so that no instance outlives a test run for long.
+
 #include <chrono>
 #include <cstdint>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "asio/io_service_strand.hpp"
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
+#include "maidsafe/common/tcp/connection.h"
+
+#include "maidsafe/launcher/local_connection.h"
+#include "maidsafe/launcher/types.h"
+
+namespace {
+
+enum class Behaviour { kComplete, kDrop, kGarbage, kHang, kExitEarly };
+
+struct Options {
+  Options()
+      : launcher_fd(-1),
+        launcher_port(0),
+        launch_token(),
+        think_time(0),
+        behaviour(Behaviour::kComplete) {}
+
+  int launcher_fd;
+  maidsafe::tcp::Port launcher_port;
+  std::string launch_token;
+  std::chrono::milliseconds think_time;
+  Behaviour behaviour;
+};
+
+const std::size_t kGarbageSize(37);
+const std::chrono::minutes kMaxWait(10);
+
+void ThrowInvalidArgument(const std::string& arg) {
+  LOG(kError) << "Invalid argument: " << arg;
+  BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_argument));
+}
+
+// Returns true and sets 'value' if 'arg' is "--<name>=<value>".
+bool ParseOption(const std::string& arg, const std::string& name, std::string& value) {
+  const std::string prefix("--" + name + "=");
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+Behaviour ParseBehaviour(const std::string& value) {
+  if (value == "complete")
+    return Behaviour::kComplete;
+  if (value == "drop")
+    return Behaviour::kDrop;
+  if (value == "garbage")
+    return Behaviour::kGarbage;
+  if (value == "hang")
+    return Behaviour::kHang;
+  if (value == "exit_early")
+    return Behaviour::kExitEarly;
+  ThrowInvalidArgument("--behaviour=" + value);
+  return Behaviour::kComplete;
+}
+
+// 'unuseds' holds the program name followed by the arguments not consumed by logging.  The Launcher
+// passes either "--launcher_fd=N", or "--launcher_port=X" and "--launch_token=Y".
+Options ParseOptions(const std::vector<std::vector<char>>& unuseds) {
+  Options options;
+  for (std::size_t i(1); i < unuseds.size(); ++i) {
+    const std::string arg(&unuseds[i][0]);
+    std::string value;
+    if (ParseOption(arg, "launcher_fd", value))
+      options.launcher_fd = std::stoi(value);
+    else if (ParseOption(arg, "launcher_port", value))
+      options.launcher_port = static_cast<maidsafe::tcp::Port>(std::stoi(value));
+    else if (ParseOption(arg, "launch_token", value))
+      options.launch_token = value;
+    else if (ParseOption(arg, "think_time_ms", value))
+      options.think_time = std::chrono::milliseconds(std::stoi(value));
+    else if (ParseOption(arg, "behaviour", value))
+      options.behaviour = ParseBehaviour(value);
+    else
+      ThrowInvalidArgument(arg);
+  }
+  if ((options.launcher_fd == -1) == (options.launcher_port == 0 || options.launch_token.empty()))
+    ThrowInvalidArgument("expected either a launcher descriptor, or a port and token");
+  return options;
+}
+
+maidsafe::tcp::Message RandomMessage(std::size_t size) {
+  const std::string data(maidsafe::RandomString(size));
+  return maidsafe::tcp::Message(data.begin(), data.end());
+}
+
+// The app's end of its connection to the Launcher, over either transport.
+class LauncherConnection {
+ public:
+  LauncherConnection(asio::io_service::strand& strand, const Options& options)
+      : local_connection_(), tcp_connection_(), once_(), closed_() {
+    auto on_closed([this] { std::call_once(once_, [this] { closed_.set_value(); }); });
+    if (options.launcher_fd != -1) {
+      local_connection_ = maidsafe::launcher::LocalConnection::MakeShared(strand,
+                                                                          options.launcher_fd);
+      local_connection_->Start([](maidsafe::tcp::Message) {}, on_closed);
+    } else {
+      tcp_connection_ = maidsafe::tcp::Connection::MakeShared(strand, options.launcher_port);
+      tcp_connection_->Start([](maidsafe::tcp::Message) {}, on_closed);
+      // The first message over TCP identifies the launch.
+      Send(maidsafe::tcp::Message(options.launch_token.begin(), options.launch_token.end()));
+    }
+  }
+
+  void Send(maidsafe::tcp::Message message) {
+    if (local_connection_)
+      local_connection_->Send(std::move(message));
+    else
+      tcp_connection_->Send(std::move(message));
+  }
+
+  // Abandons any messages not yet written.
+  void Close() {
+    if (local_connection_)
+      local_connection_->Close();
+    else
+      tcp_connection_->Close();
+  }
+
+  // Returns false if the connection is still open after 'timeout'.
+  bool WaitForClose(std::chrono::steady_clock::duration timeout) {
+    return closed_.get_future().wait_for(timeout) == std::future_status::ready;
+  }
+
+ private:
+  maidsafe::launcher::LocalConnectionPtr local_connection_;
+  maidsafe::tcp::ConnectionPtr tcp_connection_;
+  std::once_flag once_;
+  std::promise<void> closed_;
+};
+
+}  // unnamed namespace
 
 int main(int argc, char* argv[]) {
-  bool connected_to_launcher{false}, should_hang{false};
+  bool connected_to_launcher{false};
   int exit_code{0};
   try {
     auto unuseds(maidsafe::log::Logging::Instance().Initialise(argc, argv));
-    if (unuseds.size() != 2U)
-      BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_argument));
-    // uint16_t port{static_cast<uint16_t>(std::stoi(std::string{&unuseds[1][0]}))};
-    // maidsafe::launcher::ClientInterface client_interface{port};
-    // connected_to_launcher = true;
-
-    //  std::future<void> worker;
-    //  VaultConfig config{ vault_interface.GetConfiguration() };
-    //  switch (config.test_config.test_type) {
-    //  case VaultConfig::TestType::kNone:
-    //    break;
-    //  case VaultConfig::TestType::kKillConnection:
-    //    worker = std::async(std::launch::async, [&] { vault_interface.KillConnection(); });
-    //    break;
-    //  case VaultConfig::TestType::kSendInvalidMessage:
-    //    worker = std::async(std::launch::async, [&] { vault_interface.SendInvalidMessage(); });
-    //    break;
-    //  case VaultConfig::TestType::kStopProcess:
-    //    worker = std::async(std::launch::async, [&] { vault_interface.StopProcess(); });
-    //    break;
-    //  case VaultConfig::TestType::kIgnoreStopRequest:
-    //    should_hang = true;
-    //    break;
-    //  default:
-    //    BOOST_THROW_EXCEPTION(maidsafe::MakeError(maidsafe::CommonErrors::invalid_argument));
-    //  }
-    //  exit_code = vault_interface.WaitForExit();
-    //  worker.get();
+    const Options options(ParseOptions(unuseds));
+    if (options.behaviour == Behaviour::kExitEarly)
+      return exit_code;
+
+    maidsafe::AsioService asio_service(1);
+    asio::io_service::strand strand(asio_service.service());
+    LauncherConnection connection(strand, options);
+    connected_to_launcher = true;
+
+    if (options.behaviour == Behaviour::kDrop) {
+      connection.Close();
+    } else {
+      maidsafe::Sleep(options.think_time);
+      connection.Send(RandomMessage(
+          options.behaviour == Behaviour::kGarbage ? kGarbageSize
+                                                   : maidsafe::launcher::kSessionKeySize));
+      if (options.behaviour == Behaviour::kComplete) {
+        maidsafe::Sleep(options.think_time);
+        const std::string confirmation("confirmed");
+        // The Launcher closes the connection once it has the confirmation.
+        connection.Send(maidsafe::tcp::Message(confirmation.begin(), confirmation.end()));
+      }
+    }
+    if (!connection.WaitForClose(kMaxWait))
+      LOG(kWarning) << "Launcher didn't close the connection.";
+    asio_service.Stop();
   } catch (const maidsafe::maidsafe_error& error) {
     if (connected_to_launcher)
       LOG(kError) << error.what();
     else
-      LOG(kError) << "This is only designed to be invoked by VaultManager.";
+      LOG(kError) << "This is only designed to be invoked by the Launcher.";
     exit_code = maidsafe::ErrorToInt(error);
   } catch (const std::exception& e) {
     if (connected_to_launcher)
       LOG(kError) << e.what();
     else
-      LOG(kError) << "This is only designed to be invoked by VaultManager.";
+      LOG(kError) << "This is only designed to be invoked by the Launcher.";
     exit_code = maidsafe::ErrorToInt(maidsafe::MakeError(maidsafe::CommonErrors::invalid_argument));
   }
-  if (should_hang)
-    maidsafe::Sleep(std::chrono::hours(6));
   return exit_code;
 }
@@ -0,0 +1,198 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/launch_latencies.h"
+
+#include <chrono>
+#include <cstdint>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+using std::chrono::milliseconds;
+
+// Bucket bounds grow by a factor of 2^(1/4), and are rounded up to whole milliseconds.
+void ExpectBucketBound(milliseconds latency, milliseconds percentile) {
+  EXPECT_LE(latency, percentile);
+  EXPECT_LE(percentile.count(), latency.count() * 1.19 + 1);
+}
+
+}  // unnamed namespace
+
+TEST(LaunchLatenciesTest, BEH_Histogram) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(milliseconds(0), histogram.Percentile(0.99));
+  for (int i(1); i <= 100; ++i)
+    histogram.Add(milliseconds(i));
+  EXPECT_EQ(100U, histogram.SampleCount());
+  EXPECT_EQ(milliseconds(1), histogram.Percentile(0.0));
+  ExpectBucketBound(milliseconds(50), histogram.Percentile(0.5));
+  ExpectBucketBound(milliseconds(99), histogram.Percentile(0.99));
+  ExpectBucketBound(milliseconds(100), histogram.Percentile(1.0));
+
+  // Latencies beyond the last bucket are counted in it.
+  histogram.Add(std::chrono::hours(24));
+  EXPECT_LT(std::chrono::hours(1), histogram.Percentile(1.0));
+
+  // Counts are halved on reaching the threshold, so recent latencies come to dominate.
+  for (std::uint64_t i(histogram.SampleCount()); i < LatencyHistogram::kDecayThreshold * 3; ++i) {
+    histogram.Add(milliseconds(1));
+    ASSERT_LT(histogram.SampleCount(), LatencyHistogram::kDecayThreshold);
+  }
+  EXPECT_EQ(milliseconds(1), histogram.Percentile(0.99));
+
+  EXPECT_EQ(histogram.BucketCounts(), LatencyHistogram(histogram.BucketCounts()).BucketCounts());
+  LatencyHistogram::Counts counts{};
+  counts[0] = LatencyHistogram::kDecayThreshold;
+  EXPECT_THROW(LatencyHistogram{counts}, common_error);
+}
+
+TEST(LaunchLatenciesTest, BEH_LaunchTimeout) {
+  const LaunchTimeoutPolicy policy(std::chrono::minutes(1), std::chrono::seconds(2),
+                                   std::chrono::minutes(2));
+  LatencyHistogram latencies;
+
+  // Too few samples - use the initial timeout.
+  for (std::size_t i(1); i < policy.min_samples; ++i)
+    latencies.Add(std::chrono::seconds(2));
+  EXPECT_EQ(policy.initial_timeout, LaunchTimeout(policy, latencies));
+
+  // A multiple of the percentile latency...
+  latencies.Add(std::chrono::seconds(2));
+  ExpectBucketBound(std::chrono::seconds(6), LaunchTimeout(policy, latencies));
+
+  // ...bounded below, so that a stuck fast app fails quickly...
+  LatencyHistogram fast;
+  for (std::size_t i(0); i < policy.min_samples; ++i)
+    fast.Add(milliseconds(100));
+  EXPECT_EQ(policy.min_timeout, LaunchTimeout(policy, fast));
+
+  // ...and above, however slow the app has been.
+  LatencyHistogram slow;
+  for (std::size_t i(0); i < policy.min_samples; ++i)
+    slow.Add(std::chrono::minutes(1));
+  EXPECT_EQ(policy.max_timeout, LaunchTimeout(policy, slow));
+}
+
+TEST(LaunchLatenciesTest, BEH_TimedOutPhasesAreNotSampled) {
+  const maidsafe::test::TestPath test_root(
+      maidsafe::test::CreateTestPath("MaidSafe_TestLaunchLatencies"));
+  const crypto::AES256KeyAndIV key_and_iv(
+      RandomBytes(crypto::AES256_KeySize + crypto::AES256_IVSize));
+  const LaunchTimeoutPolicy connect_policy(std::chrono::minutes(1), std::chrono::seconds(2),
+                                           std::chrono::minutes(2));
+  const LaunchTimeoutPolicy handshake_policy;
+  LaunchLatencies latencies(*test_root / "launch_latencies", key_and_iv, connect_policy,
+                            handshake_policy);
+
+  // An app which has never connected keeps the initial timeouts, however often it stalls.
+  for (std::uint64_t i(1); i <= 100; ++i) {
+    EXPECT_EQ(i, latencies.TimedOut("stuck app", LaunchPhase::kConnect));
+    EXPECT_EQ(connect_policy.initial_timeout, latencies.Timeouts("stuck app").connect);
+  }
+  EXPECT_EQ(1U, latencies.TimedOut("stuck app", LaunchPhase::kHandshake));
+  EXPECT_EQ(handshake_policy.initial_timeout, latencies.Timeouts("stuck app").handshake);
+  EXPECT_EQ(0U, latencies.Histogram("stuck app", LaunchPhase::kConnect).SampleCount());
+
+  // Once an app's timeouts are derived from its latencies, repeated timeouts never raise them.
+  for (int i(0); i < 20; ++i) {
+    latencies.Add("app", LaunchPhase::kConnect, std::chrono::seconds(3));
+    latencies.Add("app", LaunchPhase::kHandshake, milliseconds(200));
+  }
+  const LaunchTimeouts timeouts(latencies.Timeouts("app"));
+  ExpectBucketBound(std::chrono::seconds(9), timeouts.connect);
+  for (int i(0); i < 1000; ++i) {
+    latencies.TimedOut("app", LaunchPhase::kConnect);
+    latencies.TimedOut("app", LaunchPhase::kHandshake);
+    const LaunchTimeouts current(latencies.Timeouts("app"));
+    ASSERT_LE(current.connect, timeouts.connect);
+    ASSERT_LE(current.handshake, timeouts.handshake);
+  }
+  EXPECT_EQ(20U, latencies.Histogram("app", LaunchPhase::kConnect).SampleCount());
+  EXPECT_EQ(20U, latencies.Histogram("app", LaunchPhase::kHandshake).SampleCount());
+}
+
+TEST(LaunchLatenciesTest, BEH_PersistAndReload) {
+  const maidsafe::test::TestPath test_root(
+      maidsafe::test::CreateTestPath("MaidSafe_TestLaunchLatencies"));
+  const boost::filesystem::path file_path(*test_root / "launch_latencies");
+  const crypto::AES256KeyAndIV key_and_iv(
+      RandomBytes(crypto::AES256_KeySize + crypto::AES256_IVSize));
+  const LaunchTimeoutPolicy connect_policy(std::chrono::minutes(1), std::chrono::seconds(2),
+                                           std::chrono::minutes(2));
+  const LaunchTimeoutPolicy handshake_policy;
+
+  LaunchTimeouts timeouts;
+  {
+    LaunchLatencies latencies(file_path, key_and_iv, connect_policy, handshake_policy);
+    const LaunchTimeouts initial(latencies.Timeouts("app"));
+    EXPECT_EQ(connect_policy.initial_timeout, initial.connect);
+    EXPECT_EQ(handshake_policy.initial_timeout, initial.handshake);
+    for (int i(0); i < 20; ++i) {
+      latencies.Add("app", LaunchPhase::kConnect, std::chrono::seconds(3));
+      latencies.Add("app", LaunchPhase::kHandshake, milliseconds(200));
+    }
+    latencies.Add("other app", LaunchPhase::kConnect, std::chrono::seconds(1));
+    timeouts = latencies.Timeouts("app");
+    ExpectBucketBound(std::chrono::seconds(9), timeouts.connect);
+    EXPECT_EQ(handshake_policy.min_timeout, timeouts.handshake);
+    EXPECT_EQ(connect_policy.initial_timeout, latencies.Timeouts("other app").connect);
+    latencies.Save();
+  }
+
+  // The histograms survive being reloaded...
+  {
+    LaunchLatencies latencies(file_path, key_and_iv, connect_policy, handshake_policy);
+    EXPECT_EQ(timeouts.connect, latencies.Timeouts("app").connect);
+    EXPECT_EQ(timeouts.handshake, latencies.Timeouts("app").handshake);
+    EXPECT_EQ(20U, latencies.Histogram("app", LaunchPhase::kHandshake).SampleCount());
+    EXPECT_EQ(1U, latencies.Histogram("other app", LaunchPhase::kConnect).SampleCount());
+    EXPECT_EQ(0U, latencies.Histogram("other app", LaunchPhase::kHandshake).SampleCount());
+  }
+
+  // ...but are discarded if they can't be read.
+  const crypto::AES256KeyAndIV other_key_and_iv(
+      RandomBytes(crypto::AES256_KeySize + crypto::AES256_IVSize));
+  {
+    LaunchLatencies latencies(file_path, other_key_and_iv, connect_policy, handshake_policy);
+    EXPECT_EQ(connect_policy.initial_timeout, latencies.Timeouts("app").connect);
+  }
+  ASSERT_TRUE(WriteFile(file_path, "MSCLAT01 corrupt"));
+  {
+    LaunchLatencies latencies(file_path, key_and_iv, connect_policy, handshake_policy);
+    EXPECT_EQ(0U, latencies.Histogram("app", LaunchPhase::kConnect).SampleCount());
+  }
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
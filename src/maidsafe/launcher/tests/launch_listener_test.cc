@@ -0,0 +1,176 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/launch_listener.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "asio/io_service_strand.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+tcp::Message ToMessage(const std::string& text) { return tcp::Message(text.begin(), text.end()); }
+
+// The handlers of a single registration, each of which fulfils a promise.
+struct Registered {
+  std::promise<tcp::ConnectionPtr> connection;
+  std::promise<tcp::Message> message;
+  std::promise<void> closed;
+};
+
+LaunchToken Register(LaunchListener& launch_listener, std::shared_ptr<Registered> registered) {
+  return launch_listener.Register(
+      [registered](tcp::ConnectionPtr connection) { registered->connection.set_value(connection); },
+      [registered](tcp::Message message) { registered->message.set_value(std::move(message)); },
+      [registered] { registered->closed.set_value(); });
+}
+
+// An app's end of a connection to the launch listener, which records whether it's been closed.
+struct Client {
+  Client(asio::io_service::strand& strand, tcp::Port port)
+      : connection(tcp::Connection::MakeShared(strand, port)), closed() {
+    connection->Start([](tcp::Message) {}, [this] { closed.set_value(); });
+  }
+
+  bool WaitForClose() {
+    return closed.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+  }
+
+  tcp::ConnectionPtr connection;
+  std::promise<void> closed;
+};
+
+template <typename T>
+bool IsReady(std::future<T>& future) {
+  return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+}
+
+}  // unnamed namespace
+
+TEST(LaunchListenerTest, BEH_RoutesByToken) {
+  AsioService asio_service(2);
+  asio::io_service::strand strand(asio_service.service());
+  auto launch_listener(
+      LaunchListener::MakeShared(asio_service.service(), std::chrono::seconds(10)));
+
+  // Tokens are distinct, and both launches share the one listening port.
+  auto first(std::make_shared<Registered>()), second(std::make_shared<Registered>());
+  const LaunchToken first_token(Register(*launch_listener, first));
+  const LaunchToken second_token(Register(*launch_listener, second));
+  EXPECT_NE(first_token, second_token);
+  EXPECT_EQ(2U, launch_listener->PendingCount());
+
+  // Connections are routed by the token they present, not by the order they connect in.
+  Client second_client(strand, launch_listener->ListeningPort());
+  second_client.connection->Send(ToMessage(second_token));
+  Client first_client(strand, launch_listener->ListeningPort());
+  first_client.connection->Send(ToMessage(first_token));
+  auto first_connection(first->connection.get_future());
+  auto second_connection(second->connection.get_future());
+  ASSERT_TRUE(IsReady(first_connection));
+  ASSERT_TRUE(IsReady(second_connection));
+  // As the Launcher does, the routed connections are kept for the duration of the handshake.
+  const tcp::ConnectionPtr first_routed(first_connection.get());
+  const tcp::ConnectionPtr second_routed(second_connection.get());
+  EXPECT_TRUE(first_routed != nullptr);
+  EXPECT_TRUE(second_routed != nullptr);
+  EXPECT_EQ(0U, launch_listener->PendingCount());
+
+  // Subsequent messages and closure are forwarded to the matching registration.
+  first_client.connection->Send(ToMessage("first"));
+  second_client.connection->Send(ToMessage("second"));
+  auto first_message(first->message.get_future());
+  auto second_message(second->message.get_future());
+  ASSERT_TRUE(IsReady(first_message));
+  ASSERT_TRUE(IsReady(second_message));
+  EXPECT_EQ(ToMessage("first"), first_message.get());
+  EXPECT_EQ(ToMessage("second"), second_message.get());
+  second_client.connection->Close();
+  auto second_closed(second->closed.get_future());
+  EXPECT_TRUE(IsReady(second_closed));
+
+  // A spent token is refused.
+  Client replay_client(strand, launch_listener->ListeningPort());
+  replay_client.connection->Send(ToMessage(first_token));
+  EXPECT_TRUE(replay_client.WaitForClose());
+
+  // As is a withdrawn one, and an unknown one.
+  auto withdrawn(std::make_shared<Registered>());
+  const LaunchToken withdrawn_token(Register(*launch_listener, withdrawn));
+  EXPECT_TRUE(launch_listener->Unregister(withdrawn_token));
+  EXPECT_FALSE(launch_listener->Unregister(withdrawn_token));
+  EXPECT_FALSE(launch_listener->Unregister(first_token));
+  Client withdrawn_client(strand, launch_listener->ListeningPort());
+  withdrawn_client.connection->Send(ToMessage(withdrawn_token));
+  EXPECT_TRUE(withdrawn_client.WaitForClose());
+  Client unknown_client(strand, launch_listener->ListeningPort());
+  unknown_client.connection->Send(ToMessage("unknown"));
+  EXPECT_TRUE(unknown_client.WaitForClose());
+  EXPECT_EQ(0U, launch_listener->PendingCount());
+
+  first_client.connection->Close();
+  launch_listener.reset();
+  asio_service.Stop();
+}
+
+TEST(LaunchListenerTest, BEH_IdentifyTimeout) {
+  AsioService asio_service(2);
+  asio::io_service::strand strand(asio_service.service());
+  auto launch_listener(
+      LaunchListener::MakeShared(asio_service.service(), std::chrono::milliseconds(100)));
+  auto registered(std::make_shared<Registered>());
+  const LaunchToken token(Register(*launch_listener, registered));
+
+  // A connection which doesn't present a token is closed, and the registration is unaffected.
+  Client silent_client(strand, launch_listener->ListeningPort());
+  EXPECT_TRUE(silent_client.WaitForClose());
+  EXPECT_EQ(1U, launch_listener->PendingCount());
+
+  // A connection which presents one in time stays open beyond the timeout.
+  Client client(strand, launch_listener->ListeningPort());
+  client.connection->Send(ToMessage(token));
+  auto connection(registered->connection.get_future());
+  ASSERT_TRUE(IsReady(connection));
+  const tcp::ConnectionPtr routed(connection.get());
+  auto closed(registered->closed.get_future());
+  EXPECT_EQ(std::future_status::timeout, closed.wait_for(std::chrono::milliseconds(300)));
+
+  client.connection->Close();
+  EXPECT_TRUE(IsReady(closed));
+  launch_listener.reset();
+  asio_service.Stop();
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
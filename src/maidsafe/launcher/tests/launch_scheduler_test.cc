@@ -0,0 +1,186 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/launch_scheduler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+// With a single io_service thread, apps are started in the order the scheduler posts them.
+//
+// Records the order in which apps are started, and holds each launch open until it's settled by
+// the test.  Apps named in 'failing' throw from the start functor instead.
+class Recorder {
+ public:
+  explicit Recorder(std::set<AppName> failing = std::set<AppName>())
+      : failing_(std::move(failing)), mutex_(), cond_var_(), started_(), on_settled_() {}
+
+  LaunchScheduler::StartFunctor StartFunctor() {
+    return [this](const AppName& app_name, std::function<void()> on_settled) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      started_.push_back(app_name);
+      cond_var_.notify_all();
+      if (failing_.count(app_name) != 0)
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+      on_settled_.emplace(app_name, std::move(on_settled));
+    };
+  }
+
+  // Waits until 'count' apps have been started, and returns them in the order started.
+  std::vector<AppName> WaitForStarted(std::size_t count) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(10),
+                                   [&] { return started_.size() >= count; }));
+    return started_;
+  }
+
+  void Settle(const AppName& app_name) {
+    std::function<void()> on_settled;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      on_settled = on_settled_.at(app_name);
+    }
+    on_settled();
+  }
+
+ private:
+  const std::set<AppName> failing_;
+  std::mutex mutex_;
+  std::condition_variable cond_var_;
+  std::vector<AppName> started_;
+  std::map<AppName, std::function<void()>> on_settled_;
+};
+
+AutoStartOptions::AppOptions Options(int priority, std::set<AppName> launch_after = {}) {
+  AutoStartOptions::AppOptions options;
+  options.priority = priority;
+  options.launch_after = std::move(launch_after);
+  return options;
+}
+
+}  // unnamed namespace
+
+TEST(LaunchSchedulerTest, BEH_PriorityAndConcurrencyCap) {
+  AsioService asio_service(1);
+  Recorder recorder;
+  AutoStartOptions options;
+  options.max_concurrent_launches = 2;
+  options.apps["b"] = Options(5);
+  options.apps["d"] = Options(10);
+  options.apps["unknown"] = Options(20);
+  auto scheduler(LaunchScheduler::MakeShared(asio_service.service(), {"a", "b", "c", "d", "e"},
+                                             options, recorder.StartFunctor()));
+  EXPECT_EQ(5U, scheduler->PendingCount());
+
+  // Only two launches are in progress at a time, highest priority first, then by name.
+  scheduler->Start();
+  EXPECT_EQ((std::vector<AppName>{"d", "b"}), recorder.WaitForStarted(2));
+  EXPECT_EQ(3U, scheduler->PendingCount());
+  EXPECT_EQ(2U, scheduler->InProgressCount());
+  recorder.Settle("b");
+  EXPECT_EQ((std::vector<AppName>{"d", "b", "a"}), recorder.WaitForStarted(3));
+  recorder.Settle("d");
+  recorder.Settle("d");  // Settling again is harmless.
+  EXPECT_EQ((std::vector<AppName>{"d", "b", "a", "c"}), recorder.WaitForStarted(4));
+  EXPECT_EQ(1U, scheduler->PendingCount());
+  EXPECT_EQ(2U, scheduler->InProgressCount());
+  recorder.Settle("a");
+  recorder.Settle("c");
+  EXPECT_EQ((std::vector<AppName>{"d", "b", "a", "c", "e"}), recorder.WaitForStarted(5));
+  recorder.Settle("e");
+  EXPECT_EQ(0U, scheduler->PendingCount());
+  EXPECT_EQ(0U, scheduler->InProgressCount());
+  scheduler->Stop();
+  asio_service.Stop();
+}
+
+TEST(LaunchSchedulerTest, BEH_LaunchAfter) {
+  AsioService asio_service(1);
+  Recorder recorder;
+  AutoStartOptions options;
+  options.max_concurrent_launches = 10;
+  // 'a' waits for 'b', which waits for 'c', despite their priorities.  Dependencies on apps not
+  // being launched, or on themselves, are ignored.
+  options.apps["a"] = Options(10, {"b"});
+  options.apps["b"] = Options(5, {"c", "b", "not_auto_started"});
+  // 'x' and 'y' form a cycle, which is broken once nothing else can proceed.
+  options.apps["x"] = Options(0, {"y"});
+  options.apps["y"] = Options(1, {"x"});
+  auto scheduler(LaunchScheduler::MakeShared(asio_service.service(), {"a", "b", "c", "x", "y"},
+                                             options, recorder.StartFunctor()));
+  scheduler->Start();
+  EXPECT_EQ((std::vector<AppName>{"c"}), recorder.WaitForStarted(1));
+  recorder.Settle("c");
+  EXPECT_EQ((std::vector<AppName>{"c", "b"}), recorder.WaitForStarted(2));
+  recorder.Settle("b");
+  EXPECT_EQ((std::vector<AppName>{"c", "b", "a"}), recorder.WaitForStarted(3));
+  recorder.Settle("a");
+  EXPECT_EQ((std::vector<AppName>{"c", "b", "a", "y"}), recorder.WaitForStarted(4));
+  recorder.Settle("y");
+  EXPECT_EQ((std::vector<AppName>{"c", "b", "a", "y", "x"}), recorder.WaitForStarted(5));
+  recorder.Settle("x");
+  EXPECT_EQ(0U, scheduler->PendingCount());
+  scheduler->Stop();
+  asio_service.Stop();
+}
+
+TEST(LaunchSchedulerTest, BEH_FailedStartAndStop) {
+  AsioService asio_service(1);
+  // A launch which fails to start settles immediately, and its dependents still launch.
+  Recorder recorder({"a"});
+  AutoStartOptions options;
+  options.max_concurrent_launches = 1;
+  options.apps["b"] = Options(0, {"a"});
+  auto scheduler(LaunchScheduler::MakeShared(asio_service.service(), {"a", "b", "c", "d"},
+                                             options, recorder.StartFunctor()));
+  scheduler->Start();
+  EXPECT_EQ((std::vector<AppName>{"a", "b"}), recorder.WaitForStarted(2));
+
+  // Once stopped, nothing further is started, even when in-progress launches settle.
+  scheduler->Stop();
+  recorder.Settle("b");
+  asio_service.Stop();
+  EXPECT_EQ((std::vector<AppName>{"a", "b"}), recorder.WaitForStarted(0));
+  EXPECT_EQ(2U, scheduler->PendingCount());
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
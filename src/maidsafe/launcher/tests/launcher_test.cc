@@ -22,11 +22,24 @@
 extern "C" char** environ;
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <future>
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
 
 #include "maidsafe/common/authentication/user_credentials.h"
 #include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
 
 #include "maidsafe/launcher/account.h"
 #include "maidsafe/launcher/account_getter.h"
@@ -38,6 +51,53 @@ namespace launcher {
 
 namespace test {
 
+namespace {
+
+#ifndef MAIDSAFE_WIN32
+using Duration = std::chrono::steady_clock::duration;
+
+boost::filesystem::path DummyAppPath() {
+  return ThisExecutablePath().parent_path() / "dummy_app";
+}
+
+// Launches 'count' instances of 'app_name' at once and waits for every launch to finish.  Returns
+// the time each successful launch took from being requested until its handshake completed, and
+// sets 'failures' to the number which failed.
+std::vector<Duration> LaunchConcurrently(Launcher& launcher, const AppName& app_name,
+                                         HandshakeTransport transport, int count, int& failures) {
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::vector<Duration> latencies;
+  int outstanding{count};
+  failures = 0;
+  for (int i(0); i != count; ++i) {
+    const auto start(std::chrono::steady_clock::now());
+    launcher.LaunchApp(app_name, transport, [&, start](bool completed) {
+      const auto latency(std::chrono::steady_clock::now() - start);
+      std::lock_guard<std::mutex> lock{mutex};
+      if (completed)
+        latencies.push_back(latency);
+      else
+        ++failures;
+      if (--outstanding == 0)
+        finished.notify_one();
+    });
+  }
+  std::unique_lock<std::mutex> lock{mutex};
+  finished.wait(lock, [&] { return outstanding == 0; });
+  return latencies;
+}
+
+// 'sorted' must be non-empty and in ascending order.
+double PercentileMs(const std::vector<Duration>& sorted, double percentile) {
+  const auto rank(static_cast<std::size_t>(std::ceil(percentile * sorted.size())));
+  const auto& latency(sorted[std::min(std::max(rank, std::size_t{1}), sorted.size()) - 1]);
+  return std::chrono::duration<double, std::milli>(latency).count();
+}
+#endif
+
+}  // unnamed namespace
+
 class LauncherTest : public TestUsingFakeStore {
  protected:
   LauncherTest() : TestUsingFakeStore("Launcher") {}
@@ -64,6 +124,78 @@ TEST_F(LauncherTest, FUNC_CreateMultipleAccounts) {
   }
 }
 
+TEST_F(LauncherTest, FUNC_Batch) {
+  auto user_credentials_tuple(GetRandomUserCredentialsTuple());
+  auto launcher(Launcher::CreateAccount(std::get<0>(user_credentials_tuple),
+                                        std::get<1>(user_credentials_tuple),
+                                        std::get<2>(user_credentials_tuple)));
+  std::set<AppDetails> apps;
+  {
+    auto batch(launcher->BeginBatch());
+    for (int i(0); i != 10; ++i) {
+      AppDetails app{CreateRandomAppDetails()};
+      batch.AddApp(app.name, app.path, app.args, app.icon, app.auto_start);
+      app.auto_start = !app.auto_start;
+      batch.UpdateAppAutoStart(app.name, app.auto_start);
+      apps.insert(app);
+    }
+    EXPECT_TRUE(launcher->GetApps(true).empty());
+    batch.Commit();
+  }
+  EXPECT_TRUE(Equals(apps, launcher->GetApps(true), kIgnorePermittedDirs));
+
+  // If any operation in a batch fails, none are applied.
+  {
+    auto batch(launcher->BeginBatch());
+    batch.RemoveAppLocally(apps.begin()->name);
+    batch.RemoveAppLocally(RandomAlphaNumericString(20));
+    EXPECT_TRUE(ThrowsAs([&] { batch.Commit(); }, CommonErrors::no_such_element));
+    batch.Commit();  // the batch is now empty
+  }
+  EXPECT_TRUE(Equals(apps, launcher->GetApps(true), kIgnorePermittedDirs));
+  launcher->LogoutAndStop();
+}
+
+TEST_F(LauncherTest, FUNC_RevertToLastSavedSession) {
+  auto user_credentials_tuple(GetRandomUserCredentialsTuple());
+  auto launcher(Launcher::CreateAccount(std::get<0>(user_credentials_tuple),
+                                        std::get<1>(user_credentials_tuple),
+                                        std::get<2>(user_credentials_tuple)));
+  // With no 'SaveSession' calls, reverting returns to the initial state.
+  AppDetails app{CreateRandomAppDetails()};
+  launcher->AddApp(app.name, app.path, app.args, app.icon, app.auto_start);
+  launcher->RevertToLastSavedSession();
+  EXPECT_TRUE(launcher->GetApps(true).empty());
+
+  launcher->AddApp(app.name, app.path, app.args, app.icon, app.auto_start);
+  launcher->SaveSession();
+  const std::set<AppDetails> saved_apps(launcher->GetApps(true));
+
+  // Changes to the account and to the local apps alike are undone.
+  AppDetails other_app{CreateRandomAppDetails()};
+  launcher->AddApp(other_app.name, other_app.path, other_app.args, other_app.icon,
+                   other_app.auto_start);
+  const AppName new_name(app.name + RandomAlphaNumericString(5));
+  launcher->UpdateAppName(app.name, new_name);
+  launcher->UpdateAppIcon(new_name, other_app.icon);
+  launcher->UpdateAppAutoStart(new_name, !app.auto_start);
+  launcher->RemoveAppLocally(other_app.name);
+  launcher->RevertToLastSavedSession();
+  EXPECT_TRUE(Equals(saved_apps, launcher->GetApps(true), kIgnorePermittedDirs));
+  EXPECT_TRUE(launcher->GetApps(false).empty());
+
+  // Reverting again, or saving, is then a no-op.
+  launcher->RevertToLastSavedSession();
+  EXPECT_TRUE(Equals(saved_apps, launcher->GetApps(true), kIgnorePermittedDirs));
+  launcher->SaveSession();
+
+  // A change made after a revert is logged afresh.
+  launcher->UpdateAppPath(app.name, other_app.path);
+  launcher->RevertToLastSavedSession();
+  EXPECT_TRUE(Equals(saved_apps, launcher->GetApps(true), kIgnorePermittedDirs));
+  launcher->LogoutAndStop();
+}
+
 TEST_F(LauncherTest, NETWORK_CreateDuplicateAccount) {
   auto user_credentials_tuple(GetRandomUserCredentialsTuple());
   {  // Create first account
@@ -108,6 +240,76 @@ TEST_F(LauncherTest, NETWORK_InvalidLogin) {
 }
 
 
+#ifndef MAIDSAFE_WIN32
+TEST_F(LauncherTest, FUNC_LaunchMisbehavingApps) {
+  auto user_credentials_tuple(GetRandomUserCredentialsTuple());
+  auto launcher(Launcher::CreateAccount(std::get<0>(user_credentials_tuple),
+                                        std::get<1>(user_credentials_tuple),
+                                        std::get<2>(user_credentials_tuple)));
+  // Only an app which confirms the handshake completes its launch; every other launch fails once
+  // its timeout expires or the app's connection or process ends.  A bad session key fails the
+  // launch as soon as it arrives, whereas an app which hangs uses up the whole handshake timeout.
+  const std::vector<std::pair<std::string, bool>> behaviours{
+      {"complete", true}, {"drop", false}, {"garbage", false}, {"hang", false},
+      {"exit_early", false}};
+  for (const auto& transport : {HandshakeTransport::kSocketPair, HandshakeTransport::kTcp}) {
+    std::vector<std::future<std::pair<bool, Duration>>> results;
+    for (const auto& behaviour : behaviours) {
+      const AppName app_name(RandomAlphaNumericString(20));
+      launcher->AddApp(app_name, DummyAppPath(), "--behaviour=" + behaviour.first,
+                       SerialisedData(), false);
+      auto completed(std::make_shared<std::promise<std::pair<bool, Duration>>>());
+      results.push_back(completed->get_future());
+      const auto start(std::chrono::steady_clock::now());
+      launcher->LaunchApp(app_name, transport, [completed, start](bool result) {
+        completed->set_value(std::make_pair(result, std::chrono::steady_clock::now() - start));
+      });
+    }
+    for (std::size_t i(0); i != behaviours.size(); ++i) {
+      const auto result(results[i].get());
+      EXPECT_EQ(behaviours[i].second, result.first) << behaviours[i].first;
+      if (behaviours[i].first == "garbage")
+        EXPECT_LT(result.second, Launcher::handshake_timeout_ / 2);
+      if (behaviours[i].first == "hang")
+        EXPECT_GE(result.second, Launcher::handshake_timeout_);
+    }
+  }
+  launcher->LogoutAndStop();
+}
+
+// Reports how many launches the Launcher completes per second with many in flight at once, and the
+// spread of their time to complete the handshake, for sizing its thread pool.
+TEST_F(LauncherTest, FUNC_LaunchThroughput) {
+  auto user_credentials_tuple(GetRandomUserCredentialsTuple());
+  auto launcher(Launcher::CreateAccount(std::get<0>(user_credentials_tuple),
+                                        std::get<1>(user_credentials_tuple),
+                                        std::get<2>(user_credentials_tuple)));
+  const int kLaunchCount{200};
+  for (const int think_time_ms : {0, 50}) {
+    const AppName app_name(RandomAlphaNumericString(20));
+    launcher->AddApp(app_name, DummyAppPath(),
+                     "--think_time_ms=" + std::to_string(think_time_ms), SerialisedData(), false);
+    for (const auto& transport : {HandshakeTransport::kSocketPair, HandshakeTransport::kTcp}) {
+      int failures{0};
+      const auto start(std::chrono::steady_clock::now());
+      auto latencies(LaunchConcurrently(*launcher, app_name, transport, kLaunchCount, failures));
+      const std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+      EXPECT_EQ(0, failures);
+      ASSERT_FALSE(latencies.empty());
+      std::sort(latencies.begin(), latencies.end());
+      std::cout << kLaunchCount << " concurrent launches over "
+                << (transport == HandshakeTransport::kTcp ? "TCP" : "a socket pair") << " with "
+                << think_time_ms << " ms think time: "
+                << static_cast<double>(latencies.size()) / elapsed.count()
+                << " launches/s; time to handshake complete p50 " << PercentileMs(latencies, 0.5)
+                << " ms, p99 " << PercentileMs(latencies, 0.99) << " ms, p999 "
+                << PercentileMs(latencies, 0.999) << " ms\n";
+    }
+  }
+  launcher->LogoutAndStop();
+}
+#endif
+
 // TODO(Team)  move to nfs
 // TEST(ClientTest, FUNC_Constructor) {
 //  routing::BootstrapContacts bootstrap_contacts;
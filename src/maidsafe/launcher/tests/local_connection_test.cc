@@ -0,0 +1,174 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/local_connection.h"
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "asio/io_service_strand.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/launch_listener.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+tcp::Message RandomMessage(std::size_t size) {
+  const std::string data(RandomString(size));
+  return tcp::Message(data.begin(), data.end());
+}
+
+template <typename T>
+bool IsReady(std::future<T>& future) {
+  return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+}
+
+// Collects the messages received on a connection, fulfilling 'all_received' once 'expected'
+// messages have arrived.
+struct Receiver {
+  explicit Receiver(std::size_t expected_in) : expected(expected_in) {}
+
+  void Receive(tcp::Message message) {
+    std::lock_guard<std::mutex> lock{mutex};
+    messages.push_back(std::move(message));
+    if (messages.size() == expected)
+      all_received.set_value();
+  }
+
+  const std::size_t expected;
+  std::mutex mutex;
+  std::vector<tcp::Message> messages;
+  std::promise<void> all_received;
+  std::promise<void> closed;
+};
+
+}  // unnamed namespace
+
+#ifndef MAIDSAFE_WIN32
+TEST(LocalConnectionTest, BEH_MessagesAndClose) {
+  AsioService asio_service(2);
+  asio::io_service::strand strand(asio_service.service());
+  auto ends(LocalConnection::MakePair(strand));
+
+  // Messages of any size up to the maximum arrive intact and in order, in both directions.
+  const std::vector<tcp::Message> messages{RandomMessage(1), tcp::Message(), RandomMessage(100000),
+                                           RandomMessage(LocalConnection::kMaxMessageSize),
+                                           RandomMessage(10)};
+  auto first(std::make_shared<Receiver>(messages.size()));
+  auto second(std::make_shared<Receiver>(messages.size()));
+  ends.first->Start([first](tcp::Message message) { first->Receive(std::move(message)); },
+                    [first] { first->closed.set_value(); });
+  ends.second->Start([second](tcp::Message message) { second->Receive(std::move(message)); },
+                     [second] { second->closed.set_value(); });
+  for (const auto& message : messages) {
+    ends.first->Send(message);
+    ends.second->Send(message);
+  }
+  auto first_received(first->all_received.get_future());
+  auto second_received(second->all_received.get_future());
+  ASSERT_TRUE(IsReady(first_received));
+  ASSERT_TRUE(IsReady(second_received));
+  EXPECT_EQ(messages, first->messages);
+  EXPECT_EQ(messages, second->messages);
+
+  EXPECT_THROW(ends.first->Send(RandomMessage(LocalConnection::kMaxMessageSize + 1)),
+               common_error);
+
+  // Closing either end closes both.
+  ends.first->Close();
+  auto first_closed(first->closed.get_future());
+  auto second_closed(second->closed.get_future());
+  EXPECT_TRUE(IsReady(first_closed));
+  EXPECT_TRUE(IsReady(second_closed));
+  asio_service.Stop();
+}
+
+TEST(LocalConnectionTest, FUNC_HandshakeLatency) {
+  // Compares the time taken for an app to connect and exchange the handshake's first request and
+  // reply with the launcher over a socket pair, and over TCP via the shared launch listener.
+  using Clock = std::chrono::steady_clock;
+  const int kHandshakeCount(200);
+  const tcp::Message session_key(RandomMessage(512)), directories(RandomMessage(2048));
+  AsioService asio_service(2);
+  asio::io_service::strand strand(asio_service.service());
+  auto mean([&](Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() /
+           kHandshakeCount;
+  });
+
+  auto start(Clock::now());
+  for (int i(0); i < kHandshakeCount; ++i) {
+    auto ends(LocalConnection::MakePair(strand));
+    LocalConnectionPtr launcher_end(ends.first);
+    launcher_end->Start([&, launcher_end](tcp::Message) { launcher_end->Send(directories); },
+                        [] {});
+    std::promise<tcp::Message> reply;
+    ends.second->Start([&](tcp::Message message) { reply.set_value(std::move(message)); }, [] {});
+    ends.second->Send(session_key);
+    auto reply_future(reply.get_future());
+    ASSERT_TRUE(IsReady(reply_future));
+    EXPECT_EQ(directories, reply_future.get());
+    ends.first->Close();
+  }
+  std::cout << "Mean handshake time over a socket pair: " << mean(start) << " us\n";
+
+  auto launch_listener(
+      LaunchListener::MakeShared(asio_service.service(), std::chrono::seconds(10)));
+  start = Clock::now();
+  for (int i(0); i < kHandshakeCount; ++i) {
+    tcp::ConnectionPtr launcher_end;
+    const LaunchToken token(launch_listener->Register(
+        [&](tcp::ConnectionPtr connection) { launcher_end = connection; },
+        [&](tcp::Message) { launcher_end->Send(directories); }, [] {}));
+    std::promise<tcp::Message> reply;
+    auto app_end(tcp::Connection::MakeShared(strand, launch_listener->ListeningPort()));
+    app_end->Start([&](tcp::Message message) { reply.set_value(std::move(message)); }, [] {});
+    app_end->Send(tcp::Message(token.begin(), token.end()));
+    app_end->Send(session_key);
+    auto reply_future(reply.get_future());
+    ASSERT_TRUE(IsReady(reply_future));
+    EXPECT_EQ(directories, reply_future.get());
+    app_end->Close();
+  }
+  std::cout << "Mean handshake time over TCP:           " << mean(start) << " us\n";
+
+  launch_listener.reset();
+  asio_service.Stop();
+}
+#endif
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
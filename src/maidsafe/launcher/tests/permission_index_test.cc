@@ -0,0 +1,244 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/permission_index.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/launcher/app_details.h"
+#include "maidsafe/launcher/app_indexes.h"
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+using Rights = DirectoryInfo::AccessRights;
+
+DirectoryInfo MakeDir(const fs::path& path, Rights rights) {
+  DirectoryInfo dir(CreateRandomDirectoryInfo());
+  dir.path = path;
+  dir.access_rights = rights;
+  return dir;
+}
+
+std::set<std::pair<AppName, fs::path>> Paths(const std::vector<PermissionIndex::Grant>& grants) {
+  std::set<std::pair<AppName, fs::path>> paths;
+  for (const auto& grant : grants)
+    paths.emplace(grant.first, grant.second.path);
+  return paths;
+}
+
+// The reference implementation: the rights of the deepest of 'app''s permitted directories which
+// is 'path' or one of its ancestors.
+Rights ScanAccessRights(const AppDetails& app, const fs::path& path) {
+  const fs::path canonical_path(CanonicalAppPath(path));
+  std::size_t deepest(0);
+  Rights rights(Rights::kNone);
+  for (const auto& dir : app.permitted_dirs) {
+    const fs::path canonical_dir(CanonicalAppPath(dir.path));
+    auto dir_itr(canonical_dir.begin()), path_itr(canonical_path.begin());
+    std::size_t depth(0);
+    while (dir_itr != canonical_dir.end() && path_itr != canonical_path.end() &&
+           *dir_itr == *path_itr) {
+      ++dir_itr;
+      ++path_itr;
+      ++depth;
+    }
+    if (dir_itr != canonical_dir.end() || depth < deepest)
+      continue;
+    if (depth > deepest) {
+      deepest = depth;
+      rights = Rights::kNone;
+    }
+    rights = std::max(rights, dir.access_rights);
+  }
+  return rights;
+}
+
+}  // unnamed namespace
+
+TEST(PermissionIndexTest, BEH_AccessRights) {
+  PermissionIndex index;
+  EXPECT_TRUE(index.empty());
+  index.Add("A", MakeDir("/docs", Rights::kReadWrite));
+  index.Add("A", MakeDir("/docs/private", Rights::kReadOnly));
+  index.Add("B", MakeDir("/docs/private/b/", Rights::kReadWrite));
+  EXPECT_FALSE(index.empty());
+
+  // Access extends to the whole subtree, with the nearest grant taking precedence.
+  EXPECT_EQ(Rights::kReadWrite, index.AccessRights("A", "/docs"));
+  EXPECT_EQ(Rights::kReadWrite, index.AccessRights("A", "/docs/public/x"));
+  EXPECT_EQ(Rights::kReadOnly, index.AccessRights("A", "/docs/private"));
+  EXPECT_EQ(Rights::kReadOnly, index.AccessRights("A", "/docs/./private/b/../c"));
+  EXPECT_EQ(Rights::kNone, index.AccessRights("A", "/"));
+  EXPECT_EQ(Rights::kNone, index.AccessRights("A", "/doc"));
+  EXPECT_EQ(Rights::kNone, index.AccessRights("A", "docs"));
+  EXPECT_EQ(Rights::kNone, index.AccessRights("B", "/docs/private"));
+  EXPECT_EQ(Rights::kReadWrite, index.AccessRights("B", "/docs/private/b/c"));
+  EXPECT_EQ(Rights::kNone, index.AccessRights("C", "/docs"));
+
+  // Re-granting a directory replaces the grant.
+  DirectoryInfo dir(MakeDir("/docs/private", Rights::kReadWrite));
+  index.Add("A", dir);
+  EXPECT_EQ(Rights::kReadWrite, index.AccessRights("A", "/docs/private/c"));
+  dir.access_rights = Rights::kReadOnly;
+  index.Add("A", dir);
+  EXPECT_EQ(Rights::kReadOnly, index.AccessRights("A", "/docs/private/c"));
+}
+
+TEST(PermissionIndexTest, BEH_GrantsUnderAndRemove) {
+  PermissionIndex index;
+  const DirectoryInfo docs(MakeDir("/docs", Rights::kReadWrite)),
+      private_docs(MakeDir("/docs/private", Rights::kReadOnly)),
+      b_docs(MakeDir("/docs/private/b", Rights::kReadWrite)),
+      music(MakeDir("/music", Rights::kReadOnly));
+  index.Add("A", docs);
+  index.Add("A", private_docs);
+  index.Add("B", b_docs);
+  index.Add("B", music);
+
+  using PathSet = std::set<std::pair<AppName, fs::path>>;
+  EXPECT_EQ((PathSet{{"A", "/docs"}, {"A", "/docs/private"}, {"B", "/docs/private/b"}}),
+            Paths(index.GrantsUnder("/docs")));
+  EXPECT_EQ((PathSet{{"A", "/docs/private"}, {"B", "/docs/private/b"}}),
+            Paths(index.GrantsUnder("/docs/private/")));
+  EXPECT_EQ(4U, index.GrantsUnder("/").size());
+  EXPECT_TRUE(index.GrantsUnder("/docs/public").empty());
+  EXPECT_TRUE(index.GrantsUnder("/docs/private/b/c").empty());
+
+  // Removal doesn't affect copies, and unknown grants are ignored.
+  const PermissionIndex copy(index);
+  index.Remove("A", private_docs);
+  index.Remove("B", private_docs);
+  index.Remove("A", MakeDir("/films", Rights::kReadOnly));
+  EXPECT_EQ(Rights::kReadWrite, index.AccessRights("A", "/docs/private"));
+  EXPECT_EQ(Rights::kReadOnly, copy.AccessRights("A", "/docs/private"));
+  EXPECT_EQ(3U, index.GrantsUnder("/").size());
+  EXPECT_EQ(4U, copy.GrantsUnder("/").size());
+
+  // Nodes left with no grants are pruned.
+  index.Remove("A", docs);
+  index.Remove("B", b_docs);
+  EXPECT_TRUE(index.GrantsUnder("/docs").empty());
+  EXPECT_FALSE(index.empty());
+  index.Remove("B", music);
+  EXPECT_TRUE(index.empty());
+  EXPECT_FALSE(copy.empty());
+}
+
+TEST(PermissionIndexTest, BEH_AppIndexesUpdate) {
+  AppIndexes indexes;
+  AppDetails app{CreateRandomAppDetails()};
+  app.permitted_dirs.clear();
+  const DirectoryInfo docs(MakeDir("/docs", Rights::kReadWrite));
+  app.permitted_dirs.insert(docs);
+  indexes.Insert(app, true);
+  EXPECT_EQ(Rights::kReadWrite, indexes.permissions().AccessRights(app.name, "/docs/a"));
+
+  // Changing a directory's rights, adding a directory and renaming are all reflected.
+  AppDetails updated_app(app);
+  DirectoryInfo read_only_docs(docs);
+  read_only_docs.access_rights = Rights::kReadOnly;
+  updated_app.permitted_dirs.erase(docs);
+  updated_app.permitted_dirs.insert(read_only_docs);
+  const DirectoryInfo music(MakeDir("/music", Rights::kReadOnly));
+  updated_app.permitted_dirs.insert(music);
+  indexes.Update(app, updated_app, true);
+  EXPECT_EQ(Rights::kReadOnly, indexes.permissions().AccessRights(app.name, "/docs/a"));
+  EXPECT_EQ(Rights::kReadOnly, indexes.permissions().AccessRights(app.name, "/music"));
+  EXPECT_EQ(std::vector<AppName>{app.name}, indexes.AppsWithDirectory(music.directory_id));
+
+  app = updated_app;
+  updated_app.name += "-renamed";
+  updated_app.permitted_dirs.erase(music);
+  indexes.Update(app, updated_app, true);
+  EXPECT_EQ(Rights::kNone, indexes.permissions().AccessRights(app.name, "/docs/a"));
+  EXPECT_EQ(Rights::kReadOnly, indexes.permissions().AccessRights(updated_app.name, "/docs/a"));
+  EXPECT_EQ(Rights::kNone, indexes.permissions().AccessRights(updated_app.name, "/music"));
+  EXPECT_TRUE(indexes.AppsWithDirectory(music.directory_id).empty());
+}
+
+TEST(PermissionIndexTest, FUNC_IndexMatchesScan) {
+  const int kAppCount(2000), kDirsPerApp(20), kQueryCount(20000);
+  // Use a small alphabet of path elements so that the apps' directories overlap heavily.
+  auto random_path([](int max_depth) {
+    fs::path path("/");
+    const int depth(static_cast<int>(RandomUint32() % max_depth) + 1);
+    for (int i(0); i < depth; ++i)
+      path /= std::string(1, static_cast<char>('a' + RandomUint32() % 4));
+    return path;
+  });
+  std::vector<AppDetails> apps;
+  PermissionIndex index;
+  for (int i(0); i < kAppCount; ++i) {
+    AppDetails app;
+    app.name = RandomAlphaNumericString(20);
+    for (int j(0); j < kDirsPerApp; ++j) {
+      const Rights rights(RandomUint32() % 2 == 0 ? Rights::kReadOnly : Rights::kReadWrite);
+      app.permitted_dirs.insert(MakeDir(random_path(5), rights));
+    }
+    for (const auto& dir : app.permitted_dirs)
+      index.Add(app.name, dir);
+    apps.push_back(std::move(app));
+  }
+  std::vector<std::pair<const AppDetails*, fs::path>> queries;
+  for (int i(0); i < kQueryCount; ++i)
+    queries.emplace_back(&apps[RandomUint32() % apps.size()], random_path(7));
+
+  std::vector<Rights> indexed_results, scanned_results;
+  for (const auto& query : queries) {
+    indexed_results.push_back(index.AccessRights(query.first->name, query.second));
+    scanned_results.push_back(ScanAccessRights(*query.first, query.second));
+  }
+  EXPECT_EQ(scanned_results, indexed_results);
+
+  // Revoking a subtree across all apps only visits the grants within it.
+  const fs::path subtree("/a/b");
+  std::size_t scanned_count(0);
+  for (const auto& app : apps) {
+    for (const auto& dir : app.permitted_dirs) {
+      if (CanonicalAppPath(dir.path).compare(0, 5, "/a/b/") == 0 ||
+          CanonicalAppPath(dir.path) == "/a/b") {
+        ++scanned_count;
+      }
+    }
+  }
+  EXPECT_EQ(scanned_count, index.GrantsUnder(subtree).size());
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
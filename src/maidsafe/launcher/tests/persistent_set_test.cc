@@ -0,0 +1,182 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/persistent_set.h"
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+testing::AssertionResult Matches(const std::set<std::uint32_t>& expected,
+                                 const PersistentSet<std::uint32_t>& actual) {
+  if (expected.size() != actual.size()) {
+    return testing::AssertionFailure() << "Expected size " << expected.size() << " but got "
+                                       << actual.size();
+  }
+  if (!std::equal(expected.begin(), expected.end(), actual.begin()))
+    return testing::AssertionFailure() << "Contents differ";
+  return testing::AssertionSuccess();
+}
+
+}  // unnamed namespace
+
+TEST(PersistentSetTest, BEH_MatchesStdSet) {
+  std::set<std::uint32_t> expected;
+  PersistentSet<std::uint32_t> actual;
+  EXPECT_TRUE(actual.empty());
+  EXPECT_TRUE(actual.begin() == actual.end());
+
+  for (int i(0); i < 2000; ++i) {
+    std::uint32_t value{RandomUint32() % 500};
+    if (RandomUint32() % 3 == 0) {
+      EXPECT_EQ(expected.erase(value), actual.erase(value));
+    } else {
+      EXPECT_EQ(expected.insert(value).second, actual.insert(value));
+    }
+    ASSERT_EQ(expected.count(value), actual.count(value));
+  }
+  EXPECT_TRUE(Matches(expected, actual));
+
+  // 'find' must return an iterator from which the remainder of the set can be traversed.
+  for (std::uint32_t value(0); value < 500; ++value) {
+    auto expected_itr(expected.find(value));
+    auto actual_itr(actual.find(value));
+    if (expected_itr == expected.end()) {
+      EXPECT_TRUE(actual_itr == actual.end());
+      continue;
+    }
+    ASSERT_TRUE(actual_itr != actual.end());
+    EXPECT_TRUE(std::equal(expected_itr, expected.end(), actual_itr));
+  }
+
+  // Likewise for 'lower_bound'.
+  for (std::uint32_t value(0); value < 501; ++value) {
+    auto expected_itr(expected.lower_bound(value));
+    auto actual_itr(actual.lower_bound(value));
+    EXPECT_EQ(std::distance(expected_itr, expected.end()), std::distance(actual_itr, actual.end()));
+    EXPECT_TRUE(std::equal(expected_itr, expected.end(), actual_itr));
+  }
+
+  actual.clear();
+  EXPECT_TRUE(actual.empty());
+}
+
+TEST(PersistentSetTest, BEH_CopiesAreIndependent) {
+  std::set<std::uint32_t> expected;
+  PersistentSet<std::uint32_t> original;
+  for (std::uint32_t i(0); i < 100; ++i) {
+    expected.insert(i * 2);
+    original.insert(i * 2);
+  }
+
+  // Modifying a copy mustn't affect the original, and vice versa.
+  std::vector<PersistentSet<std::uint32_t>> copies(10, original);
+  for (std::uint32_t i(0); i < copies.size(); ++i) {
+    copies[i].erase(i * 2);
+    copies[i].insert(i * 2 + 1);
+  }
+  EXPECT_TRUE(Matches(expected, original));
+  for (std::uint32_t i(0); i < copies.size(); ++i) {
+    std::set<std::uint32_t> expected_copy(expected);
+    expected_copy.erase(i * 2);
+    expected_copy.insert(i * 2 + 1);
+    EXPECT_TRUE(Matches(expected_copy, copies[i]));
+  }
+
+  original.clear();
+  EXPECT_TRUE(original.empty());
+  EXPECT_EQ(expected.size(), copies.front().size());
+
+  // Moving leaves the source empty.
+  PersistentSet<std::uint32_t> moved_to(std::move(copies.front()));
+  EXPECT_EQ(expected.size(), moved_to.size());
+  EXPECT_TRUE(copies.front().empty());
+}
+
+TEST(PersistentSetTest, BEH_InsertOrReplace) {
+  using Pair = std::pair<int, int>;
+  struct CompareFirst {
+    bool operator()(const Pair& lhs, const Pair& rhs) const { return lhs.first < rhs.first; }
+  };
+  PersistentSet<Pair, CompareFirst> set;
+  EXPECT_TRUE(set.insert(Pair(1, 1)));
+  EXPECT_FALSE(set.insert(Pair(1, 2)));
+  EXPECT_EQ(1, set.find(Pair(1, 0))->second);
+
+  auto copy(set);
+  EXPECT_FALSE(set.insert_or_replace(Pair(1, 2)));
+  EXPECT_EQ(2, set.find(Pair(1, 0))->second);
+  EXPECT_EQ(1, copy.find(Pair(1, 0))->second);
+  EXPECT_TRUE(set.insert_or_replace(Pair(2, 2)));
+  EXPECT_EQ(2U, set.size());
+
+  // Shared values are held without being copied.
+  auto shared(std::make_shared<const Pair>(3, 3));
+  EXPECT_TRUE(set.insert(shared));
+  EXPECT_EQ(shared.get(), &*set.find(Pair(3, 0)));
+  EXPECT_FALSE(set.insert(std::make_shared<const Pair>(3, 4)));
+  auto replacement(std::make_shared<const Pair>(3, 5));
+  EXPECT_FALSE(set.insert_or_replace(replacement));
+  EXPECT_EQ(replacement.get(), &*set.find(Pair(3, 0)));
+  EXPECT_EQ(3, shared->second);
+  EXPECT_EQ(3U, set.size());
+}
+
+TEST(PersistentSetTest, BEH_FromSorted) {
+  EXPECT_TRUE(PersistentSet<std::uint32_t>::FromSorted({}).empty());
+  std::set<std::uint32_t> expected;
+  while (expected.size() < 1000)
+    expected.insert(RandomUint32());
+  auto actual(PersistentSet<std::uint32_t>::FromSorted(
+      std::vector<std::uint32_t>(expected.begin(), expected.end())));
+  EXPECT_TRUE(Matches(expected, actual));
+
+  // The built tree remains balanced under further changes.
+  for (int i(0); i < 1000; ++i) {
+    std::uint32_t value{RandomUint32()};
+    if (i % 2 == 0) {
+      value = *std::next(expected.begin(), RandomUint32() % expected.size());
+      EXPECT_EQ(expected.erase(value), actual.erase(value));
+    } else {
+      EXPECT_EQ(expected.insert(value).second, actual.insert(value));
+    }
+  }
+  EXPECT_TRUE(Matches(expected, actual));
+  for (const auto& value : expected)
+    EXPECT_EQ(1U, actual.count(value));
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,171 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/retry_policy.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/launcher/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+TEST(RetryPolicyTest, BEH_IsTransient) {
+  EXPECT_TRUE(IsTransient(MakeError(RoutingErrors::timed_out)));
+  EXPECT_TRUE(IsTransient(MakeError(RoutingErrors::not_connected)));
+  EXPECT_TRUE(IsTransient(MakeError(NfsErrors::timed_out)));
+  EXPECT_FALSE(IsTransient(MakeError(CommonErrors::parsing_error)));
+  EXPECT_FALSE(IsTransient(MakeError(CommonErrors::no_such_element)));
+  EXPECT_FALSE(IsTransient(MakeError(VaultErrors::no_such_account)));
+  EXPECT_FALSE(IsTransient(std::runtime_error("Not a system error")));
+}
+
+TEST(RetryPolicyTest, BEH_BackoffDelay) {
+  RetryPolicy policy{10, std::chrono::milliseconds(100), std::chrono::milliseconds(1000), 2.0, 0.0};
+  EXPECT_EQ(std::chrono::milliseconds(100), BackoffDelay(policy, 1));
+  EXPECT_EQ(std::chrono::milliseconds(200), BackoffDelay(policy, 2));
+  EXPECT_EQ(std::chrono::milliseconds(400), BackoffDelay(policy, 3));
+  EXPECT_EQ(std::chrono::milliseconds(1000), BackoffDelay(policy, 5));
+  EXPECT_EQ(std::chrono::milliseconds(1000), BackoffDelay(policy, 9));
+
+  // With jitter, delays must lie in [(1 - jitter) * delay, delay].
+  policy.jitter = 0.5;
+  for (int i(0); i < 100; ++i) {
+    auto delay(BackoffDelay(policy, 3));
+    EXPECT_GE(delay, std::chrono::milliseconds(200));
+    EXPECT_LE(delay, std::chrono::milliseconds(400));
+  }
+}
+
+TEST(RetryPolicyTest, BEH_RetryWithBackoff) {
+  RetryPolicy policy{3, std::chrono::milliseconds(0), std::chrono::milliseconds(0), 1.0, 0.0};
+  {  // Transient errors are retried until success.
+    NetworkOperationStats stats;
+    int calls{0};
+    EXPECT_EQ(3, RetryWithBackoff(policy, stats, [&] {
+                if (++calls < 3)
+                  BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::timed_out));
+                return calls;
+              }));
+    NetworkMetrics metrics{stats};
+    EXPECT_EQ(3U, metrics.attempts);
+    EXPECT_EQ(2U, metrics.retries);
+    EXPECT_EQ(0U, metrics.permanent_failures);
+    EXPECT_EQ(0U, metrics.exhausted_failures);
+  }
+  {  // Transient errors give up after 'max_attempts'.
+    NetworkOperationStats stats;
+    EXPECT_TRUE(ThrowsAs([&] {
+      RetryWithBackoff(policy, stats,
+                       [] { BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_connected)); });
+    }, RoutingErrors::not_connected));
+    NetworkMetrics metrics{stats};
+    EXPECT_EQ(3U, metrics.attempts);
+    EXPECT_EQ(2U, metrics.retries);
+    EXPECT_EQ(1U, metrics.exhausted_failures);
+  }
+  {  // Permanent errors aren't retried.
+    NetworkOperationStats stats;
+    EXPECT_TRUE(ThrowsAs([&] {
+      RetryWithBackoff(policy, stats,
+                       [] { BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error)); });
+    }, CommonErrors::parsing_error));
+    NetworkMetrics metrics{stats};
+    EXPECT_EQ(1U, metrics.attempts);
+    EXPECT_EQ(0U, metrics.retries);
+    EXPECT_EQ(1U, metrics.permanent_failures);
+  }
+}
+
+TEST(RetryPolicyTest, BEH_HedgeDelay) {
+  HedgePolicy policy;
+  policy.min_samples = 10;
+  policy.percentile = 0.95;
+  LatencyTracker latencies{100};
+
+  // Too few samples - use the initial delay.
+  EXPECT_EQ(policy.initial_delay, HedgeDelay(policy, latencies));
+
+  for (int i(1); i <= 100; ++i)
+    latencies.Add(std::chrono::milliseconds(i));
+  EXPECT_EQ(100U, latencies.SampleCount());
+  EXPECT_EQ(std::chrono::milliseconds(95), HedgeDelay(policy, latencies));
+
+  // The window is bounded, so older samples are overwritten.
+  for (int i(0); i < 100; ++i)
+    latencies.Add(std::chrono::milliseconds(1));
+  EXPECT_EQ(100U, latencies.SampleCount());
+  EXPECT_EQ(policy.min_delay, HedgeDelay(policy, latencies));
+}
+
+TEST(RetryPolicyTest, BEH_HedgedRead) {
+  HedgePolicy policy;
+  policy.initial_delay = std::chrono::milliseconds(10);
+  auto latencies(std::make_shared<LatencyTracker>());
+  auto stats(std::make_shared<NetworkOperationStats>());
+  auto asio_service(maidsafe::make_unique<BoostAsioService>(2));
+
+  // A slow first request is overtaken by its hedge.  As when logging in, neither the read nor
+  // destroying the service which the losing request is still running on waits for it.
+  auto calls(std::make_shared<std::atomic<int>>(0));
+  auto slow_read_finished(std::make_shared<std::promise<void>>());
+  const auto start(std::chrono::steady_clock::now());
+  EXPECT_EQ(2, HedgedRead(asio_service->service(), policy, latencies, stats,
+                          [calls, slow_read_finished] {
+                            if (++*calls != 1)
+                              return 2;
+                            std::this_thread::sleep_for(std::chrono::seconds(2));
+                            slow_read_finished->set_value();
+                            return 1;
+                          }));
+  DestroyDetached(std::move(asio_service));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  NetworkMetrics metrics{*stats};
+  EXPECT_EQ(1U, metrics.hedges_sent);
+  EXPECT_EQ(1U, metrics.hedges_won);
+  EXPECT_EQ(std::future_status::ready,
+            slow_read_finished->get_future().wait_for(std::chrono::seconds(10)));
+
+  // If every request fails, the first error is rethrown.
+  asio_service = maidsafe::make_unique<BoostAsioService>(2);
+  EXPECT_TRUE(ThrowsAs([&] {
+    HedgedRead(asio_service->service(), policy, latencies, stats, []() -> int {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+    });
+  }, CommonErrors::no_such_element));
+  asio_service->Stop();
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
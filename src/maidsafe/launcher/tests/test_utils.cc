@@ -19,6 +19,7 @@
 #include "maidsafe/launcher/tests/test_utils.h"
 
 #include <string>
+#include <vector>
 
 #include "maidsafe/directory_info.h"
 #include "maidsafe/common/crypto.h"
@@ -100,6 +101,33 @@ AppDetails CreateRandomAppDetails() {
   return app;
 }
 
+AppDetails CreateTypicalAppDetails() {
+  static const std::vector<std::string> kDirectories{
+      "/usr/bin/", "/usr/local/bin/", "/opt/", "/Applications/", "C:\\Program Files\\"};
+  static const std::vector<std::string> kFlags{"--log_folder=/var/log/", "--config=/etc/",
+                                               "--port=", "--verbose", "--log_*=V"};
+  AppDetails app;
+  app.name = RandomAlphaNumericString(6, 16);
+  const std::string& directory(kDirectories[RandomUint32() % kDirectories.size()]);
+  if (directory == "/Applications/")
+    app.path = directory + app.name + ".app/Contents/MacOS/" + app.name;
+  else if (directory[0] == 'C')
+    app.path = directory + app.name + "\\" + app.name + ".exe";
+  else
+    app.path = directory + app.name;
+  const int flag_count(static_cast<int>(RandomUint32() % 4));
+  for (int i(0); i < flag_count; ++i) {
+    const std::string& flag(kFlags[RandomUint32() % kFlags.size()]);
+    app.args += (i == 0 ? "" : " ") + flag;
+    if (flag == "--port=")
+      app.args += std::to_string(1024 + RandomUint32() % 64512);
+    else if (flag.back() == '/')
+      app.args += app.name;
+  }
+  app.auto_start = (RandomUint32() % 2 == 0);
+  return app;
+}
+
 testing::AssertionResult Equals(const AppDetails& expected, const AppDetails& actual,
                                 int ignore_field) {
   if (expected.name != actual.name) {
@@ -83,6 +83,10 @@ DirectoryInfo CreateRandomDirectoryInfo();
 
 AppDetails CreateRandomAppDetails();
 
+// Returns an app with no permitted dirs or icon, and with a path and args resembling those of real
+// installs - i.e. sharing common prefixes and flags with other such apps.
+AppDetails CreateTypicalAppDetails();
+
 enum IgnoreField {
   kIgnorePath = 1,
   kIgnoreArgs = 2,
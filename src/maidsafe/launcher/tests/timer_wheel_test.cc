@@ -0,0 +1,250 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/timer_wheel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "asio/steady_timer.hpp"
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace test {
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+
+// Counts expiries, and records by how much each timer overran its deadline.  Waiters are woken
+// once 'expected' timers have expired.
+class Expiries {
+ public:
+  explicit Expiries(std::size_t expected)
+      : mutex_(), condition_(), expected_(expected), count_(0), early_(0), max_lateness_() {}
+
+  TimerWheel::Handler Handler(Clock::duration timeout) {
+    const Clock::time_point deadline(Clock::now() + timeout);
+    return [this, deadline] {
+      const Clock::time_point now(Clock::now());
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (now < deadline)
+        ++early_;
+      else
+        max_lateness_ = std::max(max_lateness_, now - deadline);
+      if (++count_ == expected_)
+        condition_.notify_all();
+    };
+  }
+
+  bool Wait() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    return condition_.wait_for(lock, std::chrono::seconds(20), [&] { return count_ >= expected_; });
+  }
+
+  std::size_t Count() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return count_;
+  }
+
+  std::size_t Early() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return early_;
+  }
+
+  Clock::duration MaxLateness() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return max_lateness_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  const std::size_t expected_;
+  std::size_t count_, early_;
+  Clock::duration max_lateness_;
+};
+
+template <typename Duration>
+std::int64_t Milliseconds(Duration duration) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+}  // unnamed namespace
+
+TEST(TimerWheelTest, BEH_ArmAndCancel) {
+  AsioService asio_service(1);
+  EXPECT_THROW(TimerWheel::MakeShared(asio_service.service(), Clock::duration::zero()),
+               common_error);
+  auto timer_wheel(TimerWheel::MakeShared(asio_service.service(), std::chrono::milliseconds(1)));
+
+  std::mutex mutex;
+  std::vector<int> order;
+  auto record([&](int id) {
+    return [&, id] {
+      std::lock_guard<std::mutex> lock{mutex};
+      order.push_back(id);
+    };
+  });
+  std::promise<void> last_expired;
+  auto third(timer_wheel->Arm(std::chrono::milliseconds(100), [&] { last_expired.set_value(); }));
+  auto second(timer_wheel->Arm(std::chrono::milliseconds(40), record(2)));
+  auto cancelled(timer_wheel->Arm(std::chrono::milliseconds(20), record(0)));
+  auto first(timer_wheel->Arm(std::chrono::milliseconds(5), record(1)));
+  EXPECT_EQ(4U, timer_wheel->Count());
+
+  // Only armed timers can be cancelled, and only once.
+  EXPECT_TRUE(timer_wheel->Cancel(cancelled));
+  EXPECT_FALSE(timer_wheel->Cancel(cancelled));
+  EXPECT_FALSE(timer_wheel->Cancel(TimerWheel::Timer()));
+  EXPECT_EQ(3U, timer_wheel->Count());
+
+  auto last_expired_future(last_expired.get_future());
+  ASSERT_EQ(std::future_status::ready, last_expired_future.wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(0U, timer_wheel->Count());
+  EXPECT_FALSE(timer_wheel->Cancel(first));
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    EXPECT_EQ((std::vector<int>{1, 2}), order);
+  }
+
+  // The wheel can be rearmed after falling idle, and every timer cancelled at once.
+  Expiries expiries(1);
+  timer_wheel->Arm(std::chrono::milliseconds(10), expiries.Handler(std::chrono::milliseconds(10)));
+  EXPECT_TRUE(expiries.Wait());
+  timer_wheel->Arm(std::chrono::milliseconds(1), record(4));
+  timer_wheel->Arm(std::chrono::minutes(10), record(5));
+  EXPECT_EQ(2U, timer_wheel->CancelAll());
+  EXPECT_EQ(0U, timer_wheel->Count());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    EXPECT_EQ((std::vector<int>{1, 2}), order);
+  }
+
+  // It can be destroyed with timers still armed.
+  timer_wheel->Arm(std::chrono::hours(1), record(3));
+  timer_wheel.reset();
+  asio_service.Stop();
+  EXPECT_EQ(0U, expiries.Early());
+}
+
+TEST(TimerWheelTest, BEH_Cascade) {
+  // With 100 ns ticks, these timeouts are held in every level of the wheel, and the last is beyond
+  // its range altogether, so timers must be cascaded down to expire on time.
+  AsioService asio_service(2);
+  const Clock::duration kResolution(std::chrono::nanoseconds(100));
+  auto timer_wheel(TimerWheel::MakeShared(asio_service.service(), kResolution));
+  const std::vector<Clock::duration> timeouts{
+      std::chrono::microseconds(5), std::chrono::microseconds(300), std::chrono::milliseconds(5),
+      std::chrono::milliseconds(400), std::chrono::seconds(3)};
+  Expiries expiries(timeouts.size() * 2);
+  for (const auto& timeout : timeouts) {
+    timer_wheel->Arm(timeout, expiries.Handler(timeout));
+    timer_wheel->Arm(timeout + std::chrono::milliseconds(1), expiries.Handler(timeout));
+    // A timer cancelled in any level is never invoked.
+    EXPECT_TRUE(timer_wheel->Cancel(timer_wheel->Arm(timeout, expiries.Handler(timeout))));
+  }
+  ASSERT_TRUE(expiries.Wait());
+  EXPECT_EQ(0U, expiries.Early());
+  EXPECT_LT(Milliseconds(expiries.MaxLateness()), 200);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(timeouts.size() * 2, expiries.Count());
+  EXPECT_EQ(0U, timer_wheel->Count());
+  asio_service.Stop();
+}
+
+TEST(TimerWheelTest, FUNC_TenThousandPendingLaunches) {
+  // Arms the connect timeouts of 10k concurrent launches, cancels half of them as though those
+  // apps had connected, and lets the rest expire.  Arming and cancelling the same number of
+  // asio::steady_timers is timed for comparison.
+  const std::size_t kLaunchCount(10000);
+  AsioService asio_service(4);
+  auto timer_wheel(TimerWheel::MakeShared(asio_service.service(), std::chrono::milliseconds(10)));
+  Expiries expiries(kLaunchCount / 2);
+  std::atomic<std::size_t> cancelled_expiries(0);
+  std::vector<TimerWheel::Timer> timers;
+  timers.reserve(kLaunchCount);
+
+  auto start(Clock::now());
+  for (std::size_t i(0); i < kLaunchCount; ++i) {
+    const Clock::duration timeout(std::chrono::milliseconds(200 + RandomUint32() % 800));
+    if (i % 2 == 0)
+      timers.push_back(timer_wheel->Arm(timeout, expiries.Handler(timeout)));
+    else
+      timers.push_back(timer_wheel->Arm(timeout, [&] { ++cancelled_expiries; }));
+  }
+  const auto arm_time(Clock::now() - start);
+  EXPECT_EQ(kLaunchCount, timer_wheel->Count());
+  start = Clock::now();
+  for (std::size_t i(1); i < kLaunchCount; i += 2)
+    EXPECT_TRUE(timer_wheel->Cancel(timers[i]));
+  const auto cancel_time(Clock::now() - start);
+  EXPECT_EQ(kLaunchCount / 2, timer_wheel->Count());
+
+  ASSERT_TRUE(expiries.Wait());
+  EXPECT_EQ(0U, expiries.Early());
+  EXPECT_EQ(0U, cancelled_expiries);
+  EXPECT_EQ(0U, timer_wheel->Count());
+
+  std::vector<std::unique_ptr<asio::steady_timer>> asio_timers;
+  asio_timers.reserve(kLaunchCount);
+  start = Clock::now();
+  for (std::size_t i(0); i < kLaunchCount; ++i) {
+    asio_timers.emplace_back(new asio::steady_timer(
+        asio_service.service(), std::chrono::milliseconds(200 + RandomUint32() % 800)));
+    asio_timers.back()->async_wait([](const asio::error_code&) {});
+  }
+  const auto asio_arm_time(Clock::now() - start);
+  start = Clock::now();
+  for (auto& asio_timer : asio_timers)
+    asio_timer->cancel();
+  const auto asio_cancel_time(Clock::now() - start);
+  asio_service.Stop();
+
+  auto per_timer([&](Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / kLaunchCount;
+  });
+  std::cout << "Timer wheel: arm " << per_timer(arm_time) << " ns, cancel "
+            << per_timer(cancel_time) << " ns per launch; latest expiry "
+            << Milliseconds(expiries.MaxLateness()) << " ms after its deadline\n"
+            << "asio::steady_timer: arm " << per_timer(asio_arm_time) << " ns, cancel "
+            << per_timer(asio_cancel_time) << " ns per launch\n";
+}
+
+}  // namespace test
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,259 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/launcher/timer_wheel.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "asio/post.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace launcher {
+
+namespace {
+
+const std::uint64_t kSlotMask(TimerWheel::kSlotCount - 1);
+
+// The number of ticks spanned by a single slot at 'level'.
+std::uint64_t SlotSpan(std::size_t level) {
+  return std::uint64_t{1} << (TimerWheel::kSlotBits * level);
+}
+
+}  // unnamed namespace
+
+const std::size_t TimerWheel::kLevelCount;
+const std::size_t TimerWheel::kSlotBits;
+const std::size_t TimerWheel::kSlotCount;
+
+// Only accessed with the wheel's mutex held.
+struct TimerWheel::Entry {
+  Entry(std::uint64_t expiry_tick_in, Handler on_expiry_in)
+      : expiry_tick(expiry_tick_in),
+        on_expiry(std::move(on_expiry_in)),
+        armed(false),
+        level(0),
+        slot(0),
+        position() {}
+
+  std::uint64_t expiry_tick;
+  Handler on_expiry;
+  bool armed;
+  std::size_t level, slot;
+  Slot::iterator position;
+};
+
+std::shared_ptr<TimerWheel> TimerWheel::MakeShared(asio::io_service& io_service,
+                                                   Clock::duration resolution) {
+  if (resolution <= Clock::duration::zero()) {
+    LOG(kError) << "Timer wheel resolution must be positive.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  }
+  return std::shared_ptr<TimerWheel>(new TimerWheel(io_service, resolution));
+}
+
+TimerWheel::TimerWheel(asio::io_service& io_service, Clock::duration resolution)
+    : io_service_(io_service),
+      resolution_(resolution),
+      start_(Clock::now()),
+      mutex_(),
+      asio_timer_(io_service),
+      levels_(),
+      current_tick_(0),
+      scheduled_tick_(0),
+      count_(0) {}
+
+TimerWheel::~TimerWheel() {
+  // Handlers commonly hold whatever holds their Timer, so the cycles are broken here.
+  for (auto& level : levels_) {
+    for (auto& slot : level) {
+      for (const auto& timer : slot) {
+        timer->armed = false;
+        timer->on_expiry = nullptr;
+      }
+    }
+  }
+}
+
+TimerWheel::Timer TimerWheel::Arm(Clock::duration timeout, Handler on_expiry) {
+  const Clock::time_point now(Clock::now());
+  auto timer(std::make_shared<Entry>(TickAt(now + timeout), std::move(on_expiry)));
+  std::lock_guard<std::mutex> lock{mutex_};
+  // With nothing pending the wheel isn't being advanced, so it's caught up with the clock here.
+  if (count_ == 0) {
+    current_tick_ =
+        std::max(current_tick_, static_cast<std::uint64_t>((now - start_) / resolution_));
+  }
+  timer->expiry_tick = std::max(timer->expiry_tick, current_tick_ + 1);
+  Place(timer);
+  ++count_;
+  Reschedule();
+  return timer;
+}
+
+bool TimerWheel::Cancel(const Timer& timer) {
+  if (!timer)
+    return false;
+  Handler on_expiry;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (!timer->armed)
+      return false;
+    Unlink(*timer);
+    --count_;
+    on_expiry = std::move(timer->on_expiry);
+  }
+  return true;
+}
+
+std::size_t TimerWheel::CancelAll() {
+  // Declared before the lock, so that the handlers are destroyed once it's released.
+  std::vector<Handler> cancelled;
+  std::lock_guard<std::mutex> lock{mutex_};
+  for (auto& level : levels_) {
+    for (auto& slot : level) {
+      for (const auto& timer : slot) {
+        timer->armed = false;
+        cancelled.push_back(std::move(timer->on_expiry));
+      }
+      slot.clear();
+    }
+  }
+  const std::size_t count(count_);
+  count_ = 0;
+  Reschedule();
+  return count;
+}
+
+std::size_t TimerWheel::Count() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return count_;
+}
+
+std::uint64_t TimerWheel::TickAt(Clock::time_point time) const {
+  // Rounded up, so that no timer expires early.
+  const Clock::duration elapsed(std::max(time - start_, Clock::duration::zero()));
+  return static_cast<std::uint64_t>((elapsed + resolution_ - Clock::duration(1)) / resolution_);
+}
+
+void TimerWheel::Place(const Timer& timer) {
+  const std::uint64_t delta(timer->expiry_tick - current_tick_);
+  std::size_t level(0);
+  while (level + 1 < kLevelCount && delta >= SlotSpan(level + 1))
+    ++level;
+  // Beyond the top level's range, the timer is held in its furthest slot and re-placed from there.
+  const std::uint64_t tick(delta < SlotSpan(kLevelCount)
+                               ? timer->expiry_tick
+                               : current_tick_ + SlotSpan(kLevelCount) - 1);
+  timer->level = level;
+  timer->slot = static_cast<std::size_t>((tick >> (kSlotBits * level)) & kSlotMask);
+  Slot& slot(levels_[level][timer->slot]);
+  timer->position = slot.insert(slot.end(), timer);
+  timer->armed = true;
+}
+
+void TimerWheel::Unlink(Entry& entry) {
+  levels_[entry.level][entry.slot].erase(entry.position);
+  entry.armed = false;
+}
+
+std::uint64_t TimerWheel::NextTick() const {
+  // Something next happens when a timer expires from the lowest level, or an occupied slot of a
+  // higher level is cascaded, at the start of the span of ticks that slot covers.
+  std::uint64_t next_tick(std::numeric_limits<std::uint64_t>::max());
+  for (std::size_t level(0); level < kLevelCount; ++level) {
+    const std::uint64_t base(current_tick_ >> (kSlotBits * level));
+    for (std::uint64_t offset(1); offset <= kSlotCount; ++offset) {
+      if (!levels_[level][(base + offset) & kSlotMask].empty()) {
+        next_tick = std::min(next_tick, (base + offset) << (kSlotBits * level));
+        break;
+      }
+    }
+  }
+  return next_tick;
+}
+
+void TimerWheel::Advance(std::uint64_t target_tick, std::vector<Handler>& expired) {
+  while (count_ != 0) {
+    const std::uint64_t next_tick(NextTick());
+    if (next_tick > target_tick)
+      break;
+    current_tick_ = next_tick;
+    // Each time a level's index wraps, the next slot of the level above is cascaded down.
+    for (std::size_t level(1); level < kLevelCount; ++level) {
+      if ((current_tick_ & (SlotSpan(level) - 1)) != 0)
+        break;
+      Slot cascading;
+      cascading.swap(levels_[level][(current_tick_ >> (kSlotBits * level)) & kSlotMask]);
+      for (const auto& timer : cascading)
+        Place(timer);
+    }
+    Slot expiring;
+    expiring.swap(levels_[0][current_tick_ & kSlotMask]);
+    for (const auto& timer : expiring) {
+      timer->armed = false;
+      --count_;
+      expired.push_back(std::move(timer->on_expiry));
+    }
+  }
+  // No slots are occupied between here and 'target_tick'.
+  current_tick_ = std::max(current_tick_, target_tick);
+}
+
+void TimerWheel::Reschedule() {
+  if (count_ == 0) {
+    if (scheduled_tick_ != 0)
+      asio_timer_.cancel();
+    scheduled_tick_ = 0;
+    return;
+  }
+  const std::uint64_t next_tick(NextTick());
+  if (next_tick == scheduled_tick_)
+    return;
+  scheduled_tick_ = next_tick;
+  asio_timer_.expires_at(start_ + static_cast<Clock::rep>(next_tick) * resolution_);
+  std::weak_ptr<TimerWheel> weak_this(shared_from_this());
+  asio_timer_.async_wait([weak_this](const asio::error_code& error) {
+    auto timer_wheel(weak_this.lock());
+    if (timer_wheel && error != asio::error::operation_aborted)
+      timer_wheel->HandleTick();
+  });
+}
+
+void TimerWheel::HandleTick() {
+  std::vector<Handler> expired;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    scheduled_tick_ = 0;
+    Advance(static_cast<std::uint64_t>((Clock::now() - start_) / resolution_), expired);
+    Reschedule();
+  }
+  for (auto& on_expiry : expired) {
+    if (on_expiry)
+      asio::post(io_service_, std::move(on_expiry));
+  }
+}
+
+}  // namespace launcher
+
+}  // namespace maidsafe
@@ -0,0 +1,113 @@
+/*  Copyright 2015 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_LAUNCHER_TIMER_WHEEL_H_
+#define MAIDSAFE_LAUNCHER_TIMER_WHEEL_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "asio/io_service.hpp"
+#include "asio/steady_timer.hpp"
+
+namespace maidsafe {
+
+namespace launcher {
+
+// A hierarchical timer wheel, driven by a single asio::steady_timer, for timing out large numbers
+// of concurrent launches.  Arming and cancelling are O(1): timeouts are rounded up to a whole
+// number of ticks of 'resolution', and held in one of four levels of 64 slots, each level's slots
+// spanning 64 times as many ticks as the level below's.  As time passes, timers are cascaded down
+// a level at a time until they expire from the lowest.  Timeouts beyond the range of the top level
+// are held there and cascaded until they're within range.
+//
+// Expiry handlers are posted to 'io_service'.  A timer never expires before its timeout has
+// elapsed, but may expire up to one tick plus scheduling latency after.  The asio timer is only
+// armed while timers are pending, and only for the next tick at which one expires or is cascaded.
+//
+// All public functions are threadsafe.
+class TimerWheel : public std::enable_shared_from_this<TimerWheel> {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Handler = std::function<void()>;
+  struct Entry;
+  // Identifies an armed timer.  A default-constructed Timer is never armed.
+  using Timer = std::shared_ptr<Entry>;
+
+  static const std::size_t kLevelCount = 4;
+  static const std::size_t kSlotBits = 6;
+  static const std::size_t kSlotCount = 1 << kSlotBits;
+
+  static std::shared_ptr<TimerWheel> MakeShared(asio::io_service& io_service,
+                                                Clock::duration resolution);
+  ~TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+  TimerWheel& operator=(TimerWheel&&) = delete;
+
+  // Arms a timer which posts 'on_expiry' once 'timeout' has elapsed, unless cancelled first.
+  Timer Arm(Clock::duration timeout, Handler on_expiry);
+  // Returns true if 'timer' was cancelled before expiring, in which case its handler is never
+  // invoked.  Returns false if it has already expired or been cancelled, or is null.
+  bool Cancel(const Timer& timer);
+  // Cancels every armed timer, so that none of their handlers are invoked, and returns how many
+  // there were.  Handlers already posted to the io_service are unaffected.
+  std::size_t CancelAll();
+  // The number of armed timers.
+  std::size_t Count() const;
+
+ private:
+  using Slot = std::list<Timer>;
+
+  TimerWheel(asio::io_service& io_service, Clock::duration resolution);
+  std::uint64_t TickAt(Clock::time_point time) const;
+  // These must be called with 'mutex_' held.
+  std::uint64_t NextTick() const;
+  void Place(const Timer& timer);
+  void Unlink(Entry& entry);
+  void Advance(std::uint64_t target_tick, std::vector<Handler>& expired);
+  void Reschedule();
+  void HandleTick();
+
+  asio::io_service& io_service_;
+  const Clock::duration resolution_;
+  const Clock::time_point start_;
+  mutable std::mutex mutex_;
+  asio::steady_timer asio_timer_;
+  std::array<std::array<Slot, kSlotCount>, kLevelCount> levels_;
+  // All timers due at or before this tick have expired.
+  std::uint64_t current_tick_;
+  // The tick the asio timer is armed for, or 0 if it isn't armed.
+  std::uint64_t scheduled_tick_;
+  std::size_t count_;
+};
+
+}  // namespace launcher
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_LAUNCHER_TIMER_WHEEL_H_
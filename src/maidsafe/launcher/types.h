@@ -19,7 +19,9 @@
 #ifndef MAIDSAFE_LAUNCHER_TYPES_H_
 #define MAIDSAFE_LAUNCHER_TYPES_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -48,6 +50,18 @@ using Keyword = std::vector<unsigned char>;
 using Pin = std::uint32_t;
 using Password = std::vector<unsigned char>;
 
+// How a launched app performs its handshake with the Launcher.  With kSocketPair the app inherits
+// one end of a pre-connected socket pair; with kTcp it connects to the Launcher's loopback
+// listener.  TCP is used as the fallback wherever socket pairs are unavailable.
+enum class HandshakeTransport { kSocketPair, kTcp };
+
+// The size of the session public key which a launched app must send as its first handshake message.
+const std::size_t kSessionKeySize = 512;
+
+// Invoked once a launch has finished: with true if the app completed its handshake, or false if
+// the launch failed or timed out.
+using LaunchHandler = std::function<void(bool completed)>;
+
 // Once Routing and NFS are updated, this block should be reduced to just the #ifdef USE_FAKE_STORE
 // ... #else ... #endif block.  Other blocks inside ROUTING_AND_NFS_UPDATED guards should be handled
 // similarly.